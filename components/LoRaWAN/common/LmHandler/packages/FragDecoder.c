@@ -22,6 +22,7 @@
  */
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include "utilities.h"
 #include "FragDecoder.h"
 
@@ -41,6 +42,15 @@
     #define DBG( fmt, ... )
 #endif
 
+/*!
+ * Number of 32 bits words holding a bit array of the given size
+ */
+#define FRAG_BIT_WORDS( bits )                      ( ( ( uint32_t )( bits ) + 31 ) >> 5 )
+
+/*!
+ * Number of 32 bits words holding a fragment
+ */
+#define FRAG_ROW_WORDS                              ( ( FRAG_MAX_SIZE + 3 ) >> 2 )
 
 /*
  *=============================================================================
@@ -48,6 +58,12 @@
  *=============================================================================
  */
 
+/*!
+ * Bit arrays are stored in 32 bits words, bit i in word i / 32 at position
+ * i % 32. The work memory is allocated per session: FragRxBits by
+ * FragDecoderInit, the parity matrix once the first coded fragment fixes the
+ * number of lost fragments (FragNbLost).
+ */
 typedef struct
 {
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
@@ -60,10 +76,47 @@ typedef struct
     uint8_t FragSize;
 
     uint32_t M2BLine;
-    uint8_t MatrixM2B[( ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 ) * FRAG_MAX_REDUNDANCY];
-    uint16_t FragNbMissingIndex[FRAG_MAX_NB];
-
-    uint8_t S[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
+    /*!
+     * Uncoded fragments received, FragNb bits
+     */
+    uint32_t *FragRxBits;
+    /*!
+     * Upper triangular matrix, row r holds bits [r, FragNbLost) from word
+     * r / 32 onwards
+     */
+    uint32_t *MatrixM2B;
+    /*!
+     * Rows of MatrixM2B already set, FragNbLost bits
+     */
+    uint32_t *S;
+    /*!
+     * Parity row of the coded fragment being processed, FragNb bits
+     */
+    uint32_t *MatrixRow;
+    /*!
+     * Coded fragment row reduced to the lost fragments, FragNbLost bits
+     */
+    uint32_t *DataTempVector;
+    /*!
+     * Number of lost fragments before each word of FragRxBits
+     */
+    uint16_t *MissingBefore;
+    /*!
+     * Fragment index of the x th lost fragment, FragNbLost entries
+     */
+    uint16_t *MissingFrags;
+    /*!
+     * Single allocation holding the buffers above but FragRxBits
+     */
+    void *MatrixMem;
+    /*!
+     * Number of words of a FragNbLost bits array
+     */
+    uint16_t LostWords;
+    /*!
+     * Final FragDecoderProcess result, FRAG_SESSION_ONGOING until then
+     */
+    int32_t Result;
 
     FragDecoderStatus_t Status;
 }FragDecoder_t;
@@ -110,6 +163,45 @@ static void GetRow( uint8_t *src, uint16_t row, uint16_t size );
 static void GetRow( uint8_t *dst, uint8_t *src, uint16_t row, uint16_t size );
 #endif
 
+/*!
+ * \brief Allocates decoder work memory through the FragDecoderAlloc callback
+ *
+ * \param [IN] size Number of bytes to allocate
+ *
+ * \retval ptr      Allocated memory, NULL on failure
+ */
+static void* FragAlloc( size_t size );
+
+/*!
+ * \brief Releases decoder work memory through the FragDecoderFree callback
+ *
+ * \param [IN] ptr Memory to release, may be NULL
+ */
+static void FragFree( void *ptr );
+
+/*!
+ * \brief Releases all the session work memory
+ */
+static void FragFreeSessionMemory( void );
+
+/*!
+ * \brief Allocates the parity matrix for FragDecoder.Status.FragNbLost lost
+ *        fragments and builds the lost fragments index
+ *
+ * \retval status Return true on success
+ */
+static bool FragAllocMatrix( void );
+
+/*!
+ * \brief Ends the session, releases the work memory and keeps the result
+ *        returned by the next FragDecoderProcess calls
+ *
+ * \param [IN] result FragDecoderProcess result
+ *
+ * \retval result     Same as the input
+ */
+static int32_t FragSessionEnd( int32_t result );
+
 /*!
  * \brief Gets the parity value from a given row of the parity matrix
  *
@@ -118,7 +210,7 @@ static void GetRow( uint8_t *dst, uint8_t *src, uint16_t row, uint16_t size );
  *
  * \retval parity         Parity value at the given index
  */
-static uint8_t GetParity( uint16_t index, uint8_t *matrixRow  );
+static uint8_t GetParity( uint16_t index, const uint32_t *matrixRow );
 
 /*!
  * \brief Sets the parity value on the given row of the parity matrix
@@ -127,7 +219,7 @@ static uint8_t GetParity( uint16_t index, uint8_t *matrixRow  );
  * \param [IN/OUT] matrixRow Pointer to the parity matrix.
  * \param [IN]     parity    The parity value to be set in the parity matrix
  */
-static void SetParity( uint16_t index, uint8_t *matrixRow, uint8_t parity );
+static void SetParity( uint16_t index, uint32_t *matrixRow, uint8_t parity );
 
 /*!
  * \brief Check if the provided value is a power of 2
@@ -143,22 +235,23 @@ static bool IsPowerOfTwo( uint32_t x );
  *
  * \param [IN]  line1  1st Data line to be XORed
  * \param [IN]  line2  2nd Data line to be XORed
- * \param [IN]  size   Number of elements in line1
+ * \param [IN]  size   Number of bytes in line1, rounded up to whole words
  *
  * \param [OUT] result XOR( line1, line2 ) result stored in line1
  */
-static void XorDataLine( uint8_t *line1, uint8_t *line2, int32_t size );
+static void XorDataLine( uint32_t *line1, const uint32_t *line2, int32_t size );
 
 /*!
  * \brief XORs two parity lines
  *
  * \param [IN]  line1  1st Parity line to be XORed
  * \param [IN]  line2  2nd Parity line to be XORed
- * \param [IN]  size   Number of elements in line1
+ * \param [IN]  from   First word to be XORed
+ * \param [IN]  words  Number of words in line1
  *
  * \param [OUT] result XOR( line1, line2 ) result stored in line1
  */
-static void XorParityLine( uint8_t* line1, uint8_t* line2, int32_t size );
+static void XorParityLine( uint32_t *line1, const uint32_t *line2, uint16_t from, uint16_t words );
 
 /*!
  * \brief Generates a pseudo random number : PRBS23
@@ -176,7 +269,7 @@ static int32_t FragPrbs23( int32_t value );
  * \param [IN]  m         Fragment number
  * \param [OUT] matrixRow Parity matrix
  */
-static void FragGetParityMatrixRow( int32_t n, int32_t m, uint8_t *matrixRow );
+static void FragGetParityMatrixRow( int32_t n, int32_t m, uint32_t *matrixRow );
 
 /*!
  * \brief Finds the index of the first one in a bit array
@@ -185,7 +278,7 @@ static void FragGetParityMatrixRow( int32_t n, int32_t m, uint8_t *matrixRow );
  * \param [IN] size     Bit array size
  * \retval index        The index of the first 1 in the bit array
  */
-static uint16_t BitArrayFindFirstOne( uint8_t *bitArray, uint16_t size );
+static uint16_t BitArrayFindFirstOne( const uint32_t *bitArray, uint16_t size );
 
 /*!
  * \brief Checks if the provided bit array only contains zeros
@@ -194,42 +287,33 @@ static uint16_t BitArrayFindFirstOne( uint8_t *bitArray, uint16_t size );
  * \param [IN] size     Bit array size
  * \retval isAllZeros   [0: Contains ones, 1: Contains all zeros]
  */
-static uint8_t BitArrayIsAllZeros( uint8_t *bitArray, uint16_t  size );
+static uint8_t BitArrayIsAllZeros( const uint32_t *bitArray, uint16_t size );
 
 /*!
  * \brief Finds & marks missing fragments
  *
  * \param [IN]  counter Current fragment counter
- * \param [OUT] FragDecoder.FragNbMissingIndex[] array is updated in place
+ * \param [OUT] FragDecoder.Status.FragNbLost is updated in place
  */
 static void FragFindMissingFrags( uint16_t counter );
 
 /*!
- * \brief Finds the index (frag counter) of the x th missing frag
+ * \brief Gets the rank of a missing fragment among the missing fragments
  *
- * \param [IN] x   x th missing frag
+ * \param [IN] index Missing fragment index
  *
- * \retval counter The counter value associated to the x th missing frag
+ * \retval x         The missing fragment is the x th missing frag
  */
-static uint16_t FragFindMissingIndex( uint16_t x );
+static uint16_t FragGetMissingRank( uint16_t index );
 
 /*!
- * \brief Extacts a row from the binary matrix and expands it to a bitArray
+ * \brief Gets a row of the binary matrix
  *
- * \param [IN] bitArray  Pointer to the bit array
- * \param [IN] rowIndex  Matrix row index
- * \param [IN] bitsInRow Number of bits in one row
- */
-static void FragExtractLineFromBinaryMatrix( uint8_t* bitArray, uint16_t rowIndex, uint16_t bitsInRow );
-
-/*!
- * \brief Collapses and Pushs a row of a bit array to the matrix
+ * \param [IN] rowIndex Matrix row index
  *
- * \param [IN] bitArray  Pointer to the bit array
- * \param [IN] rowIndex  Matrix row index
- * \param [IN] bitsInRow Number of bits in one row
+ * \retval row          Row words, valid from word rowIndex / 32 onwards
  */
-static void FragPushLineToBinaryMatrix( uint8_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow );
+static uint32_t* FragGetBinaryMatrixRow( uint16_t rowIndex );
 
 /*
  *=============================================================================
@@ -245,6 +329,10 @@ void FragDecoderInit( uint16_t fragNb, uint8_t fragSize, FragDecoderCallbacks_t
 void FragDecoderInit( uint16_t fragNb, uint8_t fragSize, uint8_t *file, uint32_t fileSize )
 #endif
 {
+    uint8_t buffer[64];
+
+    FragFreeSessionMemory( );
+
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
     FragDecoder.Callbacks = callbacks;
 #else
@@ -255,46 +343,48 @@ void FragDecoderInit( uint16_t fragNb, uint8_t fragSize, uint8_t *file, uint32_t
     FragDecoder.FragSize = fragSize;                            // number of byte on a row
     FragDecoder.Status.FragNbLastRx = 0;
     FragDecoder.Status.FragNbLost = 0;
+    FragDecoder.Status.MatrixError = 0;
     FragDecoder.M2BLine = 0;
+    FragDecoder.LostWords = 0;
+    FragDecoder.Result = FRAG_SESSION_ONGOING;
 
-    // Initialize missing fragments index array
-    for( uint16_t i = 0; i < FRAG_MAX_NB; i++ )
+    // Initialize received fragments bit array
+    FragDecoder.FragRxBits = FragAlloc( FRAG_BIT_WORDS( fragNb ) * sizeof( uint32_t ) );
+    if( FragDecoder.FragRxBits == NULL )
     {
-        FragDecoder.FragNbMissingIndex[i] = 1;
+        FragDecoder.Status.MatrixError = 1;
+        FragSessionEnd( FRAG_SESSION_FINISHED );
     }
-
-    // Initialize parity matrix
-    for( uint32_t i = 0; i < ( ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 ); i++ )
+    else
     {
-        FragDecoder.S[i] = 0;
+        memset1( ( uint8_t* )FragDecoder.FragRxBits, 0, FRAG_BIT_WORDS( fragNb ) * sizeof( uint32_t ) );
     }
 
-    for( uint32_t i = 0; i < ( ( ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 ) * FRAG_MAX_REDUNDANCY ); i++ )
-    {
-       FragDecoder.MatrixM2B[i] = 0xFF;
-    }
-    
     // Initialize final uncoded data buffer ( FRAG_MAX_NB * FRAG_MAX_SIZE )
-    for( uint32_t i = 0; i < ( fragNb * fragSize ); i++ )
+    memset1( buffer, 0xFF, sizeof( buffer ) );
+    for( uint32_t i = 0; i < ( ( uint32_t )fragNb * fragSize ); i += sizeof( buffer ) )
     {
+        uint32_t size = ( ( uint32_t )fragNb * fragSize ) - i;
+
+        if( size > sizeof( buffer ) )
+        {
+            size = sizeof( buffer );
+        }
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
         if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderWrite != NULL ) )
         {
-            uint8_t buffer[1] = { 0xFF };
-            FragDecoder.Callbacks->FragDecoderWrite( i, buffer, 1 );
+            FragDecoder.Callbacks->FragDecoderWrite( i, buffer, size );
         }
 #else
-        FragDecoder.File[i] = 0xFF;
+        memcpy1( &FragDecoder.File[i], buffer, size );
 #endif
     }
-    FragDecoder.Status.FragNbLost = 0;
-    FragDecoder.Status.FragNbLastRx = 0;
 }
 
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
 uint32_t FragDecoderGetMaxFileSize( void )
 {
-    return FRAG_MAX_NB * FRAG_MAX_SIZE;
+    return ( uint32_t )FRAG_MAX_NB * FRAG_MAX_SIZE;
 }
 #endif
 
@@ -304,18 +394,17 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
     int32_t first = 0;
     int32_t noInfo = 0;
 
-    uint8_t matrixRow[(FRAG_MAX_NB >> 3 ) + 1];
-    uint8_t matrixDataTemp[FRAG_MAX_SIZE];
-    uint8_t dataTempVector[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
-    uint8_t dataTempVector2[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
-
-    memset1( matrixRow, 0, ( FRAG_MAX_NB >> 3 ) + 1 );
-    memset1( matrixDataTemp, 0, FRAG_MAX_SIZE );
-    memset1( dataTempVector, 0, ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 );
-    memset1( dataTempVector2, 0, ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 );
+    // Word aligned copies of the fragment data
+    uint32_t matrixData[FRAG_ROW_WORDS];
+    uint32_t matrixDataTemp[FRAG_ROW_WORDS];
 
     FragDecoder.Status.FragNbRx = fragCounter;
 
+    if( FragDecoder.Result != FRAG_SESSION_ONGOING )
+    {
+        return FragDecoder.Result;
+    }
+
     if( fragCounter < FragDecoder.Status.FragNbLastRx )
     {
         return FRAG_SESSION_ONGOING;  // Drop frame out of order
@@ -332,15 +421,15 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
         SetRow( FragDecoder.File, rawData, fragCounter - 1, FragDecoder.FragSize );
 #endif
 
-        FragDecoder.FragNbMissingIndex[fragCounter - 1] = 0;
+        SetParity( fragCounter - 1, FragDecoder.FragRxBits, 1 );
 
-        // Update the FragDecoder.FragNbMissingIndex with the loosing frame
+        // Update the FragDecoder.FragNbLost with the loosing frame
         FragFindMissingFrags( fragCounter );
 
         if( ( FragDecoder.Status.FragNbLost == 0 ) && ( fragCounter == FragDecoder.FragNb ) )
-        { 
+        {
             // the case : all the M(FragNb) first rows have been transmitted with no error
-            return FragDecoder.Status.FragNbLost;
+            return FragSessionEnd( FragDecoder.Status.FragNbLost );
         }
     }
     else
@@ -348,7 +437,7 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
         if( FragDecoder.Status.FragNbLost > FRAG_MAX_REDUNDANCY )
         {
            FragDecoder.Status.MatrixError = 1;
-           return FRAG_SESSION_FINISHED;
+           return FragSessionEnd( FRAG_SESSION_FINISHED );
         }
         // At this point we receive encoded frames and the number of loosing frames
         // is well known: FragDecoder.FragNbLost - 1;
@@ -356,124 +445,144 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
         // In case of the end of true data is missing
         FragFindMissingFrags( fragCounter );
 
+        if( FragDecoder.MatrixMem == NULL )
+        {
+            if( FragDecoder.Status.FragNbLost == 0 )
+            {
+                return FRAG_SESSION_ONGOING;
+            }
+            if( ( FragDecoder.Status.FragNbLost > FRAG_MAX_REDUNDANCY ) || ( FragAllocMatrix( ) == false ) )
+            {
+                FragDecoder.Status.MatrixError = 1;
+                return FragSessionEnd( FRAG_SESSION_FINISHED );
+            }
+        }
+
+        memcpy1( ( uint8_t* )matrixData, rawData, FragDecoder.FragSize );
+        memset1( ( uint8_t* )FragDecoder.DataTempVector, 0, FragDecoder.LostWords * sizeof( uint32_t ) );
+
         // fragCounter - FragDecoder.FragNb
-        FragGetParityMatrixRow( fragCounter - FragDecoder.FragNb, FragDecoder.FragNb, matrixRow );
+        FragGetParityMatrixRow( fragCounter - FragDecoder.FragNb, FragDecoder.FragNb, FragDecoder.MatrixRow );
 
-        for( int32_t i = 0; i < FragDecoder.FragNb; i++ )
+        for( uint16_t w = 0; w < FRAG_BIT_WORDS( FragDecoder.FragNb ); w++ )
         {
-            if( GetParity( i , matrixRow ) == 1 )
+            uint32_t received = FragDecoder.MatrixRow[w] & FragDecoder.FragRxBits[w];
+            uint32_t missing = FragDecoder.MatrixRow[w] & ~FragDecoder.FragRxBits[w];
+
+            // XOR with already receive frags
+            while( received != 0 )
             {
-                if( FragDecoder.FragNbMissingIndex[i] == 0 )
-                {
-                    // XOR with already receive frag
-                    SetParity( i, matrixRow, 0 );
+                uint16_t i = ( w << 5 ) + __builtin_ctz( received );
+
+                received &= received - 1;
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                    GetRow( matrixDataTemp, i, FragDecoder.FragSize );
+                GetRow( ( uint8_t* )matrixDataTemp, i, FragDecoder.FragSize );
 #else
-                    GetRow( matrixDataTemp, FragDecoder.File, i, FragDecoder.FragSize );
+                GetRow( ( uint8_t* )matrixDataTemp, FragDecoder.File, i, FragDecoder.FragSize );
 #endif
-                    XorDataLine( rawData, matrixDataTemp, FragDecoder.FragSize );
-                }
-                else
-                {
-                    // Fill the "little" boolean matrix m2b
-                    SetParity( FragDecoder.FragNbMissingIndex[i] - 1, dataTempVector, 1 );
-                    if( first == 0 )
-                    {
-                        first = 1;
-                    }
-                }
+                XorDataLine( matrixData, matrixDataTemp, FragDecoder.FragSize );
+            }
+            // Fill the "little" boolean matrix m2b
+            while( missing != 0 )
+            {
+                uint16_t i = ( w << 5 ) + __builtin_ctz( missing );
+
+                missing &= missing - 1;
+                SetParity( FragGetMissingRank( i ), FragDecoder.DataTempVector, 1 );
+                first = 1;
             }
         }
 
-        firstOneInRow = BitArrayFindFirstOne( dataTempVector, FragDecoder.Status.FragNbLost );
+        firstOneInRow = BitArrayFindFirstOne( FragDecoder.DataTempVector, FragDecoder.Status.FragNbLost );
 
         if( first > 0 )
         {
-            int32_t li;
-            int32_t lj;
+            uint16_t li;
 
             // Manage a new line in MatrixM2B
             while( GetParity( firstOneInRow, FragDecoder.S ) == 1 )
-            { 
+            {
                 // Row already diagonalized exist & ( FragDecoder.MatrixM2B[firstOneInRow][0] )
-                FragExtractLineFromBinaryMatrix( dataTempVector2, firstOneInRow, FragDecoder.Status.FragNbLost );
-                XorParityLine( dataTempVector, dataTempVector2, FragDecoder.Status.FragNbLost );
+                XorParityLine( FragDecoder.DataTempVector, FragGetBinaryMatrixRow( firstOneInRow ),
+                               firstOneInRow >> 5, FragDecoder.LostWords );
                 // Have to store it in the mi th position of the missing frag
-                li = FragFindMissingIndex( firstOneInRow );
+                li = FragDecoder.MissingFrags[firstOneInRow];
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                GetRow( matrixDataTemp, li, FragDecoder.FragSize );
+                GetRow( ( uint8_t* )matrixDataTemp, li, FragDecoder.FragSize );
 #else
-                GetRow( matrixDataTemp, FragDecoder.File, li, FragDecoder.FragSize );
+                GetRow( ( uint8_t* )matrixDataTemp, FragDecoder.File, li, FragDecoder.FragSize );
 #endif
-                XorDataLine( rawData, matrixDataTemp, FragDecoder.FragSize );
-                if( BitArrayIsAllZeros( dataTempVector, FragDecoder.Status.FragNbLost ) )
+                XorDataLine( matrixData, matrixDataTemp, FragDecoder.FragSize );
+                if( BitArrayIsAllZeros( FragDecoder.DataTempVector, FragDecoder.Status.FragNbLost ) )
                 {
                     noInfo = 1;
                     break;
                 }
-                firstOneInRow = BitArrayFindFirstOne( dataTempVector, FragDecoder.Status.FragNbLost );
+                firstOneInRow = BitArrayFindFirstOne( FragDecoder.DataTempVector, FragDecoder.Status.FragNbLost );
             }
 
             if( noInfo == 0 )
             {
-                FragPushLineToBinaryMatrix( dataTempVector, firstOneInRow, FragDecoder.Status.FragNbLost );
-                li = FragFindMissingIndex( firstOneInRow );
+                uint32_t *row = FragGetBinaryMatrixRow( firstOneInRow );
+
+                // Collapse the row to its upper triangular part
+                for( uint16_t w = firstOneInRow >> 5; w < FragDecoder.LostWords; w++ )
+                {
+                    row[w] = FragDecoder.DataTempVector[w];
+                }
+                li = FragDecoder.MissingFrags[firstOneInRow];
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                SetRow( rawData, li, FragDecoder.FragSize );
+                SetRow( ( uint8_t* )matrixData, li, FragDecoder.FragSize );
 #else
-                SetRow( FragDecoder.File, rawData, li, FragDecoder.FragSize );
+                SetRow( FragDecoder.File, ( uint8_t* )matrixData, li, FragDecoder.FragSize );
 #endif
                 SetParity( firstOneInRow, FragDecoder.S, 1 );
                 FragDecoder.M2BLine++;
             }
 
             if( FragDecoder.M2BLine == FragDecoder.Status.FragNbLost )
-            { 
-                // Then last step diagonalized
-                if( FragDecoder.Status.FragNbLost > 1 )
+            {
+                // Then last step diagonalized, the rows below i are already
+                // solved: XOR them into row i where it has a one
+                for( int32_t i = ( FragDecoder.Status.FragNbLost - 2 ); i >= 0 ; i-- )
                 {
-                    int32_t i, j;
+                    uint32_t *row = FragGetBinaryMatrixRow( i );
 
-                    for( i = ( FragDecoder.Status.FragNbLost - 2 ); i >= 0 ; i-- )
-                    {
-                        li = FragFindMissingIndex( i );
+                    li = FragDecoder.MissingFrags[i];
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                        GetRow( matrixDataTemp, li, FragDecoder.FragSize );
+                    GetRow( ( uint8_t* )matrixDataTemp, li, FragDecoder.FragSize );
 #else
-                        GetRow( matrixDataTemp, FragDecoder.File, li, FragDecoder.FragSize );
+                    GetRow( ( uint8_t* )matrixDataTemp, FragDecoder.File, li, FragDecoder.FragSize );
 #endif
-                        for( j = ( FragDecoder.Status.FragNbLost - 1 ); j > i; j--)
-                        {
-                            FragExtractLineFromBinaryMatrix( dataTempVector2, i, FragDecoder.Status.FragNbLost );
-                            FragExtractLineFromBinaryMatrix( dataTempVector, j, FragDecoder.Status.FragNbLost );
-                            if( GetParity( j, dataTempVector2 ) == 1 )
-                            {
-                                XorParityLine( dataTempVector2, dataTempVector, FragDecoder.Status.FragNbLost );
+                    for( uint16_t w = i >> 5; w < FragDecoder.LostWords; w++ )
+                    {
+                        uint32_t bits = row[w];
 
-                                lj = FragFindMissingIndex( j );
+                        if( w == ( i >> 5 ) )
+                        {
+                            // Drop the diagonal
+                            bits &= ~( ( 2UL << ( i & 31 ) ) - 1 );
+                        }
+                        while( bits != 0 )
+                        {
+                            uint16_t j = ( w << 5 ) + __builtin_ctz( bits );
 
+                            bits &= bits - 1;
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                                GetRow( rawData, lj, FragDecoder.FragSize );
+                            GetRow( ( uint8_t* )matrixData, FragDecoder.MissingFrags[j], FragDecoder.FragSize );
 #else
-                                GetRow( rawData, FragDecoder.File, lj, FragDecoder.FragSize );
+                            GetRow( ( uint8_t* )matrixData, FragDecoder.File, FragDecoder.MissingFrags[j], FragDecoder.FragSize );
 #endif
-                                XorDataLine( matrixDataTemp , rawData , FragDecoder.FragSize );
-                            }
+                            XorDataLine( matrixDataTemp, matrixData, FragDecoder.FragSize );
                         }
+                    }
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                        SetRow( matrixDataTemp, li, FragDecoder.FragSize );
+                    SetRow( ( uint8_t* )matrixDataTemp, li, FragDecoder.FragSize );
 #else
-                        SetRow( FragDecoder.File, matrixDataTemp, li, FragDecoder.FragSize );
+                    SetRow( FragDecoder.File, ( uint8_t* )matrixDataTemp, li, FragDecoder.FragSize );
 #endif
-                    }
-                    return FragDecoder.Status.FragNbLost;
-                }
-                else
-                { 
-                    //If not ( FragDecoder.FragNbLost > 1 )
-                    return FragDecoder.Status.FragNbLost;
                 }
+                return FragSessionEnd( FragDecoder.Status.FragNbLost );
             }
         }
     }
@@ -481,7 +590,7 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
 }
 
 FragDecoderStatus_t FragDecoderGetStatus( void )
-{ 
+{
     return FragDecoder.Status;
 }
 
@@ -496,7 +605,7 @@ static void SetRow( uint8_t *src, uint16_t row, uint16_t size )
 {
     if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderWrite != NULL ) )
     {
-        FragDecoder.Callbacks->FragDecoderWrite( row * size, src, size );
+        FragDecoder.Callbacks->FragDecoderWrite( ( uint32_t )row * size, src, size );
     }
 }
 
@@ -504,64 +613,156 @@ static void GetRow( uint8_t *dst, uint16_t row, uint16_t size )
 {
     if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderRead != NULL ) )
     {
-        FragDecoder.Callbacks->FragDecoderRead( row * size, dst, size );
+        FragDecoder.Callbacks->FragDecoderRead( ( uint32_t )row * size, dst, size );
     }
 }
 #else
 static void SetRow( uint8_t *dst, uint8_t *src, uint16_t row, uint16_t size )
 {
-    memcpy1( &dst[row * size], src, size );
+    memcpy1( &dst[( uint32_t )row * size], src, size );
 }
 
 static void GetRow( uint8_t *dst, uint8_t *src, uint16_t row, uint16_t size )
 {
-    memcpy1( dst, &src[row * size], size );
+    memcpy1( dst, &src[( uint32_t )row * size], size );
 }
 #endif
 
-static uint8_t GetParity( uint16_t index, uint8_t *matrixRow  )
+static void* FragAlloc( size_t size )
+{
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+    if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderAlloc != NULL ) )
+    {
+        return FragDecoder.Callbacks->FragDecoderAlloc( size );
+    }
+#endif
+    return malloc( size );
+}
+
+static void FragFree( void *ptr )
+{
+    if( ptr == NULL )
+    {
+        return;
+    }
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+    if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderFree != NULL ) )
+    {
+        FragDecoder.Callbacks->FragDecoderFree( ptr );
+        return;
+    }
+#endif
+    free( ptr );
+}
+
+static void FragFreeSessionMemory( void )
 {
-    uint8_t parity;
-    parity = matrixRow[index >> 3];
-    parity = ( parity >> ( 7 - ( index % 8 ) ) ) & 0x01;
-    return parity;
+    FragFree( FragDecoder.MatrixMem );
+    FragFree( FragDecoder.FragRxBits );
+    FragDecoder.MatrixMem = NULL;
+    FragDecoder.FragRxBits = NULL;
+    FragDecoder.MatrixM2B = NULL;
+    FragDecoder.S = NULL;
+    FragDecoder.MatrixRow = NULL;
+    FragDecoder.DataTempVector = NULL;
+    FragDecoder.MissingBefore = NULL;
+    FragDecoder.MissingFrags = NULL;
+}
+
+static bool FragAllocMatrix( void )
+{
+    uint16_t lost = FragDecoder.Status.FragNbLost;
+    uint32_t lostWords = FRAG_BIT_WORDS( lost );
+    uint32_t fragWords = FRAG_BIT_WORDS( FragDecoder.FragNb );
+    uint32_t q = lost >> 5;
+    // Row r is ( lostWords - r / 32 ) words long
+    uint32_t m2bWords = lost * lostWords - ( ( 32 * q * ( q - 1 ) ) / 2 + q * ( lost & 31 ) );
+    uint32_t words = m2bWords + 2 * lostWords + fragWords;
+    uint32_t size = words * sizeof( uint32_t ) + ( fragWords + lost ) * sizeof( uint16_t );
+    uint16_t x = 0;
+
+    FragDecoder.MatrixMem = FragAlloc( size );
+    if( FragDecoder.MatrixMem == NULL )
+    {
+        return false;
+    }
+    memset1( ( uint8_t* )FragDecoder.MatrixMem, 0, size );
+
+    FragDecoder.LostWords = lostWords;
+    FragDecoder.MatrixM2B = ( uint32_t* )FragDecoder.MatrixMem;
+    FragDecoder.S = FragDecoder.MatrixM2B + m2bWords;
+    FragDecoder.DataTempVector = FragDecoder.S + lostWords;
+    FragDecoder.MatrixRow = FragDecoder.DataTempVector + lostWords;
+    FragDecoder.MissingBefore = ( uint16_t* )( FragDecoder.MatrixRow + fragWords );
+    FragDecoder.MissingFrags = FragDecoder.MissingBefore + fragWords;
+
+    // Every uncoded fragment is either received or lost at this point
+    for( uint16_t w = 0; w < fragWords; w++ )
+    {
+        uint32_t missing = ~FragDecoder.FragRxBits[w];
+
+        if( ( ( w + 1 ) << 5 ) > FragDecoder.FragNb )
+        {
+            missing &= ( 1UL << ( FragDecoder.FragNb & 31 ) ) - 1;
+        }
+        FragDecoder.MissingBefore[w] = x;
+        while( ( missing != 0 ) && ( x < lost ) )
+        {
+            FragDecoder.MissingFrags[x++] = ( w << 5 ) + __builtin_ctz( missing );
+            missing &= missing - 1;
+        }
+        if( missing != 0 )
+        {
+            return false;
+        }
+    }
+    return x == lost;
 }
 
-static void SetParity( uint16_t index, uint8_t *matrixRow, uint8_t parity )
+static int32_t FragSessionEnd( int32_t result )
 {
-    uint8_t mask = 0xFF - ( 1 << ( 7 - ( index % 8 ) ) );
-    parity = parity << ( 7 - ( index % 8 ) );
-    matrixRow[index >> 3] = ( matrixRow[index >> 3] & mask ) + parity;
+    FragFreeSessionMemory( );
+    FragDecoder.Result = result;
+    return result;
 }
 
-static bool IsPowerOfTwo( uint32_t x )
+static uint8_t GetParity( uint16_t index, const uint32_t *matrixRow )
 {
-    uint8_t sumBit = 0;
+    return ( matrixRow[index >> 5] >> ( index & 31 ) ) & 0x01;
+}
+
+static void SetParity( uint16_t index, uint32_t *matrixRow, uint8_t parity )
+{
+    uint32_t mask = 1UL << ( index & 31 );
 
-    for( uint8_t i = 0; i < 32; i++ )
+    if( parity != 0 )
     {
-        sumBit += ( x & ( 1 << i ) ) >> i;
+        matrixRow[index >> 5] |= mask;
     }
-    if( sumBit == 1 )
+    else
     {
-        return true;
+        matrixRow[index >> 5] &= ~mask;
     }
-    return false;
 }
 
-static void XorDataLine( uint8_t *line1, uint8_t *line2, int32_t size )
+static bool IsPowerOfTwo( uint32_t x )
 {
-    for( int32_t i = 0; i < size; i++ )
+    return ( x != 0 ) && ( ( x & ( x - 1 ) ) == 0 );
+}
+
+static void XorDataLine( uint32_t *line1, const uint32_t *line2, int32_t size )
+{
+    for( int32_t i = 0; i < ( ( size + 3 ) >> 2 ); i++ )
     {
-        line1[i] = line1[i] ^ line2[i];
+        line1[i] ^= line2[i];
     }
 }
 
-static void XorParityLine( uint8_t* line1, uint8_t* line2, int32_t size )
+static void XorParityLine( uint32_t *line1, const uint32_t *line2, uint16_t from, uint16_t words )
 {
-    for( int32_t i = 0; i < size; i++ )
+    for( uint16_t i = from; i < words; i++ )
     {
-        SetParity( i, line1, ( GetParity( i, line1 ) ^ GetParity( i, line2 ) ) );
+        line1[i] ^= line2[i];
     }
 }
 
@@ -572,7 +773,7 @@ static int32_t FragPrbs23( int32_t value )
     return ( value >> 1 ) + ( ( b0 ^ b1 ) << 22 );
 }
 
-static void FragGetParityMatrixRow( int32_t n, int32_t m, uint8_t *matrixRow )
+static void FragGetParityMatrixRow( int32_t n, int32_t m, uint32_t *matrixRow )
 {
     int32_t mTemp;
     int32_t x;
@@ -583,16 +784,13 @@ static void FragGetParityMatrixRow( int32_t n, int32_t m, uint8_t *matrixRow )
     {
         mTemp = 1;
     }
-    else 
+    else
     {
         mTemp = 0;
     }
 
     x = 1 + ( 1001 * n );
-    for( int32_t i = 0; i < ( ( m >> 3 ) + 1 ); i++ )
-    {
-        matrixRow[i] = 0;
-    }
+    memset1( ( uint8_t* )matrixRow, 0, FRAG_BIT_WORDS( m ) * sizeof( uint32_t ) );
     while( nbCoeff < ( m >> 1 ) )
     {
         r = 1 << 16;
@@ -606,23 +804,23 @@ static void FragGetParityMatrixRow( int32_t n, int32_t m, uint8_t *matrixRow )
     }
 }
 
-static uint16_t BitArrayFindFirstOne( uint8_t *bitArray, uint16_t size )
+static uint16_t BitArrayFindFirstOne( const uint32_t *bitArray, uint16_t size )
 {
-    for( uint16_t i = 0; i < size; i++)
+    for( uint16_t w = 0; w < FRAG_BIT_WORDS( size ); w++ )
     {
-        if ( GetParity( i, bitArray ) == 1 )
+        if( bitArray[w] != 0 )
         {
-            return i;
+            return ( w << 5 ) + __builtin_ctz( bitArray[w] );
         }
     }
     return 0;
 }
 
-static uint8_t BitArrayIsAllZeros( uint8_t *bitArray, uint16_t  size )
+static uint8_t BitArrayIsAllZeros( const uint32_t *bitArray, uint16_t size )
 {
-    for( uint16_t i = 0; i < size; i++ )
+    for( uint16_t w = 0; w < FRAG_BIT_WORDS( size ); w++ )
     {
-        if( GetParity( i, bitArray ) == 1 )
+        if( bitArray[w] != 0 )
         {
             return 0;
         }
@@ -634,18 +832,23 @@ static uint8_t BitArrayIsAllZeros( uint8_t *bitArray, uint16_t  size )
  * \brief Finds & marks missing fragments
  *
  * \param [IN]  counter Current fragment counter
- * \param [OUT] FragDecoder.FragNbMissingIndex[] array is updated in place
+ * \param [OUT] FragDecoder.Status.FragNbLost is updated in place
  */
 static void FragFindMissingFrags( uint16_t counter )
 {
-    int32_t i;
-    for( i = FragDecoder.Status.FragNbLastRx; i < ( counter - 1 ); i++ )
+    int32_t i = FragDecoder.Status.FragNbLastRx;
+
+    // Fragments [FragNbLastRx, counter - 1) were skipped, their FragRxBits
+    // bit stays 0
+    if( i < ( counter - 1 ) )
     {
-        if( i < FragDecoder.FragNb )
+        int32_t end = ( ( counter - 1 ) < FragDecoder.FragNb ) ? ( counter - 1 ) : FragDecoder.FragNb;
+
+        if( end > i )
         {
-            FragDecoder.Status.FragNbLost++;
-            FragDecoder.FragNbMissingIndex[i] = FragDecoder.Status.FragNbLost;
+            FragDecoder.Status.FragNbLost += end - i;
         }
+        i = counter - 1;
     }
     if( i < FragDecoder.FragNb )
     {
@@ -661,91 +864,31 @@ static void FragFindMissingFrags( uint16_t counter )
 }
 
 /*!
- * \brief Finds the index (frag counter) of the x th missing frag
- *
- * \param [IN] x   x th missing frag
+ * \brief Gets the rank of a missing fragment among the missing fragments
  *
- * \retval counter The counter value associated to the x th missing frag
- */
-static uint16_t FragFindMissingIndex( uint16_t x )
-{
-    for( uint16_t i = 0; i < FragDecoder.FragNb; i++ )
-    {
-        if( FragDecoder.FragNbMissingIndex[i] == ( x + 1 ) )
-        {
-            return i;
-        }
-    }
-    return 0;
-}
-
-/*!
- * \brief Extacts a row from the binary matrix and expands it to a bitArray
+ * \param [IN] index Missing fragment index
  *
- * \param [IN] bitArray  Pointer to the bit array
- * \param [IN] rowIndex  Matrix row index
- * \param [IN] bitsInRow Number of bits in one row
+ * \retval x         The missing fragment is the x th missing frag
  */
-static void FragExtractLineFromBinaryMatrix( uint8_t* bitArray, uint16_t rowIndex, uint16_t bitsInRow )
+static uint16_t FragGetMissingRank( uint16_t index )
 {
-    uint32_t findByte = 0;
-    uint32_t findBitInByte = 0;
+    uint32_t missing = ~FragDecoder.FragRxBits[index >> 5] & ( ( 1UL << ( index & 31 ) ) - 1 );
 
-    if( rowIndex > 0 )
-    {
-        findByte      = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) >> 3;
-        findBitInByte = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) % 8;
-    }
-    if( rowIndex > 0 )
-    {
-        for( uint16_t i = 0; i < rowIndex; i++ )
-        {
-            SetParity( i, bitArray, 0 );
-        }
-    }
-    for( uint16_t i = rowIndex; i < bitsInRow; i++ )
-    {
-        SetParity( i,
-                   bitArray, 
-                   ( FragDecoder.MatrixM2B[findByte] >> ( 7 - findBitInByte ) ) & 0x01 );
-
-        findBitInByte++;
-        if( findBitInByte == 8 )
-        {
-            findBitInByte = 0;
-            findByte++;
-        }
-    }
+    return FragDecoder.MissingBefore[index >> 5] + __builtin_popcount( missing );
 }
 
 /*!
- * \brief Collapses and Pushs a row of a bit array to the matrix
+ * \brief Gets a row of the binary matrix
+ *
+ * \param [IN] rowIndex Matrix row index
  *
- * \param [IN] bitArray  Pointer to the bit array
- * \param [IN] rowIndex  Matrix row index
- * \param [IN] bitsInRow Number of bits in one row
+ * \retval row          Row words, valid from word rowIndex / 32 onwards
  */
-static void FragPushLineToBinaryMatrix( uint8_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow )
+static uint32_t* FragGetBinaryMatrixRow( uint16_t rowIndex )
 {
-    uint32_t findByte = 0;
-    uint32_t findBitInByte = 0;
+    uint32_t q = rowIndex >> 5;
+    // Sum of the lengths of the rows above, ( LostWords - r / 32 ) each
+    uint32_t offset = ( uint32_t )rowIndex * FragDecoder.LostWords - ( ( 32 * q * ( q - 1 ) ) / 2 + q * ( rowIndex & 31 ) );
 
-    if ( rowIndex > 0) {
-        findByte      = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) >> 3;
-        findBitInByte = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) % 8;
-
-    }
-    for( uint16_t i = rowIndex; i < bitsInRow; i++ )
-    {
-        if( GetParity( i, bitArray ) == 0 )
-        {
-            FragDecoder.MatrixM2B[findByte] = FragDecoder.MatrixM2B[findByte] & ( 0xFF - ( 1 << ( 7 - findBitInByte ) ) );
-        }
-        findBitInByte++;
-        if( findBitInByte == 8 )
-        {
-            findBitInByte = 0;
-            findByte++;
-        }
-    }
+    return &FragDecoder.MatrixM2B[offset - q];
 }
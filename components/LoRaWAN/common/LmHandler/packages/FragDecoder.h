@@ -27,7 +27,9 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
+#include "sdkconfig.h"
 
 /*!
  * If set to 1 the new API defining \ref FragDecoderWrite and
@@ -38,23 +40,37 @@ extern "C" {
 /*!
  * Maximum number of fragment that can be handled.
  *
- * \remark This parameter has an impact on the memory footprint.
+ * \remark The decoder allocates FRAG_MAX_NB / 8 bytes when a session starts.
  */
+#if defined( CONFIG_LORAWAN_FRAG_MAX_NB )
+#define FRAG_MAX_NB                                 CONFIG_LORAWAN_FRAG_MAX_NB
+#else
 #define FRAG_MAX_NB                                 21
+#endif
 
 /*!
  * Maximum fragment size that can be handled.
  *
- * \remark This parameter has an impact on the memory footprint.
+ * \remark Two rows of this size are kept on the stack of FragDecoderProcess.
  */
+#if defined( CONFIG_LORAWAN_FRAG_MAX_SIZE )
+#define FRAG_MAX_SIZE                               CONFIG_LORAWAN_FRAG_MAX_SIZE
+#else
 #define FRAG_MAX_SIZE                               50
+#endif
 
 /*!
- * Maximum number of extra frames that can be handled.
+ * Maximum number of lost fragments that can be recovered.
  *
- * \remark This parameter has an impact on the memory footprint.
+ * \remark The parity matrix is allocated for the actual number of lost
+ *         fragments L once the first coded fragment arrives, about
+ *         L * L / 16 + FRAG_MAX_NB / 4 bytes.
  */
+#if defined( CONFIG_LORAWAN_FRAG_MAX_REDUNDANCY )
+#define FRAG_MAX_REDUNDANCY                         CONFIG_LORAWAN_FRAG_MAX_REDUNDANCY
+#else
 #define FRAG_MAX_REDUNDANCY                         5
+#endif
 
 #define FRAG_SESSION_FINISHED                       ( int32_t )0
 #define FRAG_SESSION_NOT_STARTED                    ( int32_t )-2
@@ -91,6 +107,23 @@ typedef struct sFragDecoderCallbacks
      * \retval status Read operation status [0: Success, -1 Fail]
      */
     int8_t ( *FragDecoderRead )( uint32_t addr, uint8_t *data, uint32_t size );
+    /*!
+     * Allocates decoder work memory (received fragments, parity matrix),
+     * e.g. heap_caps_malloc( size, MALLOC_CAP_SPIRAM ). Optional, malloc is
+     * used when NULL.
+     *
+     * \param [IN] size Number of bytes to allocate.
+     *
+     * \retval ptr Allocated memory, 32 bits aligned, NULL on failure
+     */
+    void* ( *FragDecoderAlloc )( size_t size );
+    /*!
+     * Releases memory obtained from FragDecoderAlloc. Optional, free is used
+     * when NULL.
+     *
+     * \param [IN] ptr Memory to release.
+     */
+    void ( *FragDecoderFree )( void *ptr );
 }FragDecoderCallbacks_t;
 #endif
 
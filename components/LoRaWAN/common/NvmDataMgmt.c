@@ -31,12 +31,16 @@
  * \author    Johannes Bruder ( STACKFORCE )
  */
 
+
 #include <stdio.h>
+#include <stddef.h>
 #include "utilities.h"
 #include "LoRaMac.h"
 #include "NvmDataMgmt.h"
 #include "nvs_flash.h"
+#include "esp_partition.h"
 #include "esp_log.h"
+#include "sdkconfig.h"
 #include <string.h>
 /*!
  * Enables/Disables the context storage management storage.
@@ -56,8 +60,137 @@
 #define  NVS_DATA_REGION2_KEY    "LM_Region2"
 #define  NVS_DATA_CLASSB_KEY     "LM_Classb"
 
+/*!
+ * Log-structured context storage. When disabled, or when the partition is
+ * missing from the table, the contexts are kept as NVS blobs.
+ */
+#if defined( CONFIG_LORAWAN_NVM_LOG )
+#define NVM_LOG_ENABLED                    1
+#define NVM_LOG_PARTITION                  CONFIG_LORAWAN_NVM_LOG_PARTITION
+#else
+#define NVM_LOG_ENABLED                    0
+#define NVM_LOG_PARTITION                  "lorawan"
+#endif
+
+#define NVM_LOG_SECTOR_SIZE                4096
+#define NVM_LOG_MAGIC                      0x474C564E
+#define NVM_LOG_RECORD_SNAPSHOT            0x01
+#define NVM_LOG_RECORD_DELTA               0x02
+#define NVM_LOG_RECORD_ERASED              0xFF
+#define NVM_LOG_GROUP_NB                   7
+#define NVM_LOG_GROUP_ALL                  ( ( 1 << NVM_LOG_GROUP_NB ) - 1 )
+/*!
+ * Changed byte runs closer than this are merged, a run header costs 4 bytes
+ */
+#define NVM_LOG_RUN_GAP                    4
+#define NVM_LOG_ALIGN( x )                 ( ( ( x ) + 3 ) & ~3 )
+
+/*!
+ * Bank header. It is written after the snapshots that start the bank, so a
+ * bank with a valid header always holds every context.
+ */
+typedef struct sNvmLogBank
+{
+    uint32_t Magic;
+    uint32_t Seq;
+    uint32_t Crc32;
+}NvmLogBank_t;
+
+/*!
+ * Record header, followed by Length bytes of payload and padded to 4 bytes.
+ * Crc32 covers the first 4 bytes of the header and the payload.
+ *
+ * A snapshot holds a whole context, a delta holds the bytes that changed
+ * since the previous record of that context as { offset, length, bytes }
+ * runs. The Crc32 field that ends every context is not stored, it is
+ * computed again on restore.
+ */
+typedef struct sNvmLogRecord
+{
+    uint8_t Type;
+    uint8_t Group;
+    uint16_t Length;
+    uint32_t Crc32;
+}NvmLogRecord_t;
+
+typedef struct sNvmGroup
+{
+    uint16_t Flag;
+    uint16_t Offset;
+    uint16_t Size;
+    char* Key;
+}NvmGroup_t;
+
+typedef union uNvmGroupMax
+{
+    LoRaMacCryptoNvmData_t Crypto;
+    LoRaMacNvmDataGroup1_t MacGroup1;
+    LoRaMacNvmDataGroup2_t MacGroup2;
+    SecureElementNvmData_t SecureElement;
+    RegionNvmDataGroup1_t RegionGroup1;
+    RegionNvmDataGroup2_t RegionGroup2;
+    LoRaMacClassBNvmData_t ClassB;
+}NvmGroupMax_t;
+
+typedef struct sNvmLog
+{
+    const esp_partition_t* Partition;
+    uint32_t BankSize;
+    uint32_t Bank;
+    uint32_t Seq;
+    /*!
+     * Partition offset of the next record
+     */
+    uint32_t WriteOffset;
+    /*!
+     * Sectors of the inactive bank still to be erased
+     */
+    uint32_t EraseOffset;
+    uint32_t EraseEnd;
+    /*!
+     * Contexts present in the active bank
+     */
+    uint16_t Stored;
+    bool CompactPending;
+    /*!
+     * The contexts came from NVS, drop the NVS copy once they are in the log
+     */
+    bool Migrate;
+}NvmLog_t;
+
+/*!
+ * Size of a context without its trailing Crc32, in notify flag order
+ */
+#define NVM_GROUP( flag, member, key )                                       \
+    { flag, offsetof( LoRaMacNvmData_t, member ),                              \
+      sizeof( ( ( LoRaMacNvmData_t* ) 0 )->member ) - sizeof( uint32_t ), key }
+
+static const NvmGroup_t NvmGroups[NVM_LOG_GROUP_NB] =
+{
+    NVM_GROUP( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO, Crypto, NVS_DATA_CRYPTO_KEY ),
+    NVM_GROUP( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1, MacGroup1, NVS_DATA_MACGROUP1_KEY ),
+    NVM_GROUP( LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2, MacGroup2, NVS_DATA_MACGROUP2_KEY ),
+    NVM_GROUP( LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT, SecureElement, NVS_DATA_SECURE_KEY ),
+    NVM_GROUP( LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1, RegionGroup1, NVS_DATA_REGION1_KEY ),
+    NVM_GROUP( LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2, RegionGroup2, NVS_DATA_REGION2_KEY ),
+    NVM_GROUP( LORAMAC_NVM_NOTIFY_FLAG_CLASS_B, ClassB, NVS_DATA_CLASSB_KEY ),
+};
+
 static uint16_t NvmNotifyFlags = 0;
 
+static NvmLog_t NvmLog;
+
+/*!
+ * Contexts as last written to the log, the base of the delta records. Also
+ * the read buffer of the NVS restore.
+ */
+static LoRaMacNvmData_t NvmShadow;
+
+/*!
+ * Record being written or read, large enough for a snapshot of any context
+ */
+static uint32_t NvmLogBuffer[( sizeof( NvmLogRecord_t ) + sizeof( NvmGroupMax_t ) + 3 ) / 4];
+
 static esp_err_t __nvs_write(char *p_key, void *p_data, size_t len)
 {
     nvs_handle_t my_handle;
@@ -115,7 +248,7 @@ static esp_err_t __nvs_read_then_check(char *p_key, void *p_data, size_t r_len)
     nvs_close(my_handle);
 
     len = r_len;
-    
+
     calculatedCrc32 = Crc32Init( );
     for( uint16_t i = 0; i < ( len - sizeof( readCrc32 ) ); i++ )
     {
@@ -142,207 +275,617 @@ static esp_err_t __nvm_reset(char *p_key)
     if (err != ESP_OK) return err;
 
     err = nvs_erase_key(my_handle, p_key);
-    if (err != ESP_OK) {
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
         nvs_close(my_handle);
         return err;
     }
+    nvs_commit(my_handle);
     nvs_close(my_handle);
     return ESP_OK;
 }
 
-void NvmDataMgmtEvent( uint16_t notifyFlags )
+static uint8_t* __group_ptr( LoRaMacNvmData_t* nvm, uint8_t group )
 {
-    NvmNotifyFlags = notifyFlags;
+    return ( uint8_t* ) nvm + NvmGroups[group].Offset;
 }
 
-uint16_t NvmDataMgmtStore( void )
+static void __group_update_crc( LoRaMacNvmData_t* nvm, uint8_t group )
 {
-#if( CONTEXT_MANAGEMENT_ENABLED == 1 )
-    uint16_t offset = 0;
-    uint16_t dataSize = 0;
-    MibRequestConfirm_t mibReq;
-    mibReq.Type = MIB_NVM_CTXS;
-    LoRaMacMibGetRequestConfirm( &mibReq );
-    LoRaMacNvmData_t* nvm = mibReq.Param.Contexts;
+    uint8_t* data = __group_ptr( nvm, group );
+    uint32_t crc = Crc32( data, NvmGroups[group].Size );
 
-    // Input checks
-    if( NvmNotifyFlags == LORAMAC_NVM_NOTIFY_FLAG_NONE )
+    memcpy( data + NvmGroups[group].Size, &crc, sizeof( crc ) );
+}
+
+static uint32_t __log_record_crc( NvmLogRecord_t* rec )
+{
+    uint32_t crc = Crc32Init( );
+
+    crc = Crc32Update( crc, ( uint8_t* ) rec, 4 );
+    crc = Crc32Update( crc, ( uint8_t* ) ( rec + 1 ), rec->Length );
+    return Crc32Finalize( crc );
+}
+
+/*!
+ * Sets the log state of an empty or unreadable partition: the next store
+ * writes every context to bank 0.
+ */
+static void __log_set_empty( void )
+{
+    NvmLog.Bank = 1;
+    NvmLog.Seq = 0;
+    NvmLog.WriteOffset = 2 * NvmLog.BankSize;
+    NvmLog.EraseOffset = 0;
+    NvmLog.EraseEnd = NvmLog.BankSize;
+    NvmLog.Stored = 0;
+    NvmLog.CompactPending = true;
+}
+
+static bool __log_init( void )
+{
+    uint32_t snapshotSize = sizeof( NvmLogBank_t );
+
+    NvmLog.Migrate = false;
+    NvmLog.Partition = esp_partition_find_first( ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                 NVM_LOG_PARTITION );
+    if( NvmLog.Partition == NULL )
     {
-        // There was no update.
-        return 0;
+        ESP_LOGW("lorawan", "no \"%s\" partition, contexts are kept in NVS", NVM_LOG_PARTITION);
+        return false;
     }
-    if( LoRaMacStop( ) != LORAMAC_STATUS_OK )
+
+    for( uint8_t i = 0; i < NVM_LOG_GROUP_NB; i++ )
+    {
+        snapshotSize += NVM_LOG_ALIGN( sizeof( NvmLogRecord_t ) + NvmGroups[i].Size );
+    }
+    NvmLog.BankSize = ( NvmLog.Partition->size / 2 ) & ~( NVM_LOG_SECTOR_SIZE - 1 );
+    if( NvmLog.BankSize < 2 * snapshotSize )
+    {
+        ESP_LOGE("lorawan", "\"%s\" partition too small, %u bytes per bank needed",
+                 NVM_LOG_PARTITION, ( unsigned ) ( 2 * snapshotSize ));
+        NvmLog.Partition = NULL;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * Erases a sector unless it is blank already.
+ */
+static esp_err_t __log_erase_sector( uint32_t offset )
+{
+    uint32_t buf[64];
+    esp_err_t err;
+
+    for( uint32_t i = 0; i < NVM_LOG_SECTOR_SIZE; i += sizeof( buf ) )
+    {
+        err = esp_partition_read( NvmLog.Partition, offset + i, buf, sizeof( buf ) );
+        if( err != ESP_OK )
+        {
+            return err;
+        }
+        for( uint8_t j = 0; j < 64; j++ )
+        {
+            if( buf[j] != 0xFFFFFFFF )
+            {
+                return esp_partition_erase_range( NvmLog.Partition, offset, NVM_LOG_SECTOR_SIZE );
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+/*!
+ * Erases the next dirty sector of the inactive bank. Called once per store,
+ * so a store waits for at most one sector erase and a compaction for none.
+ */
+static esp_err_t __log_erase_step( void )
+{
+    esp_err_t err;
+
+    if( NvmLog.EraseOffset >= NvmLog.EraseEnd )
+    {
+        return ESP_OK;
+    }
+    err = __log_erase_sector( NvmLog.EraseOffset );
+    if( err == ESP_OK )
+    {
+        NvmLog.EraseOffset += NVM_LOG_SECTOR_SIZE;
+    }
+    return err;
+}
+
+/*!
+ * Writes the record staged in NvmLogBuffer at offset.
+ *
+ * \param [IN] offset Partition offset
+ * \param [IN] type   NVM_LOG_RECORD_SNAPSHOT or NVM_LOG_RECORD_DELTA
+ * \param [IN] group  Context index in NvmGroups
+ * \param [IN] length Payload length
+ * \param [OUT] size  Bytes taken in the log
+ */
+static esp_err_t __log_write_record( uint32_t offset, uint8_t type, uint8_t group, uint16_t length,
+                                     uint32_t* size )
+{
+    NvmLogRecord_t* rec = ( NvmLogRecord_t* ) NvmLogBuffer;
+    uint8_t* payload = ( uint8_t* ) ( rec + 1 );
+
+    *size = NVM_LOG_ALIGN( sizeof( NvmLogRecord_t ) + length );
+    rec->Type = type;
+    rec->Group = group;
+    rec->Length = length;
+    rec->Crc32 = __log_record_crc( rec );
+    memset( payload + length, 0xFF, *size - sizeof( NvmLogRecord_t ) - length );
+    return esp_partition_write( NvmLog.Partition, offset, rec, *size );
+}
+
+static esp_err_t __log_append( uint8_t type, uint8_t group, uint16_t length )
+{
+    uint32_t end = ( NvmLog.Bank + 1 ) * NvmLog.BankSize;
+    uint32_t size = NVM_LOG_ALIGN( sizeof( NvmLogRecord_t ) + length );
+    esp_err_t err;
+
+    if( NvmLog.WriteOffset + size > end )
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    err = __log_write_record( NvmLog.WriteOffset, type, group, length, &size );
+    if( err != ESP_OK )
+    {
+        // The record may be half written, continue in a new bank
+        NvmLog.CompactPending = true;
+        return err;
+    }
+    NvmLog.WriteOffset += size;
+    return ESP_OK;
+}
+
+/*!
+ * Starts the inactive bank with a snapshot of every context. The bank header
+ * goes last, so an interrupted compaction leaves the active bank in use.
+ */
+static esp_err_t __log_compact( LoRaMacNvmData_t* nvm )
+{
+    uint32_t bank = NvmLog.Bank ^ 1;
+    uint32_t base = bank * NvmLog.BankSize;
+    uint32_t offset = base + sizeof( NvmLogBank_t );
+    uint32_t size = 0;
+    uint8_t* payload = ( uint8_t* ) NvmLogBuffer + sizeof( NvmLogRecord_t );
+    NvmLogBank_t header;
+    esp_err_t err = ESP_OK;
+
+    // Normally done by the stores since the last compaction
+    while( ( err == ESP_OK ) && ( NvmLog.EraseOffset < NvmLog.EraseEnd ) )
+    {
+        err = __log_erase_step( );
+    }
+
+    for( uint8_t i = 0; ( err == ESP_OK ) && ( i < NVM_LOG_GROUP_NB ); i++ )
+    {
+        memcpy( payload, __group_ptr( nvm, i ), NvmGroups[i].Size );
+        err = __log_write_record( offset, NVM_LOG_RECORD_SNAPSHOT, i, NvmGroups[i].Size, &size );
+        offset += size;
+    }
+
+    if( err == ESP_OK )
+    {
+        header.Magic = NVM_LOG_MAGIC;
+        header.Seq = NvmLog.Seq + 1;
+        header.Crc32 = Crc32( ( uint8_t* ) &header, offsetof( NvmLogBank_t, Crc32 ) );
+        err = esp_partition_write( NvmLog.Partition, base, &header, sizeof( header ) );
+    }
+
+    if( err != ESP_OK )
+    {
+        NvmLog.EraseOffset = base;
+        NvmLog.EraseEnd = base + NvmLog.BankSize;
+        NvmLog.CompactPending = true;
+        return err;
+    }
+
+    // The previous bank is erased by the next stores, up to where it was used
+    NvmLog.EraseOffset = NvmLog.Bank * NvmLog.BankSize;
+    NvmLog.EraseEnd = ( NvmLog.WriteOffset + NVM_LOG_SECTOR_SIZE - 1 ) & ~( NVM_LOG_SECTOR_SIZE - 1 );
+    NvmLog.Bank = bank;
+    NvmLog.Seq = header.Seq;
+    NvmLog.WriteOffset = offset;
+    NvmLog.Stored = NVM_LOG_GROUP_ALL;
+    NvmLog.CompactPending = false;
+    memcpy( &NvmShadow, nvm, sizeof( NvmShadow ) );
+    return ESP_OK;
+}
+
+/*!
+ * Encodes the bytes of a context that differ from its last stored copy.
+ *
+ * \retval Payload length, 0 when the runs take half the context or more and
+ *         a snapshot is written instead.
+ */
+static uint16_t __log_delta( const uint8_t* cur, const uint8_t* old, uint16_t size, uint8_t* out )
+{
+    uint16_t length = 0;
+    uint16_t i = 0;
+
+    while( i < size )
+    {
+        if( cur[i] == old[i] )
+        {
+            i++;
+            continue;
+        }
+
+        uint16_t start = i;
+        uint16_t end = i + 1;
+        for( uint16_t j = end; ( j < size ) && ( j < end + NVM_LOG_RUN_GAP ); j++ )
+        {
+            if( cur[j] != old[j] )
+            {
+                end = j + 1;
+            }
+        }
+
+        uint16_t run = end - start;
+        if( length + 4 + run >= size / 2 )
+        {
+            return 0;
+        }
+        out[length++] = start & 0xFF;
+        out[length++] = start >> 8;
+        out[length++] = run & 0xFF;
+        out[length++] = run >> 8;
+        memcpy( out + length, cur + start, run );
+        length += run;
+        i = end;
+    }
+    return length;
+}
+
+static bool __log_apply_delta( uint8_t* data, uint16_t size, const uint8_t* in, uint16_t length )
+{
+    uint16_t i = 0;
+
+    while( i < length )
+    {
+        if( length - i < 4 )
+        {
+            return false;
+        }
+        uint16_t offset = in[i] | ( in[i + 1] << 8 );
+        uint16_t run = in[i + 2] | ( in[i + 3] << 8 );
+        i += 4;
+        if( ( run > length - i ) || ( offset > size ) || ( run > size - offset ) )
+        {
+            return false;
+        }
+        memcpy( data + offset, in + i, run );
+        i += run;
+    }
+    return true;
+}
+
+/*!
+ * Replays the newest bank into NvmShadow.
+ *
+ * \retval Notify flags of the contexts found, 0 if the log is empty.
+ */
+static uint16_t __log_restore( void )
+{
+    NvmLogBank_t header[2];
+    bool valid[2];
+    NvmLogRecord_t* rec = ( NvmLogRecord_t* ) NvmLogBuffer;
+    uint8_t* payload = ( uint8_t* ) ( rec + 1 );
+    uint16_t flags = 0;
+
+    for( uint8_t b = 0; b < 2; b++ )
+    {
+        valid[b] = ( esp_partition_read( NvmLog.Partition, b * NvmLog.BankSize, &header[b],
+                                         sizeof( header[b] ) ) == ESP_OK ) &&
+                   ( header[b].Magic == NVM_LOG_MAGIC ) &&
+                   ( header[b].Crc32 == Crc32( ( uint8_t* ) &header[b], offsetof( NvmLogBank_t, Crc32 ) ) );
+    }
+    if( ( valid[0] == false ) && ( valid[1] == false ) )
     {
+        __log_set_empty( );
         return 0;
     }
 
-     // Crypto
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_CRYPTO ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_CRYPTO )
+    if( ( valid[0] == true ) && ( valid[1] == true ) )
     {
-        esp_err_t err  = __nvs_write(NVS_DATA_CRYPTO_KEY, ( uint8_t* ) &nvm->Crypto,  sizeof( nvm->Crypto ));
-        if( err != ESP_OK ) {
-            ESP_LOGE("lorawan", "nvs Crypto write err:0x%x", err);
-        }        
+        NvmLog.Bank = ( ( int32_t ) ( header[1].Seq - header[0].Seq ) > 0 ) ? 1 : 0;
     }
+    else
+    {
+        NvmLog.Bank = ( valid[1] == true ) ? 1 : 0;
+    }
+    NvmLog.Seq = header[NvmLog.Bank].Seq;
+    NvmLog.EraseOffset = ( NvmLog.Bank ^ 1 ) * NvmLog.BankSize;
+    NvmLog.EraseEnd = NvmLog.EraseOffset + NvmLog.BankSize;
+    NvmLog.Stored = 0;
+    NvmLog.CompactPending = false;
+
+    uint32_t offset = NvmLog.Bank * NvmLog.BankSize + sizeof( NvmLogBank_t );
+    uint32_t end = ( NvmLog.Bank + 1 ) * NvmLog.BankSize;
+    while( offset + sizeof( NvmLogRecord_t ) <= end )
+    {
+        if( esp_partition_read( NvmLog.Partition, offset, rec, sizeof( NvmLogRecord_t ) ) != ESP_OK )
+        {
+            NvmLog.CompactPending = true;
+            break;
+        }
+        if( rec->Type == NVM_LOG_RECORD_ERASED )
+        {
+            // End of the log, or a record cut short by a reset
+            const uint8_t* raw = ( const uint8_t* ) rec;
+            for( uint8_t i = 0; i < sizeof( NvmLogRecord_t ); i++ )
+            {
+                if( raw[i] != 0xFF )
+                {
+                    NvmLog.CompactPending = true;
+                }
+            }
+            break;
+        }
+
+        uint32_t size = NVM_LOG_ALIGN( sizeof( NvmLogRecord_t ) + rec->Length );
+        uint8_t group = rec->Group;
+        if( ( group >= NVM_LOG_GROUP_NB ) || ( rec->Length > NvmGroups[group].Size ) ||
+            ( offset + size > end ) ||
+            ( esp_partition_read( NvmLog.Partition, offset + sizeof( NvmLogRecord_t ), payload,
+                                  rec->Length ) != ESP_OK ) ||
+            ( rec->Crc32 != __log_record_crc( rec ) ) )
+        {
+            NvmLog.CompactPending = true;
+            break;
+        }
 
-    // MacGroup1
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1 )
+        uint8_t* data = __group_ptr( &NvmShadow, group );
+        if( ( rec->Type == NVM_LOG_RECORD_SNAPSHOT ) && ( rec->Length == NvmGroups[group].Size ) )
+        {
+            memcpy( data, payload, rec->Length );
+            flags |= NvmGroups[group].Flag;
+        }
+        else if( ( rec->Type != NVM_LOG_RECORD_DELTA ) || ( ( flags & NvmGroups[group].Flag ) == 0 ) ||
+                 ( __log_apply_delta( data, NvmGroups[group].Size, payload, rec->Length ) == false ) )
+        {
+            NvmLog.CompactPending = true;
+            break;
+        }
+        offset += size;
+    }
+    NvmLog.WriteOffset = offset;
+
+    for( uint8_t i = 0; i < NVM_LOG_GROUP_NB; i++ )
     {
-        esp_err_t err  = __nvs_write(NVS_DATA_MACGROUP1_KEY, ( uint8_t* ) &nvm->MacGroup1,  sizeof( nvm->MacGroup1 ));
-        if( err != ESP_OK ) {
-            ESP_LOGE("lorawan", "nvs MacGroup1 write err:0x%x", err);
-        }                
+        if( ( flags & NvmGroups[i].Flag ) != 0 )
+        {
+            __group_update_crc( &NvmShadow, i );
+            NvmLog.Stored |= 1 << i;
+        }
     }
+    return flags;
+}
 
+static uint16_t __log_store( LoRaMacNvmData_t* nvm )
+{
+    uint8_t* payload = ( uint8_t* ) NvmLogBuffer + sizeof( NvmLogRecord_t );
+    uint16_t dataSize = 0;
+    esp_err_t err = ESP_OK;
 
-    // MacGroup2
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 )
+    for( uint8_t i = 0; ( NvmLog.CompactPending == false ) && ( i < NVM_LOG_GROUP_NB ); i++ )
     {
-        esp_err_t err  = __nvs_write(NVS_DATA_MACGROUP2_KEY, ( uint8_t* ) &nvm->MacGroup2,  sizeof( nvm->MacGroup2 ));
-        if( err != ESP_OK ) {
-            ESP_LOGE("lorawan", "nvs MacGroup2 write err:0x%x", err);
-        }     
+        uint8_t* cur = __group_ptr( nvm, i );
+        uint8_t* old = __group_ptr( &NvmShadow, i );
+        uint16_t size = NvmGroups[i].Size;
+        uint8_t type = NVM_LOG_RECORD_DELTA;
+        uint16_t length = 0;
+
+        if( ( NvmNotifyFlags & NvmGroups[i].Flag ) == 0 )
+        {
+            continue;
+        }
+        if( ( NvmLog.Stored & ( 1 << i ) ) != 0 )
+        {
+            if( memcmp( cur, old, size ) == 0 )
+            {
+                continue;
+            }
+            length = __log_delta( cur, old, size, payload );
+        }
+        if( length == 0 )
+        {
+            // First copy, or a structural change
+            type = NVM_LOG_RECORD_SNAPSHOT;
+            length = size;
+            memcpy( payload, cur, size );
+        }
+
+        err = __log_append( type, i, length );
+        if( err != ESP_OK )
+        {
+            break;
+        }
+        memcpy( old, cur, size + sizeof( uint32_t ) );
+        NvmLog.Stored |= 1 << i;
+        dataSize += length;
     }
 
-    // Secure element
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT )
+    if( ( NvmLog.CompactPending == true ) || ( err == ESP_ERR_NO_MEM ) )
     {
-        esp_err_t err  = __nvs_write(NVS_DATA_SECURE_KEY, ( uint8_t* ) &nvm->SecureElement,  sizeof( nvm->SecureElement ));
-        if( err != ESP_OK ) {
-            ESP_LOGE("lorawan", "nvs SecureElement write err:0x%x", err);
-        }   
+        err = __log_compact( nvm );
+        if( err == ESP_OK )
+        {
+            dataSize = sizeof( LoRaMacNvmData_t );
+            if( NvmLog.Migrate == true )
+            {
+                for( uint8_t i = 0; i < NVM_LOG_GROUP_NB; i++ )
+                {
+                    __nvm_reset( NvmGroups[i].Key );
+                }
+                NvmLog.Migrate = false;
+            }
+        }
+    }
+    else if( err == ESP_OK )
+    {
+        err = __log_erase_step( );
     }
 
-    // Region group 1
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1 ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1 )
+    if( err != ESP_OK )
     {
-        esp_err_t err  = __nvs_write(NVS_DATA_REGION1_KEY, ( uint8_t* ) &nvm->RegionGroup1,  sizeof( nvm->RegionGroup1 ));
-        if( err != ESP_OK ) {
-            ESP_LOGE("lorawan", "nvs RegionGroup1 write err:0x%x", err);
-        }   
+        ESP_LOGE("lorawan", "nvm log write err:0x%x", err);
+        return 0;
     }
+    return dataSize;
+}
 
-    // Region group 2
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2 ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2 )
+static esp_err_t __nvs_store( LoRaMacNvmData_t* nvm )
+{
+    if( LoRaMacStop( ) != LORAMAC_STATUS_OK )
     {
-        esp_err_t err  = __nvs_write(NVS_DATA_REGION2_KEY, ( uint8_t* ) &nvm->RegionGroup2,  sizeof( nvm->RegionGroup2 ));
-        if( err != ESP_OK ) {
-            ESP_LOGE("lorawan", "nvs RegionGroup2 write err:0x%x", err);
-        }     
+        return ESP_ERR_INVALID_STATE;
     }
 
-    // Class b
-    if( ( NvmNotifyFlags & LORAMAC_NVM_NOTIFY_FLAG_CLASS_B ) ==
-        LORAMAC_NVM_NOTIFY_FLAG_CLASS_B )
+    for( uint8_t i = 0; i < NVM_LOG_GROUP_NB; i++ )
     {
-        esp_err_t err  = __nvs_write(NVS_DATA_CLASSB_KEY, ( uint8_t* ) &nvm->ClassB,  sizeof( nvm->ClassB ));
-        if( err != ESP_OK ) {
-            ESP_LOGE("lorawan", "nvs ClassB write err:0x%x", err);
-        }    
+        if( ( NvmNotifyFlags & NvmGroups[i].Flag ) == NvmGroups[i].Flag )
+        {
+            esp_err_t err  = __nvs_write(NvmGroups[i].Key, __group_ptr( nvm, i ),
+                                         NvmGroups[i].Size + sizeof( uint32_t ));
+            if( err != ESP_OK ) {
+                ESP_LOGE("lorawan", "nvs %s write err:0x%x", NvmGroups[i].Key, err);
+            }
+        }
     }
 
-    // Reset notification flags
-    NvmNotifyFlags = LORAMAC_NVM_NOTIFY_FLAG_NONE;
-   
     // Resume LoRaMac
     LoRaMacStart( );
-    return dataSize;
-#else
-    return 0;
-#endif
+    return ESP_OK;
 }
 
-uint16_t NvmDataMgmtRestore( void )
+void NvmDataMgmtEvent( uint16_t notifyFlags )
+{
+    // Kept until stored, a store can be postponed while the MAC is busy
+    NvmNotifyFlags |= notifyFlags;
+}
+
+uint16_t NvmDataMgmtStore( void )
 {
 #if( CONTEXT_MANAGEMENT_ENABLED == 1 )
+    uint16_t dataSize = 0;
     MibRequestConfirm_t mibReq;
     mibReq.Type = MIB_NVM_CTXS;
     LoRaMacMibGetRequestConfirm( &mibReq );
     LoRaMacNvmData_t* nvm = mibReq.Param.Contexts;
-    uint16_t offset = 0;
-    
-    static LoRaMacNvmData_t data;
-    esp_err_t err;
-    
-    LoRaMacRegion_t new_region = nvm->MacGroup2.Region;
 
+    // Input checks
+    if( NvmNotifyFlags == LORAMAC_NVM_NOTIFY_FLAG_NONE )
+    {
+        // There was no update.
+        return 0;
+    }
+
+    if( NvmLog.Partition == NULL )
+    {
+        if( __nvs_store( nvm ) != ESP_OK )
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        // The contexts only change in LoRaMacProcess, which runs in this
+        // task, so the log is written without stopping the MAC. A busy MAC
+        // may be half way through an update, wait for it to be idle.
+        if( LoRaMacIsBusy( ) == true )
+        {
+            return 0;
+        }
+        dataSize = __log_store( nvm );
+    }
+
+    // Reset notification flags
+    NvmNotifyFlags = LORAMAC_NVM_NOTIFY_FLAG_NONE;
+    return dataSize;
+#else
+    return 0;
+#endif
+}
+
+static uint16_t __nvs_restore( LoRaMacNvmData_t* nvm, LoRaMacRegion_t new_region )
+{
+    LoRaMacNvmData_t* data = &NvmShadow;
+    esp_err_t err;
 
     // Crypto
-    err = __nvs_read_then_check(NVS_DATA_CRYPTO_KEY, ( uint8_t* ) &data.Crypto,  sizeof( data.Crypto ));
+    err = __nvs_read_then_check(NVS_DATA_CRYPTO_KEY, ( uint8_t* ) &data->Crypto,  sizeof( data->Crypto ));
     if( err == ESP_OK )
     {
-        memcpy( (uint8_t * ) &nvm->Crypto, (uint8_t*) &data.Crypto ,sizeof( data.Crypto ));
+        memcpy( (uint8_t * ) &nvm->Crypto, (uint8_t*) &data->Crypto ,sizeof( data->Crypto ));
     } else if( err != ESP_ERR_NVS_NOT_FOUND) {
         ESP_LOGE("lorawan", "nvs Crypto read err:0x%x", err);
         return  0;
     }
 
     // Secure element
-    err = __nvs_read_then_check(NVS_DATA_SECURE_KEY, ( uint8_t* ) &data.SecureElement,  sizeof( data.SecureElement ));
+    err = __nvs_read_then_check(NVS_DATA_SECURE_KEY, ( uint8_t* ) &data->SecureElement,  sizeof( data->SecureElement ));
     if( err == ESP_OK )
     {
-        memcpy( (uint8_t*) &nvm->SecureElement, (uint8_t*) &data.SecureElement ,sizeof( data.SecureElement ));
+        memcpy( (uint8_t*) &nvm->SecureElement, (uint8_t*) &data->SecureElement ,sizeof( data->SecureElement ));
     } else if( err != ESP_ERR_NVS_NOT_FOUND) {
         ESP_LOGE("lorawan", "nvs SecureElement read err:0x%x", err);
         return  0;
     }
 
     // Mac Group 2
-    err = __nvs_read_then_check(NVS_DATA_MACGROUP2_KEY, ( uint8_t* ) &data.MacGroup2,  sizeof( data.MacGroup2 ));
+    err = __nvs_read_then_check(NVS_DATA_MACGROUP2_KEY, ( uint8_t* ) &data->MacGroup2,  sizeof( data->MacGroup2 ));
     if( err == ESP_OK )
     {
-        if( new_region != data.MacGroup2.Region ) {
-            ESP_LOGI("lorawan", "change region: %d --> %d", data.MacGroup2.Region, new_region);
+        if( new_region != data->MacGroup2.Region ) {
+            ESP_LOGI("lorawan", "change region: %d --> %d", data->MacGroup2.Region, new_region);
             return 0; //When changing the region, the following fields cannot be restored.
         }
 
-        memcpy( (uint8_t*) &nvm->MacGroup2, (uint8_t*) &data.MacGroup2 ,sizeof( data.MacGroup2 ));
+        memcpy( (uint8_t*) &nvm->MacGroup2, (uint8_t*) &data->MacGroup2 ,sizeof( data->MacGroup2 ));
     } else if( err != ESP_ERR_NVS_NOT_FOUND) {
         ESP_LOGE("lorawan", "nvs MacGroup2 read err:0x%x", err);
         return  0;
     }
 
     // Mac Group 1
-    err = __nvs_read_then_check(NVS_DATA_MACGROUP1_KEY, ( uint8_t* ) &data.MacGroup1,  sizeof( data.MacGroup1 ));
+    err = __nvs_read_then_check(NVS_DATA_MACGROUP1_KEY, ( uint8_t* ) &data->MacGroup1,  sizeof( data->MacGroup1 ));
     if( err == ESP_OK )
     {
-        memcpy( (uint8_t*) &nvm->MacGroup1, (uint8_t*) &data.MacGroup1 ,sizeof( data.MacGroup1 ));
+        memcpy( (uint8_t*) &nvm->MacGroup1, (uint8_t*) &data->MacGroup1 ,sizeof( data->MacGroup1 ));
     } else if( err != ESP_ERR_NVS_NOT_FOUND) {
         ESP_LOGE("lorawan", "nvs MacGroup1 read err:0x%x", err);
         return  0;
     }
 
     // Region group 1
-    err = __nvs_read_then_check(NVS_DATA_REGION1_KEY, ( uint8_t* ) &data.RegionGroup1,  sizeof( data.RegionGroup1 ));
+    err = __nvs_read_then_check(NVS_DATA_REGION1_KEY, ( uint8_t* ) &data->RegionGroup1,  sizeof( data->RegionGroup1 ));
     if( err == ESP_OK )
     {
-        memcpy( (uint8_t*) &nvm->RegionGroup1, (uint8_t*) &data.RegionGroup1 ,sizeof( data.RegionGroup1 ));
+        memcpy( (uint8_t*) &nvm->RegionGroup1, (uint8_t*) &data->RegionGroup1 ,sizeof( data->RegionGroup1 ));
     } else if( err != ESP_ERR_NVS_NOT_FOUND) {
         ESP_LOGE("lorawan", "nvs RegionGroup1 read err:0x%x", err);
         return  0;
     }
 
     // Region group 2
-    err = __nvs_read_then_check(NVS_DATA_REGION2_KEY, ( uint8_t* ) &data.RegionGroup2,  sizeof( data.RegionGroup2 ));
+    err = __nvs_read_then_check(NVS_DATA_REGION2_KEY, ( uint8_t* ) &data->RegionGroup2,  sizeof( data->RegionGroup2 ));
     if( err == ESP_OK )
     {
-        memcpy( (uint8_t*) &nvm->RegionGroup2, (uint8_t*) &data.RegionGroup2 ,sizeof( data.RegionGroup2 ));
+        memcpy( (uint8_t*) &nvm->RegionGroup2, (uint8_t*) &data->RegionGroup2 ,sizeof( data->RegionGroup2 ));
     } else if( err != ESP_ERR_NVS_NOT_FOUND) {
         ESP_LOGE("lorawan", "nvs RegionGroup2 read err:0x%x", err);
         return  0;
     }
 
     // Class b
-    err = __nvs_read_then_check(NVS_DATA_CLASSB_KEY, ( uint8_t* ) &data.ClassB,  sizeof( data.ClassB ));
+    err = __nvs_read_then_check(NVS_DATA_CLASSB_KEY, ( uint8_t* ) &data->ClassB,  sizeof( data->ClassB ));
     if( err == ESP_OK )
     {
-        memcpy( (uint8_t*) &nvm->ClassB, (uint8_t*) &data.ClassB ,sizeof( data.ClassB ));
+        memcpy( (uint8_t*) &nvm->ClassB, (uint8_t*) &data->ClassB ,sizeof( data->ClassB ));
     } else if( err != ESP_ERR_NVS_NOT_FOUND) {
         ESP_LOGE("lorawan", "nvs ClassB read err:0x%x", err);
         return  0;
@@ -350,42 +893,78 @@ uint16_t NvmDataMgmtRestore( void )
 
     ESP_LOGI("lorawan", "NvmDataMgmtRestore ok.");
     return sizeof( LoRaMacNvmData_t );
+}
+
+uint16_t NvmDataMgmtRestore( void )
+{
+#if( CONTEXT_MANAGEMENT_ENABLED == 1 )
+    MibRequestConfirm_t mibReq;
+    mibReq.Type = MIB_NVM_CTXS;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    LoRaMacNvmData_t* nvm = mibReq.Param.Contexts;
+    LoRaMacRegion_t new_region = nvm->MacGroup2.Region;
+
+    if( ( NVM_LOG_ENABLED == 1 ) && ( __log_init( ) == true ) )
+    {
+        uint16_t flags = __log_restore( );
+        if( flags != 0 )
+        {
+            // Crypto and secure element first, they are kept across a region change
+            for( uint8_t i = 0; i < NVM_LOG_GROUP_NB; i++ )
+            {
+                if( ( NvmGroups[i].Flag & flags & ( LORAMAC_NVM_NOTIFY_FLAG_CRYPTO |
+                                                    LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT ) ) != 0 )
+                {
+                    memcpy( __group_ptr( nvm, i ), __group_ptr( &NvmShadow, i ),
+                            NvmGroups[i].Size + sizeof( uint32_t ) );
+                }
+            }
+            if( ( ( flags & LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2 ) != 0 ) &&
+                ( NvmShadow.MacGroup2.Region != new_region ) )
+            {
+                ESP_LOGI("lorawan", "change region: %d --> %d", NvmShadow.MacGroup2.Region, new_region);
+                return 0; //When changing the region, the following fields cannot be restored.
+            }
+            for( uint8_t i = 0; i < NVM_LOG_GROUP_NB; i++ )
+            {
+                if( ( NvmGroups[i].Flag & flags ) != 0 )
+                {
+                    memcpy( __group_ptr( nvm, i ), __group_ptr( &NvmShadow, i ),
+                            NvmGroups[i].Size + sizeof( uint32_t ) );
+                }
+            }
+            ESP_LOGI("lorawan", "NvmDataMgmtRestore ok, log bank %u seq %u, %u bytes used",
+                     ( unsigned ) NvmLog.Bank, ( unsigned ) NvmLog.Seq,
+                     ( unsigned ) ( NvmLog.WriteOffset - NvmLog.Bank * NvmLog.BankSize ));
+            return sizeof( LoRaMacNvmData_t );
+        }
+        // Empty log: take the NVS copy, the first store moves it to the log
+        NvmLog.Migrate = true;
+    }
+    return __nvs_restore( nvm, new_region );
 #endif
     return 0;
 }
 
 bool NvmDataMgmtFactoryReset( void )
 {
-    uint16_t offset = 0;
 #if( CONTEXT_MANAGEMENT_ENABLED == 1 )
     esp_err_t  err;
-    err = __nvm_reset(NVS_DATA_CRYPTO_KEY);
-    if(  err != ESP_OK ) {
-        return false;
-    }
-    err = __nvm_reset(NVS_DATA_MACGROUP1_KEY);
-    if(  err != ESP_OK ) {
-        return false;
-    }
-    err = __nvm_reset(NVS_DATA_MACGROUP2_KEY);
-    if(  err != ESP_OK ) {
-        return false;
-    }
-    err = __nvm_reset(NVS_DATA_SECURE_KEY);
-    if(  err != ESP_OK ) {
-        return false;
-    }
-    err = __nvm_reset(NVS_DATA_REGION1_KEY);
-    if(  err != ESP_OK ) {
-        return false;
-    }
-    err = __nvm_reset(NVS_DATA_REGION2_KEY);
-    if(  err != ESP_OK ) {
-        return false;
+    if( ( NVM_LOG_ENABLED == 1 ) && ( ( NvmLog.Partition != NULL ) || ( __log_init( ) == true ) ) )
+    {
+        err = esp_partition_erase_range( NvmLog.Partition, 0, 2 * NvmLog.BankSize );
+        if(  err != ESP_OK ) {
+            return false;
+        }
+        __log_set_empty( );
+        NvmLog.EraseEnd = 0;
     }
-    err = __nvm_reset(NVS_DATA_CLASSB_KEY);
-    if(  err != ESP_OK ) {
-        return false;
+    for( uint8_t i = 0; i < NVM_LOG_GROUP_NB; i++ )
+    {
+        err = __nvm_reset(NvmGroups[i].Key);
+        if(  err != ESP_OK ) {
+            return false;
+        }
     }
 #endif
     return true;
@@ -398,5 +977,5 @@ int nvm_init(void)
       ESP_ERROR_CHECK(nvs_flash_erase());
       ret = nvs_flash_init();
     }
+    return ret;
 }
-
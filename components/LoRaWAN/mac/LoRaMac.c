@@ -295,7 +295,7 @@ static SemaphoreHandle_t  LoRaMacMutex; // Operation protection for timer tasks
  * Statistics on how long it takes to open the receive window (ms)
  * The time it takes to execute the OnRxWindow1TimerEvent() or OnRxWindow2TimerEvent
  */
-static uint32_t openRXwindowTakeTimeMs = 23;
+static uint32_t openRXwindowTakeTimeUs = 23000;
 
 /*!
  * Defines the LoRaMac radio events status
@@ -750,6 +750,7 @@ static bool LoRaMacHandleResponseTimeout( TimerTime_t timeoutInMs, TimerTime_t s
 struct
 {
     TimerTime_t CurTime;
+    int64_t CurTimeUs;
 }TxDoneParams;
 
 /*!
@@ -764,16 +765,17 @@ struct
     int8_t Snr;
 }RxDoneParams;
 
-extern TimerTime_t g_lora_irq_time;
+extern int64_t g_lora_irq_time_us;
 
 static void OnRadioTxDone( void )
 {
     LORA_MAC_MUTEX_TAKE(LoRaMacMutex)
-    if( g_lora_irq_time != 0) {
-        TxDoneParams.CurTime = g_lora_irq_time;  //It takes 27ms from the start of the interrupt to the execution here.
+    if( g_lora_irq_time_us != 0) {
+        TxDoneParams.CurTimeUs = g_lora_irq_time_us;  //It takes 27ms from the start of the interrupt to the execution here.
     } else {
-        TxDoneParams.CurTime = TimerGetCurrentTime();
+        TxDoneParams.CurTimeUs = TimerGetCurrentTimeUs();
     }
+    TxDoneParams.CurTime = ( TimerTime_t )( TxDoneParams.CurTimeUs / 1000 );
     //ESP_LOGI(TAG,"OnRadioTxDone : %d, %d\r\n",  TxDoneParams.CurTime, TimerGetCurrentTime() - TxDoneParams.CurTime);
 
     MacCtx.LastTxSysTime = SysTimeGet( );
@@ -790,8 +792,8 @@ static void OnRadioTxDone( void )
 static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr )
 {
     LORA_MAC_MUTEX_TAKE(LoRaMacMutex)
-    if( g_lora_irq_time != 0) {
-        RxDoneParams.LastRxDone = g_lora_irq_time;
+    if( g_lora_irq_time_us != 0) {
+        RxDoneParams.LastRxDone = ( TimerTime_t )( g_lora_irq_time_us / 1000 );
     } else {
         RxDoneParams.LastRxDone = TimerGetCurrentTime();
     }
@@ -859,12 +861,15 @@ static void ProcessRadioTxDone( void )
 
     // Setup timers
     CRITICAL_SECTION_BEGIN( );
-    uint32_t offset = TimerGetCurrentTime( ) - TxDoneParams.CurTime;
-    TimerSetValue( &MacCtx.RxWindowTimer1, MacCtx.RxWindow1Delay - offset - openRXwindowTakeTimeMs );
+    // Windows are timed from the TxDone IRQ edge, in microseconds
+    int64_t offset = TimerGetCurrentTimeUs( ) - TxDoneParams.CurTimeUs + openRXwindowTakeTimeUs;
+    int64_t rx1Delay = ( int64_t )MacCtx.RxWindow1Delay * 1000 - offset;
+    int64_t rx2Delay = ( int64_t )MacCtx.RxWindow2Delay * 1000 - offset;
+    TimerSetValueUs( &MacCtx.RxWindowTimer1, ( rx1Delay > 0 ) ? rx1Delay : 0 );
     TimerStart( &MacCtx.RxWindowTimer1 );
-    TimerSetValue( &MacCtx.RxWindowTimer2, MacCtx.RxWindow2Delay - offset - openRXwindowTakeTimeMs );
+    TimerSetValueUs( &MacCtx.RxWindowTimer2, ( rx2Delay > 0 ) ? rx2Delay : 0 );
     TimerStart( &MacCtx.RxWindowTimer2 );
-    //ESP_LOGI(TAG,"RxWindow1Delay: %d ms, RxWindow2Delay: %d ms, offset: %dms, openRXwindowTakeTime: %d ms\r\n", MacCtx.RxWindow1Delay, MacCtx.RxWindow2Delay, offset, openRXwindowTakeTimeMs);
+    //ESP_LOGI(TAG,"RxWindow1Delay: %d ms, RxWindow2Delay: %d ms, offset: %lld us, openRXwindowTakeTime: %d us\r\n", MacCtx.RxWindow1Delay, MacCtx.RxWindow2Delay, offset, openRXwindowTakeTimeUs);
     CRITICAL_SECTION_END( );
 
     if( MacCtx.NodeAckRequested == true )
@@ -2008,7 +2013,7 @@ static void OnTxDelayedTimerEvent1( void* context )
 static void OnRxWindow1TimerEvent( void* context )
 {
     LORA_MAC_MUTEX_TAKE(LoRaMacMutex)
-    TimerTime_t cur = TimerGetCurrentTime();
+    int64_t cur = TimerGetCurrentTimeUs();
 
     MacCtx.RxWindow1Config.Channel = MacCtx.Channel;
     MacCtx.RxWindow1Config.DrOffset = Nvm.MacGroup2.MacParams.Rx1DrOffset;
@@ -2018,7 +2023,7 @@ static void OnRxWindow1TimerEvent( void* context )
     MacCtx.RxWindow1Config.NetworkActivation = Nvm.MacGroup2.NetworkActivation;
 
     RxWindowSetup( &MacCtx.RxWindowTimer1, &MacCtx.RxWindow1Config );
-    openRXwindowTakeTimeMs = TimerGetCurrentTime() - cur;
+    openRXwindowTakeTimeUs = ( uint32_t )( TimerGetCurrentTimeUs() - cur );
     LORA_MAC_MUTEX_GIVE(LoRaMacMutex);
 }
 
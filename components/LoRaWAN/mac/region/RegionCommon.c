@@ -173,16 +173,40 @@ static uint16_t UpdateTimeCredits( Band_t* band, bool joined, bool dutyCycleEnab
 
 static uint8_t CountChannels( uint16_t mask, uint8_t nbBits )
 {
-    uint8_t nbActiveBits = 0;
+    return ( uint8_t )__builtin_popcount( mask & ( ( 1UL << nbBits ) - 1 ) );
+}
+
+/*!
+ * \brief Pops the lowest set bit of a channels mask word
+ *
+ * \param [IN/OUT] mask Channels mask word, the bit is cleared
+ *
+ * \retval bit           Index of the bit in the word
+ */
+static uint8_t PopLowestChannel( uint16_t* mask )
+{
+    uint8_t bit = ( uint8_t )__builtin_ctz( *mask );
+
+    *mask &= *mask - 1;
+    return bit;
+}
 
-    for( uint8_t j = 0; j < nbBits; j++ )
+/*!
+ * \brief Elapsed time since a band update, for a time read once per call
+ *        (same result as TimerGetElapsedTime)
+ *
+ * \param [IN] currentTime Current time
+ * \param [IN] past        Time of the band update, 0 if none
+ *
+ * \retval elapsedTime      Elapsed time, 0 if past is 0
+ */
+static TimerTime_t GetElapsedTime( TimerTime_t currentTime, TimerTime_t past )
+{
+    if( past == 0 )
     {
-        if( ( mask & ( 1 << j ) ) == ( 1 << j ) )
-        {
-            nbActiveBits++;
-        }
+        return 0;
     }
-    return nbActiveBits;
+    return currentTime - past;
 }
 
 bool RegionCommonChanVerifyDr( uint8_t nbChannels, uint16_t* channelsMask, int8_t dr, int8_t minDr, int8_t maxDr, ChannelParams_t* channels )
@@ -194,16 +218,19 @@ bool RegionCommonChanVerifyDr( uint8_t nbChannels, uint16_t* channelsMask, int8_
 
     for( uint8_t i = 0, k = 0; i < nbChannels; i += 16, k++ )
     {
-        for( uint8_t j = 0; j < 16; j++ )
+        uint16_t mask = channelsMask[k];
+
+        // Only the enabled channels of the word are visited
+        while( mask != 0 )
         {
-            if( ( ( channelsMask[k] & ( 1 << j ) ) != 0 ) )
-            {// Check datarate validity for enabled channels
-                if( RegionCommonValueInRange( dr, ( channels[i + j].DrRange.Fields.Min & 0x0F ),
-                                                  ( channels[i + j].DrRange.Fields.Max & 0x0F ) ) == 1 )
-                {
-                    // At least 1 channel has been found we can return OK.
-                    return true;
-                }
+            uint8_t j = PopLowestChannel( &mask );
+
+            // Check datarate validity for enabled channels
+            if( RegionCommonValueInRange( dr, ( channels[i + j].DrRange.Fields.Min & 0x0F ),
+                                              ( channels[i + j].DrRange.Fields.Max & 0x0F ) ) == 1 )
+            {
+                // At least 1 channel has been found we can return OK.
+                return true;
             }
         }
     }
@@ -293,7 +320,7 @@ TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, Band_t* bands,
 
     for( uint8_t i = 0; i < nbBands; i++ )
     {
-        TimerTime_t elapsedTime = TimerGetElapsedTime( bands[i].LastBandUpdateTime );
+        TimerTime_t elapsedTime = GetElapsedTime( currentTime, bands[i].LastBandUpdateTime );
 
         // Synchronization of bands and credits
         dutyCycle = UpdateTimeCredits( &bands[i], joined, dutyCycleEnabled,
@@ -504,35 +531,36 @@ void RegionCommonCountNbOfEnabledChannels( RegionCommonCountNbOfEnabledChannelsP
 
     for( uint8_t i = 0, k = 0; i < countNbOfEnabledChannelsParams->MaxNbChannels; i += 16, k++ )
     {
-        for( uint8_t j = 0; j < 16; j++ )
+        uint16_t mask = countNbOfEnabledChannelsParams->ChannelsMask[k];
+
+        if( ( countNbOfEnabledChannelsParams->Joined == false ) &&
+            ( countNbOfEnabledChannelsParams->JoinChannels != NULL ) )
         {
-            if( ( countNbOfEnabledChannelsParams->ChannelsMask[k] & ( 1 << j ) ) != 0 )
-            {
-                if( countNbOfEnabledChannelsParams->Channels[i + j].Frequency == 0 )
-                { // Check if the channel is enabled
-                    continue;
-                }
-                if( ( countNbOfEnabledChannelsParams->Joined == false ) &&
-                    ( countNbOfEnabledChannelsParams->JoinChannels != NULL ) )
-                {
-                    if( ( countNbOfEnabledChannelsParams->JoinChannels[k] & ( 1 << j ) ) == 0 )
-                    {
-                        continue;
-                    }
-                }
-                if( RegionCommonValueInRange( countNbOfEnabledChannelsParams->Datarate,
-                                              countNbOfEnabledChannelsParams->Channels[i + j].DrRange.Fields.Min,
-                                              countNbOfEnabledChannelsParams->Channels[i + j].DrRange.Fields.Max ) == false )
-                { // Check if the current channel selection supports the given datarate
-                    continue;
-                }
-                if( countNbOfEnabledChannelsParams->Bands[countNbOfEnabledChannelsParams->Channels[i + j].Band].ReadyForTransmission == false )
-                { // Check if the band is available for transmission
-                    nbRestrictedChannelsCount++;
-                    continue;
-                }
-                enabledChannels[nbChannelCount++] = i + j;
+            mask &= countNbOfEnabledChannelsParams->JoinChannels[k];
+        }
+
+        // Visit the enabled channels of the word in increasing order
+        while( mask != 0 )
+        {
+            uint8_t j = PopLowestChannel( &mask );
+            ChannelParams_t* channel = &countNbOfEnabledChannelsParams->Channels[i + j];
+
+            if( channel->Frequency == 0 )
+            { // Check if the channel is enabled
+                continue;
+            }
+            if( RegionCommonValueInRange( countNbOfEnabledChannelsParams->Datarate,
+                                          channel->DrRange.Fields.Min,
+                                          channel->DrRange.Fields.Max ) == false )
+            { // Check if the current channel selection supports the given datarate
+                continue;
+            }
+            if( countNbOfEnabledChannelsParams->Bands[channel->Band].ReadyForTransmission == false )
+            { // Check if the band is available for transmission
+                nbRestrictedChannelsCount++;
+                continue;
             }
+            enabledChannels[nbChannelCount++] = i + j;
         }
     }
     *nbEnabledChannels = nbChannelCount;
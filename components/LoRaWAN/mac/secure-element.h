@@ -138,6 +138,19 @@ SecureElementStatus_t SecureElementVerifyAesCmac( uint8_t* buffer, uint16_t size
  */
 SecureElementStatus_t SecureElementAesEncrypt( uint8_t* buffer, uint16_t size, KeyIdentifier_t keyID, uint8_t* encBuffer );
 
+/*!
+ * Encrypts or decrypts a buffer in place in AES-CTR mode (LoRaWAN payload
+ * encryption): block i is XORed with aes128_encrypt(key, A_i), where A_i is
+ * ctrBlock with its last byte incremented i times.
+ *
+ * \param[IN]     ctrBlock       - First counter block A_1 (16 bytes), left unchanged
+ * \param[IN/OUT] buffer         - Data buffer
+ * \param[IN]     size           - Data buffer size, any length
+ * \param[IN]     keyID          - Key identifier to determine the AES key to be used
+ * \retval                       - Status of the operation
+ */
+SecureElementStatus_t SecureElementAesCtrEncrypt( uint8_t* ctrBlock, uint8_t* buffer, uint16_t size, KeyIdentifier_t keyID );
+
 /*!
  * Derives and store a key
  *
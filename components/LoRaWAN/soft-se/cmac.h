@@ -47,6 +47,7 @@ extern "C" {
  
 typedef struct _AES_CMAC_CTX {
             aes_context    rijndael;
+            const aes_context* schedule;    /* rijndael, or a schedule set by AES_CMAC_SetKeySchedule */
             uint8_t        X[16];
             uint8_t        M_last[16];
             uint32_t       M_n;
@@ -57,6 +58,8 @@ typedef struct _AES_CMAC_CTX {
 //__BEGIN_DECLS
 void     AES_CMAC_Init(AES_CMAC_CTX * ctx);
 void     AES_CMAC_SetKey(AES_CMAC_CTX * ctx, const uint8_t key[AES_CMAC_KEY_LENGTH]);
+/* Uses a key schedule expanded earlier by aes_set_key, which must outlive ctx */
+void     AES_CMAC_SetKeySchedule(AES_CMAC_CTX * ctx, const aes_context * keySchedule);
 void     AES_CMAC_Update(AES_CMAC_CTX * ctx, const uint8_t * data, uint32_t len);
           //          __attribute__((__bounded__(__string__,2,3)));
 void     AES_CMAC_Final(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX  * ctx);
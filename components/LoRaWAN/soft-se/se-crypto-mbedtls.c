@@ -0,0 +1,199 @@
+/*!
+ * \file      se-crypto-mbedtls.c
+ *
+ * \brief     Secure element AES backend on the mbedTLS AES API. With
+ *            CONFIG_MBEDTLS_HARDWARE_AES (ESP-IDF default) the blocks are
+ *            processed by the AES peripheral.
+ *
+ * \remark    CMAC is computed as a CBC-MAC over all blocks but the last one,
+ *            which lets the peripheral chain a whole frame in one call, plus
+ *            the RFC 4493 sub key step on the last block.
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+#include "utilities.h"
+#include "mbedtls/aes.h"
+#include "se-crypto.h"
+
+/*!
+ * Scratch buffer for the discarded CBC output, a 242 bytes frame plus its
+ * B0 block go through in one transfer
+ */
+#define SE_CRYPTO_CBC_CHUNK_SIZE                    256
+
+/*!
+ * Left shift of a CMAC sub key by one bit (RFC 4493, section 2.3)
+ *
+ * \param[IN/OUT] key         - 16 bytes sub key
+ */
+static void ShiftSubkey( uint8_t* key )
+{
+    uint8_t msb = key[0] & 0x80;
+
+    for( uint8_t i = 0; i < 15; i++ )
+    {
+        key[i] = ( uint8_t )( ( key[i] << 1 ) | ( key[i + 1] >> 7 ) );
+    }
+    key[15] = ( uint8_t )( key[15] << 1 );
+    if( msb != 0 )
+    {
+        key[15] ^= 0x87;
+    }
+}
+
+/*!
+ * Chains complete blocks into the CBC-MAC value
+ *
+ * \param[IN]     ctx         - Key context
+ * \param[IN/OUT] x           - CBC-MAC value (IV)
+ * \param[IN]     data        - Data buffer
+ * \param[IN]     size        - Data buffer size, multiple of 16
+ * \retval                    - Status of the operation
+ */
+static SecureElementStatus_t CbcMac( SeCryptoKey_t* ctx, uint8_t* x, const uint8_t* data, uint16_t size )
+{
+    uint8_t scratch[SE_CRYPTO_CBC_CHUNK_SIZE];
+
+    while( size > 0 )
+    {
+        uint16_t len = ( size > SE_CRYPTO_CBC_CHUNK_SIZE ) ? SE_CRYPTO_CBC_CHUNK_SIZE : size;
+
+        if( mbedtls_aes_crypt_cbc( ctx, MBEDTLS_AES_ENCRYPT, len, x, data, scratch ) != 0 )
+        {
+            return SECURE_ELEMENT_FAIL_CMAC;
+        }
+        data += len;
+        size -= len;
+    }
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+SecureElementStatus_t SeCryptoSetKey( SeCryptoKey_t* ctx, const uint8_t* key )
+{
+    mbedtls_aes_init( ctx );
+    if( mbedtls_aes_setkey_enc( ctx, key, 128 ) != 0 )
+    {
+        mbedtls_aes_free( ctx );
+        return SECURE_ELEMENT_ERROR;
+    }
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+void SeCryptoClearKey( SeCryptoKey_t* ctx )
+{
+    mbedtls_aes_free( ctx );
+}
+
+SecureElementStatus_t SeCryptoAesEcbEncrypt( SeCryptoKey_t* ctx, const uint8_t* input, uint16_t size,
+                                             uint8_t* output )
+{
+    if( ( size % 16 ) != 0 )
+    {
+        return SECURE_ELEMENT_ERROR_BUF_SIZE;
+    }
+
+    for( uint16_t block = 0; block < size; block += 16 )
+    {
+        if( mbedtls_aes_crypt_ecb( ctx, MBEDTLS_AES_ENCRYPT, &input[block], &output[block] ) != 0 )
+        {
+            return SECURE_ELEMENT_FAIL_ENCRYPT;
+        }
+    }
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+SecureElementStatus_t SeCryptoAesCtr( SeCryptoKey_t* ctx, const uint8_t* ctrBlock, uint8_t* buffer, uint16_t size )
+{
+    uint8_t  aBlock[16];
+    uint8_t  counter[16];
+    uint8_t  sBlock[16];
+    SecureElementStatus_t retval = SECURE_ELEMENT_SUCCESS;
+
+    memcpy1( aBlock, ctrBlock, 16 );
+
+    while( size > 0 )
+    {
+        // mbedTLS carries into byte 14 when the last byte wraps, LoRaWAN does
+        // not: run up to the wrap, then restart from a counter byte of 0
+        uint32_t toWrap = ( 256 - ( uint32_t )aBlock[15] ) * 16;
+        uint16_t len    = ( size > toWrap ) ? ( uint16_t )toWrap : size;
+        size_t   ncOff  = 0;
+
+        memcpy1( counter, aBlock, 16 );
+        if( mbedtls_aes_crypt_ctr( ctx, len, &ncOff, counter, sBlock, buffer, buffer ) != 0 )
+        {
+            retval = SECURE_ELEMENT_FAIL_ENCRYPT;
+            break;
+        }
+        aBlock[15] = 0;
+        buffer += len;
+        size -= len;
+    }
+    memset1( sBlock, 0, sizeof( sBlock ) );
+    return retval;
+}
+
+SecureElementStatus_t SeCryptoAesCmac( SeCryptoKey_t* ctx, const uint8_t* micBxBuffer, const uint8_t* buffer,
+                                       uint16_t size, uint8_t* cmac )
+{
+    uint8_t x[16]    = { 0 };
+    uint8_t key[16]  = { 0 };
+    uint8_t last[16] = { 0 };
+    SecureElementStatus_t retval;
+
+    // Sub key K1
+    if( mbedtls_aes_crypt_ecb( ctx, MBEDTLS_AES_ENCRYPT, key, key ) != 0 )
+    {
+        return SECURE_ELEMENT_FAIL_CMAC;
+    }
+    ShiftSubkey( key );
+
+    if( micBxBuffer != NULL )
+    {
+        if( size == 0 )
+        {
+            // The Bx block is the whole message
+            buffer = micBxBuffer;
+            size   = 16;
+        }
+        else if( ( retval = CbcMac( ctx, x, micBxBuffer, 16 ) ) != SECURE_ELEMENT_SUCCESS )
+        {
+            return retval;
+        }
+    }
+
+    // Everything but the last block, which may be complete or not
+    uint16_t headSize = ( size == 0 ) ? 0 : ( uint16_t )( ( ( size - 1 ) / 16 ) * 16 );
+    uint16_t lastSize = size - headSize;
+
+    if( ( retval = CbcMac( ctx, x, buffer, headSize ) ) != SECURE_ELEMENT_SUCCESS )
+    {
+        return retval;
+    }
+
+    memcpy1( last, &buffer[headSize], lastSize );
+    if( lastSize < 16 )
+    {
+        // Sub key K2 and padding
+        ShiftSubkey( key );
+        last[lastSize] = 0x80;
+    }
+    for( uint8_t i = 0; i < 16; i++ )
+    {
+        last[i] ^= key[i] ^ x[i];
+    }
+
+    if( mbedtls_aes_crypt_ecb( ctx, MBEDTLS_AES_ENCRYPT, last, cmac ) != 0 )
+    {
+        retval = SECURE_ELEMENT_FAIL_CMAC;
+    }
+    memset1( key, 0, sizeof( key ) );
+    memset1( last, 0, sizeof( last ) );
+    return retval;
+}
+
+const char* SeCryptoBackendName( void )
+{
+    return "mbedtls";
+}
@@ -0,0 +1,117 @@
+/*!
+ * \file      se-crypto-selftest.c
+ *
+ * \brief     Known-answer tests of the secure element AES backend, shared by
+ *            all backends and by host_test/soft_se
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "utilities.h"
+#include "se-crypto.h"
+
+/*
+ * FIPS-197 appendix C.1
+ */
+static const uint8_t Fips197Key[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t Fips197Plain[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const uint8_t Fips197Cipher[16] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+/*
+ * RFC 4493 section 4
+ */
+static const uint8_t Rfc4493Key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const uint8_t Rfc4493Message[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+static const struct
+{
+    uint16_t Size;
+    uint8_t  Cmac[16];
+} Rfc4493Cmac[] = {
+    { 0, { 0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28, 0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46 } },
+    { 16, { 0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44, 0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c } },
+    { 40, { 0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27 } },
+    { 64, { 0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92, 0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe } },
+};
+
+/*
+ * LoRaWAN payload encryption of bytes 0..49 with the RFC 4493 key, counter
+ * byte starting at 0xfe so it wraps to 0x00 without carry (generated with
+ * OpenSSL AES-128-ECB over the counter blocks)
+ */
+static const uint8_t CtrBlock[16] = {
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x11, 0x22, 0x33, 0x44, 0x2a, 0x00, 0x00, 0x00, 0x00, 0xfe
+};
+static const uint8_t CtrCipher[50] = {
+    0xb4, 0xef, 0xef, 0xa2, 0xe3, 0x9a, 0x30, 0x3d, 0x45, 0xe7, 0x51, 0xa4, 0x79, 0xdf, 0x17, 0xae,
+    0xb9, 0x72, 0x75, 0x19, 0xe2, 0xe5, 0x17, 0x65, 0xd8, 0x9a, 0x92, 0xed, 0x93, 0xc8, 0xf3, 0x27,
+    0xd7, 0x52, 0x0c, 0xc9, 0xf4, 0x3a, 0x26, 0xb9, 0x45, 0x29, 0xd1, 0x0e, 0x24, 0x19, 0xca, 0xce,
+    0x81, 0xe6
+};
+
+SecureElementStatus_t SeCryptoSelfTest( void )
+{
+    SeCryptoKey_t ctx;
+    uint8_t       out[64];
+    bool          ok = true;
+
+    // AES-ECB
+    if( SeCryptoSetKey( &ctx, Fips197Key ) != SECURE_ELEMENT_SUCCESS )
+    {
+        return SECURE_ELEMENT_ERROR;
+    }
+    ok &= ( SeCryptoAesEcbEncrypt( &ctx, Fips197Plain, 16, out ) == SECURE_ELEMENT_SUCCESS ) &&
+          ( memcmp( out, Fips197Cipher, 16 ) == 0 );
+    SeCryptoClearKey( &ctx );
+
+    if( SeCryptoSetKey( &ctx, Rfc4493Key ) != SECURE_ELEMENT_SUCCESS )
+    {
+        return SECURE_ELEMENT_ERROR;
+    }
+
+    // AES-CMAC, whole message and split after a 16 bytes Bx block
+    for( uint8_t i = 0; i < ( sizeof( Rfc4493Cmac ) / sizeof( Rfc4493Cmac[0] ) ); i++ )
+    {
+        uint16_t size = Rfc4493Cmac[i].Size;
+
+        ok &= ( SeCryptoAesCmac( &ctx, NULL, Rfc4493Message, size, out ) == SECURE_ELEMENT_SUCCESS ) &&
+              ( memcmp( out, Rfc4493Cmac[i].Cmac, 16 ) == 0 );
+        if( size >= 16 )
+        {
+            ok &= ( SeCryptoAesCmac( &ctx, Rfc4493Message, &Rfc4493Message[16], size - 16, out ) ==
+                    SECURE_ELEMENT_SUCCESS ) &&
+                  ( memcmp( out, Rfc4493Cmac[i].Cmac, 16 ) == 0 );
+        }
+    }
+
+    // AES-CTR across the counter wrap, and back
+    for( uint8_t i = 0; i < sizeof( CtrCipher ); i++ )
+    {
+        out[i] = i;
+    }
+    ok &= ( SeCryptoAesCtr( &ctx, CtrBlock, out, sizeof( CtrCipher ) ) == SECURE_ELEMENT_SUCCESS ) &&
+          ( memcmp( out, CtrCipher, sizeof( CtrCipher ) ) == 0 );
+    ok &= ( SeCryptoAesCtr( &ctx, CtrBlock, out, sizeof( CtrCipher ) ) == SECURE_ELEMENT_SUCCESS );
+    for( uint8_t i = 0; i < sizeof( CtrCipher ); i++ )
+    {
+        ok &= ( out[i] == i );
+    }
+
+    SeCryptoClearKey( &ctx );
+    memset1( out, 0, sizeof( out ) );
+
+    return ok ? SECURE_ELEMENT_SUCCESS : SECURE_ELEMENT_ERROR;
+}
@@ -0,0 +1,88 @@
+/*!
+ * \file      se-crypto-soft.c
+ *
+ * \brief     Secure element AES backend on the aes.c / cmac.c software
+ *            implementation
+ */
+#include <stdint.h>
+
+#include "utilities.h"
+#include "aes.h"
+#include "cmac.h"
+#include "se-crypto.h"
+
+SecureElementStatus_t SeCryptoSetKey( SeCryptoKey_t* ctx, const uint8_t* key )
+{
+    memset1( ( uint8_t* )ctx, 0, sizeof( SeCryptoKey_t ) );
+    if( aes_set_key( key, 16, ctx ) != 0 )
+    {
+        return SECURE_ELEMENT_ERROR;
+    }
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+void SeCryptoClearKey( SeCryptoKey_t* ctx )
+{
+    memset1( ( uint8_t* )ctx, 0, sizeof( SeCryptoKey_t ) );
+}
+
+SecureElementStatus_t SeCryptoAesEcbEncrypt( SeCryptoKey_t* ctx, const uint8_t* input, uint16_t size,
+                                             uint8_t* output )
+{
+    if( ( size % 16 ) != 0 )
+    {
+        return SECURE_ELEMENT_ERROR_BUF_SIZE;
+    }
+
+    for( uint16_t block = 0; block < size; block += 16 )
+    {
+        lorawan_aes_encrypt( &input[block], &output[block], ctx );
+    }
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+SecureElementStatus_t SeCryptoAesCtr( SeCryptoKey_t* ctx, const uint8_t* ctrBlock, uint8_t* buffer, uint16_t size )
+{
+    uint8_t aBlock[16];
+    uint8_t sBlock[16];
+
+    memcpy1( aBlock, ctrBlock, 16 );
+
+    while( size > 0 )
+    {
+        uint8_t len = ( size > 16 ) ? 16 : size;
+
+        lorawan_aes_encrypt( aBlock, sBlock, ctx );
+        for( uint8_t i = 0; i < len; i++ )
+        {
+            buffer[i] ^= sBlock[i];
+        }
+        aBlock[15]++;
+        buffer += len;
+        size -= len;
+    }
+    memset1( sBlock, 0, sizeof( sBlock ) );
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+SecureElementStatus_t SeCryptoAesCmac( SeCryptoKey_t* ctx, const uint8_t* micBxBuffer, const uint8_t* buffer,
+                                       uint16_t size, uint8_t* cmac )
+{
+    AES_CMAC_CTX aesCmacCtx[1];
+
+    AES_CMAC_Init( aesCmacCtx );
+    AES_CMAC_SetKeySchedule( aesCmacCtx, ctx );
+
+    if( micBxBuffer != NULL )
+    {
+        AES_CMAC_Update( aesCmacCtx, micBxBuffer, 16 );
+    }
+    AES_CMAC_Update( aesCmacCtx, buffer, size );
+    AES_CMAC_Final( cmac, aesCmacCtx );
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+const char* SeCryptoBackendName( void )
+{
+    return "software";
+}
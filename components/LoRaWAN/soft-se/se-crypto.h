@@ -0,0 +1,108 @@
+/*!
+ * \file      se-crypto.h
+ *
+ * \brief     AES-128 backend of the software secure element
+ *
+ * \remark    The backend is chosen at build time (menuconfig, LoRaWAN ->
+ *            Secure element crypto backend):
+ *            - se-crypto-soft.c   : aes.c / cmac.c table implementation
+ *            - se-crypto-mbedtls.c: mbedTLS AES API, which ESP-IDF routes to
+ *                                   the AES peripheral of the chip
+ *            Both produce bit-exact LoRaWAN results, checked by
+ *            SeCryptoSelfTest.
+ */
+#ifndef __SE_CRYPTO_H__
+#define __SE_CRYPTO_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "secure-element.h"
+
+#if defined( CONFIG_LORAWAN_SE_CRYPTO_MBEDTLS )
+#include "mbedtls/aes.h"
+
+/*!
+ * Key context of the backend, set up once per key by SeCryptoSetKey
+ */
+typedef mbedtls_aes_context SeCryptoKey_t;
+#else
+#include "aes.h"
+
+typedef aes_context SeCryptoKey_t;
+#endif
+
+/*!
+ * Sets up a key context for an AES-128 key
+ *
+ * \param[OUT] ctx            - Key context
+ * \param[IN]  key            - 16 bytes key
+ * \retval                    - Status of the operation
+ */
+SecureElementStatus_t SeCryptoSetKey( SeCryptoKey_t* ctx, const uint8_t* key );
+
+/*!
+ * Releases and wipes a key context set up by SeCryptoSetKey
+ *
+ * \param[IN]  ctx            - Key context
+ */
+void SeCryptoClearKey( SeCryptoKey_t* ctx );
+
+/*!
+ * AES-ECB encrypts a buffer
+ *
+ * \param[IN]  ctx            - Key context
+ * \param[IN]  input          - Data buffer
+ * \param[IN]  size           - Data buffer size, multiple of 16
+ * \param[OUT] output         - Encrypted buffer, may be input
+ * \retval                    - Status of the operation
+ */
+SecureElementStatus_t SeCryptoAesEcbEncrypt( SeCryptoKey_t* ctx, const uint8_t* input, uint16_t size,
+                                             uint8_t* output );
+
+/*!
+ * AES-CTR encrypts or decrypts a buffer in place, LoRaWAN style: only the
+ * last byte of the counter block is incremented and it wraps without carry.
+ *
+ * \param[IN]     ctx         - Key context
+ * \param[IN]     ctrBlock    - First counter block (16 bytes), left unchanged
+ * \param[IN/OUT] buffer      - Data buffer
+ * \param[IN]     size        - Data buffer size, any length
+ * \retval                    - Status of the operation
+ */
+SecureElementStatus_t SeCryptoAesCtr( SeCryptoKey_t* ctx, const uint8_t* ctrBlock, uint8_t* buffer, uint16_t size );
+
+/*!
+ * Computes the AES-CMAC (RFC 4493) of micBxBuffer | buffer
+ *
+ * \param[IN]  ctx            - Key context
+ * \param[IN]  micBxBuffer    - Initial 16 bytes Bx block, NULL if none
+ * \param[IN]  buffer         - Data buffer
+ * \param[IN]  size           - Data buffer size
+ * \param[OUT] cmac           - 16 bytes CMAC
+ * \retval                    - Status of the operation
+ */
+SecureElementStatus_t SeCryptoAesCmac( SeCryptoKey_t* ctx, const uint8_t* micBxBuffer, const uint8_t* buffer,
+                                       uint16_t size, uint8_t* cmac );
+
+/*!
+ * \retval                    - Name of the backend, for logs
+ */
+const char* SeCryptoBackendName( void );
+
+/*!
+ * Runs the known-answer tests (FIPS-197, RFC 4493 and LoRaWAN counter
+ * wrap-around) against the selected backend
+ *
+ * \retval                    - SECURE_ELEMENT_SUCCESS if all results match
+ */
+SecureElementStatus_t SeCryptoSelfTest( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //  __SE_CRYPTO_H__
@@ -25,20 +25,40 @@
  */
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
 
 #include "utilities.h"
-#include "aes.h"
-#include "cmac.h"
 
 #include "LoRaMacHeaderTypes.h"
 
 #include "secure-element.h"
 #include "secure-element-nvm.h"
+#include "se-crypto.h"
 #include "se-identity.h"
 #include "soft-se-hal.h"
 
 static SecureElementNvmData_t* SeNvm;
 
+/*
+ * Expanded AES key schedule (backend key context) of a key list entry
+ *
+ * \remark The key it was expanded from is kept as well: the key list is not
+ *         only written by SecureElementSetKey, the MAC also restores it as a
+ *         whole from its NVM context.
+ */
+typedef struct sKeySchedule
+{
+    bool          IsValid;
+    uint8_t       KeyValue[SE_KEY_SIZE];
+    SeCryptoKey_t Context;
+} KeySchedule_t;
+
+/*
+ * Key schedules, same order as SeNvm->KeyList
+ */
+static KeySchedule_t KeySchedules[NUM_OF_KEYS];
+
 /*
  * Local functions
  */
@@ -63,6 +83,54 @@ static SecureElementStatus_t GetKeyByID( KeyIdentifier_t keyID, Key_t** keyItem
     return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
 }
 
+/*
+ * Forgets the key schedule of a key list entry
+ *
+ * \param[IN]  index          - Index in the key list
+ */
+static void InvalidateKeySchedule( uint8_t index )
+{
+    if( KeySchedules[index].IsValid == true )
+    {
+        SeCryptoClearKey( &KeySchedules[index].Context );
+    }
+    memset1( ( uint8_t* )&KeySchedules[index], 0, sizeof( KeySchedule_t ) );
+}
+
+/*
+ * Gets the expanded key schedule of a key, expands it on first use or
+ * after the key changed.
+ *
+ * \param[IN]  keyID          - Key identifier
+ * \param[OUT] keySchedule    - Key schedule reference
+ * \retval                    - Status of the operation
+ */
+static SecureElementStatus_t GetKeySchedule( KeyIdentifier_t keyID, SeCryptoKey_t** keySchedule )
+{
+    Key_t*                keyItem;
+    SecureElementStatus_t retval = GetKeyByID( keyID, &keyItem );
+
+    if( retval == SECURE_ELEMENT_SUCCESS )
+    {
+        uint8_t        index = ( uint8_t )( keyItem - SeNvm->KeyList );
+        KeySchedule_t* sched = &KeySchedules[index];
+
+        if( ( sched->IsValid == false ) || ( memcmp( sched->KeyValue, keyItem->KeyValue, SE_KEY_SIZE ) != 0 ) )
+        {
+            InvalidateKeySchedule( index );
+            retval = SeCryptoSetKey( &sched->Context, keyItem->KeyValue );
+            if( retval != SECURE_ELEMENT_SUCCESS )
+            {
+                return retval;
+            }
+            memcpy1( sched->KeyValue, keyItem->KeyValue, SE_KEY_SIZE );
+            sched->IsValid = true;
+        }
+        *keySchedule = &sched->Context;
+    }
+    return retval;
+}
+
 /*
  * Computes a CMAC of a message using provided initial Bx block
  *
@@ -84,26 +152,17 @@ static SecureElementStatus_t ComputeCmac( uint8_t* micBxBuffer, uint8_t* buffer,
     }
 
     uint8_t Cmac[16];
-    AES_CMAC_CTX aesCmacCtx[1];
 
-    AES_CMAC_Init( aesCmacCtx );
-
-    Key_t*                keyItem;
-    SecureElementStatus_t retval = GetKeyByID( keyID, &keyItem );
+    SeCryptoKey_t*        keySchedule;
+    SecureElementStatus_t retval = GetKeySchedule( keyID, &keySchedule );
 
     if( retval == SECURE_ELEMENT_SUCCESS )
     {
-        AES_CMAC_SetKey( aesCmacCtx, keyItem->KeyValue );
-
-        if( micBxBuffer != NULL )
-        {
-            AES_CMAC_Update( aesCmacCtx, micBxBuffer, 16 );
-        }
-
-        AES_CMAC_Update( aesCmacCtx, buffer, size );
-
-        AES_CMAC_Final( Cmac, aesCmacCtx );
+        retval = SeCryptoAesCmac( keySchedule, micBxBuffer, buffer, size, Cmac );
+    }
 
+    if( retval == SECURE_ELEMENT_SUCCESS )
+    {
         // Bring into the required format
         *cmac = ( uint32_t )( ( uint32_t ) Cmac[3] << 24 | ( uint32_t ) Cmac[2] << 16 | ( uint32_t ) Cmac[1] << 8 |
                               ( uint32_t ) Cmac[0] );
@@ -153,6 +212,18 @@ SecureElementStatus_t SecureElementInit( SecureElementNvmData_t* nvm )
     // Initialize data
     memcpy1( ( uint8_t* )SeNvm, ( uint8_t* )&seNvmInit, sizeof( seNvmInit ) );
 
+    for( uint8_t i = 0; i < NUM_OF_KEYS; i++ )
+    {
+        InvalidateKeySchedule( i );
+    }
+
+#if defined( CONFIG_LORAWAN_SE_CRYPTO_SELFTEST )
+    if( SeCryptoSelfTest( ) != SECURE_ELEMENT_SUCCESS )
+    {
+        return SECURE_ELEMENT_ERROR;
+    }
+#endif
+
 #if !defined( SECURE_ELEMENT_PRE_PROVISIONED )
 #if( STATIC_DEVICE_EUI == 0 )
     // Get a DevEUI from MCU unique ID
@@ -173,6 +244,8 @@ SecureElementStatus_t SecureElementSetKey( KeyIdentifier_t keyID, uint8_t* key )
     {
         if( SeNvm->KeyList[i].KeyID == keyID )
         {
+            InvalidateKeySchedule( i );
+
             if( ( keyID == MC_KEY_0 ) || ( keyID == MC_KEY_1 ) || ( keyID == MC_KEY_2 ) || ( keyID == MC_KEY_3 ) )
             {  // Decrypt the key if its a Mckey
                 SecureElementStatus_t retval           = SECURE_ELEMENT_ERROR;
@@ -244,24 +317,30 @@ SecureElementStatus_t SecureElementAesEncrypt( uint8_t* buffer, uint16_t size, K
         return SECURE_ELEMENT_ERROR_BUF_SIZE;
     }
 
-    aes_context aesContext;
-    memset1( aesContext.ksch, '\0', 240 );
-
-    Key_t*                pItem;
-    SecureElementStatus_t retval = GetKeyByID( keyID, &pItem );
+    SeCryptoKey_t*        keySchedule;
+    SecureElementStatus_t retval = GetKeySchedule( keyID, &keySchedule );
 
     if( retval == SECURE_ELEMENT_SUCCESS )
     {
-        aes_set_key( pItem->KeyValue, 16, &aesContext );
+        retval = SeCryptoAesEcbEncrypt( keySchedule, buffer, size, encBuffer );
+    }
+    return retval;
+}
 
-        uint8_t block = 0;
+SecureElementStatus_t SecureElementAesCtrEncrypt( uint8_t* ctrBlock, uint8_t* buffer, uint16_t size,
+                                                  KeyIdentifier_t keyID )
+{
+    if( ( ctrBlock == NULL ) || ( buffer == NULL ) )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
 
-        while( size != 0 )
-        {
-            lorawan_aes_encrypt( &buffer[block], &encBuffer[block], &aesContext );
-            block = block + 16;
-            size  = size - 16;
-        }
+    SeCryptoKey_t*        keySchedule;
+    SecureElementStatus_t retval = GetKeySchedule( keyID, &keySchedule );
+
+    if( retval == SECURE_ELEMENT_SUCCESS )
+    {
+        retval = SeCryptoAesCtr( keySchedule, ctrBlock, buffer, size );
     }
     return retval;
 }
@@ -279,6 +279,8 @@ typedef struct {
     bool TOUCH_PANEL_INVERSE_Y;
     int TOUCH_PANEL_I2C_ADDR;
     bool TOUCH_WITH_HOME_BUTTON;
+    bool TOUCH_PANEL_INT_EN;            // TP INT is wired to an IO expander input
+    int TOUCH_PANEL_INT_EXPANDER_IO;    // Expander pin of TP INT (active low)
 
     bool BSP_BUTTON_EN;
     adc1_channel_t BUTTON_ADC_CHAN; // only use for adc button
@@ -287,6 +289,8 @@ typedef struct {
 
     bool FUNC_IO_EXPANDER_EN;
     uint8_t IO_EXPANDER_I2C_ADDR;
+    bool FUNC_IO_EXPANDER_INT_EN;
+    int GPIO_IO_EXPANDER_INT;           // Expander INT output (open drain, active low)
 
     /**
      * @brief ESP-Dev-Board I2C GPIO defineation
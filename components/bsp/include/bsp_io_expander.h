@@ -0,0 +1,36 @@
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Handler called from the IO expander INT line ISR
+ * 
+ * @note Runs in interrupt context, it must be placed in IRAM and must not
+ *       touch the I2C bus. Read the expander input port from a task instead.
+ */
+typedef void (*bsp_io_expander_isr_t)(void *arg);
+
+/**
+ * @brief Add a handler for the IO expander INT line
+ * 
+ * The INT line is shared by every expander input (touch panel, radio DIO1...),
+ * so each handler has to check its own pin level to find out what changed.
+ * The expander releases INT once its input port is read.
+ * 
+ * @param isr Handler called on the falling edge of INT
+ * @param arg User data passed to the handler
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_NOT_SUPPORTED: The board has no expander INT line
+ *    - ESP_ERR_NO_MEM: Too many handlers
+ *    - Others: Fail
+ */
+esp_err_t bsp_io_expander_isr_add(bsp_io_expander_isr_t isr, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
@@ -25,6 +25,7 @@
 
 static const char *TAG = "board sensecap";
 
+#define EXPANDER_IO_TP_INT      6
 #define EXPANDER_IO_TP_RESET    7
 #define EXPANDER_IO_LCD_CS      4
 #define EXPANDER_IO_LCD_RESET   5
@@ -157,6 +158,10 @@ static const board_res_desc_t g_board_lcd_evb_res = {
 
     .TOUCH_PANEL_I2C_ADDR = 0,
     .TOUCH_WITH_HOME_BUTTON = 0,
+#if CONFIG_SENSECAP_INDICATOR_TOUCH_INT
+    .TOUCH_PANEL_INT_EN = (1),
+#endif
+    .TOUCH_PANEL_INT_EXPANDER_IO = EXPANDER_IO_TP_INT,
 
     .BSP_BUTTON_EN =   (1),
     .BUTTON_TAB =  g_btns,
@@ -217,6 +222,8 @@ static const board_res_desc_t g_board_lcd_evb_res = {
 
     .FUNC_IO_EXPANDER_EN = true,
     .IO_EXPANDER_I2C_ADDR = 0x20,
+    .FUNC_IO_EXPANDER_INT_EN = true,
+    .GPIO_IO_EXPANDER_INT = (GPIO_NUM_42),
 
     .codec_ops = NULL,
     .io_expander_ops = &g_board_lcd_evb_io_expander_ops,
@@ -125,6 +125,72 @@ esp_err_t indev_tp_get_dev(char **dev_name, uint8_t *dev_addr)
     return ESP_FAIL;
 }
 
+esp_err_t indev_tp_int_register(bsp_io_expander_isr_t isr, void *arg)
+{
+    const board_res_desc_t *brd = bsp_board_get_description();
+
+    if (!brd->TOUCH_PANEL_INT_EN || NULL == brd->io_expander_ops) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (tp_dev_id < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret_val = ESP_OK;
+
+    switch (tp_dev_list[tp_dev_id].dev_vendor) {
+    case TP_VENDOR_FT:
+        /* Keep INT low for the whole touch so only press and release raise an edge */
+        ret_val = ft5x06_set_int_mode(ft5x06_int_mode_polling);
+        break;
+    case TP_VENDOR_TT:
+    case TP_VENDOR_GOODIX:
+        /* INT asserted on every new report by default, nothing to configure */
+        break;
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (ESP_OK != ret_val) {
+        return ret_val;
+    }
+
+    brd->io_expander_ops->set_direction(brd->TOUCH_PANEL_INT_EXPANDER_IO, 0);
+    ret_val = bsp_io_expander_isr_add(isr, arg);
+    if (ESP_OK != ret_val) {
+        return ret_val;
+    }
+
+    /* Release INT in case an edge is already latched */
+    indev_tp_int_ack(NULL);
+
+    ESP_LOGI(TAG, "Touch panel INT on expander IO%d", brd->TOUCH_PANEL_INT_EXPANDER_IO);
+    return ESP_OK;
+}
+
+esp_err_t indev_tp_int_ack(bool *tp_int)
+{
+    static bool last_level = true;
+    const board_res_desc_t *brd = bsp_board_get_description();
+    uint16_t pin_val = 0;
+
+    esp_err_t ret_val = brd->io_expander_ops->read_input_pins(&pin_val);
+    if (ESP_OK != ret_val) {
+        /* Unknown source, let the caller read the panel */
+        if (tp_int) {
+            *tp_int = true;
+        }
+        return ret_val;
+    }
+
+    /* INT is active low; a level change also catches a release */
+    bool level = !!(pin_val & (0x01 << brd->TOUCH_PANEL_INT_EXPANDER_IO));
+    if (tp_int) {
+        *tp_int = !level || level != last_level;
+    }
+    last_level = level;
+    return ESP_OK;
+}
+
 esp_err_t indev_tp_read(uint8_t *tp_num, uint16_t *x, uint16_t *y, uint8_t *btn_val)
 {
     if (tp_dev_id < 0) {
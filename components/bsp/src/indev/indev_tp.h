@@ -7,7 +7,9 @@
 #pragma once
 
 #include "esp_err.h"
+#include <stdbool.h>
 #include <stdint.h>
+#include "bsp_io_expander.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,6 +40,37 @@ esp_err_t indev_tp_read(uint8_t *tp_num, uint16_t *x, uint16_t *y, uint8_t *btn_
 
 esp_err_t indev_tp_get_dev(char **dev_name, uint8_t *dev_addr);
 
+/**
+ * @brief Register a handler for the touch panel INT line
+ * 
+ * Puts the touch IC in a mode where INT stays asserted while the panel is
+ * touched and hooks `isr` on the IO expander INT line.
+ * 
+ * @param isr Handler called from ISR context on every expander INT edge
+ * @param arg User data
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_NOT_SUPPORTED: TP INT not wired on this board, keep polling
+ *    - Others: Fail
+ */
+esp_err_t indev_tp_int_register(bsp_io_expander_isr_t isr, void *arg);
+
+/**
+ * @brief Acknowledge a touch panel interrupt
+ * 
+ * Reads the IO expander input port, which releases the shared INT line.
+ * Call it from task context after the handler fired. The line is shared with
+ * the radio, so the edge may not come from the touch panel at all.
+ * 
+ * @param tp_int Set to true if TP INT is asserted or changed since the last
+ *               ack, false if the edge came from another expander input.
+ *               May be NULL.
+ * @return
+ *    - ESP_OK: Success
+ *    - Others: Fail
+ */
+esp_err_t indev_tp_int_ack(bool *tp_int);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,60 @@
+#include <stddef.h>
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "driver/gpio.h"
+#include "bsp_board.h"
+#include "bsp_io_expander.h"
+
+#define IO_EXPANDER_ISR_MAX     (4)
+
+static const char *TAG = "bsp io expander";
+
+typedef struct {
+    bsp_io_expander_isr_t isr;
+    void *arg;
+} io_expander_isr_t;
+
+static io_expander_isr_t g_isr_tab[IO_EXPANDER_ISR_MAX];
+static volatile size_t g_isr_num = 0;
+static portMUX_TYPE g_isr_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void IRAM_ATTR io_expander_isr_handler(void *arg)
+{
+    for (size_t i = 0; i < g_isr_num; i++) {
+        g_isr_tab[i].isr(g_isr_tab[i].arg);
+    }
+}
+
+esp_err_t bsp_io_expander_isr_add(bsp_io_expander_isr_t isr, void *arg)
+{
+    const board_res_desc_t *brd = bsp_board_get_description();
+
+    ESP_RETURN_ON_FALSE(NULL != isr, ESP_ERR_INVALID_ARG, TAG, "isr is NULL");
+    ESP_RETURN_ON_FALSE(brd->FUNC_IO_EXPANDER_INT_EN, ESP_ERR_NOT_SUPPORTED, TAG, "No expander INT line");
+    ESP_RETURN_ON_FALSE(g_isr_num < IO_EXPANDER_ISR_MAX, ESP_ERR_NO_MEM, TAG, "Too many expander INT handlers");
+
+    if (0 == g_isr_num) {
+        gpio_config_t io_conf = {
+            .intr_type = GPIO_INTR_NEGEDGE,
+            .pin_bit_mask = (1ULL << brd->GPIO_IO_EXPANDER_INT),
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = GPIO_PULLUP_ENABLE,
+        };
+        ESP_RETURN_ON_ERROR(gpio_config(&io_conf), TAG, "Failed config expander INT gpio");
+
+        /* ISR service may already be installed by another driver */
+        esp_err_t ret = gpio_install_isr_service(0);
+        ESP_RETURN_ON_FALSE(ESP_OK == ret || ESP_ERR_INVALID_STATE == ret, ret, TAG, "Failed install gpio isr service");
+        ESP_RETURN_ON_ERROR(gpio_isr_handler_add(brd->GPIO_IO_EXPANDER_INT, io_expander_isr_handler, NULL),
+                            TAG, "Failed add expander INT isr");
+    }
+
+    /* Fill the slot before publishing it to the ISR */
+    portENTER_CRITICAL(&g_isr_lock);
+    g_isr_tab[g_isr_num].isr = isr;
+    g_isr_tab[g_isr_num].arg = arg;
+    g_isr_num++;
+    portEXIT_CRITICAL(&g_isr_lock);
+
+    return ESP_OK;
+}
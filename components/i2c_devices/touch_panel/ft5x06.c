@@ -158,3 +158,12 @@ esp_err_t fx5x06_read_gesture(ft5x06_gesture_t *gesture)
 {
     return ft5x06_read_byte(FT5x06_GESTURE_ID, (uint8_t *)gesture);
 }
+
+esp_err_t ft5x06_set_int_mode(ft5x06_int_mode_t mode)
+{
+    if (NULL == ft5x06_handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return ft5x06_write_byte(FT5x06_ID_G_MODE, (uint8_t)mode);
+}
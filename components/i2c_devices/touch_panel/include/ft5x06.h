@@ -23,6 +23,11 @@ typedef enum {
     ft5x06_gesture_zoom_out     = 0x49,
 } ft5x06_gesture_t;
 
+typedef enum {
+    ft5x06_int_mode_polling     = 0x00, /* INT held low while the panel is touched */
+    ft5x06_int_mode_trigger     = 0x01, /* INT pulsed on every new report */
+} ft5x06_int_mode_t;
+
 /**
  * @brief Init FT5x06 series touch panel
  * 
@@ -54,6 +59,16 @@ esp_err_t ft5x06_read_pos(uint8_t *touch_points_num, uint16_t *x, uint16_t *y);
  */
 esp_err_t fx5x06_read_gesture(ft5x06_gesture_t *gesture);
 
+/**
+ * @brief Set how FT5x06 drives its INT line
+ * 
+ * @param mode Interrupt mode, see `ft5x06_int_mode_t`
+ * @return 
+ *    - ESP_OK: Success
+ *    - Others: Fail
+ */
+esp_err_t ft5x06_set_int_mode(ft5x06_int_mode_t mode);
+
 #ifdef __cplusplus
 }
 #endif
@@ -265,6 +265,80 @@ int lgw_radio_setup( void )
     return LGW_HAL_SUCCESS;
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int lgw_send_locked( struct lgw_pkt_tx_s* pkt_data )
+{
+    /* Update RX status */
+    rx_status = RX_SUSPENDED;
+
+    /* Configure for TX */
+    lgw_radio_configure_tx( &lgw_ral, pkt_data );
+
+    /* Update TX status */
+    tx_status = TX_SCHEDULED;
+
+    /* Get TCXO startup time, if any */
+    uint32_t tcxo_startup_time_in_tick = 0;
+#if defined( CONFIG_RADIO_TYPE_SX1261 ) || defined( CONFIG_RADIO_TYPE_SX1262 ) || defined( CONFIG_RADIO_TYPE_SX1268 )
+    ral_sx126x_bsp_get_xosc_cfg( NULL, NULL, NULL, &tcxo_startup_time_in_tick );
+#elif defined( CONFIG_RADIO_TYPE_LLCC68 )
+    ral_llcc68_bsp_get_xosc_cfg( NULL, NULL, NULL, &tcxo_startup_time_in_tick );
+#elif defined( CONFIG_RADIO_TYPE_LR1121 )
+    ral_lr11xx_bsp_get_xosc_cfg( NULL, NULL, NULL, &tcxo_startup_time_in_tick );
+#endif
+    uint32_t tcxo_startup_time_us = tcxo_startup_time_in_tick * 15625 / 1000;
+
+    /* Wait for time to send packet */
+    uint32_t count_us_now;
+    do
+    {
+        lgw_get_instcnt( &count_us_now );
+        WAIT_US( 100 );
+    } while( ( int32_t )( pkt_data->count_us - count_us_now ) > ( int32_t ) tcxo_startup_time_us );
+
+    /* Send packet */
+    ASSERT_RAL_RC( ral_set_tx( &lgw_ral ) );
+
+    /* Update TX status */
+    tx_status = TX_EMITTING;
+
+    /* Wait for TX_DONE */
+    bool      flag_tx_done    = false;
+    bool      flag_tx_timeout = false;
+    ral_irq_t irq_regs;
+    do
+    {
+        ASSERT_RAL_RC( ral_get_and_clear_irq_status( &lgw_ral, &irq_regs ) );
+        if( ( irq_regs & RAL_IRQ_TX_DONE ) == RAL_IRQ_TX_DONE )
+        {
+            lgw_get_instcnt( &count_us_now );
+            printf( "%lu: IRQ_TX_DONE\n", count_us_now );
+            flag_tx_done = true;
+        }
+        if( ( irq_regs & RAL_IRQ_RX_TIMEOUT ) == RAL_IRQ_RX_TIMEOUT )
+        {  // TODO: check if IRQ also valid for TX
+            lgw_get_instcnt( &count_us_now );
+            ESP_LOGW( TAG_HAL, "%lu: TX:IRQ_TIMEOUT\n", count_us_now );
+            flag_tx_timeout = true;
+        }
+
+        /* Yield for 10ms (avoid TWDT watchdog timeout) for long TX */
+        vTaskDelay( pdMS_TO_TICKS( 10 ) );
+    } while( ( flag_tx_done == false ) && ( flag_tx_timeout == false ) );
+
+    /* Update TX status */
+    tx_status = TX_FREE;
+
+    /* Back to RX config */
+    lgw_radio_set_rx( &lgw_ral, rxrf_conf.freq_hz, rxif_conf.datarate, rxif_conf.bandwidth, rxif_conf.coderate );
+
+    /* Update RX status */
+    rx_status = RX_ON;
+
+    return ( flag_tx_timeout == false ) ? LGW_HAL_SUCCESS : LGW_HAL_ERROR;
+}
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
@@ -348,10 +422,12 @@ int lgw_start( void )
         return LGW_HAL_ERROR;
     }
 
-    /* Configure radio */
+    /* Configure radio, the RX task of a previous start may still be running */
+    lgw_radio_lock( );
     err = lgw_radio_setup( );
     if( err == LGW_HAL_ERROR )
     {
+        lgw_radio_unlock( );
         ESP_LOGE( TAG_HAL, "ERROR: FAILED TO SETUP RADIO\n" );
         return LGW_HAL_ERROR;
     }
@@ -361,6 +437,7 @@ int lgw_start( void )
 
     /* Set RX */
     lgw_radio_set_rx( &lgw_ral, rxrf_conf.freq_hz, rxif_conf.datarate, rxif_conf.bandwidth, rxif_conf.coderate );
+    lgw_radio_unlock( );
 
     /* Update RX status */
     rx_status = RX_ON;
@@ -401,15 +478,7 @@ int lgw_stop( void )
 
 int lgw_receive( uint8_t max_pkt, struct lgw_pkt_rx_s* pkt_data )
 {
-    struct lgw_pkt_rx_s* p = &pkt_data[0];
-    uint32_t             count_us;
-    int8_t               rssi, snr;
-    uint8_t              status;
-    uint16_t             size;
-    bool                 irq_received;
-    int                  nb_packet_received = 0;
-
-    /* max_pkt is ignored, only 1 packet can be received at a time */
+    int nb_packet_received;
 
     /* check if the concentrator is running */
     if( is_started == false )
@@ -418,36 +487,28 @@ int lgw_receive( uint8_t max_pkt, struct lgw_pkt_rx_s* pkt_data )
         return LGW_HAL_ERROR;
     }
 
-    memset( p, 0, sizeof( struct lgw_pkt_rx_s ) );
-    nb_packet_received =
-        lgw_radio_get_pkt( &lgw_ral, &irq_received, &count_us, &rssi, &snr, &status, &size, p->payload );
-    if( nb_packet_received > 0 )
+    /* Packets were fetched by the RX task on their IRQ, the radio stays in RX */
+    nb_packet_received = lgw_radio_get_pkts( max_pkt, pkt_data );
+
+    /* Compensate timestamp with for radio processing delay */
+    uint32_t count_us_correction = lgw_radio_timestamp_correction( rxif_conf.datarate, rxif_conf.bandwidth );
+
+    for( int i = 0; i < nb_packet_received; i++ )
     {
-        p->count_us   = count_us;
+        struct lgw_pkt_rx_s* p = &pkt_data[i];
+
         p->freq_hz    = rxrf_conf.freq_hz;
         p->if_chain   = 0;
         p->rf_chain   = 0;
-        p->status     = status;
         p->modulation = rxif_conf.modulation;
         p->datarate   = rxif_conf.datarate;
         p->bandwidth  = rxif_conf.bandwidth;
         p->coderate   = rxif_conf.coderate;
-        p->rssic      = ( float ) rssi;
-        p->snr        = ( float ) snr;
-        p->size       = size;
 
-        /* Compensate timestamp with for radio processing delay */
-        uint32_t count_us_correction = lgw_radio_timestamp_correction( rxif_conf.datarate, rxif_conf.bandwidth );
         ESP_LOGI( TAG_HAL, "count_us correction: %lu us", count_us_correction );
         p->count_us -= count_us_correction;
     }
 
-    if( irq_received == true )
-    {
-        /* Reconfigure RX */
-        lgw_radio_set_rx( &lgw_ral, rxrf_conf.freq_hz, rxif_conf.datarate, rxif_conf.bandwidth, rxif_conf.coderate );
-    }
-
     return nb_packet_received;
 };
 
@@ -455,6 +516,8 @@ int lgw_receive( uint8_t max_pkt, struct lgw_pkt_rx_s* pkt_data )
 
 int lgw_send( struct lgw_pkt_tx_s* pkt_data )
 {
+    int err;
+
     /* check if the concentrator is running */
     if( is_started == false )
     {
@@ -462,74 +525,12 @@ int lgw_send( struct lgw_pkt_tx_s* pkt_data )
         return LGW_HAL_ERROR;
     }
 
-    /* Update RX status */
-    rx_status = RX_SUSPENDED;
-
-    /* Configure for TX */
-    lgw_radio_configure_tx( &lgw_ral, pkt_data );
-
-    /* Update TX status */
-    tx_status = TX_SCHEDULED;
-
-    /* Get TCXO startup time, if any */
-    uint32_t tcxo_startup_time_in_tick = 0;
-#if defined( CONFIG_RADIO_TYPE_SX1261 ) || defined( CONFIG_RADIO_TYPE_SX1262 ) || defined( CONFIG_RADIO_TYPE_SX1268 )
-    ral_sx126x_bsp_get_xosc_cfg( NULL, NULL, NULL, &tcxo_startup_time_in_tick );
-#elif defined( CONFIG_RADIO_TYPE_LLCC68 )
-    ral_llcc68_bsp_get_xosc_cfg( NULL, NULL, NULL, &tcxo_startup_time_in_tick );
-#elif defined( CONFIG_RADIO_TYPE_LR1121 )
-    ral_lr11xx_bsp_get_xosc_cfg( NULL, NULL, NULL, &tcxo_startup_time_in_tick );
-#endif
-    uint32_t tcxo_startup_time_us = tcxo_startup_time_in_tick * 15625 / 1000;
-
-    /* Wait for time to send packet */
-    uint32_t count_us_now;
-    do
-    {
-        lgw_get_instcnt( &count_us_now );
-        WAIT_US( 100 );
-    } while( ( int32_t )( pkt_data->count_us - count_us_now ) > ( int32_t ) tcxo_startup_time_us );
-
-    /* Send packet */
-    ASSERT_RAL_RC( ral_set_tx( &lgw_ral ) );
-
-    /* Update TX status */
-    tx_status = TX_EMITTING;
+    /* Keep the RX task off the radio until it is back in RX */
+    lgw_radio_lock( );
+    err = lgw_send_locked( pkt_data );
+    lgw_radio_unlock( );
 
-    /* Wait for TX_DONE */
-    bool      flag_tx_done    = false;
-    bool      flag_tx_timeout = false;
-    ral_irq_t irq_regs;
-    do
-    {
-        ASSERT_RAL_RC( ral_get_and_clear_irq_status( &lgw_ral, &irq_regs ) );
-        if( ( irq_regs & RAL_IRQ_TX_DONE ) == RAL_IRQ_TX_DONE )
-        {
-            lgw_get_instcnt( &count_us_now );
-            printf( "%lu: IRQ_TX_DONE\n", count_us_now );
-            flag_tx_done = true;
-        }
-        if( ( irq_regs & RAL_IRQ_RX_TIMEOUT ) == RAL_IRQ_RX_TIMEOUT )
-        {  // TODO: check if IRQ also valid for TX
-            lgw_get_instcnt( &count_us_now );
-            ESP_LOGW( TAG_HAL, "%lu: TX:IRQ_TIMEOUT\n", count_us_now );
-            flag_tx_timeout = true;
-        }
-
-        /* Yield for 10ms (avoid TWDT watchdog timeout) for long TX */
-        vTaskDelay( pdMS_TO_TICKS( 10 ) );
-    } while( ( flag_tx_done == false ) && ( flag_tx_timeout == false ) );
-
-    /* Update TX status */
-    tx_status = TX_FREE;
-
-    /* Back to RX config */
-    lgw_radio_set_rx( &lgw_ral, rxrf_conf.freq_hz, rxif_conf.datarate, rxif_conf.bandwidth, rxif_conf.coderate );
-
-    /* Update RX status */
-    rx_status = RX_ON;
-
-    return ( flag_tx_timeout == false ) ? LGW_HAL_SUCCESS : LGW_HAL_ERROR;
+    return err;
 };
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -16,6 +16,14 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* --- DEPENDENCIES --------------------------------------------------------- */
 
 #include <string.h>
+#include <stdatomic.h>
+
+#include "sdkconfig.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 
 #include "lorahub_aux.h"
 #include "lorahub_hal.h"
@@ -24,6 +32,13 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #include "ral.h"
 #include "radio_context.h"
 
+#define INDICATOR_LORAHUB 1
+
+#if( INDICATOR_LORAHUB )
+#include "bsp_io_expander.h"
+#include "bsp_sx126x.h"
+#endif
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE MACROS -------------------------------------------------------- */
 
@@ -36,7 +51,18 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 static const char* TAG_HAL_RX = "HAL_RX";
 
-#define RX_TIMEOUT_MS 120000 /* 2 minutes */
+/* Packets held between two lgw_receive calls, a power of 2 */
+#define RX_RING_SIZE CONFIG_LORAHUB_RX_RING_SIZE
+
+#if( RX_RING_SIZE & ( RX_RING_SIZE - 1 ) ) != 0
+#error "CONFIG_LORAHUB_RX_RING_SIZE must be a power of 2"
+#endif
+
+/* The RX task also checks the radio this often, in case an edge was missed */
+#define RX_POLL_MS 100
+
+/* INT edges stamped by the ISR and not yet looked at by the RX task */
+#define RX_IRQ_QUEUE_LEN 10
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE TYPES --------------------------------------------------------- */
@@ -44,12 +70,19 @@ static const char* TAG_HAL_RX = "HAL_RX";
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
-static volatile bool irq_fired    = false;
-static uint32_t      irq_count_us = 0;
+static QueueHandle_t     rx_irq_queue   = NULL;
+static SemaphoreHandle_t radio_lock     = NULL;
+static TaskHandle_t      rx_task_handle = NULL;
 
-static bool flag_rx_done      = false;
-static bool flag_rx_crc_error = false;
-static bool flag_rx_timeout   = false;
+/*
+ * Single producer (RX task), single consumer (lgw_receive) ring. head and tail
+ * run freely and are only written by their owner; a slot is filled before
+ * head moves past it and copied out before tail does.
+ */
+static struct lgw_pkt_rx_s rx_ring[RX_RING_SIZE];
+static atomic_uint         rx_ring_head    = 0;
+static atomic_uint         rx_ring_tail    = 0;
+static atomic_uint         rx_ring_dropped = 0;
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
@@ -57,38 +90,48 @@ static bool flag_rx_timeout   = false;
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
+/*
+ * Only stamps the edge. On the shared expander INT it may come from touch or
+ * BUSY as well; reading the port to find out is left to the RX task.
+ */
 static void IRAM_ATTR radio_on_dio_irq( void* args )
 {
-    irq_fired = true;
-    lgw_get_instcnt( &irq_count_us );
+    BaseType_t woken = pdFALSE;
+    uint32_t   count_us;
+
+    lgw_get_instcnt( &count_us );
+    xQueueSendFromISR( rx_irq_queue, &count_us, &woken );
+    portYIELD_FROM_ISR( woken );
 }
 
-void radio_irq_process( const ral_t* ral )
+/* Drops the edges stamped so far */
+static void rx_irq_drop( void )
 {
-    if( irq_fired == true )
-    {
-        irq_fired = false;
+    uint32_t count_us;
 
-        ral_irq_t irq_regs;
-        ral_get_and_clear_irq_status( ral, &irq_regs );
-        if( ( irq_regs & RAL_IRQ_RX_DONE ) == RAL_IRQ_RX_DONE )
-        {
-            // printf("%lu: IRQ_RX_DONE\n", irq_count_us);
-            flag_rx_done = true;
-        }
+    while( xQueueReceive( rx_irq_queue, &count_us, 0 ) == pdTRUE )
+    {
+    }
+}
 
-        if( ( irq_regs & RAL_IRQ_RX_CRC_ERROR ) == RAL_IRQ_RX_CRC_ERROR )
-        {
-            ESP_LOGW( TAG_HAL_RX, "%lu: IRQ_CRC_ERROR", irq_count_us );
-            flag_rx_crc_error = true;
-        }
+/* DIO1 level, on the expander one read of its input port; the read also releases INT */
+static bool rx_dio1_is_high( const ral_t* ral )
+{
+#if( INDICATOR_LORAHUB )
+    uint16_t pin_val = 0;
 
-        if( ( irq_regs & RAL_IRQ_RX_TIMEOUT ) == RAL_IRQ_RX_TIMEOUT )
-        {
-            ESP_LOGW( TAG_HAL_RX, "%lu: RX:IRQ_TIMEOUT", irq_count_us );
-            flag_rx_timeout = true;
-        }
+    ( void ) ral;
+    if( indicator_io_expander->read_input_pins( &pin_val ) != ESP_OK )
+    {
+        /* Let the IRQ status tell */
+        return true;
     }
+    return ( pin_val & ( 0x01 << EXPANDER_IO_RADIO_DIO_1 ) ) != 0;
+#else
+    const radio_context_t* radio_context = ( const radio_context_t* ) ( ral->context );
+
+    return gpio_get_level( radio_context->gpio_dio1 ) != 0;
+#endif
 }
 
 static void set_led_rx( const ral_t* ral, bool on )
@@ -111,21 +154,174 @@ static void set_led_tx( const ral_t* ral, bool on )
     }
 }
 
+/* Copies a received packet into the next ring slot, payload first: the next packet overwrites it once its header is in */
+static void rx_push( const ral_t* ral, ral_irq_t irq_regs, uint32_t count_us )
+{
+    unsigned int head = atomic_load_explicit( &rx_ring_head, memory_order_relaxed );
+    unsigned int tail = atomic_load_explicit( &rx_ring_tail, memory_order_acquire );
+
+    if( ( head - tail ) >= RX_RING_SIZE )
+    {
+        atomic_fetch_add_explicit( &rx_ring_dropped, 1, memory_order_relaxed );
+        ESP_LOGW( TAG_HAL_RX, "%lu: RX ring full, packet dropped", count_us );
+        return;
+    }
+
+    set_led_rx( ral, true );
+
+    struct lgw_pkt_rx_s*     p = &rx_ring[head % RX_RING_SIZE];
+    ral_lora_rx_pkt_status_t pkt_status_lora;
+
+    p->count_us = count_us;
+    p->size     = 0;
+    if( ( irq_regs & RAL_IRQ_RX_CRC_ERROR ) == RAL_IRQ_RX_CRC_ERROR )
+    {
+        ESP_LOGW( TAG_HAL_RX, "%lu: IRQ_CRC_ERROR", count_us );
+        p->status = STAT_CRC_BAD;
+    }
+    else
+    {
+        p->status = STAT_CRC_OK;
+        if( ral_get_pkt_payload( ral, sizeof( p->payload ), p->payload, &p->size ) != RAL_STATUS_OK )
+        {
+            p->status = STAT_UNDEFINED;
+        }
+    }
+
+    if( ral_get_lora_rx_pkt_status( ral, &pkt_status_lora ) == RAL_STATUS_OK )
+    {
+        p->rssic = ( float ) pkt_status_lora.rssi_pkt_in_dbm;
+        p->snr   = ( float ) pkt_status_lora.snr_pkt_in_db;
+    }
+
+    atomic_store_explicit( &rx_ring_head, head + 1, memory_order_release );
+    set_led_rx( ral, false );
+}
+
+/* Reads the IRQ status and moves a received packet into the ring, false if there was no IRQ */
+static bool rx_fetch( const ral_t* ral, uint32_t count_us )
+{
+    ral_irq_t irq_regs;
+
+    if( ( ral_get_irq_status( ral, &irq_regs ) != RAL_STATUS_OK ) || ( irq_regs == RAL_IRQ_NONE ) )
+    {
+        return false;
+    }
+
+    if( ( irq_regs & ( RAL_IRQ_RX_DONE | RAL_IRQ_RX_CRC_ERROR ) ) != 0 )
+    {
+        rx_push( ral, irq_regs, count_us );
+    }
+
+    /* Cleared after the payload is read, and only what was read: a later IRQ keeps DIO1 high */
+    ral_clear_irq_status( ral, irq_regs );
+
+    if( ( irq_regs & RAL_IRQ_RX_TIMEOUT ) == RAL_IRQ_RX_TIMEOUT )
+    {
+        /* Not expected in continuous mode, start RX again */
+        ESP_LOGW( TAG_HAL_RX, "%lu: RX:IRQ_TIMEOUT", count_us );
+        ral_set_rx( ral, RAL_RX_TIMEOUT_CONTINUOUS_MODE );
+    }
+    return true;
+}
+
+static void rx_task( void* args )
+{
+    const ral_t* ral = ( const ral_t* ) args;
+    uint32_t     count_us;
+
+    for( ;; )
+    {
+        if( xQueueReceive( rx_irq_queue, &count_us, pdMS_TO_TICKS( RX_POLL_MS ) ) != pdTRUE )
+        {
+            /* No edge: look anyway, a packet found this way is stamped late */
+            lgw_get_instcnt( &count_us );
+        }
+
+        /*
+         * One port read per edge: it releases INT, and an edge from touch or
+         * another task's radio command finds DIO1 low and ends here. When
+         * DIO1 is high, this edge is the one it raised.
+         */
+        lgw_radio_lock( );
+        while( rx_dio1_is_high( ral ) )
+        {
+            bool fetched = rx_fetch( ral, count_us );
+
+            /* BUSY pulsed INT around each command of the fetch, those edges are ours */
+            rx_irq_drop( );
+            if( fetched == false )
+            {
+                break;
+            }
+            /* DIO1 still high: a packet ended during the fetch, its edge went with ours */
+            lgw_get_instcnt( &count_us );
+        }
+        lgw_radio_unlock( );
+    }
+}
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
 int lgw_radio_init_rx( const ral_t* ral )
 {
+    if( rx_task_handle != NULL )
+    {
+        return LGW_HAL_SUCCESS;
+    }
+
+    rx_irq_queue = xQueueCreate( RX_IRQ_QUEUE_LEN, sizeof( uint32_t ) );
+    if( rx_irq_queue == NULL )
+    {
+        ESP_LOGE( TAG_HAL_RX, "ERROR: failed to create RX IRQ queue" );
+        return LGW_HAL_ERROR;
+    }
+
+    if( xTaskCreate( rx_task, "lorahub_rx", CONFIG_LORAHUB_RX_TASK_STACK_SIZE, ( void* ) ral,
+                     CONFIG_LORAHUB_RX_TASK_PRIORITY, &rx_task_handle ) != pdPASS )
+    {
+        ESP_LOGE( TAG_HAL_RX, "ERROR: failed to create RX task" );
+        return LGW_HAL_ERROR;
+    }
+
+#if( INDICATOR_LORAHUB )
+    /* DIO1 is an expander input, its INT line is shared with BUSY and the touch panel */
+    if( bsp_io_expander_isr_add( radio_on_dio_irq, NULL ) != ESP_OK )
+    {
+        ESP_LOGW( TAG_HAL_RX, "no expander INT, polling RX every %d ms", RX_POLL_MS );
+    }
+#else
     const radio_context_t* radio_context = ( const radio_context_t* ) ( ral->context );
 
     gpio_install_isr_service( 0 );
     gpio_isr_handler_add( radio_context->gpio_dio1, radio_on_dio_irq, NULL );
+#endif
 
     return LGW_HAL_SUCCESS;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+void lgw_radio_lock( void )
+{
+    if( radio_lock == NULL )
+    {
+        /* First called from lgw_start, before the RX task exists */
+        radio_lock = xSemaphoreCreateMutex( );
+    }
+    xSemaphoreTake( radio_lock, portMAX_DELAY );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_radio_unlock( void )
+{
+    xSemaphoreGive( radio_lock );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 int lgw_radio_set_rx( const ral_t* ral, uint32_t freq_hz, uint32_t datarate, uint8_t bandwidth, uint8_t coderate )
 {
     set_led_rx( ral, false );
@@ -224,75 +420,40 @@ int lgw_radio_set_rx( const ral_t* ral, uint32_t freq_hz, uint32_t datarate, uin
     /* Set RX */
     ASSERT_RAL_RC( ral_set_rf_freq( ral, freq_hz ) );
     ASSERT_RAL_RC( ral_set_lora_symb_nb_timeout( ral, 0 ) );
-    ASSERT_RAL_RC( ral_set_rx( ral, RX_TIMEOUT_MS ) );
+    /* The radio stays in RX after each packet, there is nothing to set up again */
+    ASSERT_RAL_RC( ral_set_rx( ral, RAL_RX_TIMEOUT_CONTINUOUS_MODE ) );
 
     return LGW_HAL_SUCCESS;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_radio_get_pkt( const ral_t* ral, bool* irq_received, uint32_t* count_us, int8_t* rssi, int8_t* snr,
-                       uint8_t* status, uint16_t* size, uint8_t* payload )
+int lgw_radio_get_pkts( uint8_t max_pkt, struct lgw_pkt_rx_s* pkt_data )
 {
-    int nb_pkt_received = 0;
-
-    /* Initialize return values */
-    *count_us     = 0;
-    *rssi         = 0;
-    *snr          = 0;
-    *status       = STAT_UNDEFINED;
-    *size         = 0;
-    *irq_received = false;
-
-    /* Check if a packet has been received */
-    radio_irq_process( ral );
-    if( ( flag_rx_done == true ) || ( flag_rx_crc_error == true ) )
-    {
-        set_led_rx( ral, true );
-
-        *irq_received = true;
-        *count_us     = irq_count_us;
-
-        ral_lora_rx_pkt_status_t pkt_status_lora;
-        ASSERT_RAL_RC( ral_get_lora_rx_pkt_status( ral, &pkt_status_lora ) );
-        *rssi = pkt_status_lora.rssi_pkt_in_dbm;
-        *snr  = pkt_status_lora.snr_pkt_in_db;
+    unsigned int tail = atomic_load_explicit( &rx_ring_tail, memory_order_relaxed );
+    unsigned int head = atomic_load_explicit( &rx_ring_head, memory_order_acquire );
+    int          nb_pkt_received = 0;
 
-        if( flag_rx_crc_error == true )
-        {
-            *status = STAT_CRC_BAD;
-        }
-        else
-        {
-            *status = STAT_CRC_OK;
-
-            /* Get packet payload */
-            ASSERT_RAL_RC( ral_get_pkt_payload( ral, 256, payload, size ) );
-#if 0
-            ESP_LOGI(TAG_HAL_RX, "%d byte packet received:", *size);
-            ESP_LOG_BUFFER_HEX_LEVEL(TAG_HAL_RX, payload, *size, ESP_LOG_INFO);
-#endif
-        }
-
-        nb_pkt_received += 1;
-
-        /* Update status */
-        flag_rx_done      = false;
-        flag_rx_crc_error = false;
-    }
-    else if( flag_rx_timeout == true )
+    while( ( nb_pkt_received < max_pkt ) && ( tail != head ) )
     {
-        *irq_received = true;
-
-        /* Update status */
-        flag_rx_timeout = false;
+        memcpy( &pkt_data[nb_pkt_received], &rx_ring[tail % RX_RING_SIZE], sizeof( struct lgw_pkt_rx_s ) );
+        nb_pkt_received += 1;
+        tail += 1;
     }
+    atomic_store_explicit( &rx_ring_tail, tail, memory_order_release );
 
     return nb_pkt_received;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+uint32_t lgw_radio_rx_dropped( void )
+{
+    return atomic_load_explicit( &rx_ring_dropped, memory_order_relaxed );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 uint32_t lgw_radio_timestamp_correction( uint32_t sf, uint8_t bw )
 {
 #if defined( CONFIG_RADIO_TYPE_SX1261 ) || defined( CONFIG_RADIO_TYPE_SX1262 ) || \
@@ -32,12 +32,24 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
 
+struct lgw_pkt_rx_s;
+
+/* Starts the RX task, which moves each received packet into the RX ring on the DIO1 IRQ */
 int lgw_radio_init_rx( const ral_t* ral );
 
+/* Serialises radio access between the RX task and the callers of the functions below */
+void lgw_radio_lock( void );
+
+void lgw_radio_unlock( void );
+
+/* Configures the radio and puts it in continuous RX, call with the radio locked */
 int lgw_radio_set_rx( const ral_t* ral, uint32_t freq_hz, uint32_t datarate, uint8_t bandwidth, uint8_t coderate );
 
-int lgw_radio_get_pkt( const ral_t* ral, bool* irq_received, uint32_t* count_us, int8_t* rssi, int8_t* snr,
-                       uint8_t* status, uint16_t* size, uint8_t* payload );
+/* Moves up to max_pkt packets out of the RX ring: timestamp, status, RSSI, SNR and payload */
+int lgw_radio_get_pkts( uint8_t max_pkt, struct lgw_pkt_rx_s* pkt_data );
+
+/* Packets dropped because the RX ring was full */
+uint32_t lgw_radio_rx_dropped( void );
 
 uint32_t lgw_radio_timestamp_correction( uint32_t sf, uint8_t bw );
 
@@ -183,6 +183,39 @@ RadioOperatingModes_t SX126xGetOperatingMode( void );
  */
 void SX126xSetOperatingMode( RadioOperatingModes_t mode );
 
+/*!
+ * Number of buckets of the latency histograms. Bucket i counts latencies
+ * below 64 us << i, the last one all the others.
+ */
+#define SX126X_LATENCY_BUCKETS                      10
+
+/*!
+ * \brief Latency statistics
+ */
+typedef struct SX126xLatency_s
+{
+    uint32_t Count;                                     //! Events measured
+    uint32_t MaxUs;                                     //! Longest delay [us]
+    uint64_t SumUs;                                     //! Sum of the delays [us]
+    uint32_t Histogram[SX126X_LATENCY_BUCKETS];
+}SX126xLatency_t;
+
+/*!
+ * \brief Gets the statistics of the delay from the DIO1 edge to the radio
+ *        IRQ handler call since boot
+ *
+ * \param [OUT] latency     Copy of the statistics
+ */
+void SX126xGetIrqLatency( SX126xLatency_t *latency );
+
+/*!
+ * \brief Gets the statistics of the delay from the end of a command (NSS
+ *        high) to SX126xWaitOnBusy seeing BUSY low since boot
+ *
+ * \param [OUT] latency     Copy of the statistics
+ */
+void SX126xGetBusyLatency( SX126xLatency_t *latency );
+
 /*!
  * Radio hardware and global parameters
  */
@@ -6,7 +6,10 @@
 #include <string.h>
 
 #include "bsp_i2c.h"
+#include "bsp_io_expander.h"
 #include "timer.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
 //#define SX126X_SPI_DBUG 
 
 #define HOST_ID                 SPI3_HOST
@@ -27,107 +30,177 @@ static const char *TAG = "sx126x";
 static RadioOperatingModes_t OperatingMode;
 static bool init_flag = false;
 
-TimerTime_t g_lora_irq_time = 0;
+/* Time of the last radio IRQ edge, esp_timer_get_time() [us] */
+int64_t g_lora_irq_time_us = 0;
 bool  g_have_tcxo = false;
 
+static SX126xLatency_t irq_latency;
+static SX126xLatency_t busy_latency;
+static portMUX_TYPE latency_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Given on every expander INT edge, taken by SX126xWaitOnBusy */
+static SemaphoreHandle_t busy_sem;
+static bool busy_irq = false;
+/* End of the last command not yet seen ready, esp_timer_get_time() [us] */
+static int64_t busy_cmd_end_us;
+static bool busy_pending = false;
+
+/*
+ * Only timestamps the edge. Reading the expander to see which input changed
+ * takes an I2C transaction, so it is left to expander_io_int.
+ */
 static void IRAM_ATTR gpio_isr_handler(void* arg)
 {
-    TimerTime_t irq_time = TimerGetCurrentTime();
+    int64_t irq_time = esp_timer_get_time();
     xQueueSendFromISR(gpio_evt_queue, &irq_time, NULL);
 }
 
-uint32_t SX126xGetDio1PinState( void );
-
-static void expander_io_int(void* arg)
+/*
+ * BUSY is an expander input too, so its falling edge also pulls INT low. The
+ * task waiting in SX126xWaitOnBusy is woken to read the port again.
+ */
+static void IRAM_ATTR busy_isr_handler(void* arg)
 {
-    TimerTime_t irq_time;
-    RadioOperatingModes_t  mode;
-    for(;;) {
-        if(xQueueReceive(gpio_evt_queue, &irq_time, portMAX_DELAY)) {
-            g_lora_irq_time = irq_time;
-            // printf("lora irq:%d\n", g_lora_irq_time);
-
-            if( SX126xGetDio1PinState()) { // Only handle DIO1 interrupt
-                xSemaphoreTake(radio_mutex, portMAX_DELAY);
-                mode = SX126xGetOperatingMode();
-                xSemaphoreGive(radio_mutex);
-                if( mode !=  MODE_SLEEP ) { // Filter out sleep mode interrupts
-                    (g_dioIrq) (0); //handle irq
-                }
-            }
-        }
+    BaseType_t woken = pdFALSE;
+
+    xSemaphoreGiveFromISR(busy_sem, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
     }
 }
 
-static bool spi_write_byte(uint8_t* data_in, size_t DataLength )
+static void latency_add(SX126xLatency_t *latency, int64_t since)
 {
-#ifdef SX126X_SPI_DBUG
-    printf("spi write: ");
-    for(int i =0; i < DataLength ; i++) {
-        printf("%x ",data_in[i]);
-    }
-    printf("\r\n");
-#endif
-
-	spi_transaction_t SPITransaction;
+    uint32_t us = (uint32_t)(esp_timer_get_time() - since);
+    uint32_t bucket = 0;
 
-	if ( DataLength > 0 ) {
-		memset( &SPITransaction, 0, sizeof( spi_transaction_t ) );
-		SPITransaction.length = DataLength * 8;
-		SPITransaction.tx_buffer = data_in;
-		SPITransaction.rx_buffer = NULL;
-		spi_device_transmit( SpiHandle, &SPITransaction );
-	}
+    while (bucket < SX126X_LATENCY_BUCKETS - 1 && us >= (64u << bucket)) {
+        bucket++;
+    }
+    portENTER_CRITICAL(&latency_lock);
+    latency->Count++;
+    latency->SumUs += us;
+    if (us > latency->MaxUs) {
+        latency->MaxUs = us;
+    }
+    latency->Histogram[bucket]++;
+    portEXIT_CRITICAL(&latency_lock);
+}
 
-	return true;
+void SX126xGetIrqLatency( SX126xLatency_t *latency )
+{
+    portENTER_CRITICAL(&latency_lock);
+    *latency = irq_latency;
+    portEXIT_CRITICAL(&latency_lock);
 }
 
-static bool spi_read_byte(uint8_t* data_out, size_t DataLength )
+void SX126xGetBusyLatency( SX126xLatency_t *latency )
 {
-	spi_transaction_t SPITransaction;
+    portENTER_CRITICAL(&latency_lock);
+    *latency = busy_latency;
+    portEXIT_CRITICAL(&latency_lock);
+}
 
-	if ( DataLength > 0 ) {
-		memset( &SPITransaction, 0, sizeof( spi_transaction_t ) );
-		SPITransaction.length = DataLength * 8;
-		SPITransaction.tx_buffer = NULL;
-		SPITransaction.rx_buffer = data_out;
-		spi_device_transmit( SpiHandle, &SPITransaction );
-	}
+static void expander_io_int(void* arg)
+{
+    int64_t irq_time;
+    int64_t later;
+    uint16_t pin_val;
 
-#ifdef SX126X_SPI_DBUG
-    printf("spi read: ");
-    for(int i =0; i < DataLength ; i++) {
-        printf("%x ",data_out[i]);
+    for(;;) {
+        if(xQueueReceive(gpio_evt_queue, &irq_time, portMAX_DELAY)) {
+            /*
+             * The INT line is shared with the touch panel and stays low until
+             * someone reads the input port. Edges queued since are folded into
+             * one read, which shows the state of all expander inputs. The first
+             * edge is kept: it is the DIO1 edge unless another input changed
+             * just before.
+             */
+            while (xQueueReceive(gpio_evt_queue, &later, 0)) {
+            }
+            if (indicator_io_expander->read_input_pins(&pin_val) != ESP_OK) {
+                continue;
+            }
+            if (!(pin_val & (0x01 << EXPANDER_IO_RADIO_DIO_1))) {
+                continue;
+            }
+            // Filter out sleep mode interrupts
+            if (SX126xGetOperatingMode() == MODE_SLEEP) {
+                continue;
+            }
+            g_lora_irq_time_us = irq_time;
+            latency_add(&irq_latency, irq_time);
+            (g_dioIrq) (0); //handle irq
+        }
     }
-    printf("\r\n");
-#endif
-	return true;
 }
 
-static uint8_t spi_transfer(uint8_t* data_in, uint8_t* data_out, size_t DataLength)
-{
-	spi_transaction_t SPITransaction;
+/*
+ * Every command goes out as one SPI transaction: the header (opcode, then the
+ * address, offset or NOP bytes) and the payload are copied into one
+ * DMA-capable buffer. NSS sits on the IO expander, so each command still
+ * costs an I2C write to pull it low and another to release it. The buffers and
+ * the descriptor, set up in bsp_sx126x_init, are only used with radio_mutex
+ * held.
+ */
+#define SPI_HEADER_MAX          4
+#define SPI_BUFFER_SIZE         (SPI_HEADER_MAX + 256)
+/* Shorter transactions are polled, longer ones wait for the DMA interrupt */
+#define SPI_POLLING_MAX         32
+
+static DMA_ATTR uint8_t spi_tx_buf[SPI_BUFFER_SIZE];
+static DMA_ATTR uint8_t spi_rx_buf[SPI_BUFFER_SIZE];
+static spi_transaction_t spi_trans;
+
+/*
+ * Sends header, then size bytes from tx (or NOPs when tx is NULL). When rx is
+ * set, the bytes clocked in after the header are copied there. Returns the
+ * byte clocked in while header[1] went out, the status for read commands.
+ */
+static uint8_t spi_command(const uint8_t *header, size_t header_len, const uint8_t *tx, uint8_t *rx, size_t size)
+{
+    size_t len = header_len + size;
+
+    if (len > SPI_BUFFER_SIZE) {
+        ESP_LOGE(TAG, "command 0x%02x too long (%u bytes)", header[0], (unsigned)len);
+        return 0;
+    }
+    memcpy(spi_tx_buf, header, header_len);
+    if (tx != NULL) {
+        memcpy(spi_tx_buf + header_len, tx, size);
+    } else {
+        memset(spi_tx_buf + header_len, 0, size);
+    }
+    spi_trans.length = len * 8;
 
-	if ( DataLength > 0 ) {
-		memset( &SPITransaction, 0, sizeof( spi_transaction_t ) );
-		SPITransaction.length = DataLength * 8;
-		SPITransaction.tx_buffer = data_in;
-		SPITransaction.rx_buffer = data_out;
-		spi_device_transmit( SpiHandle, &SPITransaction );
-	}
+    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 0);
+    if (len <= SPI_POLLING_MAX) {
+        spi_device_polling_transmit(SpiHandle, &spi_trans);
+    } else {
+        spi_device_transmit(SpiHandle, &spi_trans);
+    }
+    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 1);
+    // BUSY stays high during sleep, the wait after the wakeup is timed instead
+    if (header[0] != RADIO_SET_SLEEP) {
+        busy_cmd_end_us = esp_timer_get_time();
+        busy_pending = true;
+    }
 
+    if (rx != NULL) {
+        memcpy(rx, spi_rx_buf + header_len, size);
+    }
 #ifdef SX126X_SPI_DBUG
     printf("spi write: ");
-    for(int i =0; i < DataLength ; i++) {
-        printf("%x ",data_in[i]);
+    for (int i = 0; i < len; i++) {
+        printf("%x ", spi_tx_buf[i]);
     }
     printf(",read: ");
-    for(int i =0; i < DataLength ; i++) {
-        printf("%x ",data_out[i]);
+    for (int i = 0; i < len; i++) {
+        printf("%x ", spi_rx_buf[i]);
     }
     printf("\r\n");
 #endif
-	return true;
+    return (len > 1) ? spi_rx_buf[1] : 0;
 }
 
 void SX126xIoInit( void )
@@ -175,6 +248,7 @@ void bsp_sx126x_init(void)
     indicator_io_expander = brd->io_expander_ops;
 
     radio_mutex =xSemaphoreCreateMutex();
+    busy_sem = xSemaphoreCreateBinary();
 
 
     esp_err_t ret;
@@ -207,7 +281,14 @@ void bsp_sx126x_init(void)
 	ESP_LOGI(TAG, "spi_bus_add_device=%d",ret);
 	assert(ret==ESP_OK);
 
+    memset(&spi_trans, 0, sizeof(spi_trans));
+    spi_trans.tx_buffer = spi_tx_buf;
+    spi_trans.rx_buffer = spi_rx_buf;
+
     SX126xIoInit();
+
+    // Without the INT line, SX126xWaitOnBusy polls once per tick
+    busy_irq = (bsp_io_expander_isr_add(busy_isr_handler, NULL) == ESP_OK);
 }
 
 spi_device_handle_t bsp_sx126x_spi_handle_get(void)
@@ -225,17 +306,11 @@ void SX126xIoIrqInit( DioIrqHandler dioIrq )
     }
     Ioirq_init_flag = true;
 
-    gpio_config_t io_conf = {};
-    io_conf.intr_type = GPIO_INTR_NEGEDGE; //falling edge
-    io_conf.pin_bit_mask = (1ULL << ESP32_EXPANDER_IO_INT);
-    io_conf.mode = GPIO_MODE_INPUT;
-    io_conf.pull_up_en = 1;
-    gpio_config(&io_conf);
-    gpio_evt_queue = xQueueCreate(10, sizeof(TimerTime_t));
+    gpio_evt_queue = xQueueCreate(10, sizeof(int64_t));
     xTaskCreate(expander_io_int, "expander_io_int", GPIO_QUEUE_STACK, NULL, 10, NULL);
 
-    gpio_install_isr_service(0);
-    gpio_isr_handler_add(ESP32_EXPANDER_IO_INT, gpio_isr_handler, (void*)ESP32_EXPANDER_IO_INT);
+    // The expander INT line (ESP32_EXPANDER_IO_INT) is shared with the touch panel
+    bsp_io_expander_isr_add(gpio_isr_handler, (void*)ESP32_EXPANDER_IO_INT);
 }
 
 void SX126xIoDeInit( void )
@@ -287,29 +362,50 @@ void SX126xReset( void )
     vTaskDelay(20 / portTICK_PERIOD_MS);
 }
 
+/*
+ * BUSY usually drops before the first input port read completes, so the port
+ * is read up to BUSY_SPIN_READS times back to back. After that the task sleeps
+ * until the next expander INT edge, or BUSY_WAIT_MS if none comes, and reads
+ * again. The semaphore is cleared before each read: INT is re-armed by that
+ * read, so an edge after it is never missed. Edges of other expander inputs
+ * only cost an extra read.
+ */
+#define BUSY_SPIN_READS         2
+#define BUSY_WAIT_MS            10
+
 void SX126xWaitOnBusy( void )
 {
     uint16_t pin_val;
-    while(1) {
+    int reads = 0;
+
+    for (;;) {
+        xSemaphoreTake(busy_sem, 0);
         esp_err_t ret = indicator_io_expander->read_input_pins(&pin_val);
-        if( ret == ESP_OK ) {
-            if( !(pin_val & (0x01 << EXPANDER_IO_RADIO_BUSY)) ) {
-                return;
-            }
+        if (ret == ESP_OK && !(pin_val & (0x01 << EXPANDER_IO_RADIO_BUSY))) {
+            break;
+        }
+        if (++reads < BUSY_SPIN_READS) {
+            continue;
+        }
+        if (busy_irq) {
+            xSemaphoreTake(busy_sem, pdMS_TO_TICKS(BUSY_WAIT_MS));
+        } else {
+            vTaskDelay(1);
         }
-        vTaskDelay(2 / portTICK_PERIOD_MS);
+    }
+    if (busy_pending) {
+        busy_pending = false;
+        latency_add(&busy_latency, busy_cmd_end_us);
     }
 }
 
 void SX126xWakeup( void )
 {
     xSemaphoreTake(radio_mutex, portMAX_DELAY);
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 0);
     uint8_t tx_buf[2];
     tx_buf[0] = RADIO_GET_STATUS;
     tx_buf[1] = 0x00;
-    spi_write_byte(( uint8_t *)tx_buf, sizeof(tx_buf));
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 1);
+    spi_command(tx_buf, sizeof(tx_buf), NULL, NULL, 0);
     xSemaphoreGive(radio_mutex);
 
     SX126xWaitOnBusy( );
@@ -326,10 +422,8 @@ void SX126xWriteCommand( RadioCommands_t command, uint8_t *buffer, uint16_t size
         // Update mode in advance to prevent interrupts from being triggered when the device is sleeping
         SX126xSetOperatingMode( MODE_SLEEP ); 
     }
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 0);
-    spi_write_byte(( uint8_t *)&command, 1);
-    spi_write_byte( buffer, size);
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 1);
+    uint8_t opcode = command;
+    spi_command(&opcode, 1, buffer, NULL, size);
     xSemaphoreGive(radio_mutex);
 
     if( command != RADIO_SET_SLEEP )
@@ -345,12 +439,10 @@ uint8_t SX126xReadCommand( RadioCommands_t command, uint8_t *buffer, uint16_t si
     SX126xCheckDeviceReady( );
 
     xSemaphoreTake(radio_mutex, portMAX_DELAY);
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 0);
-    spi_write_byte(( uint8_t *)&command, 1);
-    uint8_t data = 0x00;
-    spi_transfer(&data, &status, 1);
-    spi_read_byte(buffer, size);
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 1);
+    uint8_t tx_buf[2];
+    tx_buf[0] = command;
+    tx_buf[1] = 0x00;
+    status = spi_command(tx_buf, sizeof(tx_buf), NULL, buffer, size);
     xSemaphoreGive(radio_mutex);
 
     SX126xWaitOnBusy( );
@@ -363,14 +455,11 @@ void SX126xWriteRegisters( uint16_t address, uint8_t *buffer, uint16_t size )
     SX126xCheckDeviceReady( );
 
     xSemaphoreTake(radio_mutex, portMAX_DELAY);
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 0);
     uint8_t tx_buf[3];
     tx_buf[0] = RADIO_WRITE_REGISTER;
     tx_buf[1] = ( address & 0xFF00 ) >> 8;
     tx_buf[2] = address & 0x00FF;
-    spi_write_byte(( uint8_t *)tx_buf, 3);
-    spi_write_byte( buffer, size);
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 1);
+    spi_command(tx_buf, sizeof(tx_buf), buffer, NULL, size);
     xSemaphoreGive(radio_mutex);
 
     SX126xWaitOnBusy( );
@@ -386,15 +475,12 @@ void SX126xReadRegisters( uint16_t address, uint8_t *buffer, uint16_t size )
     SX126xCheckDeviceReady( );
 
     xSemaphoreTake(radio_mutex, portMAX_DELAY);
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 0);
     uint8_t tx_buf[4];
     tx_buf[0] = RADIO_READ_REGISTER;
     tx_buf[1] = ( address & 0xFF00 ) >> 8;
     tx_buf[2] = address & 0x00FF;
     tx_buf[3] = 0;
-    spi_write_byte(( uint8_t *)tx_buf, 4);
-    spi_read_byte(buffer, size);
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 1);
+    spi_command(tx_buf, sizeof(tx_buf), NULL, buffer, size);
     xSemaphoreGive(radio_mutex);
 
     SX126xWaitOnBusy( );
@@ -412,13 +498,10 @@ void SX126xWriteBuffer( uint8_t offset, uint8_t *buffer, uint8_t size )
     SX126xCheckDeviceReady( );
 
     xSemaphoreTake(radio_mutex, portMAX_DELAY);
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 0);
     uint8_t tx_buf[2];
     tx_buf[0] = RADIO_WRITE_BUFFER;
     tx_buf[1] = offset;
-    spi_write_byte(( uint8_t *)tx_buf, sizeof(tx_buf));
-    spi_write_byte( buffer, size);
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 1);
+    spi_command(tx_buf, sizeof(tx_buf), buffer, NULL, size);
     xSemaphoreGive(radio_mutex);
 
     SX126xWaitOnBusy( );
@@ -429,15 +512,11 @@ void SX126xReadBuffer( uint8_t offset, uint8_t *buffer, uint8_t size )
     SX126xCheckDeviceReady( );
 
     xSemaphoreTake(radio_mutex, portMAX_DELAY);
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 0);
     uint8_t tx_buf[3];
     tx_buf[0] = RADIO_READ_BUFFER;
     tx_buf[1] = offset;
     tx_buf[2] = 0;
-    spi_write_byte(( uint8_t *)tx_buf, sizeof(tx_buf));
-    spi_read_byte(buffer, size);
-
-    indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 1);
+    spi_command(tx_buf, sizeof(tx_buf), NULL, buffer, size);
     xSemaphoreGive(radio_mutex);
     
     SX126xWaitOnBusy( );
@@ -1,31 +1,407 @@
+/*!
+ * \file      timer.c
+ *
+ * \brief     Timer objects of the LoRaMac stack and radio driver
+ *
+ * \remark    All TimerEvent_t objects share a single esp_timer one-shot, armed
+ *            for the earliest expiry. Running timers are filed in a
+ *            hierarchical timer wheel so that start and stop take constant
+ *            time. Expiries are kept in microseconds; the wheel slots only
+ *            sort them, they do not round them.
+ *
+ *            With CONFIG_LORA_TIMER_TASK the one-shot is dispatched from the
+ *            timer ISR when ESP-IDF allows it and only wakes the LoRaMac
+ *            timer task, which runs the callbacks. Otherwise the callbacks
+ *            run in the esp_timer task.
+ */
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_timer.h"
 #include "timer.h"
 
-void TimerInit( TimerEvent_t *obj, void ( *callback )( void *context ) )
+#if defined( CONFIG_LORA_TIMER_TRACE_GPIO ) && ( CONFIG_LORA_TIMER_TRACE_GPIO >= 0 )
+#include "driver/gpio.h"
+/*!
+ * The trace pin is high while a timer callback runs. Its rising edges show
+ * the RX window openings against the radio DIO1 line on a scope.
+ */
+#define TIMER_TRACE( level )                        gpio_set_level( CONFIG_LORA_TIMER_TRACE_GPIO, level )
+#else
+#define TIMER_TRACE( level )
+#endif
+
+/*!
+ * Level 0 slots are 2^10 us wide. Each level has 64 slots, 64 times as wide
+ * as the ones below, so four levels cover 2^34 us (about 4.8 hours). Timers
+ * further out wait in the last slot of the top level and are filed again
+ * when it comes up.
+ */
+#define TIMER_WHEEL_TICK_SHIFT                      10
+#define TIMER_WHEEL_SLOT_BITS                       6
+#define TIMER_WHEEL_SLOTS                           ( 1 << TIMER_WHEEL_SLOT_BITS )
+#define TIMER_WHEEL_LEVELS                          4
+
+#define TIMER_HW_IDLE                               UINT64_MAX
+
+/*!
+ * Slot lists of the wheel and, per level, a bit per non-empty slot
+ */
+static TimerEvent_t *TimerWheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+static uint64_t TimerWheelOccupied[TIMER_WHEEL_LEVELS];
+
+/*!
+ * Tick the wheel has been advanced to. On level L, the slots hold the ticks
+ * whose value shifted by L * TIMER_WHEEL_SLOT_BITS lies in the 64 values
+ * starting at this tick shifted the same way, so walking the slots round
+ * from the current one visits them in time order.
+ */
+static uint64_t TimerWheelTick;
+
+static esp_timer_handle_t TimerHw;
+static uint64_t TimerHwExpiry = TIMER_HW_IDLE;
+
+static portMUX_TYPE TimerLock = portMUX_INITIALIZER_UNLOCKED;
+
+#if CONFIG_LORA_TIMER_TASK
+static TaskHandle_t TimerTaskHandle;
+#endif
+
+static uint64_t TimerWheelSlotMask( uint64_t first, uint64_t last )
 {
+    uint64_t mask;
+    uint32_t shift;
 
-    obj->ReloadValue = 0;
-    obj->IsStarted = false;
-    obj->timer_args.callback = callback;
-    obj->timer_args.arg = NULL;
-    obj->timer_args.name = "lorawan";
-    ESP_ERROR_CHECK(esp_timer_create(&obj->timer_args, &obj->timer_handle));
+    if( last < first )
+    {
+        return 0;
+    }
+    if( ( last - first ) >= ( TIMER_WHEEL_SLOTS - 1 ) )
+    {
+        return UINT64_MAX;
+    }
+    mask = ( ( uint64_t )1 << ( last - first + 1 ) ) - 1;
+    shift = first & ( TIMER_WHEEL_SLOTS - 1 );
+    return ( shift == 0 ) ? mask : ( ( mask << shift ) | ( mask >> ( 64 - shift ) ) );
+}
+
+static void TimerWheelInsert( TimerEvent_t *obj )
+{
+    uint64_t tick = obj->Timestamp >> TIMER_WHEEL_TICK_SHIFT;
+    uint64_t pos;
+    uint64_t last;
+    uint32_t shift = 0;
+    uint8_t level;
+    uint8_t slot;
+
+    if( tick < TimerWheelTick )
+    {
+        // Already due, file it in the current slot
+        tick = TimerWheelTick;
+    }
+    for( level = 0; level < ( TIMER_WHEEL_LEVELS - 1 ); level++ )
+    {
+        shift = level * TIMER_WHEEL_SLOT_BITS;
+        if( ( ( tick >> shift ) - ( TimerWheelTick >> shift ) ) < TIMER_WHEEL_SLOTS )
+        {
+            break;
+        }
+    }
+    shift = level * TIMER_WHEEL_SLOT_BITS;
+    pos = tick >> shift;
+    last = ( TimerWheelTick >> shift ) + TIMER_WHEEL_SLOTS - 1;
+    if( pos > last )
+    {
+        pos = last;
+    }
+    slot = pos & ( TIMER_WHEEL_SLOTS - 1 );
+
+    obj->Level = level;
+    obj->Slot = slot;
+    obj->Prev = NULL;
+    obj->Next = TimerWheel[level][slot];
+    if( obj->Next != NULL )
+    {
+        obj->Next->Prev = obj;
+    }
+    TimerWheel[level][slot] = obj;
+    TimerWheelOccupied[level] |= ( uint64_t )1 << slot;
+}
+
+static void TimerWheelRemove( TimerEvent_t *obj )
+{
+    if( obj->Prev != NULL )
+    {
+        obj->Prev->Next = obj->Next;
+    }
+    else
+    {
+        TimerWheel[obj->Level][obj->Slot] = obj->Next;
+        if( obj->Next == NULL )
+        {
+            TimerWheelOccupied[obj->Level] &= ~( ( uint64_t )1 << obj->Slot );
+        }
+    }
+    if( obj->Next != NULL )
+    {
+        obj->Next->Prev = obj->Prev;
+    }
+    obj->Prev = NULL;
+    obj->Next = NULL;
+}
+
+/*!
+ * \brief Moves the wheel to the given tick
+ *
+ * \remark Level 0 slots of the ticks passed over and the higher level slots
+ *         that have come up are emptied and their timers filed again from
+ *         the new tick. Timers already due end up in the current level 0 slot.
+ *
+ * \param [IN] tick Current tick, not lower than TimerWheelTick
+ */
+static void TimerWheelAdvance( uint64_t tick )
+{
+    TimerEvent_t *refile = NULL;
+    TimerEvent_t *obj;
+    uint64_t due;
+    uint32_t shift;
+    uint8_t slot;
+
+    if( tick == TimerWheelTick )
+    {
+        return;
+    }
+    for( uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++ )
+    {
+        shift = level * TIMER_WHEEL_SLOT_BITS;
+        if( level == 0 )
+        {
+            due = TimerWheelSlotMask( TimerWheelTick, tick - 1 );
+        }
+        else
+        {
+            due = TimerWheelSlotMask( ( TimerWheelTick >> shift ) + 1, tick >> shift );
+        }
+        due &= TimerWheelOccupied[level];
+        TimerWheelOccupied[level] &= ~due;
+        while( due != 0 )
+        {
+            slot = __builtin_ctzll( due );
+            due &= due - 1;
+            // Chain the slot's timers on the refile list
+            obj = TimerWheel[level][slot];
+            TimerWheel[level][slot] = NULL;
+            while( obj != NULL )
+            {
+                TimerEvent_t *next = obj->Next;
+                obj->Next = refile;
+                refile = obj;
+                obj = next;
+            }
+        }
+    }
+
+    TimerWheelTick = tick;
+    while( refile != NULL )
+    {
+        obj = refile;
+        refile = obj->Next;
+        TimerWheelInsert( obj );
+    }
+}
+
+/*!
+ * \brief Finds the running timer that expires first
+ *
+ * \retval timer Earliest timer, NULL when none is running
+ */
+static TimerEvent_t* TimerWheelEarliest( void )
+{
+    TimerEvent_t *earliest = NULL;
+    uint64_t occupied;
+    uint32_t current;
+    uint8_t slot;
+
+    for( uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++ )
+    {
+        occupied = TimerWheelOccupied[level];
+        if( occupied == 0 )
+        {
+            continue;
+        }
+        // First non-empty slot from the current one, round the wheel
+        current = ( TimerWheelTick >> ( level * TIMER_WHEEL_SLOT_BITS ) ) & ( TIMER_WHEEL_SLOTS - 1 );
+        if( current != 0 )
+        {
+            occupied = ( occupied >> current ) | ( occupied << ( 64 - current ) );
+        }
+        slot = ( current + __builtin_ctzll( occupied ) ) & ( TIMER_WHEEL_SLOTS - 1 );
+        for( TimerEvent_t *obj = TimerWheel[level][slot]; obj != NULL; obj = obj->Next )
+        {
+            if( ( earliest == NULL ) || ( obj->Timestamp < earliest->Timestamp ) )
+            {
+                earliest = obj;
+            }
+        }
+    }
+    return earliest;
+}
+
+static void TimerHwArm( uint64_t expiry, uint64_t now )
+{
+    if( expiry == TimerHwExpiry )
+    {
+        return;
+    }
+    esp_timer_stop( TimerHw );
+    ESP_ERROR_CHECK( esp_timer_start_once( TimerHw, ( expiry > now ) ? ( expiry - now ) : 0 ) );
+    TimerHwExpiry = expiry;
+}
+
+/*!
+ * \brief Runs the callbacks of the expired timers and arms the one-shot for
+ *        the next one
+ *
+ * \remark Callbacks run one at a time without the lock held, so they can
+ *         start and stop timers, including ones that have expired as well.
+ */
+static void TimerProcess( void )
+{
+    TimerEvent_t *obj;
+    uint64_t now;
+
+    portENTER_CRITICAL( &TimerLock );
+    // The one-shot has fired, or is about to and will find nothing to do
+    TimerHwExpiry = TIMER_HW_IDLE;
+    portEXIT_CRITICAL( &TimerLock );
+
+    for( ;; )
+    {
+        portENTER_CRITICAL( &TimerLock );
+        now = esp_timer_get_time( );
+        TimerWheelAdvance( now >> TIMER_WHEEL_TICK_SHIFT );
+        obj = TimerWheelEarliest( );
+        if( ( obj == NULL ) || ( obj->Timestamp > now ) )
+        {
+            if( obj != NULL )
+            {
+                TimerHwArm( obj->Timestamp, now );
+            }
+            portEXIT_CRITICAL( &TimerLock );
+            return;
+        }
+        TimerWheelRemove( obj );
+        obj->IsStarted = false;
+        portEXIT_CRITICAL( &TimerLock );
+
+        TIMER_TRACE( 1 );
+        obj->Callback( obj->Context );
+        TIMER_TRACE( 0 );
+    }
+}
+
+#if CONFIG_LORA_TIMER_TASK
+static void TimerTask( void *arg )
+{
+    for( ;; )
+    {
+        ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+        TimerProcess( );
+    }
+}
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+#include "esp_attr.h"
+
+static void IRAM_ATTR TimerHwIrq( void *arg )
+{
+    BaseType_t woken = pdFALSE;
+
+    vTaskNotifyGiveFromISR( TimerTaskHandle, &woken );
+    if( woken == pdTRUE )
+    {
+        esp_timer_isr_dispatch_need_yield( );
+    }
+}
+#else
+static void TimerHwIrq( void *arg )
+{
+    xTaskNotifyGive( TimerTaskHandle );
+}
+#endif
+#else
+static void TimerHwIrq( void *arg )
+{
+    TimerProcess( );
+}
+#endif
+
+static void TimerServiceInit( void )
+{
+    if( TimerHw != NULL )
+    {
+        return;
+    }
+
+    esp_timer_create_args_t args = {
+        .callback = TimerHwIrq,
+        .arg = NULL,
+        .name = "lorawan",
+#if CONFIG_LORA_TIMER_TASK && CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+        .dispatch_method = ESP_TIMER_ISR,
+#endif
+    };
+
+    TimerWheelTick = ( uint64_t )esp_timer_get_time( ) >> TIMER_WHEEL_TICK_SHIFT;
+#if CONFIG_LORA_TIMER_TASK
+    xTaskCreate( TimerTask, "lora_timer", CONFIG_LORA_TIMER_TASK_STACK_SIZE, NULL,
+                 CONFIG_LORA_TIMER_TASK_PRIORITY, &TimerTaskHandle );
+#endif
+#if defined( CONFIG_LORA_TIMER_TRACE_GPIO ) && ( CONFIG_LORA_TIMER_TRACE_GPIO >= 0 )
+    gpio_reset_pin( CONFIG_LORA_TIMER_TRACE_GPIO );
+    gpio_set_direction( CONFIG_LORA_TIMER_TRACE_GPIO, GPIO_MODE_OUTPUT );
+    TIMER_TRACE( 0 );
+#endif
+    ESP_ERROR_CHECK( esp_timer_create( &args, &TimerHw ) );
+}
+
+void TimerInit( TimerEvent_t *obj, void ( *callback )( void *context ) )
+{
+    TimerInit2( obj, callback, NULL );
 }
 
 void TimerInit2( TimerEvent_t *obj, void ( *callback )( void *context ),  void *context)
 {
+    TimerServiceInit( );
 
+    obj->Timestamp = 0;
     obj->ReloadValue = 0;
     obj->IsStarted = false;
-    obj->timer_args.callback = callback;
-    obj->timer_args.arg = context;
-    obj->timer_args.name = "lorawan";
-    ESP_ERROR_CHECK(esp_timer_create(&obj->timer_args, &obj->timer_handle));
+    obj->Callback = callback;
+    obj->Context = context;
+    obj->Prev = NULL;
+    obj->Next = NULL;
 }
 
 void TimerStart( TimerEvent_t *obj )
 {
-    obj->IsStarted = true;
-    ESP_ERROR_CHECK(esp_timer_start_once(obj->timer_handle, obj->ReloadValue));
+    uint64_t now;
+
+    portENTER_CRITICAL( &TimerLock );
+    if( obj->IsStarted == false )
+    {
+        now = esp_timer_get_time( );
+        obj->Timestamp = now + obj->ReloadValue;
+        obj->IsStarted = true;
+        TimerWheelInsert( obj );
+        if( obj->Timestamp < TimerHwExpiry )
+        {
+            TimerHwArm( obj->Timestamp, now );
+        }
+    }
+    portEXIT_CRITICAL( &TimerLock );
 }
 
 bool TimerIsStarted( TimerEvent_t *obj )
@@ -35,8 +411,14 @@ bool TimerIsStarted( TimerEvent_t *obj )
 
 void TimerStop( TimerEvent_t *obj )
 {
-    obj->IsStarted = false;
-    esp_timer_stop(obj->timer_handle);
+    // The one-shot stays armed, TimerProcess re-arms it when it finds nothing due
+    portENTER_CRITICAL( &TimerLock );
+    if( obj->IsStarted == true )
+    {
+        TimerWheelRemove( obj );
+        obj->IsStarted = false;
+    }
+    portEXIT_CRITICAL( &TimerLock );
 }
 
 void TimerReset( TimerEvent_t *obj )
@@ -47,11 +429,16 @@ void TimerReset( TimerEvent_t *obj )
 
 void TimerSetValue( TimerEvent_t *obj, uint32_t value )
 {
-    uint64_t ticks = value * 1000; //us
+    TimerStop( obj );
+
+    obj->ReloadValue = ( uint64_t )value * 1000; //us
+}
 
+void TimerSetValueUs( TimerEvent_t *obj, uint64_t value )
+{
     TimerStop( obj );
 
-    obj->ReloadValue = ticks;
+    obj->ReloadValue = value;
 }
 
 TimerTime_t TimerGetCurrentTime( void )
@@ -60,6 +447,11 @@ TimerTime_t TimerGetCurrentTime( void )
     return (TimerTime_t)(now/1000);
 }
 
+int64_t TimerGetCurrentTimeUs( void )
+{
+    return esp_timer_get_time( );
+}
+
 TimerTime_t TimerGetElapsedTime( TimerTime_t past )
 {
     if ( past == 0 )
@@ -69,5 +461,3 @@ TimerTime_t TimerGetElapsedTime( TimerTime_t past )
     uint32_t now = TimerGetCurrentTime( );
     return (now-past);
 }
-
-
@@ -31,22 +31,20 @@ extern "C"
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include "esp_timer.h"
-
 /*!
  * \brief Timer object description
  */
 typedef struct TimerEvent_s
 {
-    // uint64_t Timestamp;                  //! Current timer value
-    uint64_t ReloadValue;                //! Timer delay value
+    uint64_t Timestamp;                  //! Expiry time [us, esp_timer_get_time]
+    uint64_t ReloadValue;                //! Timer delay value [us]
     bool IsStarted;                      //! Is the timer currently running
-    // bool IsNext2Expire;                  //! Is the next timer to expire
-    // void ( *Callback )( void* context ); //! Timer IRQ callback function
-    // void *Context;                       //! User defined data object pointer to pass back
-    //struct TimerEvent_s *Next;           //! Pointer to the next Timer object.
-    esp_timer_create_args_t  timer_args;
-    esp_timer_handle_t       timer_handle;
+    uint8_t Level;                       //! Timer wheel level holding the timer
+    uint8_t Slot;                        //! Timer wheel slot holding the timer
+    void ( *Callback )( void* context ); //! Timer IRQ callback function
+    void *Context;                       //! User defined data object pointer to pass back
+    struct TimerEvent_s *Prev;           //! Previous timer in the wheel slot
+    struct TimerEvent_s *Next;           //! Next timer in the wheel slot
 }TimerEvent_t;
 
 /*!
@@ -73,6 +71,8 @@ void TimerInit2( TimerEvent_t *obj, void ( *callback )( void *context ),  void *
 /*!
  * \brief Starts and adds the timer object to the list of timer events
  *
+ * \remark A running timer is left as it is, use TimerReset to restart it.
+ *
  * \param [IN] obj Structure containing the timer object parameters
  */
 void TimerStart( TimerEvent_t *obj );
@@ -105,10 +105,18 @@ void TimerReset( TimerEvent_t *obj );
  * \brief Set timer new timeout value
  *
  * \param [IN] obj   Structure containing the timer object parameters
- * \param [IN] value New timer timeout value
+ * \param [IN] value New timer timeout value [ms]
  */
 void TimerSetValue( TimerEvent_t *obj, uint32_t value );
 
+/*!
+ * \brief Set timer new timeout value in microseconds
+ *
+ * \param [IN] obj   Structure containing the timer object parameters
+ * \param [IN] value New timer timeout value [us]
+ */
+void TimerSetValueUs( TimerEvent_t *obj, uint64_t value );
+
 /*!
  * \brief Read the current time
  *
@@ -116,6 +124,15 @@ void TimerSetValue( TimerEvent_t *obj, uint32_t value );
  */
 TimerTime_t TimerGetCurrentTime( void );
 
+/*!
+ * \brief Read the current time in microseconds
+ *
+ * \remark Same clock as TimerGetCurrentTime, esp_timer_get_time.
+ *
+ * \retval time returns current time [us]
+ */
+int64_t TimerGetCurrentTimeUs( void );
+
 /*!
  * \brief Return the Time elapsed since a fix moment in Time
  *
@@ -44,11 +44,13 @@
 
 #include "esp_log.h"
 #include "esp_rom_sys.h"
+#include "esp_attr.h"
 
 #include "sx126x_hal.h"
 #include "radio_context.h"
 
 #include "bsp_sx126x.h"
+#include "sx126x-board.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -64,6 +66,20 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+/**
+ * @brief Longest command and payload sent in one SPI transaction
+ *
+ * The driver's commands are at most 10 bytes, buffer accesses carry up to 255
+ * bytes after their header.
+ */
+#define SPI_BUFFER_SIZE ( 16 + 256 )
+
+/**
+ * @brief Transactions up to this length are polled, longer ones wait for the
+ * DMA interrupt
+ */
+#define SPI_POLLING_MAX 32
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -74,6 +90,13 @@
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
+static DMA_ATTR uint8_t  spi_tx_buffer[SPI_BUFFER_SIZE];
+static DMA_ATTR uint8_t  spi_rx_buffer[SPI_BUFFER_SIZE];
+static spi_transaction_t spi_transaction = {
+    .tx_buffer = spi_tx_buffer,
+    .rx_buffer = spi_rx_buffer,
+};
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
@@ -85,9 +108,19 @@
 void sx126x_hal_wait_on_busy( const void* context );
 
 /**
- * @brief SPI tranfer
+ * @brief Send a command and its data in one SPI transaction
+ *
+ * @param [in] context Radio context
+ * @param [in] command Command opcode and parameters
+ * @param [in] command_length Command length in bytes
+ * @param [in] data_out Data sent after the command, NOPs if NULL
+ * @param [out] data_in Data received after the command, may be NULL
+ * @param [in] data_length Data length in bytes
+ *
+ * @returns false if the transaction does not fit the buffer
  */
-static uint8_t spi_transfer( const void* context, uint8_t address );
+static bool spi_transfer( const void* context, const uint8_t* command, const uint16_t command_length,
+                          const uint8_t* data_out, uint8_t* data_in, const uint16_t data_length );
 
 /*
  * -----------------------------------------------------------------------------
@@ -135,7 +168,7 @@ sx126x_hal_status_t sx126x_hal_write( const void* context, const uint8_t* comman
 
 {
     const radio_context_t* sx126x_context = ( const radio_context_t* ) context;
-    int                    i;
+    bool                   ok;
 
     sx126x_hal_wait_on_busy( context );
 
@@ -145,16 +178,7 @@ sx126x_hal_status_t sx126x_hal_write( const void* context, const uint8_t* comman
     gpio_set_level( sx126x_context->spi_nss, 0 );
 #endif
 
-    /* Write command */
-    for( i = 0; i < command_length; i++ )
-    {
-        spi_transfer( context, command[i] );
-    }
-    /* Write data */
-    for( i = 0; i < data_length; i++ )
-    {
-        spi_transfer( context, data[i] );
-    }
+    ok = spi_transfer( context, command, command_length, data, NULL, data_length );
 
 #if INDICATOR_LORAHUB 
     indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 1);
@@ -162,14 +186,14 @@ sx126x_hal_status_t sx126x_hal_write( const void* context, const uint8_t* comman
     gpio_set_level( sx126x_context->spi_nss, 1 );
 #endif
 
-    return SX126X_HAL_STATUS_OK;
+    return ok ? SX126X_HAL_STATUS_OK : SX126X_HAL_STATUS_ERROR;
 }
 
 sx126x_hal_status_t sx126x_hal_read( const void* context, const uint8_t* command, const uint16_t command_length,
                                      uint8_t* data, const uint16_t data_length )
 {
     const radio_context_t* sx126x_context = ( const radio_context_t* ) context;
-    int                    i;
+    bool                   ok;
 
     sx126x_hal_wait_on_busy( context );
 
@@ -179,16 +203,7 @@ sx126x_hal_status_t sx126x_hal_read( const void* context, const uint8_t* command
     gpio_set_level( sx126x_context->spi_nss, 0 );
 #endif
 
-    /* Write command */
-    for( i = 0; i < command_length; i++ )
-    {
-        spi_transfer( context, command[i] );
-    }
-    /* Read data */
-    for( i = 0; i < data_length; i++ )
-    {
-        data[i] = spi_transfer( context, 0x00 );
-    }
+    ok = spi_transfer( context, command, command_length, NULL, data, data_length );
 
 #if INDICATOR_LORAHUB
     indicator_io_expander->set_level(EXPANDER_IO_RADIO_NSS, 1);
@@ -196,7 +211,7 @@ sx126x_hal_status_t sx126x_hal_read( const void* context, const uint8_t* command
     gpio_set_level( sx126x_context->spi_nss, 1 );
 #endif
 
-    return SX126X_HAL_STATUS_OK;
+    return ok ? SX126X_HAL_STATUS_OK : SX126X_HAL_STATUS_ERROR;
 }
 
 /*
@@ -210,12 +225,8 @@ void sx126x_hal_wait_on_busy( const void* context )
     int                    gpio_state;
 
 #if INDICATOR_LORAHUB
-    uint16_t pin_val;
-    do
-    {
-        esp_err_t ret = indicator_io_expander->read_input_pins(&pin_val);
-        WAIT_US( 1 );
-    } while( (pin_val & (0x01 << EXPANDER_IO_RADIO_BUSY)) == 1 );
+    /* BUSY is on the IO expander: wait on its INT line, see sx126x_sensecap_board.c */
+    SX126xWaitOnBusy( );
 #else
     do
     {
@@ -225,29 +236,43 @@ void sx126x_hal_wait_on_busy( const void* context )
 #endif
 }
 
-bool spi_rw_byte( const void* context, uint8_t* data_in, uint8_t* data_out, size_t length )
+static bool spi_transfer( const void* context, const uint8_t* command, const uint16_t command_length,
+                          const uint8_t* data_out, uint8_t* data_in, const uint16_t data_length )
 {
-    const radio_context_t*   sx126x_context = ( const radio_context_t* ) context;
-    static spi_transaction_t spi_transaction;
+    const radio_context_t* sx126x_context = ( const radio_context_t* ) context;
+    size_t                 length         = command_length + data_length;
+
+    if( length > SPI_BUFFER_SIZE )
+    {
+        return false;
+    }
+
+    memcpy( spi_tx_buffer, command, command_length );
+    if( data_out != NULL )
+    {
+        memcpy( spi_tx_buffer + command_length, data_out, data_length );
+    }
+    else
+    {
+        memset( spi_tx_buffer + command_length, 0x00, data_length );
+    }
 
-    if( length > 0 )
+    spi_transaction.length = length * 8; /* in bits */
+    if( length <= SPI_POLLING_MAX )
+    {
+        spi_device_polling_transmit( sx126x_context->spi_handle, &spi_transaction );
+    }
+    else
     {
-        memset( &spi_transaction, 0, sizeof( spi_transaction_t ) );
-        spi_transaction.length    = length * 8; /* in bits */
-        spi_transaction.tx_buffer = data_out;
-        spi_transaction.rx_buffer = data_in;
         spi_device_transmit( sx126x_context->spi_handle, &spi_transaction );
     }
 
-    return true;
-}
+    if( data_in != NULL )
+    {
+        memcpy( data_in, spi_rx_buffer + command_length, data_length );
+    }
 
-static uint8_t spi_transfer( const void* context, uint8_t address )
-{
-    uint8_t data_in;
-    uint8_t data_out = address;
-    spi_rw_byte( context, &data_in, &data_out, 1 );
-    return data_in;
+    return true;
 }
 
 /* --- EOF ------------------------------------------------------------------ */
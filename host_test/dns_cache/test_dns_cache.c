@@ -0,0 +1,370 @@
+/*
+ * Host unit test for main/model/dns_cache.c with a fake resolver and clock.
+ *
+ *   test_dns_cache          run all cases, exit status is the failure count
+ */
+#include <stdio.h>
+#include <string.h>
+#include "dns_cache.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+esp_log_level_t host_log_level = ESP_LOG_NONE;
+
+#define ADDR(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+/* ------------------------------------------------------------ fakes ---- */
+
+static int64_t fake_now_us;
+
+static struct {
+    esp_err_t err;
+    uint32_t  addr;
+    uint32_t  ttl_s;
+    int       calls;
+    char      last_host[DNS_CACHE_HOST_MAX];
+} fake_dns;
+
+static int tasks_started;
+
+int64_t esp_timer_get_time(void)
+{
+    return fake_now_us;
+}
+
+static void advance_s(int64_t s)
+{
+    fake_now_us += s * 1000000;
+}
+
+static esp_err_t fake_resolver(const char *host, uint32_t *addr, uint32_t *ttl_s)
+{
+    fake_dns.calls++;
+    strncpy(fake_dns.last_host, host, sizeof(fake_dns.last_host) - 1);
+    if (fake_dns.err != ESP_OK) {
+        return fake_dns.err;
+    }
+    *addr = fake_dns.addr;
+    *ttl_s = fake_dns.ttl_s;
+    return ESP_OK;
+}
+
+/* Refresh tasks run to completion inside xTaskCreate() */
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_depth,
+                       void *params, UBaseType_t priority, TaskHandle_t *created_task)
+{
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+    if (created_task) {
+        *created_task = NULL;
+    }
+    tasks_started++;
+    task(params);
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    (void)task;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    (void)ticks;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    (void)code;
+    return "";
+}
+
+/* ---------------------------------------------------------- harness ---- */
+
+static int failures;
+static const char *current;
+
+#define CHECK(cond) do {                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "FAIL %s:%d [%s] %s\n", __FILE__, __LINE__,         \
+                    current, #cond);                                            \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+static void setup(const char *name)
+{
+    current = name;
+    fake_now_us = 1000 * 1000000LL;
+    memset(&fake_dns, 0, sizeof(fake_dns));
+    fake_dns.addr = ADDR(10, 0, 0, 1);
+    fake_dns.ttl_s = 300;
+    tasks_started = 0;
+    dns_cache_init(fake_resolver);
+}
+
+/* ------------------------------------------------------------ cases ---- */
+
+static void test_miss_then_hit(void)
+{
+    uint32_t addr = 0;
+    struct dns_cache_stats st;
+
+    setup("miss_then_hit");
+    CHECK(dns_cache_lookup("transport.opendata.ch", &addr) == ESP_OK);
+    CHECK(addr == ADDR(10, 0, 0, 1));
+    CHECK(fake_dns.calls == 1);
+
+    advance_s(100);
+    addr = 0;
+    CHECK(dns_cache_lookup("TRANSPORT.opendata.ch", &addr) == ESP_OK);
+    CHECK(addr == ADDR(10, 0, 0, 1));
+    CHECK(fake_dns.calls == 1);
+    CHECK(tasks_started == 0);
+
+    dns_cache_get_stats(&st);
+    CHECK(st.misses == 1);
+    CHECK(st.hits == 1);
+}
+
+static void test_refresh_ahead(void)
+{
+    uint32_t addr = 0;
+    struct dns_cache_stats st;
+
+    setup("refresh_ahead");
+    dns_cache_lookup("transport.opendata.ch", &addr);
+
+    /* Last quarter of the TTL: cached answer, refresh in the background */
+    advance_s(230);
+    fake_dns.addr = ADDR(10, 0, 0, 2);
+    CHECK(dns_cache_lookup("transport.opendata.ch", &addr) == ESP_OK);
+    CHECK(addr == ADDR(10, 0, 0, 1));
+    CHECK(tasks_started == 1);
+    CHECK(fake_dns.calls == 2);
+
+    /* The refresh restarted the TTL with the new address */
+    advance_s(200);
+    CHECK(dns_cache_lookup("transport.opendata.ch", &addr) == ESP_OK);
+    CHECK(addr == ADDR(10, 0, 0, 2));
+    CHECK(fake_dns.calls == 2);
+
+    dns_cache_get_stats(&st);
+    CHECK(st.refreshes == 1);
+    CHECK(st.misses == 1);
+}
+
+static void test_failed_refresh_backs_off(void)
+{
+    uint32_t addr = 0;
+
+    setup("failed_refresh_backs_off");
+    dns_cache_lookup("transport.opendata.ch", &addr);
+
+    advance_s(230);
+    fake_dns.err = ESP_ERR_TIMEOUT;
+    CHECK(dns_cache_lookup("transport.opendata.ch", &addr) == ESP_OK);
+    CHECK(fake_dns.calls == 2);
+
+    /* Within DNS_CACHE_RETRY_S no new refresh is started */
+    advance_s(DNS_CACHE_RETRY_S - 1);
+    CHECK(dns_cache_lookup("transport.opendata.ch", &addr) == ESP_OK);
+    CHECK(fake_dns.calls == 2);
+
+    advance_s(1);
+    CHECK(dns_cache_lookup("transport.opendata.ch", &addr) == ESP_OK);
+    CHECK(fake_dns.calls == 3);
+    CHECK(addr == ADDR(10, 0, 0, 1));
+}
+
+static void test_expiry(void)
+{
+    uint32_t addr = 0;
+
+    setup("expiry");
+    dns_cache_lookup("transport.opendata.ch", &addr);
+
+    advance_s(300);
+    fake_dns.addr = ADDR(10, 0, 0, 3);
+    CHECK(dns_cache_lookup("transport.opendata.ch", &addr) == ESP_OK);
+    CHECK(addr == ADDR(10, 0, 0, 3));
+    CHECK(fake_dns.calls == 2);
+    CHECK(tasks_started == 0);
+}
+
+static void test_stale_fallback(void)
+{
+    uint32_t addr = 0;
+    struct dns_cache_stats st;
+
+    setup("stale_fallback");
+    dns_cache_lookup("transport.opendata.ch", &addr);
+
+    advance_s(400);
+    fake_dns.err = ESP_ERR_TIMEOUT;
+    addr = 0;
+    CHECK(dns_cache_lookup("transport.opendata.ch", &addr) == ESP_OK);
+    CHECK(addr == ADDR(10, 0, 0, 1));
+    CHECK(fake_dns.calls == 2);
+
+    /* Back-off: stale answer without asking the resolver again */
+    advance_s(1);
+    CHECK(dns_cache_lookup("transport.opendata.ch", &addr) == ESP_OK);
+    CHECK(fake_dns.calls == 2);
+
+    /* Resolver back: fresh answer */
+    advance_s(DNS_CACHE_RETRY_S);
+    fake_dns.err = ESP_OK;
+    fake_dns.addr = ADDR(10, 0, 0, 4);
+    CHECK(dns_cache_lookup("transport.opendata.ch", &addr) == ESP_OK);
+    CHECK(addr == ADDR(10, 0, 0, 4));
+
+    /* Too old to fall back on */
+    advance_s(300 + DNS_CACHE_STALE_MAX_S);
+    fake_dns.err = ESP_ERR_TIMEOUT;
+    CHECK(dns_cache_lookup("transport.opendata.ch", &addr) == ESP_FAIL);
+
+    dns_cache_get_stats(&st);
+    CHECK(st.stale == 2);
+    CHECK(st.failures == 1);
+}
+
+static void test_unknown_host_fails(void)
+{
+    uint32_t addr = 0;
+
+    setup("unknown_host_fails");
+    fake_dns.err = ESP_ERR_NOT_FOUND;
+    CHECK(dns_cache_lookup("nx.example", &addr) == ESP_FAIL);
+    CHECK(dns_cache_lookup("nx.example", &addr) == ESP_FAIL);
+    CHECK(fake_dns.calls == 2);
+}
+
+static void test_ttl_clamp(void)
+{
+    uint32_t addr = 0;
+
+    setup("ttl_clamp");
+    fake_dns.ttl_s = 0;
+    dns_cache_lookup("a.example", &addr);
+    advance_s(DNS_CACHE_TTL_MIN_S - 1);
+    dns_cache_lookup("a.example", &addr);
+    CHECK(fake_dns.calls == 2);             /* hit plus refresh-ahead */
+    CHECK(tasks_started == 1);
+
+    setup("ttl_clamp_max");
+    fake_dns.ttl_s = 7 * 86400;
+    dns_cache_lookup("a.example", &addr);
+    advance_s(DNS_CACHE_TTL_MAX_S);
+    dns_cache_lookup("a.example", &addr);
+    CHECK(fake_dns.calls == 2);
+    CHECK(tasks_started == 0);              /* expired, resolved inline */
+}
+
+static void test_bypass(void)
+{
+    uint32_t addr = 0;
+    char long_name[DNS_CACHE_HOST_MAX + 8];
+
+    setup("bypass");
+    CHECK(dns_cache_lookup("8.8.8.8", &addr) == ESP_ERR_NOT_SUPPORTED);
+    CHECK(dns_cache_lookup("::1", &addr) == ESP_ERR_NOT_SUPPORTED);
+    memset(long_name, 'a', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    CHECK(dns_cache_lookup(long_name, &addr) == ESP_ERR_NOT_SUPPORTED);
+    CHECK(fake_dns.calls == 0);
+}
+
+static void test_lru_eviction(void)
+{
+    uint32_t addr = 0;
+    char host[32];
+
+    setup("lru_eviction");
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        snprintf(host, sizeof(host), "h%d.example", i);
+        dns_cache_lookup(host, &addr);
+        advance_s(1);
+    }
+    dns_cache_lookup("h0.example", &addr);  /* h1 is now least recent */
+    advance_s(1);
+    dns_cache_lookup("new.example", &addr);
+    CHECK(fake_dns.calls == DNS_CACHE_ENTRIES + 1);
+
+    dns_cache_lookup("h0.example", &addr);
+    CHECK(fake_dns.calls == DNS_CACHE_ENTRIES + 1);
+    dns_cache_lookup("h1.example", &addr);
+    CHECK(fake_dns.calls == DNS_CACHE_ENTRIES + 2);
+}
+
+static void test_wire_query(void)
+{
+    uint8_t buf[512];
+    static const uint8_t expect[] = {
+        0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        9, 't', 'r', 'a', 'n', 's', 'p', 'o', 'r', 't',
+        8, 'o', 'p', 'e', 'n', 'd', 'a', 't', 'a',
+        2, 'c', 'h', 0,
+        0x00, 0x01, 0x00, 0x01,
+    };
+
+    setup("wire_query");
+    size_t len = dns_cache_build_query(buf, sizeof(buf), 0x1234, "transport.opendata.ch");
+    CHECK(len == sizeof(expect));
+    CHECK(memcmp(buf, expect, sizeof(expect)) == 0);
+
+    CHECK(dns_cache_build_query(buf, sizeof(buf), 1, "a..b") == 0);
+    CHECK(dns_cache_build_query(buf, 20, 1, "transport.opendata.ch") == 0);
+}
+
+static void test_wire_reply(void)
+{
+    /* Query echo, CNAME (ttl 600) then A (ttl 120), names compressed */
+    uint8_t reply[] = {
+        0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+        9, 't', 'r', 'a', 'n', 's', 'p', 'o', 'r', 't',
+        8, 'o', 'p', 'e', 'n', 'd', 'a', 't', 'a',
+        2, 'c', 'h', 0,
+        0x00, 0x01, 0x00, 0x01,
+        0xc0, 0x0c, 0x00, 0x05, 0x00, 0x01, 0x00, 0x00, 0x02, 0x58, 0x00, 0x04,
+        1, 'x', 0xc0, 0x16,
+        0xc0, 0x33, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04,
+        192, 0, 2, 7,
+    };
+    uint32_t addr = 0, ttl = 0;
+
+    setup("wire_reply");
+    CHECK(dns_cache_parse_reply(reply, sizeof(reply), 0x1234, &addr, &ttl) == ESP_OK);
+    CHECK(addr == ADDR(192, 0, 2, 7));
+    CHECK(ttl == 120);
+
+    CHECK(dns_cache_parse_reply(reply, sizeof(reply), 0x4321, &addr, &ttl) == ESP_ERR_INVALID_RESPONSE);
+    CHECK(dns_cache_parse_reply(reply, sizeof(reply) - 3, 0x1234, &addr, &ttl) == ESP_ERR_INVALID_RESPONSE);
+
+    reply[3] = 0x83;    /* NXDOMAIN */
+    CHECK(dns_cache_parse_reply(reply, sizeof(reply), 0x1234, &addr, &ttl) == ESP_ERR_NOT_FOUND);
+    reply[3] = 0x80;
+    reply[7] = 1;       /* only the CNAME */
+    CHECK(dns_cache_parse_reply(reply, sizeof(reply), 0x1234, &addr, &ttl) == ESP_ERR_NOT_FOUND);
+}
+
+int main(void)
+{
+    test_miss_then_hit();
+    test_refresh_ahead();
+    test_failed_refresh_backs_off();
+    test_expiry();
+    test_stale_fallback();
+    test_unknown_host_fails();
+    test_ttl_clamp();
+    test_bypass();
+    test_lru_eviction();
+    test_wire_query();
+    test_wire_reply();
+
+    printf("%s: %d failure(s)\n", failures ? "FAIL" : "OK", failures);
+    return failures;
+}
@@ -0,0 +1,334 @@
+/*
+ * Fragmentation decoder benchmark.
+ *
+ * Runs the unmodified FragDecoder.c on the host against a synthetic image:
+ * the image is split into fragments, coded fragments are generated with the
+ * parity matrix of the LoRa-Alliance fragmentation specification (encoder
+ * written independently of the decoder, one byte per bit), and every
+ * fragment is dropped with the given probability. Fragments are fed until
+ * the decoder reports the session finished.
+ *
+ * Reports the decode time (all FragDecoderProcess calls) and the peak of the
+ * decoder work memory, allocated through the FragDecoderAlloc callback. The
+ * file is kept in a host buffer behind FragDecoderRead / FragDecoderWrite,
+ * as flash or PSRAM would be on the device.
+ *
+ * Checks that the decoded file matches the image, plus sessions without
+ * loss, with the last uncoded fragments lost and with more losses than
+ * FRAG_MAX_REDUNDANCY, and exits non-zero on a mismatch, so it doubles as a
+ * regression test.
+ *
+ * Usage: bench_frag_decoder [-s image_bytes] [-f frag_size] [-l loss_percent]
+ *                           [-r redundancy_percent] [-n rounds] [--seed n] [--csv]
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "FragDecoder.h"
+
+#define BENCH_IMAGE_SIZE_DEFAULT    ( 200 * 1024 )
+#define BENCH_FRAG_SIZE_DEFAULT     50
+#define BENCH_LOSS_DEFAULT          10      /* % of all fragments */
+#define BENCH_REDUNDANCY_DEFAULT    25      /* Coded fragments, % of FragNb */
+#define BENCH_ROUNDS_DEFAULT        3       /* Best round is reported */
+
+typedef struct {
+    uint16_t frag_nb;
+    uint8_t frag_size;
+    unsigned loss;
+    unsigned redundancy;
+    uint32_t seed;
+} session_cfg_t;
+
+typedef struct {
+    int32_t result;
+    uint16_t lost;
+    uint16_t coded_used;
+    uint64_t decode_ns;
+    size_t peak_heap;
+    bool file_ok;
+} session_result_t;
+
+static int failures = 0;
+
+/* ---------------------------------------------------------------- host ---- */
+
+static uint8_t *file_buf;
+static uint32_t file_size;
+static size_t heap_now;
+static size_t heap_peak;
+
+static int8_t file_write(uint32_t addr, uint8_t *data, uint32_t size)
+{
+    if (addr + size > file_size) {
+        return -1;
+    }
+    memcpy(&file_buf[addr], data, size);
+    return 0;
+}
+
+static int8_t file_read(uint32_t addr, uint8_t *data, uint32_t size)
+{
+    if (addr + size > file_size) {
+        return -1;
+    }
+    memcpy(data, &file_buf[addr], size);
+    return 0;
+}
+
+/* Counts live bytes, a size header precedes each block */
+static void *counting_alloc(size_t size)
+{
+    size_t *p = malloc(size + sizeof(max_align_t));
+    if (p == NULL) {
+        return NULL;
+    }
+    *p = size;
+    heap_now += size;
+    if (heap_now > heap_peak) {
+        heap_peak = heap_now;
+    }
+    return (uint8_t *)p + sizeof(max_align_t);
+}
+
+static void counting_free(void *ptr)
+{
+    size_t *p = (size_t *)((uint8_t *)ptr - sizeof(max_align_t));
+    heap_now -= *p;
+    free(p);
+}
+
+static FragDecoderCallbacks_t callbacks = {
+    .FragDecoderWrite = file_write,
+    .FragDecoderRead = file_read,
+    .FragDecoderAlloc = counting_alloc,
+    .FragDecoderFree = counting_free,
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rng_state;
+
+static uint32_t rnd32(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+/* ------------------------------------------------------------ encoder ---- */
+
+static int32_t prbs23(int32_t x)
+{
+    int32_t b0 = x & 0x01;
+    int32_t b1 = (x & 0x20) >> 5;
+    return (x >> 1) + ((b0 ^ b1) << 22);
+}
+
+/* Row n (1-based) of the parity matrix for m fragments, one byte per column */
+static void parity_row(int32_t n, int32_t m, uint8_t *row)
+{
+    int32_t m_temp = ((m & (m - 1)) == 0) ? 1 : 0;
+    int32_t x = 1 + 1001 * n;
+
+    memset(row, 0, (size_t)m);
+    for (int32_t coeff = 0; coeff < m / 2; coeff++) {
+        int32_t r = 1 << 16;
+        while (r >= m) {
+            x = prbs23(x);
+            r = x % (m + m_temp);
+        }
+        row[r] = 1;
+    }
+}
+
+static void encode(const uint8_t *image, uint16_t frag_nb, uint8_t frag_size, uint16_t n,
+                   uint8_t *row, uint8_t *out)
+{
+    parity_row(n, frag_nb, row);
+    memset(out, 0, frag_size);
+    for (uint16_t i = 0; i < frag_nb; i++) {
+        if (row[i]) {
+            for (uint8_t b = 0; b < frag_size; b++) {
+                out[b] ^= image[(uint32_t)i * frag_size + b];
+            }
+        }
+    }
+}
+
+/* ------------------------------------------------------------ session ---- */
+
+/*
+ * drop_tail: also lose this many of the last uncoded fragments, which the
+ * decoder only learns about from the first coded fragment
+ */
+static void run_session(const session_cfg_t *cfg, uint16_t drop_tail, session_result_t *res)
+{
+    uint32_t size = (uint32_t)cfg->frag_nb * cfg->frag_size;
+    uint16_t coded_nb = (uint16_t)((uint32_t)cfg->frag_nb * cfg->redundancy / 100 + 1);
+    uint8_t *image = malloc(size);
+    uint8_t *row = malloc(cfg->frag_nb);
+    uint8_t frag[255];
+
+    memset(res, 0, sizeof(*res));
+    res->result = FRAG_SESSION_ONGOING;
+    rng_state = cfg->seed;
+    for (uint32_t i = 0; i < size; i++) {
+        image[i] = (uint8_t)rnd32();
+    }
+    file_buf = malloc(size);
+    file_size = size;
+    heap_now = heap_peak = 0;
+
+    FragDecoderInit(cfg->frag_nb, cfg->frag_size, &callbacks);
+
+    for (uint32_t counter = 1; counter <= (uint32_t)cfg->frag_nb + coded_nb; counter++) {
+        bool lost = (rnd32() % 1000) < cfg->loss * 10;
+
+        if (counter <= cfg->frag_nb) {
+            lost |= counter > (uint32_t)(cfg->frag_nb - drop_tail);
+            memcpy(frag, &image[(counter - 1) * cfg->frag_size], cfg->frag_size);
+        } else {
+            /* Encoding is not part of the decode time */
+            encode(image, cfg->frag_nb, cfg->frag_size, (uint16_t)(counter - cfg->frag_nb), row, frag);
+            if (!lost) {
+                res->coded_used++;
+            }
+        }
+        if (lost) {
+            continue;
+        }
+        uint64_t start = now_ns();
+        res->result = FragDecoderProcess((uint16_t)counter, frag);
+        res->decode_ns += now_ns() - start;
+        if (res->result != FRAG_SESSION_ONGOING) {
+            break;
+        }
+    }
+    res->lost = FragDecoderGetStatus().FragNbLost;
+    res->peak_heap = heap_peak;
+    res->file_ok = memcmp(file_buf, image, size) == 0;
+    check(heap_now == 0, "work memory released at the end of the session");
+
+    free(file_buf);
+    free(image);
+    free(row);
+}
+
+static void check_sessions(void)
+{
+    session_result_t res;
+    session_cfg_t cfg = { .frag_nb = 100, .frag_size = 23, .loss = 0, .redundancy = 30, .seed = 1 };
+
+    run_session(&cfg, 0, &res);
+    check(res.result == 0 && res.file_ok && res.peak_heap > 0, "no loss");
+
+    run_session(&cfg, 3, &res);
+    check(res.result == 3 && res.lost == 3 && res.file_ok, "last uncoded fragments lost");
+
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        session_cfg_t lossy = { .frag_nb = (uint16_t)(31 + seed * 7), .frag_size = (uint8_t)(seed + 1),
+                                .loss = 15, .redundancy = 60, .seed = seed * 7919 };
+        run_session(&lossy, (uint16_t)(seed % 3), &res);
+        if (!(res.result > 0 && res.result == res.lost && res.file_ok)) {
+            fprintf(stderr, "seed %u: result %d, lost %u: ", seed, res.result, res.lost);
+            check(false, "random loss");
+        }
+    }
+
+    cfg.frag_nb = FRAG_MAX_REDUNDANCY + 10;
+    cfg.redundancy = 10;
+    run_session(&cfg, FRAG_MAX_REDUNDANCY + 1, &res);
+    check(res.result == FRAG_SESSION_FINISHED && FragDecoderGetStatus().MatrixError == 1,
+          "more losses than FRAG_MAX_REDUNDANCY");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t image_size = BENCH_IMAGE_SIZE_DEFAULT;
+    int frag_size = BENCH_FRAG_SIZE_DEFAULT;
+    int loss = BENCH_LOSS_DEFAULT;
+    int redundancy = BENCH_REDUNDANCY_DEFAULT;
+    int rounds = BENCH_ROUNDS_DEFAULT;
+    uint32_t seed = 0x2545f491;
+    bool csv = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            image_size = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            frag_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            loss = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            redundancy = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        }
+    }
+    uint32_t frag_nb = frag_size > 0 ? (image_size + frag_size - 1) / frag_size : 0;
+    if (frag_size < 1 || frag_size > FRAG_MAX_SIZE || frag_nb < 1 || frag_nb > FRAG_MAX_NB ||
+        loss < 0 || loss > 90 || redundancy < 0 || redundancy > 400 || rounds < 1 || seed == 0) {
+        fprintf(stderr, "need 1 <= frag_size <= %d, 1 <= fragments <= %d, loss 0..90, "
+                "redundancy 0..400, rounds >= 1, seed != 0\n", FRAG_MAX_SIZE, FRAG_MAX_NB);
+        return 2;
+    }
+
+    check_sessions();
+
+    session_cfg_t cfg = { .frag_nb = (uint16_t)frag_nb, .frag_size = (uint8_t)frag_size,
+                          .loss = (unsigned)loss, .redundancy = (unsigned)redundancy, .seed = seed };
+    session_result_t best = { 0 };
+
+    for (int round = 0; round < rounds; round++) {
+        session_result_t res;
+        run_session(&cfg, 0, &res);
+        if (res.result < 0 || !res.file_ok) {
+            fprintf(stderr, "result %d, lost %u, %u coded fragments: ", res.result, res.lost, res.coded_used);
+            check(false, "image decoded");
+            break;
+        }
+        if (round == 0 || res.decode_ns < best.decode_ns) {
+            best = res;
+        }
+    }
+
+    if (csv) {
+        printf("image_bytes,frag_size,frag_nb,lost,coded_used,decode_ms,peak_heap_bytes\n");
+        printf("%u,%d,%u,%u,%u,%.3f,%zu\n", (unsigned)(frag_nb * frag_size), frag_size, frag_nb,
+               best.lost, best.coded_used, best.decode_ns / 1e6, best.peak_heap);
+    } else {
+        printf("image      %u bytes, %u fragments of %d bytes\n", (unsigned)(frag_nb * frag_size), frag_nb, frag_size);
+        printf("channel    %d%% loss, %d%% coded fragments\n", loss, redundancy);
+        printf("lost       %u uncoded fragments, recovered with %u coded fragments\n", best.lost, best.coded_used);
+        printf("decode     %.3f ms (best of %d)\n", best.decode_ns / 1e6, rounds);
+        printf("peak heap  %zu bytes decoder work memory\n", best.peak_heap);
+    }
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,316 @@
+/*
+ * LoRaMac timer service test.
+ *
+ * Builds the unmodified components/lora/timer.c on the host against a fake
+ * esp_timer clock that fires its one-shot exactly at the time asked for, and
+ * drives random TimerStart / TimerStop / TimerReset / TimerSetValue and
+ * TimerSetValueUs calls
+ * against a model of the running timers:
+ *
+ *   - every callback runs at exactly the expiry of its timer, in expiry
+ *     order, once per start, and never after the timer was stopped;
+ *   - TimerIsStarted follows the model, also from inside callbacks;
+ *   - delays from 0 ms up to several days, beyond the range of the wheel;
+ *   - callbacks that start, stop and restart other timers, including ones
+ *     that expire at the same time.
+ *
+ * Usage: test_lora_timer [-n operations] [--seed n]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "timer.h"
+
+#define TEST_OPERATIONS_DEFAULT     200000
+#define TEST_TIMERS                 48
+
+esp_log_level_t host_log_level = ESP_LOG_WARN;
+
+static int failures = 0;
+
+/* ------------------------------------------------------- fake esp_timer ---- */
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    bool armed;
+    int64_t expiry_us;
+};
+
+static struct esp_timer hw;
+static int hw_count;
+static int64_t now_us = 123456789;
+
+int64_t esp_timer_get_time(void)
+{
+    return now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    hw.args = *create_args;
+    hw_count++;
+    *out_handle = &hw;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->expiry_us = now_us + (int64_t)timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    (void)timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer->armed;
+}
+
+/* ---------------------------------------------------------------- model ---- */
+
+typedef struct {
+    TimerEvent_t timer;
+    bool started;
+    int64_t expiry_us;
+    int64_t value_us;
+} test_timer_t;
+
+static test_timer_t timers[TEST_TIMERS];
+static int64_t last_fire_us;
+static uint32_t fired;
+static uint32_t nested_ops;
+
+static uint32_t rng_state = 0x2545f491;
+
+static uint32_t rnd32(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        if (failures < 10) {
+            fprintf(stderr, "FAIL: %s (t=%lld us)\n", what, (long long)now_us);
+        }
+        failures++;
+    }
+}
+
+/* Mostly LoRaMac-like delays, some zero and some beyond the wheel's range */
+static uint32_t random_value_ms(void)
+{
+    uint32_t r = rnd32() % 100;
+
+    if (r < 5) {
+        return 0;
+    }
+    if (r < 60) {
+        return rnd32() % 3000;
+    }
+    if (r < 90) {
+        return rnd32() % 120000;
+    }
+    if (r < 97) {
+        return rnd32() % (6 * 3600 * 1000);
+    }
+    return rnd32() % (5 * 24 * 3600 * 1000);
+}
+
+static void op_set_value(test_timer_t *t, uint32_t value_ms)
+{
+    TimerSetValue(&t->timer, value_ms);
+    t->value_us = (int64_t)value_ms * 1000;
+    t->started = false;
+}
+
+/* Like the RX windows, which are timed from the IRQ stamp in microseconds */
+static void op_set_value_us(test_timer_t *t, uint64_t value_us)
+{
+    TimerSetValueUs(&t->timer, value_us);
+    t->value_us = (int64_t)value_us;
+    t->started = false;
+}
+
+static void op_start(test_timer_t *t)
+{
+    TimerStart(&t->timer);
+    if (!t->started) {
+        t->started = true;
+        t->expiry_us = now_us + t->value_us;
+    }
+}
+
+static void op_stop(test_timer_t *t)
+{
+    TimerStop(&t->timer);
+    t->started = false;
+}
+
+static void op_reset(test_timer_t *t)
+{
+    TimerReset(&t->timer);
+    t->started = true;
+    t->expiry_us = now_us + t->value_us;
+}
+
+static void random_op(void)
+{
+    test_timer_t *t = &timers[rnd32() % TEST_TIMERS];
+
+    switch (rnd32() % 9) {
+    case 0:
+    case 1:
+    case 2:
+        op_set_value(t, random_value_ms());
+        op_start(t);
+        break;
+    case 7:
+        op_set_value_us(t, (uint64_t)random_value_ms() * 1000 + rnd32() % 1000);
+        op_start(t);
+        break;
+    case 3:
+        op_start(t);
+        break;
+    case 4:
+    case 5:
+        op_stop(t);
+        break;
+    case 6:
+        op_reset(t);
+        break;
+    default:
+        op_set_value(t, random_value_ms());
+        break;
+    }
+}
+
+static void on_timer(void *context)
+{
+    test_timer_t *t = context;
+
+    check(t->started, "callback of a stopped timer");
+    check(now_us == t->expiry_us, "callback not at its expiry");
+    check(now_us >= last_fire_us, "callbacks out of order");
+    for (int i = 0; i < TEST_TIMERS; i++) {
+        if (timers[i].started && &timers[i] != t) {
+            check(timers[i].expiry_us >= now_us, "earlier timer still pending");
+        }
+    }
+    check(!TimerIsStarted(&t->timer), "timer still started in its callback");
+    t->started = false;
+    last_fire_us = now_us;
+    fired++;
+
+    /* Like LoRaMac, callbacks often arm the next timer, sometimes right away */
+    if (rnd32() % 4 == 0) {
+        test_timer_t *other = &timers[rnd32() % TEST_TIMERS];
+        nested_ops++;
+        if (rnd32() % 3 == 0) {
+            op_set_value(other, 0);
+            op_start(other);
+        } else {
+            random_op();
+        }
+    }
+}
+
+/* Runs the one-shot while it is due no later than until_us */
+static void run_until(int64_t until_us)
+{
+    while (hw.armed && hw.expiry_us <= until_us) {
+        now_us = hw.expiry_us;
+        hw.armed = false;
+        hw.args.callback(hw.args.arg);
+    }
+    if (until_us > now_us) {
+        now_us = until_us;
+    }
+}
+
+static bool any_started(void)
+{
+    for (int i = 0; i < TEST_TIMERS; i++) {
+        if (timers[i].started) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t operations = TEST_OPERATIONS_DEFAULT;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            operations = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            rng_state = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+    }
+
+    for (int i = 0; i < TEST_TIMERS; i++) {
+        TimerInit2(&timers[i].timer, on_timer, &timers[i]);
+    }
+    check(hw_count == 1, "one esp_timer for all timers");
+
+    for (uint32_t n = 0; n < operations; n++) {
+        /* Bursts of calls in the same microsecond, then gaps up to minutes */
+        uint32_t r = rnd32() % 10;
+        int64_t gap_us = (r < 3) ? 0 : (r < 8) ? (int64_t)(rnd32() % 5000000) : (int64_t)(rnd32() % 600000000);
+
+        run_until(now_us + gap_us);
+        random_op();
+        for (int i = 0; i < TEST_TIMERS; i++) {
+            if (TimerIsStarted(&timers[i].timer) != timers[i].started) {
+                check(false, "TimerIsStarted differs from the model");
+                timers[i].started = TimerIsStarted(&timers[i].timer);
+            }
+        }
+        if (any_started()) {
+            check(hw.armed, "timers running but the one-shot is idle");
+        }
+    }
+
+    /* Let everything still running expire */
+    for (int guard = 0; any_started() && guard < 1000000; guard++) {
+        check(hw.armed, "timers running but the one-shot is idle");
+        if (!hw.armed) {
+            break;
+        }
+        run_until(hw.expiry_us);
+    }
+    check(!any_started(), "timers left running");
+
+    printf("%u operations, %u callbacks (%u with nested timer calls), %.1f days simulated\n",
+           operations, fired, nested_ops, now_us / 86400e6);
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,532 @@
+/*
+ * SX1262 behind the LoRa hub HAL, for host tests, see fake_radio.h.
+ *
+ * Command counts follow ral_sx126x.c and sx126x.c for a TCXO board (no trim
+ * capacitor writes before RX); frame sizes are the driver's SX126X_SIZE_*.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "fake_radio.h"
+#include "bsp_io_expander.h"
+#include "bsp_sx126x.h"
+#include "ral_sx126x.h"
+#include "ral_sx126x_bsp.h"
+
+#define FAKE_HANDLERS_MAX       4
+/* Touch panel INT on the expander, as in sensecap_indicator_board.c */
+#define FAKE_EXPANDER_IO_TP_INT 6
+
+typedef enum {
+    MODE_STANDBY,
+    MODE_RX_SINGLE,
+    MODE_RX_CONTINUOUS,
+} fake_mode_t;
+
+typedef struct {
+    gpio_isr_t isr;
+    void *arg;
+} fake_handler_t;
+
+double fake_now_us;
+fake_radio_stats_t fake_radio;
+double fake_cmd_us = 310.0;
+double fake_byte_us = 4.0;
+double fake_port_read_us = 100.0;
+double fake_touch_us = 0.0;
+
+static fake_packet_t *schedule;
+static int schedule_count;
+static int next_start;              /* next packet to go on air */
+static int locked = -1;             /* packet being received */
+static bool locked_payload;         /* its header is past */
+static int in_buffer = -1;          /* packet whose payload is in the buffer */
+static bool buffer_unread;
+static bool buffer_clobbered;
+
+static fake_mode_t mode = MODE_STANDBY;
+static double rx_timeout_us = INFINITY;
+static ral_irq_t irq_status;
+static ral_irq_t irq_mask;
+static bool dio1;
+
+/* Expander: INT is pulled low on any input change and released by a port read */
+static bool int_latched;
+static bool touch_int;
+static double touch_next_us = INFINITY;
+
+static fake_handler_t handlers[FAKE_HANDLERS_MAX];
+static int handler_count;
+
+static void input_changed(void)
+{
+    if (int_latched) {
+        return;
+    }
+    int_latched = true;
+    fake_radio.int_edges++;
+    for (int i = 0; i < handler_count; i++) {
+        handlers[i].isr(handlers[i].arg);
+    }
+}
+
+/*
+ * n commands moving bytes on SPI in total. BUSY goes high after each one and
+ * low once it is done, both pulling INT low; the board's wait on BUSY reads
+ * the port after each edge, which releases it.
+ */
+static void cost(int n, int bytes)
+{
+    fake_radio.commands += n;
+    for (int i = 0; i < n; i++) {
+        fake_rtos_advance(fake_cmd_us + (i == 0 ? bytes * fake_byte_us : 0.0));
+        input_changed();
+        int_latched = false;
+        input_changed();
+        int_latched = false;
+    }
+}
+
+static void update_dio1(void)
+{
+    bool level = (irq_status & irq_mask) != 0;
+
+    if (level == dio1) {
+        return;
+    }
+    dio1 = level;
+    if (level) {
+        fake_radio.irq_edges++;
+    }
+    input_changed();
+}
+
+/* Anything on air is lost when the radio leaves RX or restarts it */
+static void abort_reception(void)
+{
+    if (locked >= 0) {
+        fake_radio.missed++;
+        locked = -1;
+    }
+}
+
+static bool in_rx(void)
+{
+    return mode == MODE_RX_SINGLE || mode == MODE_RX_CONTINUOUS;
+}
+
+void fake_radio_schedule(fake_packet_t *packets, int count)
+{
+    schedule = packets;
+    schedule_count = count;
+    next_start = 0;
+    touch_next_us = fake_touch_us > 0.0 ? fake_now_us + fake_touch_us : INFINITY;
+}
+
+void fake_radio_payload(uint32_t id, uint8_t *buffer, uint8_t size)
+{
+    for (int i = 0; i < size; i++) {
+        buffer[i] = i < 4 ? (uint8_t)(id >> (8 * i)) : (uint8_t)(id * 31 + i);
+    }
+}
+
+/* Next event of each kind, INFINITY if none */
+static void next_events(double *start_us, double *payload_us, double *end_us, double *timeout_us)
+{
+    *start_us = next_start < schedule_count ? schedule[next_start].start_us : INFINITY;
+    *payload_us = locked >= 0 && !locked_payload ? schedule[locked].payload_us : INFINITY;
+    *end_us = locked >= 0 && locked_payload ? schedule[locked].end_us : INFINITY;
+    *timeout_us = locked < 0 && mode == MODE_RX_SINGLE ? rx_timeout_us : INFINITY;
+}
+
+double fake_radio_next_event_us(void)
+{
+    double start_us, payload_us, end_us, timeout_us;
+
+    next_events(&start_us, &payload_us, &end_us, &timeout_us);
+    return fmin(fmin(fmin(start_us, payload_us), fmin(end_us, timeout_us)), touch_next_us);
+}
+
+void fake_radio_process_event(void)
+{
+    double start_us, payload_us, end_us, timeout_us;
+
+    next_events(&start_us, &payload_us, &end_us, &timeout_us);
+    if (touch_next_us <= fmin(fmin(start_us, payload_us), fmin(end_us, timeout_us))) {
+        touch_int = !touch_int;
+        touch_next_us += fake_touch_us;
+        fake_radio.touch_edges++;
+        input_changed();
+    } else if (end_us <= fmin(fmin(start_us, payload_us), timeout_us)) {
+        fake_packet_t *p = &schedule[locked];
+
+        p->end_in_task = fake_rtos_in_task();
+        in_buffer = locked;
+        buffer_unread = !p->crc_error;  /* nothing to read after a CRC error */
+        buffer_clobbered = false;
+        locked = -1;
+        fake_radio.received++;
+        irq_status |= RAL_IRQ_RX_DONE | (p->crc_error ? RAL_IRQ_RX_CRC_ERROR : 0);
+        if (mode == MODE_RX_SINGLE) {
+            mode = MODE_STANDBY;    /* fallback mode */
+        }
+        update_dio1();
+    } else if (payload_us <= fmin(start_us, timeout_us)) {
+        locked_payload = true;
+        if (buffer_unread && !buffer_clobbered) {
+            /* Each packet is written from the same buffer address */
+            buffer_clobbered = true;
+        }
+    } else if (timeout_us <= start_us) {
+        fake_radio.rx_timeouts++;
+        mode = MODE_STANDBY;
+        rx_timeout_us = INFINITY;
+        irq_status |= RAL_IRQ_RX_TIMEOUT;
+        update_dio1();
+    } else {
+        if (!in_rx() || locked >= 0) {
+            fake_radio.missed++;
+        } else {
+            locked = next_start;
+            locked_payload = false;
+            rx_timeout_us = INFINITY;   /* the timer stops on the header */
+        }
+        next_start++;
+    }
+}
+
+/* --- ral_drv_t ------------------------------------------------------------ */
+
+ral_status_t fake_radio_reset(const void *context)
+{
+    (void)context;
+    fake_rtos_advance(10000.0);     /* RST low then high, 5 ms each */
+    mode = MODE_STANDBY;
+    irq_status = 0;
+    irq_mask = 0;
+    dio1 = false;
+    int_latched = false;
+    locked = -1;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_init(const void *context)
+{
+    (void)context;
+    /* Regulator, TCXO control, calibration, RX boost */
+    cost(4, 16);
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_set_standby(const void *context, ral_standby_cfg_t standby_cfg)
+{
+    (void)context;
+    (void)standby_cfg;
+    cost(1, 2);
+    abort_reception();
+    mode = MODE_STANDBY;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_set_rx(const void *context, const uint32_t timeout_in_ms)
+{
+    (void)context;
+    cost(1, 4);
+    abort_reception();
+    fake_radio.set_rx++;
+    if (timeout_in_ms == RAL_RX_TIMEOUT_CONTINUOUS_MODE) {
+        mode = MODE_RX_CONTINUOUS;
+        rx_timeout_us = INFINITY;
+    } else {
+        mode = MODE_RX_SINGLE;
+        rx_timeout_us = timeout_in_ms == 0 ? INFINITY : fake_now_us + timeout_in_ms * 1000.0;
+    }
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_set_rx_tx_fallback_mode(const void *context, const ral_fallback_modes_t mode)
+{
+    (void)context;
+    (void)mode;
+    cost(1, 2);
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_get_pkt_payload(const void *context, uint16_t max_size_in_bytes, uint8_t *buffer,
+                                        uint16_t *size_in_bytes)
+{
+    uint8_t size = in_buffer >= 0 ? schedule[in_buffer].size : 0;
+
+    (void)context;
+    /* GetRxBufferStatus, then ReadBuffer */
+    cost(1, 4);
+    if (size > max_size_in_bytes) {
+        return RAL_STATUS_ERROR;
+    }
+    cost(1, 3 + size);
+    if (in_buffer < 0 || buffer_clobbered) {
+        fake_radio.overwritten++;
+        memset(buffer, 0xEE, size);
+    } else {
+        fake_radio_payload(schedule[in_buffer].id, buffer, size);
+    }
+    buffer_unread = false;
+    if (size_in_bytes) {
+        *size_in_bytes = size;
+    }
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_get_irq_status(const void *context, ral_irq_t *irq)
+{
+    (void)context;
+    cost(1, 4);
+    *irq = irq_status;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_clear_irq_status(const void *context, const ral_irq_t irq)
+{
+    (void)context;
+    cost(1, 3);
+    irq_status &= ~irq;
+    update_dio1();
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_get_and_clear_irq_status(const void *context, ral_irq_t *irq)
+{
+    ral_irq_t read;
+
+    (void)context;
+    cost(1, 4);
+    read = irq_status;
+    if (read != 0) {
+        /* Only what was read is cleared, a later IRQ keeps DIO1 high */
+        cost(1, 3);
+        irq_status &= ~read;
+        update_dio1();
+    }
+    if (irq) {
+        *irq = read;
+    }
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_set_dio_irq_params(const void *context, const ral_irq_t irq)
+{
+    (void)context;
+    cost(1, 9);
+    irq_mask = irq;
+    update_dio1();
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_set_rf_freq(const void *context, const uint32_t freq_in_hz)
+{
+    (void)context;
+    (void)freq_in_hz;
+    cost(1, 5);
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_set_pkt_type(const void *context, const ral_pkt_type_t pkt_type)
+{
+    (void)context;
+    (void)pkt_type;
+    cost(1, 2);
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_set_lora_mod_params(const void *context, const ral_lora_mod_params_t *params)
+{
+    (void)context;
+    (void)params;
+    cost(1, 5);
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_set_lora_pkt_params(const void *context, const ral_lora_pkt_params_t *params)
+{
+    (void)context;
+    (void)params;
+    /* SetPacketParams, then the IQ polarity register read and written back */
+    cost(3, 7 + 5 + 4);
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_set_lora_symb_nb_timeout(const void *context, const uint16_t nb_of_symbs)
+{
+    (void)context;
+    cost(nb_of_symbs > 0 ? 2 : 1, nb_of_symbs > 0 ? 6 : 2);
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_get_lora_rx_pkt_status(const void *context, ral_lora_rx_pkt_status_t *rx_pkt_status)
+{
+    uint32_t id = in_buffer >= 0 ? schedule[in_buffer].id : 0;
+
+    (void)context;
+    cost(1, 5);
+    rx_pkt_status->rssi_pkt_in_dbm = -60 - (int16_t)(id % 40);
+    rx_pkt_status->snr_pkt_in_db = 9;
+    rx_pkt_status->signal_rssi_pkt_in_dbm = rx_pkt_status->rssi_pkt_in_dbm;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t fake_radio_set_lora_sync_word(const void *context, const uint8_t sync_word)
+{
+    (void)context;
+    (void)sync_word;
+    cost(1, 5);
+    return RAL_STATUS_OK;
+}
+
+/* --- Board ---------------------------------------------------------------- */
+
+static const smtc_shield_sx126x_pinout_t pinout = {
+    .nss = EXPANDER_IO_RADIO_NSS,
+    .sclk = ESP32_RADIO_SCLK,
+    .mosi = ESP32_RADIO_MOSI,
+    .miso = ESP32_RADIO_MISO,
+    .reset = EXPANDER_IO_RADIO_RST,
+    .busy = EXPANDER_IO_RADIO_BUSY,
+    .irq = ESP32_EXPANDER_IO_INT,
+    .antenna_sw = 0xFF,
+    .led_tx = 0xFF,
+    .led_rx = 0xFF,
+};
+
+static const smtc_shield_sx126x_pinout_t *get_pinout(void)
+{
+    return &pinout;
+}
+
+static const smtc_shield_sx126x_t shield = {
+    .get_pinout = get_pinout,
+};
+
+const smtc_shield_sx126x_t *ral_sx126x_get_shield(void)
+{
+    return &shield;
+}
+
+void ral_sx126x_bsp_get_xosc_cfg(const void *context, ral_xosc_cfg_t *xosc_cfg,
+                                 sx126x_tcxo_ctrl_voltages_t *supply_voltage, uint32_t *startup_time_in_tick)
+{
+    (void)context;
+    if (xosc_cfg) {
+        *xosc_cfg = RAL_XOSC_CFG_TCXO_RADIO_CTRL;
+    }
+    if (supply_voltage) {
+        *supply_voltage = SX126X_TCXO_CTRL_2_4V;
+    }
+    if (startup_time_in_tick) {
+        *startup_time_in_tick = 300;
+    }
+}
+
+static esp_err_t expander_set_direction(uint8_t pin, bool is_output)
+{
+    (void)pin;
+    (void)is_output;
+    return ESP_OK;
+}
+
+static esp_err_t expander_set_level(uint8_t pin, bool level)
+{
+    (void)pin;
+    (void)level;
+    return ESP_OK;
+}
+
+static esp_err_t expander_read_input_pins(uint16_t *pin_val)
+{
+    fake_radio.port_reads++;
+    fake_rtos_advance(fake_port_read_us);
+    *pin_val = (uint16_t)((dio1 ? 1u << EXPANDER_IO_RADIO_DIO_1 : 0u) |
+                          (touch_int ? 0u : 1u << FAKE_EXPANDER_IO_TP_INT));
+    int_latched = false;
+    return ESP_OK;
+}
+
+static io_expander_ops_t expander_ops = {
+    .set_direction = expander_set_direction,
+    .set_level = expander_set_level,
+    .read_input_pins = expander_read_input_pins,
+};
+
+io_expander_ops_t *indicator_io_expander = &expander_ops;
+
+spi_device_handle_t bsp_sx126x_spi_handle_get(void)
+{
+    return NULL;
+}
+
+static esp_err_t add_handler(gpio_isr_t isr, void *arg)
+{
+    if (handler_count == FAKE_HANDLERS_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+    handlers[handler_count].isr = isr;
+    handlers[handler_count].arg = arg;
+    handler_count++;
+    return ESP_OK;
+}
+
+esp_err_t bsp_io_expander_isr_add(bsp_io_expander_isr_t isr, void *arg)
+{
+    return add_handler(isr, arg);
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+    (void)gpio_num;
+    return add_handler(isr_handler, args);
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    return ESP_OK;
+}
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+    (void)gpio_num;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    (void)gpio_num;
+    (void)mode;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    (void)gpio_num;
+    (void)intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    (void)gpio_num;
+    (void)level;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    (void)gpio_num;
+    return 0;
+}
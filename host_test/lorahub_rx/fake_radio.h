@@ -0,0 +1,84 @@
+/*
+ * SX1262 behind the LoRa hub HAL, for host tests.
+ *
+ * The radio is seen through its ral_drv_t (shim/ral_sx126x.h): each call
+ * costs the HAL commands the sx126x driver sends for it, each command the
+ * expander NSS writes and BUSY read around its SPI frame, plus the frame's
+ * bytes on the SPI bus. Packets come from a schedule of on-air intervals; one
+ * is received only if the radio is in RX from its first to its last symbol.
+ * After its header it overwrites the buffer, at its end RxDone (with CrcErr
+ * for a bad one) is raised.
+ *
+ * DIO1 is an expander input, as are BUSY and the touch panel INT. A change of
+ * any of them pulls the expander INT low, which calls the handlers added with
+ * bsp_io_expander_isr_add() or gpio_isr_handler_add(), unless INT is already
+ * low; a read of the input port releases it. BUSY pulses after every command,
+ * so each command gives INT edges of its own.
+ *
+ * Time is virtual. Calls from the consumer can be preempted by the HAL's RX
+ * task whenever it is ready (fake_rtos.c).
+ */
+#ifndef FAKE_RADIO_H
+#define FAKE_RADIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t id;
+    double start_us;                /* first preamble symbol */
+    double payload_us;              /* after the header, the buffer starts to fill */
+    double end_us;                  /* last payload symbol, RxDone */
+    uint8_t size;
+    bool crc_error;
+    bool end_in_task;               /* set by the fake: RxDone came while the RX task ran */
+} fake_packet_t;
+
+typedef struct {
+    uint32_t received;              /* RxDone raised */
+    uint32_t missed;                /* radio not in RX for the whole packet */
+    uint32_t overwritten;           /* payload read after the next packet's header */
+    uint32_t rx_timeouts;
+    uint32_t irq_edges;             /* DIO1 rising edges */
+    uint32_t int_edges;             /* expander INT falling edges, from any input */
+    uint32_t touch_edges;
+    uint32_t port_reads;            /* expander input port reads by the HAL */
+    uint32_t commands;              /* HAL commands */
+    uint32_t set_rx;
+} fake_radio_stats_t;
+
+extern double fake_now_us;
+extern fake_radio_stats_t fake_radio;
+
+/* Per HAL command: two expander writes for NSS and a port read for BUSY, [us] */
+extern double fake_cmd_us;
+/* Per SPI byte, [us] */
+extern double fake_byte_us;
+/* Per expander input port read, [us] */
+extern double fake_port_read_us;
+/* Touch panel INT toggles this often, 0 for never, [us] */
+extern double fake_touch_us;
+
+/* Packets sorted by start_us, not overlapping; the array must outlive the run */
+void fake_radio_schedule(fake_packet_t *packets, int count);
+
+/* Payload of packet id: the id little endian, then bytes derived from it */
+void fake_radio_payload(uint32_t id, uint8_t *buffer, uint8_t size);
+
+/* For fake_rtos.c: next radio event, INFINITY if none, and handling it */
+double fake_radio_next_event_us(void);
+void fake_radio_process_event(void);
+
+/* fake_rtos.c: runs the RX task ahead of the caller while it is ready */
+void fake_rtos_advance(double us);
+/* True when called from the RX task */
+bool fake_rtos_in_task(void);
+
+typedef struct {
+    uint32_t task_runs;             /* switches into the task */
+    double task_us;                 /* virtual time spent in the task */
+} fake_rtos_stats_t;
+
+extern fake_rtos_stats_t fake_rtos;
+
+#endif
@@ -0,0 +1,317 @@
+/*
+ * One FreeRTOS task next to the test's own thread, in virtual time.
+ *
+ * The task runs on a pthread but only one side runs at a time: the task has
+ * the higher priority, so it preempts the test thread whenever it is ready
+ * (an item in the queue it waits on, timeout due, or handed the mutex it waits
+ * for) and runs until it blocks again. The test thread's delays and radio
+ * commands are stretched by the time the task took meanwhile. A task that
+ * keeps waking itself would stretch them forever, so the run aborts when it
+ * holds the test thread off for FAKE_RTOS_STARVE_US in a row.
+ */
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "fake_radio.h"
+
+#define FAKE_RTOS_STARVE_US     1000000.0
+
+typedef enum {
+    TASK_NONE,
+    TASK_READY,
+    TASK_RUNNING,
+    TASK_WAIT_QUEUE,
+    TASK_WAIT_MUTEX,
+} task_state_t;
+
+typedef struct {
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+} fake_queue_t;
+
+typedef struct {
+    bool taken_by_task;
+    bool taken_by_test;
+    bool task_waiting;
+} fake_mutex_t;
+
+fake_rtos_stats_t fake_rtos;
+
+static pthread_mutex_t turn_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t turn_cond = PTHREAD_COND_INITIALIZER;
+static bool task_turn;
+static __thread bool is_task;
+
+static pthread_t task_thread;
+static TaskFunction_t task_function;
+static void *task_params;
+static volatile task_state_t task_state = TASK_NONE;
+static double task_wake_us = INFINITY;
+static fake_queue_t *task_queue;        /* queue the task waits on */
+static double task_streak_us;           /* since the test thread last ran alone */
+
+/* Hands the CPU to the other side and waits until it comes back */
+static void switch_to(bool to_task)
+{
+    pthread_mutex_lock(&turn_lock);
+    task_turn = to_task;
+    pthread_cond_broadcast(&turn_cond);
+    while (task_turn != is_task) {
+        pthread_cond_wait(&turn_cond, &turn_lock);
+    }
+    pthread_mutex_unlock(&turn_lock);
+}
+
+static bool task_ready(void)
+{
+    if (task_state == TASK_READY) {
+        return true;
+    }
+    return task_state == TASK_WAIT_QUEUE && (task_queue->count > 0 || fake_now_us >= task_wake_us);
+}
+
+static void starve_check(void)
+{
+    if (task_streak_us > FAKE_RTOS_STARVE_US) {
+        fprintf(stderr, "RX task ran %.0f ms without letting the test thread in\n", task_streak_us / 1000.0);
+        abort();
+    }
+}
+
+/* From the test thread: run the task until it blocks */
+static void run_task(void)
+{
+    double start_us = fake_now_us;
+
+    task_state = TASK_RUNNING;
+    fake_rtos.task_runs++;
+    switch_to(true);
+    fake_rtos.task_us += fake_now_us - start_us;
+}
+
+static void *task_entry(void *arg)
+{
+    (void)arg;
+    is_task = true;
+    pthread_mutex_lock(&turn_lock);
+    while (!task_turn) {
+        pthread_cond_wait(&turn_cond, &turn_lock);
+    }
+    pthread_mutex_unlock(&turn_lock);
+
+    task_function(task_params);
+    fprintf(stderr, "task function returned\n");
+    abort();
+}
+
+bool fake_rtos_in_task(void)
+{
+    return is_task;
+}
+
+void fake_rtos_advance(double us)
+{
+    double end_us = fake_now_us + us;
+
+    if (is_task) {
+        while (fake_radio_next_event_us() <= end_us) {
+            fake_now_us = fmax(fake_now_us, fake_radio_next_event_us());
+            fake_radio_process_event();
+        }
+        task_streak_us += us;
+        fake_now_us = end_us;
+        starve_check();
+        return;
+    }
+
+    for (;;) {
+        if (task_ready()) {
+            double before_us = fake_now_us;
+
+            run_task();
+            end_us += fake_now_us - before_us;
+            continue;
+        }
+
+        double radio_us = fake_radio_next_event_us();
+        double wake_us = task_state == TASK_WAIT_QUEUE ? task_wake_us : INFINITY;
+        double next_us = fmin(radio_us, wake_us);
+
+        if (next_us > end_us) {
+            break;
+        }
+        if (next_us > fake_now_us) {
+            task_streak_us = 0.0;
+        }
+        fake_now_us = fmax(fake_now_us, next_us);
+        if (radio_us <= wake_us) {
+            fake_radio_process_event();
+        }
+    }
+    if (end_us > fake_now_us) {
+        task_streak_us = 0.0;
+    }
+    fake_now_us = end_us;
+}
+
+/* --- FreeRTOS ------------------------------------------------------------- */
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_depth,
+                       void *params, UBaseType_t priority, TaskHandle_t *created_task)
+{
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+    if (task_state != TASK_NONE) {
+        fprintf(stderr, "only one task is modelled\n");
+        abort();
+    }
+
+    task_function = task;
+    task_params = params;
+    task_state = TASK_READY;
+    if (pthread_create(&task_thread, NULL, task_entry, NULL) != 0) {
+        return pdFAIL;
+    }
+    pthread_detach(task_thread);
+    if (created_task) {
+        *created_task = (TaskHandle_t)&task_state;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    (void)task;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    fake_rtos_advance((double)ticks * portTICK_PERIOD_MS * 1000.0);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t queue_length, UBaseType_t item_size)
+{
+    fake_queue_t *queue = calloc(1, sizeof(*queue));
+
+    if (queue) {
+        queue->items = calloc(queue_length, item_size);
+        queue->length = queue_length;
+        queue->item_size = item_size;
+    }
+    return queue;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t handle, const void *item, BaseType_t *higher_priority_task_woken)
+{
+    fake_queue_t *queue = handle;
+
+    if (queue->count == queue->length) {
+        return pdFALSE;
+    }
+    memcpy(queue->items + (queue->head + queue->count) % queue->length * queue->item_size, item,
+           queue->item_size);
+    queue->count++;
+    if (higher_priority_task_woken && !is_task && task_state == TASK_WAIT_QUEUE && task_queue == queue) {
+        *higher_priority_task_woken = pdTRUE;
+    }
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void *buffer, TickType_t ticks_to_wait)
+{
+    fake_queue_t *queue = handle;
+
+    if (queue->count == 0 && ticks_to_wait > 0) {
+        if (!is_task) {
+            fprintf(stderr, "only the task waits on a queue\n");
+            abort();
+        }
+        task_wake_us = ticks_to_wait == portMAX_DELAY ? INFINITY
+                       : fake_now_us + (double)ticks_to_wait * portTICK_PERIOD_MS * 1000.0;
+        task_queue = queue;
+        task_state = TASK_WAIT_QUEUE;
+        switch_to(false);
+    }
+
+    if (queue->count == 0) {
+        return pdFALSE;
+    }
+    memcpy(buffer, queue->items + queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return calloc(1, sizeof(fake_mutex_t));
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait)
+{
+    fake_mutex_t *mutex = sem;
+
+    (void)ticks_to_wait;
+    if (!mutex->taken_by_task && !mutex->taken_by_test) {
+        if (is_task) {
+            mutex->taken_by_task = true;
+        } else {
+            mutex->taken_by_test = true;
+        }
+        return pdTRUE;
+    }
+
+    if (!is_task) {
+        /* The task never blocks while it holds the radio */
+        fprintf(stderr, "test thread would wait for the task's mutex\n");
+        abort();
+    }
+    mutex->task_waiting = true;
+    task_state = TASK_WAIT_MUTEX;
+    switch_to(false);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    fake_mutex_t *mutex = sem;
+
+    if (is_task) {
+        mutex->taken_by_task = false;
+        return pdTRUE;
+    }
+
+    mutex->taken_by_test = false;
+    if (mutex->task_waiting) {
+        /* The waiting task takes it and, having the higher priority, runs now */
+        mutex->task_waiting = false;
+        mutex->taken_by_task = true;
+        run_task();
+    }
+    return pdTRUE;
+}
+
+/* --- Clock ---------------------------------------------------------------- */
+
+int64_t esp_timer_get_time(void)
+{
+    return (int64_t)fake_now_us;
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    fake_rtos_advance(us);
+}
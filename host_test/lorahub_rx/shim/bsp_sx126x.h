@@ -0,0 +1,42 @@
+/*
+ * Host shim: bsp_sx126x.h, the radio wiring the LoRa hub HAL uses and what
+ * it gets through bsp_board.h
+ */
+#ifndef HOST_SHIM_LORAHUB_BSP_SX126X_H
+#define HOST_SHIM_LORAHUB_BSP_SX126X_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+
+#define EXPANDER_IO_RADIO_NSS   0
+#define EXPANDER_IO_RADIO_RST   1
+#define EXPANDER_IO_RADIO_BUSY  2
+#define EXPANDER_IO_RADIO_DIO_1 3
+#define EXPANDER_IO_RADIO_VER   11
+
+#define ESP32_RADIO_MOSI        GPIO_NUM_48
+#define ESP32_RADIO_MISO        GPIO_NUM_47
+#define ESP32_RADIO_SCLK        GPIO_NUM_41
+#define ESP32_EXPANDER_IO_INT   GPIO_NUM_42
+
+typedef struct {
+    esp_err_t (*init)(uint8_t i2c_addr);
+    esp_err_t (*set_direction)(uint8_t pin, bool is_output);
+    esp_err_t (*set_level)(uint8_t pin, bool level);
+    esp_err_t (*read_output_pins)(uint16_t *pin_val);
+    esp_err_t (*read_input_pins)(uint16_t *pin_val);
+    esp_err_t (*multi_write_start)(void);
+    esp_err_t (*multi_write_new_level)(int pin, bool new_level);
+    esp_err_t (*multi_write_end)(void);
+} io_expander_ops_t;
+
+extern io_expander_ops_t *indicator_io_expander;
+
+spi_device_handle_t bsp_sx126x_spi_handle_get(void);
+
+#endif
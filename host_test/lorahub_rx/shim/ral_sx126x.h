@@ -0,0 +1,56 @@
+/*
+ * Host shim: ral_sx126x.h
+ *
+ * The LoRa hub HAL gets its radio from RAL_SX126X_INSTANTIATE(); here that is
+ * the fake radio (fake_radio.c) instead of ral_sx126x.c. Driver entries the
+ * RX path does not use stay NULL.
+ */
+#ifndef HOST_SHIM_RAL_SX126X_H
+#define HOST_SHIM_RAL_SX126X_H
+
+#include "ral_drv.h"
+
+ral_status_t fake_radio_reset(const void *context);
+ral_status_t fake_radio_init(const void *context);
+ral_status_t fake_radio_set_standby(const void *context, ral_standby_cfg_t standby_cfg);
+ral_status_t fake_radio_set_rx(const void *context, const uint32_t timeout_in_ms);
+ral_status_t fake_radio_set_rx_tx_fallback_mode(const void *context, const ral_fallback_modes_t mode);
+ral_status_t fake_radio_get_pkt_payload(const void *context, uint16_t max_size_in_bytes, uint8_t *buffer,
+                                        uint16_t *size_in_bytes);
+ral_status_t fake_radio_get_irq_status(const void *context, ral_irq_t *irq);
+ral_status_t fake_radio_clear_irq_status(const void *context, const ral_irq_t irq);
+ral_status_t fake_radio_get_and_clear_irq_status(const void *context, ral_irq_t *irq);
+ral_status_t fake_radio_set_dio_irq_params(const void *context, const ral_irq_t irq);
+ral_status_t fake_radio_set_rf_freq(const void *context, const uint32_t freq_in_hz);
+ral_status_t fake_radio_set_pkt_type(const void *context, const ral_pkt_type_t pkt_type);
+ral_status_t fake_radio_set_lora_mod_params(const void *context, const ral_lora_mod_params_t *params);
+ral_status_t fake_radio_set_lora_pkt_params(const void *context, const ral_lora_pkt_params_t *params);
+ral_status_t fake_radio_set_lora_symb_nb_timeout(const void *context, const uint16_t nb_of_symbs);
+ral_status_t fake_radio_get_lora_rx_pkt_status(const void *context, ral_lora_rx_pkt_status_t *rx_pkt_status);
+ral_status_t fake_radio_set_lora_sync_word(const void *context, const uint8_t sync_word);
+
+#define RAL_SX126X_INSTANTIATE( ctx )                                      \
+    {                                                                      \
+        .context = ctx,                                                    \
+        .driver  = {                                                       \
+            .reset                    = fake_radio_reset,                  \
+            .init                     = fake_radio_init,                   \
+            .set_standby              = fake_radio_set_standby,            \
+            .set_rx                   = fake_radio_set_rx,                 \
+            .set_rx_tx_fallback_mode  = fake_radio_set_rx_tx_fallback_mode, \
+            .get_pkt_payload          = fake_radio_get_pkt_payload,        \
+            .get_irq_status           = fake_radio_get_irq_status,         \
+            .clear_irq_status         = fake_radio_clear_irq_status,       \
+            .get_and_clear_irq_status = fake_radio_get_and_clear_irq_status, \
+            .set_dio_irq_params       = fake_radio_set_dio_irq_params,     \
+            .set_rf_freq              = fake_radio_set_rf_freq,            \
+            .set_pkt_type             = fake_radio_set_pkt_type,           \
+            .set_lora_mod_params      = fake_radio_set_lora_mod_params,    \
+            .set_lora_pkt_params      = fake_radio_set_lora_pkt_params,    \
+            .set_lora_symb_nb_timeout = fake_radio_set_lora_symb_nb_timeout, \
+            .get_lora_rx_pkt_status   = fake_radio_get_lora_rx_pkt_status, \
+            .set_lora_sync_word       = fake_radio_set_lora_sync_word,     \
+        },                                                                 \
+    }
+
+#endif
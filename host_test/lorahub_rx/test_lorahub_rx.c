@@ -0,0 +1,284 @@
+/*
+ * LoRa hub RX test: components/liblorahub unchanged against the fake radio
+ * (fake_radio.c) and RX task scheduler (fake_rtos.c).
+ *
+ * Bursts of packets are put on air back to back, each starting when the
+ * previous one ends, with idle time between bursts. A consumer calls
+ * lgw_receive() every poll interval until it returns fewer than max_pkt
+ * packets, like a packet forwarder's fetch loop. Every packet has to come
+ * out once, in order, with its payload, or be counted by
+ * lgw_radio_rx_dropped(); none may be missed by the radio or overwritten in
+ * its buffer. count_us must be the RxDone instant when the RX task was
+ * blocked at RxDone. When it ran, its own port reads and BUSY edges hold INT
+ * and the DIO1 edge is folded into theirs, so the stamp is off by up to that
+ * run. After the last packet, the radio must see no command and the task wake
+ * only for its poll and touch edges.
+ *
+ * Usage: test_lorahub_rx [--sf 5..12] [--bw 125|250|500] [--size bytes]
+ *        [--bursts n] [--burst n] [--gap-us us] [--idle-ms ms]
+ *        [--poll-ms ms] [--max-pkt n] [--crc-every n] [--cmd-us us]
+ *        [--byte-us us] [--touch-ms ms] [--expect-drops]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lorahub_aux.h"
+#include "lorahub_hal.h"
+#include "lorahub_hal_rx.h"
+#include "fake_radio.h"
+
+#define TEST_PACKETS_MAX        4096
+#define TEST_MAX_PKT_MAX        32
+/* From RxDone to the ISR's timestamp, counters are in whole us */
+#define TEST_STAMP_TOLERANCE_US 1
+/* From RxDone while the RX task ran, to the stamp it got */
+#define TEST_LATE_STAMP_MAX_US  10000
+/* With no traffic, the RX task is watched for this long */
+#define TEST_IDLE_MS            1000
+/* lorahub_hal_rx.c RX_POLL_MS */
+#define TEST_RX_POLL_MS         100
+
+esp_log_level_t host_log_level = ESP_LOG_ERROR;
+
+static int failures = 0;
+
+static fake_packet_t packets[TEST_PACKETS_MAX];
+static struct lgw_pkt_rx_s rx[TEST_MAX_PKT_MAX];
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        if (failures < 10) {
+            fprintf(stderr, "FAIL: %s\n", what);
+        }
+        failures++;
+    }
+}
+
+static uint8_t bw_from_khz(int khz)
+{
+    switch (khz) {
+    case 250:
+        return BW_250KHZ;
+    case 500:
+        return BW_500KHZ;
+    default:
+        return BW_125KHZ;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int sf = 7;
+    int bw_khz = 125;
+    int size = 23;
+    int bursts = 20;
+    int burst = 8;
+    double gap_us = 0.0;
+    int idle_ms = 700;
+    int poll_ms = 10;
+    int max_pkt = 8;
+    int crc_every = 0;
+    bool expect_drops = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sf") == 0 && i + 1 < argc) {
+            sf = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bw") == 0 && i + 1 < argc) {
+            bw_khz = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bursts") == 0 && i + 1 < argc) {
+            bursts = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--burst") == 0 && i + 1 < argc) {
+            burst = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--gap-us") == 0 && i + 1 < argc) {
+            gap_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--idle-ms") == 0 && i + 1 < argc) {
+            idle_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--poll-ms") == 0 && i + 1 < argc) {
+            poll_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-pkt") == 0 && i + 1 < argc) {
+            max_pkt = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--crc-every") == 0 && i + 1 < argc) {
+            crc_every = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cmd-us") == 0 && i + 1 < argc) {
+            fake_cmd_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--byte-us") == 0 && i + 1 < argc) {
+            fake_byte_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--touch-ms") == 0 && i + 1 < argc) {
+            fake_touch_us = atof(argv[++i]) * 1000.0;
+        } else if (strcmp(argv[i], "--expect-drops") == 0) {
+            expect_drops = true;
+        }
+    }
+    if (sf < 5 || sf > 12 || size < 4 || size > 255 || bursts * burst > TEST_PACKETS_MAX ||
+        max_pkt < 1 || max_pkt > TEST_MAX_PKT_MAX) {
+        fprintf(stderr, "bad arguments\n");
+        return 2;
+    }
+
+    const uint8_t bw = bw_from_khz(bw_khz);
+    uint16_t symbol_us;
+    const uint32_t toa_us = lora_packet_time_on_air(bw, sf, CR_LORA_4_5, STD_LORA_PREAMBLE, false, false,
+                                                    (uint8_t)size, NULL, NULL, &symbol_us);
+    /* Preamble, sync word and the 8 symbols that carry the explicit header */
+    const double header_us = (STD_LORA_PREAMBLE + 4.25 + 8) * symbol_us;
+
+    struct lgw_conf_rxrf_s rxrf = { .freq_hz = 868100000, .tx_enable = false };
+    struct lgw_conf_rxif_s rxif = {
+        .modulation = MOD_LORA, .bandwidth = bw, .datarate = sf, .coderate = CR_LORA_4_5,
+    };
+    check(lgw_rxrf_setconf(&rxrf) == LGW_HAL_SUCCESS, "lgw_rxrf_setconf");
+    check(lgw_rxif_setconf(&rxif) == LGW_HAL_SUCCESS, "lgw_rxif_setconf");
+    check(lgw_start() == LGW_HAL_SUCCESS, "lgw_start");
+
+    /* Bursts start once the radio is set up */
+    const int count = bursts * burst;
+    double t_us = fake_now_us + 50000.0;
+    int injected_bad = 0;
+
+    for (int n = 0; n < count; n++) {
+        if (n > 0 && n % burst == 0) {
+            t_us += idle_ms * 1000.0;
+        }
+        packets[n].id = (uint32_t)n;
+        packets[n].start_us = t_us;
+        packets[n].payload_us = t_us + header_us;
+        packets[n].end_us = t_us + toa_us;
+        packets[n].size = (uint8_t)size;
+        packets[n].crc_error = crc_every > 0 && n % crc_every == crc_every - 1;
+        injected_bad += packets[n].crc_error;
+        t_us = packets[n].end_us + gap_us;
+    }
+    fake_radio_schedule(packets, count);
+
+    /* Consumer */
+    const uint32_t correction = lgw_radio_timestamp_correction(sf, bw);
+    const double stop_us = t_us + 2.0 * poll_ms * 1000.0 + 200000.0;
+    int delivered_ok = 0;
+    int delivered_bad = 0;
+    int calls = 0;
+    int max_per_call = 0;
+    long last_id = -1;
+    double latency_sum_us = 0.0;
+    double latency_max_us = 0.0;
+    double stamp_error_max_us = 0.0;
+    double late_stamp_max_us = 0.0;
+    int late_stamps = 0;
+
+    while (fake_now_us < stop_us) {
+        int nb;
+
+        do {
+            nb = lgw_receive((uint8_t)max_pkt, rx);
+            calls++;
+            check(nb >= 0 && nb <= max_pkt, "lgw_receive returns 0..max_pkt packets");
+            if (nb > max_per_call) {
+                max_per_call = nb;
+            }
+
+            for (int i = 0; i < nb; i++) {
+                const struct lgw_pkt_rx_s *p = &rx[i];
+                uint8_t expected[256];
+
+                check(p->freq_hz == rxrf.freq_hz && p->datarate == (uint32_t)sf && p->bandwidth == bw,
+                      "packet carries the RX configuration");
+                if (p->status == STAT_CRC_BAD) {
+                    delivered_bad++;
+                    continue;
+                }
+                check(p->status == STAT_CRC_OK, "packet status CRC OK or bad");
+                check(p->size == size, "payload size");
+                if (p->size < 4) {
+                    continue;
+                }
+
+                uint32_t id = p->payload[0] | p->payload[1] << 8 | p->payload[2] << 16 |
+                              (uint32_t)p->payload[3] << 24;
+                if (id >= (uint32_t)count) {
+                    check(false, "payload id out of range");
+                    continue;
+                }
+                fake_radio_payload(id, expected, p->size);
+                check(memcmp(p->payload, expected, p->size) == 0, "payload");
+                check((long)id > last_id, "packets once and in order");
+                last_id = id;
+                delivered_ok++;
+
+                /* count_us is the RxDone edge less the HAL's correction */
+                double stamp_error_us = (double)(int32_t)(p->count_us + correction -
+                                                          (uint32_t)packets[id].end_us);
+                if (packets[id].end_in_task) {
+                    late_stamps++;
+                    late_stamp_max_us = fmax(late_stamp_max_us, fabs(stamp_error_us));
+                } else {
+                    stamp_error_max_us = fmax(stamp_error_max_us, fabs(stamp_error_us));
+                }
+
+                double latency_us = fake_now_us - packets[id].end_us;
+                latency_sum_us += latency_us;
+                latency_max_us = fmax(latency_max_us, latency_us);
+            }
+        } while (nb == max_pkt);
+
+        vTaskDelay(pdMS_TO_TICKS(poll_ms));
+    }
+
+    const uint32_t dropped = lgw_radio_rx_dropped();
+
+    /* No traffic: only the poll and touch edges may wake the task, and only to read the port */
+    const fake_radio_stats_t before_idle = fake_radio;
+    const uint32_t task_runs_before_idle = fake_rtos.task_runs;
+
+    vTaskDelay(pdMS_TO_TICKS(TEST_IDLE_MS));
+
+    const uint32_t idle_commands = fake_radio.commands - before_idle.commands;
+    const uint32_t idle_runs = fake_rtos.task_runs - task_runs_before_idle;
+    const uint32_t idle_touch = fake_radio.touch_edges - before_idle.touch_edges;
+
+    printf("SF%d BW%d, %d byte packets: %.1f ms on air, %d bursts of %d, poll every %d ms, "
+           "max_pkt %d, %.0f us per command\n",
+           sf, bw_khz, size, toa_us / 1000.0, bursts, burst, poll_ms, max_pkt, fake_cmd_us);
+    printf("  injected      %6d  (%d with a CRC error)\n", count, injected_bad);
+    printf("  delivered     %6d  (%d with a CRC error)\n", delivered_ok + delivered_bad, delivered_bad);
+    printf("  missed        %6u  (radio not in RX)\n", fake_radio.missed);
+    printf("  overwritten   %6u  (buffer reused before it was read)\n", fake_radio.overwritten);
+    printf("  ring dropped  %6u\n", dropped);
+    printf("  lgw_receive   %6d calls, up to %d packets per call\n", calls, max_per_call);
+    printf("  latency       %6.1f ms mean, %.1f ms max, from RxDone to lgw_receive\n",
+           delivered_ok ? latency_sum_us / delivered_ok / 1000.0 : 0.0, latency_max_us / 1000.0);
+    printf("  timestamp     %6.0f us max error; %d ended in a task run, up to %.1f ms off\n",
+           stamp_error_max_us, late_stamps, late_stamp_max_us / 1000.0);
+    printf("  radio         %6u commands, %u set_rx, %u DIO1 edges; RX task ran %u times, %.1f ms\n",
+           fake_radio.commands, fake_radio.set_rx, fake_radio.irq_edges, fake_rtos.task_runs,
+           fake_rtos.task_us / 1000.0);
+    printf("  expander      %6u INT edges (%u touch), %u port reads\n", fake_radio.int_edges,
+           fake_radio.touch_edges, fake_radio.port_reads);
+    printf("  idle %d ms  %6u commands, RX task ran %u times\n", TEST_IDLE_MS, idle_commands, idle_runs);
+
+    check(fake_radio.missed == 0, "no packet missed by the radio");
+    check(fake_radio.overwritten == 0, "no packet overwritten in the radio buffer");
+    check(delivered_ok + delivered_bad + (int)dropped == count, "every packet delivered or counted as dropped");
+    check(stamp_error_max_us <= TEST_STAMP_TOLERANCE_US, "count_us is the RxDone time");
+    check(late_stamp_max_us <= TEST_LATE_STAMP_MAX_US, "count_us of a packet ended in a task run");
+    check(idle_commands == 0, "no radio command without traffic");
+    check(idle_runs <= TEST_IDLE_MS / TEST_RX_POLL_MS + idle_touch + 1, "RX task idle without traffic");
+    if (expect_drops) {
+        check(dropped > 0, "the RX ring overflowed");
+        check(max_per_call == max_pkt, "lgw_receive returned max_pkt packets at once");
+    } else {
+        check(dropped == 0, "no packet dropped from the RX ring");
+        check(delivered_bad == injected_bad, "packets with a CRC error delivered as such");
+    }
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
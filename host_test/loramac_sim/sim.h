@@ -0,0 +1,159 @@
+/*
+ * Host LoRaMac simulator: virtual clock, radio and network server.
+ *
+ * All times are microseconds of simulated reference time (the network's
+ * clock) unless named *_device_*. The device clock behind esp_timer and
+ * gettimeofday() runs off the reference by the configured drift.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_timer.h"
+
+#define SIM_MAX_FRAME               255
+
+/* ------------------------------------------------------------- clock ---- */
+
+void sim_clock_init(int32_t drift_ppm);
+int64_t sim_time_us(void);
+/* Arms a timer at an absolute reference time (simulator events) */
+void sim_timer_start_at(esp_timer_handle_t timer, int64_t at_us);
+const char *sim_timer_name(esp_timer_handle_t timer);
+/*
+ * Advances the clock to the earliest armed timer due no later than
+ * limit_us, disarms it and returns it without running it. NULL when no
+ * timer is due.
+ */
+esp_timer_handle_t sim_clock_advance(int64_t limit_us);
+void sim_timer_fire(esp_timer_handle_t timer);
+/* esp_timer_start_once() calls made on a timer that was still armed */
+uint32_t sim_clock_double_starts(void);
+
+/* ----------------------------------------------------- MAC accounting ---- */
+
+typedef enum {
+    SIM_EV_JOIN_REQUEST,        /* LoRaMacMlmeRequest( MLME_JOIN ) */
+    SIM_EV_MCPS_REQUEST,        /* LoRaMacMcpsRequest */
+    SIM_EV_TX_DELAYED,          /* TxDelayedTimer, sends a postponed frame */
+    SIM_EV_TX_DONE,             /* TxDone IRQ */
+    SIM_EV_RX_WINDOW,           /* RX1/RX2 timer, opens the window */
+    SIM_EV_RX_DONE,             /* RxDone IRQ */
+    SIM_EV_RX_TIMEOUT,          /* RxTimeout IRQ */
+    SIM_EV_TIMER,               /* any other LoRaMac timer */
+    SIM_EV_COUNT
+} sim_event_t;
+
+/*
+ * Brackets a call into LoRaMac. The CPU time until sim_mac_end(), plus the
+ * LoRaMacProcess() runs it triggers, is charged to the event.
+ */
+void sim_mac_begin(sim_event_t ev);
+void sim_mac_end(void);
+/* Lets the radio reclassify a timer event by what it asked for */
+void sim_mac_note(sim_event_t ev);
+
+/* ------------------------------------------------------------- radio ---- */
+
+typedef struct {
+    uint32_t freq;
+    uint8_t sf;
+    uint8_t bw;                 /* 0: 125 kHz, 1: 250 kHz, 2: 500 kHz */
+    bool iq_inverted;
+    int64_t start_us;
+    int64_t end_us;
+    uint8_t size;
+    uint8_t payload[SIM_MAX_FRAME];
+} sim_frame_t;
+
+/* ETSI EN 300 220 sub-bands of the EU868 uplink channels */
+typedef struct {
+    const char *name;
+    uint32_t low;
+    uint32_t high;
+    uint32_t dc_div;            /* 100: 1 % duty cycle */
+} sim_band_t;
+
+#define SIM_NB_BANDS                6
+extern const sim_band_t sim_bands[SIM_NB_BANDS];
+
+typedef struct {
+    uint32_t tx_frames;
+    int64_t band_airtime_us[SIM_NB_BANDS];
+    uint32_t rx_windows;
+    uint32_t rx_done;
+    uint32_t rx_timeouts;
+    uint32_t rx_missed;         /* downlink on air but window not aligned */
+    int64_t rx_offset_min_us;   /* window opening vs downlink start */
+    int64_t rx_offset_max_us;
+    int64_t rx_margin_min_us;   /* smallest timing slack of any window */
+} sim_radio_stats_t;
+
+void sim_radio_init(uint32_t seed, uint32_t irq_latency_us);
+/* Queues a gateway transmission */
+void sim_radio_downlink(const sim_frame_t *frame);
+/* Expected downlink start of the RX1 and RX2 windows of the last uplink */
+void sim_radio_set_rx_slots(int64_t rx1_us, int64_t rx2_us);
+const sim_radio_stats_t *sim_radio_stats(void);
+int64_t sim_time_on_air_us(uint8_t sf, uint8_t bw, uint8_t size, bool crc);
+
+/* ----------------------------------------------------------- network ---- */
+
+typedef struct {
+    uint32_t loss_pct;          /* uplinks the gateway does not hear */
+    uint32_t adr_after;         /* uplinks before the LinkADRReq */
+    uint8_t adr_dr;             /* data rate requested by ADR */
+    uint32_t downlink_every;    /* application downlink period, uplinks */
+} sim_network_config_t;
+
+typedef struct {
+    uint32_t joins;
+    uint32_t uplinks;
+    uint32_t lost;
+    uint32_t bad_mic;
+    uint32_t bad_payload;
+    uint32_t downlinks;
+    uint32_t app_downlinks;
+    uint32_t acks;
+    uint32_t adr_requests;
+    uint32_t adr_answers_ok;
+} sim_network_stats_t;
+
+void sim_network_init(const sim_network_config_t *cfg, uint32_t seed);
+/* Called when an uplink has left the device's antenna */
+void sim_network_uplink(const sim_frame_t *frame);
+const sim_network_stats_t *sim_network_stats(void);
+
+/* Device identity shared by the application and the network */
+extern const uint8_t sim_dev_eui[8];
+extern const uint8_t sim_join_eui[8];
+extern const uint8_t sim_nwk_key[16];
+
+/* Application payloads carry their sequence number and a pattern from it */
+static inline void sim_payload_fill(uint8_t *buf, uint8_t size, uint32_t seq)
+{
+    for (uint8_t i = 0; i < size; i++) {
+        buf[i] = (i < 4) ? (uint8_t)(seq >> (8 * i)) : (uint8_t)(seq * 31u + i);
+    }
+}
+
+static inline bool sim_payload_check(const uint8_t *buf, uint8_t size)
+{
+    uint32_t seq;
+    uint8_t ref[SIM_MAX_FRAME];
+
+    if (size < 4) {
+        return false;
+    }
+    seq = buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+    sim_payload_fill(ref, size, seq);
+    for (uint8_t i = 0; i < size; i++) {
+        if (buf[i] != ref[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ * Virtual clock: esp_timer one-shot timers and gettimeofday() on simulated
+ * time. Nothing runs by itself; sim_clock_advance() jumps to the next due
+ * timer. Timers armed by the device (esp_timer_start_once) are scaled by the
+ * clock drift, simulator events (sim_timer_start_at) are not.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "sim.h"
+
+/* Calendar time of the device at reference time 0 */
+#define SIM_EPOCH_S                 1700000000LL
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    bool armed;
+    int64_t expiry_us;
+    uint64_t seq;               /* start order, breaks ties */
+    struct esp_timer *next;
+};
+
+static struct esp_timer *timers;
+static int64_t now_us;
+static int32_t drift;
+static uint64_t start_seq;
+static uint32_t double_starts;
+
+void sim_clock_init(int32_t drift_ppm)
+{
+    drift = drift_ppm;
+    now_us = 0;
+}
+
+int64_t sim_time_us(void)
+{
+    return now_us;
+}
+
+/* The device clock runs (1 + drift) times as fast as the reference */
+static int64_t to_device(int64_t ref_us)
+{
+    return ref_us + ref_us * drift / 1000000;
+}
+
+static int64_t to_reference(int64_t device_us)
+{
+    return device_us * 1000000 / (1000000 + drift);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return to_device(now_us);
+}
+
+int __wrap_gettimeofday(struct timeval *tv, void *tz)
+{
+    int64_t t = esp_timer_get_time();
+
+    (void)tz;
+    tv->tv_sec = SIM_EPOCH_S + t / 1000000;
+    tv->tv_usec = t % 1000000;
+    return 0;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    struct esp_timer *t = calloc(1, sizeof(*t));
+
+    if (t == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->args = *create_args;
+    t->next = timers;
+    timers = t;
+    *out_handle = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    for (struct esp_timer **p = &timers; *p != NULL; p = &(*p)->next) {
+        if (*p == timer) {
+            *p = timer->next;
+            free(timer);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+void sim_timer_start_at(esp_timer_handle_t timer, int64_t at_us)
+{
+    timer->armed = true;
+    timer->expiry_us = (at_us < now_us) ? now_us : at_us;
+    timer->seq = start_seq++;
+}
+
+/* Same contract as ESP-IDF: starting an armed timer is an error */
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->armed) {
+        double_starts++;
+        fprintf(stderr, "esp_timer_start_once: timer '%s' is already armed\n", timer->args.name);
+        return ESP_ERR_INVALID_STATE;
+    }
+    /* Like the hardware, never fire before the device time asked for */
+    int64_t target = to_device(now_us) + (int64_t)timeout_us;
+    int64_t at = to_reference(target);
+    while (to_device(at) < target) {
+        at++;
+    }
+    sim_timer_start_at(timer, at);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer->armed;
+}
+
+const char *sim_timer_name(esp_timer_handle_t timer)
+{
+    return timer->args.name;
+}
+
+esp_timer_handle_t sim_clock_advance(int64_t limit_us)
+{
+    struct esp_timer *next = NULL;
+
+    for (struct esp_timer *t = timers; t != NULL; t = t->next) {
+        if (t->armed && t->expiry_us <= limit_us &&
+            (next == NULL || t->expiry_us < next->expiry_us ||
+             (t->expiry_us == next->expiry_us && t->seq < next->seq))) {
+            next = t;
+        }
+    }
+    if (next != NULL) {
+        now_us = next->expiry_us;
+        next->armed = false;
+    }
+    return next;
+}
+
+void sim_timer_fire(esp_timer_handle_t timer)
+{
+    timer->args.callback(timer->args.arg);
+}
+
+uint32_t sim_clock_double_starts(void)
+{
+    return double_starts;
+}
@@ -0,0 +1,475 @@
+/*
+ * LoRaMac host simulation.
+ *
+ * Runs the unmodified LoRaMac, region, crypto and soft secure element code
+ * with components/lora/timer.c and adapter/systime.c on a virtual clock
+ * (sim_clock.c), a simulated radio (sim_radio.c) and a scripted network
+ * server (sim_network.c). An EU868 class A device joins over the air at DR0
+ * with ADR on and sends a 20 byte uplink every 30 s, every 5th one
+ * confirmed. The network moves it to DR5 with a LinkADRReq and sends an
+ * application downlink every 8 uplinks, alternately in RX1 and RX2.
+ *
+ * Simulated time only advances from one timer to the next, so thousands of
+ * uplinks run per host second. Reports the host CPU time LoRaMac spends per
+ * MAC event (including the LoRaMacProcess() runs the event triggers; radio
+ * and network simulation excluded), the RX window timing against the
+ * downlink and the airtime per sub-band. Checks the join, MIC and payloads
+ * on both sides, downlink delivery, acknowledgements, the ADR data rate and
+ * the duty cycle limits, and exits non-zero on a failure, so it doubles as
+ * a regression test.
+ *
+ * Usage: sim_loramac [-n uplinks] [--drift ppm] [--loss pct]
+ *                    [--irq-latency us] [--seed n] [--csv] [-v]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "LoRaMac.h"
+#include "LoRaMacTest.h"
+#include "sim.h"
+
+#define SIM_UPLINKS_DEFAULT         2000
+#define SIM_APP_PERIOD_US           (30 * 1000000LL)
+#define SIM_APP_PORT                2
+#define SIM_APP_SIZE                20
+#define SIM_CONFIRMED_EVERY         5
+#define SIM_JOIN_DR                 DR_0
+#define SIM_ADR_DR                  DR_5
+#define SIM_ADR_AFTER               3
+#define SIM_DOWNLINK_EVERY          8
+#define SIM_RETRY_US                (20 * 1000000LL)
+#define SIM_BUSY_RETRY_US           (1000000LL)
+#define SIM_DC_PERIOD_US            (3600 * 1000000LL)
+
+esp_log_level_t host_log_level = ESP_LOG_NONE;
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        if (failures < 10) {
+            fprintf(stderr, "FAIL: %s\n", what);
+        }
+        failures++;
+    }
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Replaces soft-se-hal.c, which reads the ESP32 MAC address */
+void SoftSeHalGetUniqueId(uint8_t *id)
+{
+    memcpy(id, sim_dev_eui, 8);
+}
+
+/* ----------------------------------------------------- MAC accounting ---- */
+
+typedef struct {
+    uint32_t *ns;
+    size_t count;
+    size_t cap;
+} samples_t;
+
+static const char *const event_names[SIM_EV_COUNT] = {
+    "join-request", "mcps-request", "tx-delayed", "tx-done",
+    "rx-window", "rx-done", "rx-timeout", "timer-other",
+};
+
+static samples_t samples[SIM_EV_COUNT];
+static sim_event_t current_event;
+static bool measuring;
+static bool process_pending;
+static uint64_t begin_ns;
+
+void sim_mac_begin(sim_event_t ev)
+{
+    if (measuring) {
+        fprintf(stderr, "nested MAC event %s in %s\n", event_names[ev], event_names[current_event]);
+        abort();
+    }
+    measuring = true;
+    current_event = ev;
+    begin_ns = now_ns();
+}
+
+void sim_mac_note(sim_event_t ev)
+{
+    if (measuring && current_event == SIM_EV_TIMER) {
+        current_event = ev;
+    }
+}
+
+void sim_mac_end(void)
+{
+    samples_t *s;
+
+    while (process_pending) {
+        process_pending = false;
+        LoRaMacProcess();
+    }
+    uint64_t ns = now_ns() - begin_ns;
+    measuring = false;
+
+    s = &samples[current_event];
+    if (s->count == s->cap) {
+        s->cap = s->cap ? 2 * s->cap : 1024;
+        s->ns = realloc(s->ns, s->cap * sizeof(s->ns[0]));
+        if (s->ns == NULL) {
+            abort();
+        }
+    }
+    s->ns[s->count++] = (uint32_t)ns;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* -------------------------------------------------------- application ---- */
+
+static esp_timer_handle_t app_timer;
+static bool joined;
+static uint32_t app_seq;
+static uint8_t app_buffer[SIM_APP_SIZE];
+static uint32_t uplinks_done;
+static uint32_t confirmed_sent;
+static uint32_t acks_received;
+static uint32_t downlinks_ok;
+static uint32_t downlinks_bad;
+static uint32_t dc_restricted;
+static int8_t last_datarate = -1;
+static uint32_t datarate_uplinks[16];
+
+static void app_schedule(int64_t delay_us)
+{
+    esp_timer_stop(app_timer);
+    sim_timer_start_at(app_timer, sim_time_us() + delay_us);
+}
+
+static void join(void)
+{
+    MlmeReq_t mlme;
+    LoRaMacStatus_t status;
+
+    mlme.Type = MLME_JOIN;
+    mlme.Req.Join.Datarate = SIM_JOIN_DR;
+    mlme.Req.Join.NetworkActivation = ACTIVATION_TYPE_OTAA;
+    sim_mac_begin(SIM_EV_JOIN_REQUEST);
+    status = LoRaMacMlmeRequest(&mlme);
+    sim_mac_end();
+    if (status != LORAMAC_STATUS_OK) {
+        app_schedule(mlme.ReqReturn.DutyCycleWaitTime ? mlme.ReqReturn.DutyCycleWaitTime * 1000LL : SIM_RETRY_US);
+    }
+}
+
+static void send_uplink(void)
+{
+    McpsReq_t req;
+    LoRaMacStatus_t status;
+    bool confirmed = (app_seq % SIM_CONFIRMED_EVERY) == SIM_CONFIRMED_EVERY - 1;
+
+    sim_payload_fill(app_buffer, SIM_APP_SIZE, app_seq);
+    req.Type = confirmed ? MCPS_CONFIRMED : MCPS_UNCONFIRMED;
+    req.Req.Unconfirmed.fPort = SIM_APP_PORT;
+    req.Req.Unconfirmed.fBuffer = app_buffer;
+    req.Req.Unconfirmed.fBufferSize = SIM_APP_SIZE;
+    req.Req.Unconfirmed.Datarate = SIM_JOIN_DR;
+    sim_mac_begin(SIM_EV_MCPS_REQUEST);
+    status = LoRaMacMcpsRequest(&req);
+    sim_mac_end();
+
+    if (status == LORAMAC_STATUS_OK) {
+        app_seq++;
+        confirmed_sent += confirmed;
+    } else if (status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED) {
+        dc_restricted++;
+        app_schedule(req.ReqReturn.DutyCycleWaitTime * 1000LL);
+    } else {
+        app_schedule(SIM_BUSY_RETRY_US);
+    }
+}
+
+static void on_app_timer(void *arg)
+{
+    (void)arg;
+    if (joined) {
+        send_uplink();
+    } else {
+        join();
+    }
+}
+
+static void mcps_confirm(McpsConfirm_t *confirm)
+{
+    uplinks_done++;
+    if (confirm->McpsRequest == MCPS_CONFIRMED && confirm->AckReceived) {
+        acks_received++;
+    }
+    last_datarate = (int8_t)confirm->Datarate;
+    datarate_uplinks[confirm->Datarate & 15]++;
+    app_schedule(SIM_APP_PERIOD_US);
+}
+
+static void mcps_indication(McpsIndication_t *ind)
+{
+    if (ind->Status != LORAMAC_EVENT_INFO_STATUS_OK || !ind->RxData || ind->Port != SIM_APP_PORT) {
+        return;
+    }
+    if (sim_payload_check(ind->Buffer, ind->BufferSize)) {
+        downlinks_ok++;
+    } else {
+        downlinks_bad++;
+    }
+}
+
+static void mlme_confirm(MlmeConfirm_t *confirm)
+{
+    if (confirm->MlmeRequest != MLME_JOIN) {
+        return;
+    }
+    if (confirm->Status == LORAMAC_EVENT_INFO_STATUS_OK) {
+        joined = true;
+        app_schedule(SIM_BUSY_RETRY_US);
+    } else {
+        app_schedule(SIM_RETRY_US);
+    }
+}
+
+static void mlme_indication(MlmeIndication_t *ind)
+{
+    (void)ind;
+}
+
+static void mac_process_notify(void)
+{
+    process_pending = true;
+}
+
+static void mac_setup(void)
+{
+    static LoRaMacPrimitives_t primitives = {
+        .MacMcpsConfirm = mcps_confirm,
+        .MacMcpsIndication = mcps_indication,
+        .MacMlmeConfirm = mlme_confirm,
+        .MacMlmeIndication = mlme_indication,
+    };
+    static LoRaMacCallback_t callbacks = {
+        .MacProcessNotify = mac_process_notify,
+    };
+    static uint8_t dev_eui[8];
+    static uint8_t join_eui[8];
+    static uint8_t key[16];
+    MibRequestConfirm_t mib;
+
+    check(LoRaMacInitialization(&primitives, &callbacks, LORAMAC_REGION_EU868) == LORAMAC_STATUS_OK,
+          "LoRaMacInitialization");
+
+    memcpy(dev_eui, sim_dev_eui, 8);
+    memcpy(join_eui, sim_join_eui, 8);
+    memcpy(key, sim_nwk_key, 16);
+    mib.Type = MIB_DEV_EUI;
+    mib.Param.DevEui = dev_eui;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_JOIN_EUI;
+    mib.Param.JoinEui = join_eui;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_NWK_KEY;
+    mib.Param.NwkKey = key;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_APP_KEY;
+    mib.Param.AppKey = key;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_PUBLIC_NETWORK;
+    mib.Param.EnablePublicNetwork = true;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_ADR;
+    mib.Param.AdrEnable = true;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_CHANNELS_DEFAULT_DATARATE;
+    mib.Param.ChannelsDefaultDatarate = SIM_JOIN_DR;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_CHANNELS_DATARATE;
+    mib.Param.ChannelsDatarate = SIM_JOIN_DR;
+    LoRaMacMibSetRequestConfirm(&mib);
+    LoRaMacTestSetDutyCycleOn(true);
+    LoRaMacStart();
+}
+
+/* ---------------------------------------------------------------- main ---- */
+
+static void report(bool csv, uint32_t uplinks, double host_s)
+{
+    const sim_radio_stats_t *rs = sim_radio_stats();
+    const sim_network_stats_t *ns = sim_network_stats();
+    double sim_h = (double)sim_time_us() / 3600e6;
+    uint64_t total_ns = 0;
+
+    if (csv) {
+        printf("event,count,mean_ns,p50_ns,p99_ns,max_ns\n");
+    } else {
+        printf("%u uplinks, %.1f h simulated in %.2f s: %.0f uplinks per host second\n",
+               uplinks, sim_h, host_s, uplinks / host_s);
+        printf("host CPU time per MAC event, us\n");
+        printf("%-13s %8s %8s %8s %8s %8s\n", "event", "count", "mean", "p50", "p99", "max");
+    }
+    for (int ev = 0; ev < SIM_EV_COUNT; ev++) {
+        samples_t *s = &samples[ev];
+        uint64_t sum = 0;
+
+        if (s->count == 0) {
+            continue;
+        }
+        qsort(s->ns, s->count, sizeof(s->ns[0]), cmp_u32);
+        for (size_t i = 0; i < s->count; i++) {
+            sum += s->ns[i];
+        }
+        total_ns += sum;
+        if (csv) {
+            printf("%s,%zu,%.0f,%u,%u,%u\n", event_names[ev], s->count, (double)sum / s->count,
+                   s->ns[s->count / 2], s->ns[s->count * 99 / 100], s->ns[s->count - 1]);
+        } else {
+            printf("%-13s %8zu %8.1f %8.1f %8.1f %8.1f\n", event_names[ev], s->count,
+                   (double)sum / s->count / 1e3, s->ns[s->count / 2] / 1e3,
+                   s->ns[s->count * 99 / 100] / 1e3, s->ns[s->count - 1] / 1e3);
+        }
+    }
+    if (csv) {
+        printf("per-uplink,%u,%.0f,,,\n", uplinks, uplinks ? (double)total_ns / uplinks : 0.0);
+        return;
+    }
+    printf("%-13s %8u %8.1f\n", "per uplink", uplinks, uplinks ? (double)total_ns / uplinks / 1e3 : 0.0);
+
+    printf("\nradio: %u TX, %u RX windows, %u RxDone, %u RxTimeout, %u downlinks missed\n",
+           rs->tx_frames, rs->rx_windows, rs->rx_done, rs->rx_timeouts, rs->rx_missed);
+    if (rs->rx_margin_min_us != INT64_MAX) {
+        printf("RX window opens %.2f .. %.2f ms from the downlink start, smallest margin %.2f ms\n",
+               rs->rx_offset_min_us / 1e3, rs->rx_offset_max_us / 1e3, rs->rx_margin_min_us / 1e3);
+    }
+    printf("network: %u joins, %u uplinks (%u lost), %u downlinks (%u application, %u ACK), "
+           "%u LinkADRReq, %u LinkADRAns ok\n",
+           ns->joins, ns->uplinks, ns->lost, ns->downlinks, ns->app_downlinks, ns->acks,
+           ns->adr_requests, ns->adr_answers_ok);
+    printf("device: %u downlinks received, %u of %u confirmed uplinks acknowledged, "
+           "%u duty cycle deferrals\n", downlinks_ok, acks_received, confirmed_sent, dc_restricted);
+    printf("uplinks per data rate:");
+    for (int dr = 0; dr < 16; dr++) {
+        if (datarate_uplinks[dr]) {
+            printf(" DR%d %u", dr, datarate_uplinks[dr]);
+        }
+    }
+    printf("\nairtime per sub-band:");
+    for (int i = 0; i < SIM_NB_BANDS; i++) {
+        if (rs->band_airtime_us[i]) {
+            printf(" %s %.1f s (%.3f %%)", sim_bands[i].name, rs->band_airtime_us[i] / 1e6,
+                   100.0 * rs->band_airtime_us[i] / sim_time_us());
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t uplinks = SIM_UPLINKS_DEFAULT;
+    int32_t drift_ppm = 0;
+    uint32_t loss_pct = 0;
+    uint32_t irq_latency_us = 0;
+    uint32_t seed = 0x2545f491;
+    bool csv = false;
+    sim_network_config_t ns_cfg = {
+        .adr_after = SIM_ADR_AFTER,
+        .adr_dr = SIM_ADR_DR,
+        .downlink_every = SIM_DOWNLINK_EVERY,
+    };
+    const esp_timer_create_args_t app_args = { .callback = on_app_timer, .name = "sim-app" };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            uplinks = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--drift") == 0 && i + 1 < argc) {
+            drift_ppm = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+            loss_pct = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--irq-latency") == 0 && i + 1 < argc) {
+            irq_latency_us = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            host_log_level = ESP_LOG_INFO;
+        }
+    }
+    if (uplinks < 1 || loss_pct > 100 || drift_ppm <= -1000000) {
+        fprintf(stderr, "invalid arguments\n");
+        return 2;
+    }
+    ns_cfg.loss_pct = loss_pct;
+
+    sim_clock_init(drift_ppm);
+    sim_radio_init(seed, irq_latency_us);
+    sim_network_init(&ns_cfg, seed);
+    esp_timer_create(&app_args, &app_timer);
+    mac_setup();
+    app_schedule(0);
+
+    /* Every uplink leaves within a day even with heavy loss */
+    int64_t limit_us = (int64_t)uplinks * 24 * 3600 * 1000000LL;
+    uint64_t t0 = now_ns();
+    esp_timer_handle_t t;
+
+    while (uplinks_done < uplinks && (t = sim_clock_advance(limit_us)) != NULL) {
+        if (strcmp(sim_timer_name(t), "lorawan") == 0) {
+            sim_mac_begin(SIM_EV_TIMER);
+            sim_timer_fire(t);
+            sim_mac_end();
+        } else {
+            sim_timer_fire(t);
+        }
+        if (process_pending) {
+            sim_mac_begin(SIM_EV_TIMER);
+            sim_mac_end();
+        }
+    }
+    double host_s = (now_ns() - t0) / 1e9;
+
+    const sim_radio_stats_t *rs = sim_radio_stats();
+    const sim_network_stats_t *ns = sim_network_stats();
+
+    check(joined, "device joined");
+    check(uplinks_done == uplinks, "all uplinks confirmed by the MAC");
+    check(ns->bad_mic == 0, "network rejected a frame (MIC, address or EUI)");
+    check(ns->bad_payload == 0, "uplink payload decrypted wrong");
+    check(downlinks_bad == 0, "downlink payload decrypted wrong");
+    check(ns->adr_answers_ok > 0 && last_datarate == SIM_ADR_DR, "ADR moved the device to the requested data rate");
+    check(sim_clock_double_starts() == 0, "timer started while armed");
+    if (loss_pct == 0) {
+        check(downlinks_ok == ns->app_downlinks, "every application downlink received");
+        check(acks_received == confirmed_sent, "every confirmed uplink acknowledged");
+        check(rs->rx_missed == 0, "RX window missed a downlink on air");
+    }
+    for (int i = 0; i < SIM_NB_BANDS; i++) {
+        /* Long-run limit, plus the credits LoRaMac grants for one period and one frame */
+        int64_t allowed = (sim_time_us() + SIM_DC_PERIOD_US) / sim_bands[i].dc_div + 3000000;
+        check(rs->band_airtime_us[i] <= allowed, "duty cycle limit of a sub-band");
+    }
+
+    report(csv, uplinks_done, host_s);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
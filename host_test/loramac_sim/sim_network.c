@@ -0,0 +1,364 @@
+/*
+ * Scripted network server for one LoRaWAN 1.0.x EU868 device.
+ *
+ * Accepts the join request (join accept in RX1 with a CFList adding
+ * 867.1-867.9 MHz), checks MIC, frame counter and payload of every uplink,
+ * acknowledges confirmed uplinks and sends a LinkADRReq once the device has
+ * sent cfg.adr_after uplinks. Every cfg.downlink_every uplinks an
+ * application downlink goes out, alternately in RX1 and RX2. Gateway
+ * transmissions start exactly RECEIVE_DELAY1/2 after the end of the uplink.
+ */
+#include <string.h>
+#include "aes.h"
+#include "cmac.h"
+#include "sim.h"
+
+#define NS_NET_ID                   0x000013
+#define NS_DEV_ADDR                 0x26011234
+#define NS_APP_PORT                 2
+#define NS_DOWNLINK_SIZE            8
+#define NS_JOIN_ACCEPT_DELAY1_US    5000000
+#define NS_RECEIVE_DELAY1_US        1000000
+#define NS_RX2_FREQ                 869525000
+#define NS_RX2_SF                   12
+
+#define MTYPE_JOIN_REQUEST          0
+#define MTYPE_JOIN_ACCEPT           1
+#define MTYPE_UNCONFIRMED_UP        2
+#define MTYPE_UNCONFIRMED_DOWN      3
+#define MTYPE_CONFIRMED_UP          4
+
+#define FCTRL_ADR                   0x80
+#define FCTRL_ACK                   0x20
+
+#define CID_LINK_ADR                0x03
+
+const uint8_t sim_dev_eui[8] = { 0x2c, 0xf7, 0xf1, 0x20, 0x42, 0x00, 0x51, 0x01 };
+const uint8_t sim_join_eui[8] = { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 };
+const uint8_t sim_nwk_key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static const uint32_t cflist_freqs[] = { 867100000, 867300000, 867500000, 867700000, 867900000 };
+
+static sim_network_config_t cfg;
+static sim_network_stats_t stats;
+static uint32_t rng_state;
+
+static bool joined;
+static uint8_t nwk_s_key[16];
+static uint8_t app_s_key[16];
+static uint32_t join_nonce;
+static uint32_t fcnt_up;
+static bool fcnt_up_valid;
+static uint32_t fcnt_down;
+static uint32_t uplinks_since_join;
+static uint32_t adr_requested_at;
+static bool adr_done;
+static uint32_t app_downlink_seq;
+static uint32_t rx2_toggle;
+
+static uint32_t rnd32(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void put_le(uint8_t *p, uint32_t v, int n)
+{
+    for (int i = 0; i < n; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static uint32_t get_le(const uint8_t *p, int n)
+{
+    uint32_t v = 0;
+
+    for (int i = 0; i < n; i++) {
+        v |= (uint32_t)p[i] << (8 * i);
+    }
+    return v;
+}
+
+/* ------------------------------------------------------------ crypto ---- */
+
+static uint32_t cmac4(const uint8_t key[16], const uint8_t *hdr, uint32_t hdr_len,
+                      const uint8_t *msg, uint32_t len)
+{
+    AES_CMAC_CTX ctx;
+    uint8_t digest[16];
+
+    AES_CMAC_Init(&ctx);
+    AES_CMAC_SetKey(&ctx, key);
+    if (hdr_len != 0) {
+        AES_CMAC_Update(&ctx, hdr, hdr_len);
+    }
+    AES_CMAC_Update(&ctx, msg, len);
+    AES_CMAC_Final(digest, &ctx);
+    return get_le(digest, 4);
+}
+
+static void aes_ecb(const uint8_t key[16], const uint8_t in[16], uint8_t out[16], bool decrypt)
+{
+    aes_context ctx;
+
+    aes_set_key(key, 16, &ctx);
+    if (decrypt) {
+        aes_decrypt(in, out, &ctx);
+    } else {
+        lorawan_aes_encrypt(in, out, &ctx);
+    }
+}
+
+static void block_b0(uint8_t b0[16], uint8_t dir, uint32_t fcnt, uint8_t len)
+{
+    memset(b0, 0, 16);
+    b0[0] = 0x49;
+    b0[5] = dir;
+    put_le(&b0[6], NS_DEV_ADDR, 4);
+    put_le(&b0[10], fcnt, 4);
+    b0[15] = len;
+}
+
+static uint32_t frame_mic(const uint8_t *msg, uint8_t len, uint8_t dir, uint32_t fcnt)
+{
+    uint8_t b0[16];
+
+    block_b0(b0, dir, fcnt, len);
+    return cmac4(nwk_s_key, b0, 16, msg, len);
+}
+
+/* FRMPayload encryption, its own inverse */
+static void payload_crypt(uint8_t *buf, uint8_t len, const uint8_t key[16], uint8_t dir, uint32_t fcnt)
+{
+    uint8_t a[16];
+    uint8_t s[16];
+
+    for (uint8_t off = 0, i = 1; off < len; off += 16, i++) {
+        block_b0(a, dir, fcnt, i);
+        a[0] = 0x01;
+        aes_ecb(key, a, s, false);
+        for (uint8_t j = 0; j < 16 && off + j < len; j++) {
+            buf[off + j] ^= s[j];
+        }
+    }
+}
+
+static void derive_key(uint8_t out[16], uint8_t type, uint16_t dev_nonce)
+{
+    uint8_t base[16] = { type };
+
+    put_le(&base[1], join_nonce, 3);
+    put_le(&base[4], NS_NET_ID, 3);
+    put_le(&base[7], dev_nonce, 2);
+    aes_ecb(sim_nwk_key, base, out, false);
+}
+
+/* ---------------------------------------------------------- downlink ---- */
+
+static void transmit(const sim_frame_t *up, const uint8_t *msg, uint8_t len, bool rx2, int64_t rx1_delay_us)
+{
+    sim_frame_t dl;
+
+    dl.freq = rx2 ? NS_RX2_FREQ : up->freq;
+    dl.sf = rx2 ? NS_RX2_SF : up->sf;
+    dl.bw = rx2 ? 0 : up->bw;
+    dl.iq_inverted = true;
+    dl.start_us = up->end_us + rx1_delay_us + (rx2 ? 1000000 : 0);
+    dl.end_us = dl.start_us + sim_time_on_air_us(dl.sf, dl.bw, len, false);
+    dl.size = len;
+    memcpy(dl.payload, msg, len);
+    sim_radio_downlink(&dl);
+    stats.downlinks++;
+}
+
+static void handle_join_request(const sim_frame_t *up)
+{
+    const uint8_t *p = up->payload;
+    uint8_t ja[33];
+    uint8_t enc[33];
+    uint16_t dev_nonce;
+
+    if (up->size != 23 || cmac4(sim_nwk_key, NULL, 0, p, 19) != get_le(&p[19], 4)) {
+        stats.bad_mic++;
+        return;
+    }
+    /* EUIs go over the air least significant byte first */
+    for (int i = 0; i < 8; i++) {
+        if (p[1 + i] != sim_join_eui[7 - i] || p[9 + i] != sim_dev_eui[7 - i]) {
+            stats.bad_mic++;
+            return;
+        }
+    }
+    dev_nonce = (uint16_t)get_le(&p[17], 2);
+    join_nonce++;
+
+    ja[0] = MTYPE_JOIN_ACCEPT << 5;
+    put_le(&ja[1], join_nonce, 3);
+    put_le(&ja[4], NS_NET_ID, 3);
+    put_le(&ja[7], NS_DEV_ADDR, 4);
+    ja[11] = 0x00;              /* RX1DRoffset 0, RX2 DR0 */
+    ja[12] = NS_RECEIVE_DELAY1_US / 1000000;
+    for (int i = 0; i < 5; i++) {
+        put_le(&ja[13 + 3 * i], cflist_freqs[i] / 100, 3);
+    }
+    ja[28] = 0;                 /* CFList type: frequencies */
+    put_le(&ja[29], cmac4(sim_nwk_key, NULL, 0, ja, 29), 4);
+
+    /* The device decrypts the join accept with an AES encryption */
+    enc[0] = ja[0];
+    aes_ecb(sim_nwk_key, &ja[1], &enc[1], true);
+    aes_ecb(sim_nwk_key, &ja[17], &enc[17], true);
+
+    derive_key(nwk_s_key, 0x01, dev_nonce);
+    derive_key(app_s_key, 0x02, dev_nonce);
+    joined = true;
+    fcnt_up_valid = false;
+    fcnt_down = 0;
+    uplinks_since_join = 0;
+    adr_requested_at = 0;
+    adr_done = false;
+    stats.joins++;
+    transmit(up, enc, sizeof(enc), false, NS_JOIN_ACCEPT_DELAY1_US);
+}
+
+static void handle_data_uplink(const sim_frame_t *up, bool confirmed)
+{
+    const uint8_t *p = up->payload;
+    uint8_t len = up->size;
+    uint8_t fctrl;
+    uint8_t fopts_len;
+    uint32_t fcnt;
+    bool retransmission;
+    uint8_t msg[SIM_MAX_FRAME];
+    uint8_t n = 0;
+    bool adr_req;
+    bool app_dl;
+    bool rx2;
+
+    if (!joined || len < 12 || get_le(&p[1], 4) != NS_DEV_ADDR) {
+        stats.bad_mic++;
+        return;
+    }
+    fctrl = p[5];
+    fopts_len = fctrl & 0x0f;
+    fcnt = (fcnt_up & 0xffff0000) | get_le(&p[6], 2);
+    if (fcnt_up_valid && fcnt < fcnt_up) {
+        fcnt += 0x10000;
+    }
+    if (frame_mic(p, len - 4, 0, fcnt) != get_le(&p[len - 4], 4)) {
+        stats.bad_mic++;
+        return;
+    }
+    retransmission = fcnt_up_valid && fcnt == fcnt_up;
+    fcnt_up = fcnt;
+    fcnt_up_valid = true;
+    stats.uplinks++;
+    if (!retransmission) {
+        uplinks_since_join++;
+    }
+
+    for (uint8_t i = 0; i + 1 < fopts_len; ) {
+        if (p[8 + i] != CID_LINK_ADR) {
+            break;
+        }
+        if ((p[8 + i + 1] & 0x07) == 0x07) {
+            stats.adr_answers_ok++;
+            adr_done = true;
+        }
+        i += 2;
+    }
+
+    if (len - 4 > 8 + fopts_len) {
+        uint8_t port = p[8 + fopts_len];
+        uint8_t size = len - 4 - 9 - fopts_len;
+        uint8_t data[SIM_MAX_FRAME];
+
+        memcpy(data, &p[9 + fopts_len], size);
+        payload_crypt(data, size, port == 0 ? nwk_s_key : app_s_key, 0, fcnt);
+        if (port != NS_APP_PORT || !sim_payload_check(data, size)) {
+            stats.bad_payload++;
+        }
+    }
+
+    adr_req = !adr_done && (fctrl & FCTRL_ADR) && uplinks_since_join >= cfg.adr_after &&
+              (adr_requested_at == 0 || uplinks_since_join >= adr_requested_at + 2);
+    app_dl = !retransmission && cfg.downlink_every != 0 && uplinks_since_join % cfg.downlink_every == 0;
+    if (!confirmed && !adr_req && !app_dl) {
+        return;
+    }
+
+    msg[n++] = MTYPE_UNCONFIRMED_DOWN << 5;
+    put_le(&msg[n], NS_DEV_ADDR, 4);
+    n += 4;
+    msg[n++] = FCTRL_ADR | (confirmed ? FCTRL_ACK : 0) | (adr_req ? 5 : 0);
+    put_le(&msg[n], fcnt_down, 2);
+    n += 2;
+    if (adr_req) {
+        msg[n++] = CID_LINK_ADR;
+        msg[n++] = (uint8_t)(cfg.adr_dr << 4);  /* TXPower 0: max EIRP */
+        put_le(&msg[n], 0x00ff, 2);             /* 3 default + 5 CFList channels */
+        n += 2;
+        msg[n++] = 0x01;                        /* ChMaskCntl 0, NbTrans 1 */
+        adr_requested_at = uplinks_since_join;
+        stats.adr_requests++;
+    }
+    if (app_dl) {
+        msg[n++] = NS_APP_PORT;
+        sim_payload_fill(&msg[n], NS_DOWNLINK_SIZE, app_downlink_seq++);
+        payload_crypt(&msg[n], NS_DOWNLINK_SIZE, app_s_key, 1, fcnt_down);
+        n += NS_DOWNLINK_SIZE;
+        stats.app_downlinks++;
+    }
+    put_le(&msg[n], frame_mic(msg, n, 1, fcnt_down), 4);
+    n += 4;
+    fcnt_down++;
+    if (confirmed) {
+        stats.acks++;
+    }
+    rx2 = app_dl && (rx2_toggle++ & 1);
+    transmit(up, msg, n, rx2, NS_RECEIVE_DELAY1_US);
+}
+
+/* ------------------------------------------------------------- entry ---- */
+
+void sim_network_init(const sim_network_config_t *config, uint32_t seed)
+{
+    cfg = *config;
+    rng_state = seed ? seed : 1;
+    memset(&stats, 0, sizeof(stats));
+    joined = false;
+    join_nonce = 0;
+}
+
+void sim_network_uplink(const sim_frame_t *up)
+{
+    uint8_t mtype = up->payload[0] >> 5;
+    int64_t rx1 = (mtype == MTYPE_JOIN_REQUEST) ? NS_JOIN_ACCEPT_DELAY1_US : NS_RECEIVE_DELAY1_US;
+
+    sim_radio_set_rx_slots(up->end_us + rx1, up->end_us + rx1 + 1000000);
+    if (rnd32() % 100 < cfg.loss_pct) {
+        stats.lost++;
+        return;
+    }
+    switch (mtype) {
+    case MTYPE_JOIN_REQUEST:
+        handle_join_request(up);
+        break;
+    case MTYPE_UNCONFIRMED_UP:
+    case MTYPE_CONFIRMED_UP:
+        handle_data_uplink(up, mtype == MTYPE_CONFIRMED_UP);
+        break;
+    default:
+        stats.bad_mic++;
+        break;
+    }
+}
+
+const sim_network_stats_t *sim_network_stats(void)
+{
+    return &stats;
+}
@@ -0,0 +1,547 @@
+/*
+ * Simulated SX126x behind the Radio_s interface of components/lora/radio.h.
+ *
+ * Transmissions last their time on air and end with TxDone. A receive
+ * window gets a queued gateway frame when frequency, spreading factor,
+ * bandwidth and IQ polarity match and the window is open early enough to
+ * lock on the preamble; otherwise it ends with RxTimeout after the symbol
+ * timeout. The radio listens GetWakeupTime() after leaving sleep, as the
+ * MAC assumes. IRQs are timestamped into g_lora_irq_time_us like the board's
+ * ISR does, and the handler runs after the configured latency.
+ */
+#include <string.h>
+#include "radio.h"
+#include "timer.h"
+#include "sim.h"
+
+#define SIM_RADIO_WAKEUP_MS         8       /* TCXO 5 ms + radio 3 ms, as the driver reports */
+#define SIM_PREAMBLE_LOCK_SYMBOLS   4       /* preamble symbols needed to detect a frame */
+#define SIM_MAX_DOWNLINKS           4
+#define SIM_RX_RSSI                 -60
+#define SIM_RX_SNR                  8
+
+typedef enum {
+    OP_NONE,
+    OP_TX_END,
+    OP_RX_DONE,
+    OP_RX_TIMEOUT
+} radio_op_t;
+
+typedef struct {
+    uint8_t bw;
+    uint8_t sf;
+    uint16_t preamble;
+    bool crc;
+    bool iq_inverted;
+} modem_config_t;
+
+/* Set by the DIO1 ISR on the board, read by LoRaMac */
+int64_t g_lora_irq_time_us = 0;
+
+static RadioEvents_t *events;
+static RadioState_t state;
+static bool asleep = true;
+static int64_t ready_us;
+static uint32_t channel;
+static modem_config_t tx_cfg;
+static modem_config_t rx_cfg;
+static uint16_t rx_symb_timeout;
+
+static esp_timer_handle_t op_timer;
+static radio_op_t op;
+static esp_timer_handle_t irq_timer;
+static radio_op_t irq;
+static uint32_t irq_latency;
+
+static sim_frame_t tx_frame;
+static sim_frame_t rx_frame;
+static uint8_t rx_buffer[SIM_MAX_FRAME];
+static sim_frame_t downlinks[SIM_MAX_DOWNLINKS];
+static int nb_downlinks;
+static int64_t rx_slots[2];
+static int rx_since_tx;
+static uint32_t rng_state;
+static sim_radio_stats_t stats;
+
+static const uint32_t bandwidth_hz[] = { 125000, 250000, 500000 };
+
+const sim_band_t sim_bands[SIM_NB_BANDS] = {
+    { "863-865",      863000000, 865000000, 1000 },
+    { "865-868",      865000000, 868000000, 100 },
+    { "868.0-868.6",  868000000, 868600000, 100 },
+    { "868.7-869.2",  868700000, 869200000, 1000 },
+    { "869.4-869.65", 869400000, 869650000, 10 },
+    { "869.7-870",    869700000, 870000000, 100 },
+};
+
+/* ------------------------------------------------------- time on air ---- */
+
+/* Same as RadioGetLoRaTimeOnAirNumerator() in components/lora/radio.c */
+static uint32_t lora_toa_numerator(uint8_t bw, uint8_t sf, uint8_t cr, uint16_t preamble,
+                                   bool fix_len, uint8_t size, bool crc)
+{
+    int32_t cr_denom = cr + 4;
+    bool ldro = (bw == 0 && (sf == 11 || sf == 12)) || (bw == 1 && sf == 12);
+    int32_t den;
+    int32_t num = (size << 3) + (crc ? 16 : 0) - (4 * sf) + (fix_len ? 0 : 20);
+
+    if ((sf == 5 || sf == 6) && preamble < 12) {
+        preamble = 12;
+    }
+    if (sf <= 6) {
+        den = 4 * sf;
+    } else {
+        num += 8;
+        den = ldro ? 4 * (sf - 2) : 4 * sf;
+    }
+    if (num < 0) {
+        num = 0;
+    }
+    int32_t intermediate = ((num + den - 1) / den) * cr_denom + preamble + 12;
+    if (sf <= 6) {
+        intermediate += 2;
+    }
+    return (uint32_t)((4 * intermediate + 1) * (1 << (sf - 2)));
+}
+
+static int64_t toa_us(uint8_t sf, uint8_t bw, uint16_t preamble, uint8_t size, bool crc)
+{
+    return (int64_t)lora_toa_numerator(bw, sf, 1, preamble, false, size, crc) * 1000000 / bandwidth_hz[bw];
+}
+
+int64_t sim_time_on_air_us(uint8_t sf, uint8_t bw, uint8_t size, bool crc)
+{
+    return toa_us(sf, bw, 8, size, crc);
+}
+
+static int64_t symbol_us(uint8_t sf, uint8_t bw)
+{
+    return ((int64_t)1000000 << sf) / bandwidth_hz[bw];
+}
+
+/* -------------------------------------------------------------- IRQs ---- */
+
+static void dispatch_irq(radio_op_t kind)
+{
+    switch (kind) {
+    case OP_TX_END:
+        sim_mac_begin(SIM_EV_TX_DONE);
+        events->TxDone();
+        sim_mac_end();
+        break;
+    case OP_RX_DONE:
+        stats.rx_done++;
+        memcpy(rx_buffer, rx_frame.payload, rx_frame.size);
+        sim_mac_begin(SIM_EV_RX_DONE);
+        events->RxDone(rx_buffer, rx_frame.size, SIM_RX_RSSI, SIM_RX_SNR);
+        sim_mac_end();
+        break;
+    case OP_RX_TIMEOUT:
+        stats.rx_timeouts++;
+        sim_mac_begin(SIM_EV_RX_TIMEOUT);
+        events->RxTimeout();
+        sim_mac_end();
+        break;
+    default:
+        break;
+    }
+}
+
+static void raise_irq(radio_op_t kind)
+{
+    g_lora_irq_time_us = esp_timer_get_time();
+    if (irq_latency == 0) {
+        dispatch_irq(kind);
+        return;
+    }
+    irq = kind;
+    sim_timer_start_at(irq_timer, sim_time_us() + irq_latency);
+}
+
+static void on_irq_timer(void *arg)
+{
+    (void)arg;
+    dispatch_irq(irq);
+}
+
+static void on_op_timer(void *arg)
+{
+    radio_op_t done = op;
+
+    (void)arg;
+    op = OP_NONE;
+    state = RF_IDLE;
+    if (done == OP_TX_END) {
+        sim_network_uplink(&tx_frame);
+    }
+    raise_irq(done);
+}
+
+static void start_op(radio_op_t next, int64_t at_us)
+{
+    esp_timer_stop(op_timer);
+    op = next;
+    sim_timer_start_at(op_timer, at_us);
+}
+
+static void cancel_op(void)
+{
+    esp_timer_stop(op_timer);
+    op = OP_NONE;
+    state = RF_IDLE;
+}
+
+static void wake_up(void)
+{
+    if (asleep) {
+        asleep = false;
+        ready_us = sim_time_us() + SIM_RADIO_WAKEUP_MS * 1000;
+    }
+}
+
+/* ------------------------------------------------------- sim control ---- */
+
+void sim_radio_init(uint32_t seed, uint32_t irq_latency_us)
+{
+    const esp_timer_create_args_t op_args = { .callback = on_op_timer, .name = "sim-radio" };
+    const esp_timer_create_args_t irq_args = { .callback = on_irq_timer, .name = "sim-irq" };
+
+    esp_timer_create(&op_args, &op_timer);
+    esp_timer_create(&irq_args, &irq_timer);
+    irq_latency = irq_latency_us;
+    rng_state = seed ? seed : 1;
+    memset(&stats, 0, sizeof(stats));
+    stats.rx_offset_min_us = INT64_MAX;
+    stats.rx_offset_max_us = INT64_MIN;
+    stats.rx_margin_min_us = INT64_MAX;
+}
+
+void sim_radio_downlink(const sim_frame_t *frame)
+{
+    if (nb_downlinks < SIM_MAX_DOWNLINKS) {
+        downlinks[nb_downlinks++] = *frame;
+    }
+}
+
+void sim_radio_set_rx_slots(int64_t rx1_us, int64_t rx2_us)
+{
+    rx_slots[0] = rx1_us;
+    rx_slots[1] = rx2_us;
+}
+
+const sim_radio_stats_t *sim_radio_stats(void)
+{
+    return &stats;
+}
+
+/* ------------------------------------------------------------ Radio_s ---- */
+
+static void radio_init(RadioEvents_t *ev)
+{
+    events = ev;
+    state = RF_IDLE;
+}
+
+static RadioState_t radio_get_status(void)
+{
+    return state;
+}
+
+static void radio_set_modem(RadioModems_t modem)
+{
+    (void)modem;
+}
+
+static void radio_set_channel(uint32_t freq)
+{
+    channel = freq;
+}
+
+static bool radio_is_channel_free(uint32_t freq, uint32_t rx_bw, int16_t rssi_thresh, uint32_t max_time)
+{
+    (void)freq;
+    (void)rx_bw;
+    (void)rssi_thresh;
+    (void)max_time;
+    return true;
+}
+
+static uint32_t radio_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void radio_set_rx_config(RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                uint32_t bandwidth_afc, uint16_t preamble_len, uint16_t symb_timeout,
+                                bool fix_len, uint8_t payload_len, bool crc_on, bool freq_hop_on,
+                                uint8_t hop_period, bool iq_inverted, bool rx_continuous)
+{
+    (void)modem;
+    (void)coderate;
+    (void)bandwidth_afc;
+    (void)fix_len;
+    (void)payload_len;
+    (void)freq_hop_on;
+    (void)hop_period;
+    (void)rx_continuous;
+    rx_cfg.bw = (uint8_t)bandwidth;
+    rx_cfg.sf = (uint8_t)datarate;
+    rx_cfg.preamble = preamble_len;
+    rx_cfg.crc = crc_on;
+    rx_cfg.iq_inverted = iq_inverted;
+    rx_symb_timeout = symb_timeout;
+}
+
+static void radio_set_tx_config(RadioModems_t modem, int8_t power, uint32_t fdev, uint32_t bandwidth,
+                                uint32_t datarate, uint8_t coderate, uint16_t preamble_len, bool fix_len,
+                                bool crc_on, bool freq_hop_on, uint8_t hop_period, bool iq_inverted,
+                                uint32_t timeout)
+{
+    (void)modem;
+    (void)power;
+    (void)fdev;
+    (void)coderate;
+    (void)fix_len;
+    (void)freq_hop_on;
+    (void)hop_period;
+    (void)timeout;
+    tx_cfg.bw = (uint8_t)bandwidth;
+    tx_cfg.sf = (uint8_t)datarate;
+    tx_cfg.preamble = preamble_len;
+    tx_cfg.crc = crc_on;
+    tx_cfg.iq_inverted = iq_inverted;
+}
+
+static bool radio_check_rf_frequency(uint32_t frequency)
+{
+    (void)frequency;
+    return true;
+}
+
+static uint32_t radio_time_on_air(RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                  uint16_t preamble_len, bool fix_len, uint8_t payload_len, bool crc_on)
+{
+    uint64_t num;
+
+    if (modem == MODEM_FSK) {
+        num = 1000ULL * ((preamble_len << 3) + (fix_len ? 0 : 8) + 24 + ((payload_len + (crc_on ? 2 : 0)) << 3));
+        return (uint32_t)((num + datarate - 1) / datarate);
+    }
+    num = 1000ULL * lora_toa_numerator((uint8_t)bandwidth, (uint8_t)datarate, coderate, preamble_len,
+                                       fix_len, payload_len, crc_on);
+    return (uint32_t)((num + bandwidth_hz[bandwidth] - 1) / bandwidth_hz[bandwidth]);
+}
+
+static void radio_send(uint8_t *buffer, uint8_t size)
+{
+    int64_t start;
+
+    sim_mac_note(SIM_EV_TX_DELAYED);
+    wake_up();
+    start = (ready_us > sim_time_us()) ? ready_us : sim_time_us();
+    tx_frame.freq = channel;
+    tx_frame.sf = tx_cfg.sf;
+    tx_frame.bw = tx_cfg.bw;
+    tx_frame.iq_inverted = tx_cfg.iq_inverted;
+    tx_frame.start_us = start;
+    tx_frame.end_us = start + toa_us(tx_cfg.sf, tx_cfg.bw, tx_cfg.preamble, size, tx_cfg.crc);
+    tx_frame.size = size;
+    memcpy(tx_frame.payload, buffer, size);
+    stats.tx_frames++;
+    for (int i = 0; i < SIM_NB_BANDS; i++) {
+        if (channel >= sim_bands[i].low && channel < sim_bands[i].high) {
+            stats.band_airtime_us[i] += tx_frame.end_us - tx_frame.start_us;
+            break;
+        }
+    }
+    rx_since_tx = 0;
+    rx_slots[0] = rx_slots[1] = 0;
+    state = RF_TX_RUNNING;
+    start_op(OP_TX_END, tx_frame.end_us);
+}
+
+static void radio_sleep(void)
+{
+    cancel_op();
+    asleep = true;
+}
+
+static void radio_standby(void)
+{
+    cancel_op();
+    wake_up();
+}
+
+/* Drops gateway frames whose preamble is over */
+static void purge_downlinks(int64_t now, int64_t tsym)
+{
+    int n = 0;
+
+    for (int i = 0; i < nb_downlinks; i++) {
+        if (downlinks[i].start_us + tsym * rx_cfg.preamble >= now) {
+            downlinks[n++] = downlinks[i];
+        }
+    }
+    nb_downlinks = n;
+}
+
+static void radio_rx(uint32_t timeout)
+{
+    int64_t tsym = symbol_us(rx_cfg.sf, rx_cfg.bw);
+    int64_t listen;
+    int64_t win_end;
+
+    sim_mac_note(SIM_EV_RX_WINDOW);
+    stats.rx_windows++;
+    wake_up();
+    listen = (ready_us > sim_time_us()) ? ready_us : sim_time_us();
+    if (rx_symb_timeout != 0) {
+        win_end = listen + rx_symb_timeout * tsym;
+    } else if (timeout != 0) {
+        win_end = listen + (int64_t)timeout * 1000;
+    } else {
+        win_end = INT64_MAX;
+    }
+    state = RF_RX_RUNNING;
+
+    /* Timing slack of the window against where the network would answer */
+    if (rx_since_tx < 2 && rx_slots[rx_since_tx] != 0) {
+        int64_t slot = rx_slots[rx_since_tx];
+        int64_t late = slot + (rx_cfg.preamble - SIM_PREAMBLE_LOCK_SYMBOLS) * tsym - listen;
+        int64_t early = win_end - (slot + SIM_PREAMBLE_LOCK_SYMBOLS * tsym);
+        int64_t margin = (late < early) ? late : early;
+
+        if (listen - slot < stats.rx_offset_min_us) {
+            stats.rx_offset_min_us = listen - slot;
+        }
+        if (listen - slot > stats.rx_offset_max_us) {
+            stats.rx_offset_max_us = listen - slot;
+        }
+        if (margin < stats.rx_margin_min_us) {
+            stats.rx_margin_min_us = margin;
+        }
+    }
+    rx_since_tx++;
+
+    purge_downlinks(listen, tsym);
+    for (int i = 0; i < nb_downlinks; i++) {
+        const sim_frame_t *dl = &downlinks[i];
+
+        if (dl->freq != channel || dl->sf != rx_cfg.sf || dl->bw != rx_cfg.bw ||
+            dl->iq_inverted != rx_cfg.iq_inverted || dl->start_us >= win_end) {
+            continue;
+        }
+        if (listen <= dl->start_us + (rx_cfg.preamble - SIM_PREAMBLE_LOCK_SYMBOLS) * tsym &&
+            dl->start_us + SIM_PREAMBLE_LOCK_SYMBOLS * tsym <= win_end) {
+            rx_frame = *dl;
+            downlinks[i] = downlinks[--nb_downlinks];
+            start_op(OP_RX_DONE, rx_frame.end_us);
+            return;
+        }
+        stats.rx_missed++;
+    }
+    if (win_end != INT64_MAX) {
+        start_op(OP_RX_TIMEOUT, win_end);
+    }
+}
+
+static void radio_start_cad(void)
+{
+}
+
+static void radio_set_tx_continuous_wave(uint32_t freq, int8_t power, uint16_t time)
+{
+    (void)freq;
+    (void)power;
+    (void)time;
+}
+
+static int16_t radio_rssi(RadioModems_t modem)
+{
+    (void)modem;
+    return -120;
+}
+
+static void radio_write(uint32_t addr, uint8_t data)
+{
+    (void)addr;
+    (void)data;
+}
+
+static uint8_t radio_read(uint32_t addr)
+{
+    (void)addr;
+    return 0;
+}
+
+static void radio_write_buffer(uint32_t addr, uint8_t *buffer, uint8_t size)
+{
+    (void)addr;
+    (void)buffer;
+    (void)size;
+}
+
+static void radio_read_buffer(uint32_t addr, uint8_t *buffer, uint8_t size)
+{
+    (void)addr;
+    memset(buffer, 0, size);
+}
+
+static void radio_set_max_payload_length(RadioModems_t modem, uint8_t max)
+{
+    (void)modem;
+    (void)max;
+}
+
+static void radio_set_public_network(bool enable)
+{
+    (void)enable;
+}
+
+static uint32_t radio_get_wakeup_time(void)
+{
+    return SIM_RADIO_WAKEUP_MS;
+}
+
+static void radio_irq_process(void)
+{
+}
+
+static void radio_set_rx_duty_cycle(uint32_t rx_time, uint32_t sleep_time)
+{
+    (void)rx_time;
+    (void)sleep_time;
+}
+
+const struct Radio_s Radio = {
+    .Init = radio_init,
+    .GetStatus = radio_get_status,
+    .SetModem = radio_set_modem,
+    .SetChannel = radio_set_channel,
+    .IsChannelFree = radio_is_channel_free,
+    .Random = radio_random,
+    .SetRxConfig = radio_set_rx_config,
+    .SetTxConfig = radio_set_tx_config,
+    .CheckRfFrequency = radio_check_rf_frequency,
+    .TimeOnAir = radio_time_on_air,
+    .Send = radio_send,
+    .Sleep = radio_sleep,
+    .Standby = radio_standby,
+    .Rx = radio_rx,
+    .StartCad = radio_start_cad,
+    .SetTxContinuousWave = radio_set_tx_continuous_wave,
+    .Rssi = radio_rssi,
+    .Write = radio_write,
+    .Read = radio_read,
+    .WriteBuffer = radio_write_buffer,
+    .ReadBuffer = radio_read_buffer,
+    .SetMaxPayloadLength = radio_set_max_payload_length,
+    .SetPublicNetwork = radio_set_public_network,
+    .GetWakeupTime = radio_get_wakeup_time,
+    .IrqProcess = radio_irq_process,
+    .RxBoosted = radio_rx,
+    .SetRxDutyCycle = radio_set_rx_duty_cycle,
+};
@@ -0,0 +1,761 @@
+/*
+ * LoRaMac context storage test and benchmark.
+ *
+ * Builds the unmodified NvmDataMgmt.c on the host against a RAM model of a
+ * NOR flash partition (program clears bits only, erase per 4 KB sector) and
+ * a RAM model of NVS. A simulated MAC changes its contexts the way uplinks,
+ * downlinks, LinkADRReq and rejoins do, computes the context CRCs like
+ * LoRaMacHandleNvm and calls NvmDataMgmtStore after each of them.
+ *
+ * Checks, exit code non-zero on a failure:
+ *   - after a restore the contexts are byte for byte the last stored ones,
+ *     with the log partition and with the NVS fallback;
+ *   - the log never programs a bit from 0 to 1, and never stops the MAC;
+ *   - a reset part way through a flash write, including at many points of
+ *     a bank compaction, leaves every context either as before or as after
+ *     that store, and the log recovers;
+ *   - contexts stored in NVS move to the log, and the NVS copy is dropped;
+ *   - a region change and a factory reset behave as before.
+ *
+ * Then reports, per 1000 uplinks, the flash bytes written, the program
+ * operations and sector erases, and the time a store takes and keeps the
+ * MAC stopped, for the NVS blobs and for the log. Flash times are modelled
+ * with the constants below, the host CPU time of the store is added to them.
+ *
+ * Usage: bench_nvm_data_mgmt [-n uplinks] [--csv]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "nvs_flash.h"
+#include "LoRaMac.h"
+#include "NvmDataMgmt.h"
+
+#define BENCH_UPLINKS_DEFAULT       1000
+#define TEST_POWER_CUTS             300
+
+#define PARTITION_SIZE              0x10000
+#define SECTOR_SIZE                 4096
+#define FLASH_PAGE_SIZE             256
+/* Typical QSPI NOR values (page program 0.4 - 0.7 ms, 4 KB erase 45 ms typ.) */
+#define FLASH_PAGE_PROGRAM_US       500
+#define FLASH_SECTOR_ERASE_US       45000
+/* NVS: 32 byte entries, 126 per 4 KB page */
+#define NVS_ENTRY_SIZE              32
+#define NVS_PAGE_ENTRIES            126
+
+esp_log_level_t host_log_level = ESP_LOG_NONE;
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        if (failures < 10) {
+            fprintf(stderr, "FAIL: %s\n", what);
+        }
+        failures++;
+    }
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rng_state = 0x2545f491;
+
+static uint32_t rnd32(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/* ------------------------------------------------------------- flash ---- */
+
+typedef struct {
+    uint64_t bytes;             /* bytes programmed */
+    uint64_t programs;          /* page program operations */
+    uint64_t erases;            /* sector erases */
+    uint64_t time_us;           /* modelled flash busy time */
+} flash_stats_t;
+
+static flash_stats_t stats;
+
+static uint8_t flash[PARTITION_SIZE];
+static bool partition_present = true;
+static long cut_after = -1;     /* bytes programmed before the power is lost */
+static bool power_lost = false;
+static int nor_violations = 0;
+
+static const esp_partition_t partition = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .subtype = 0x40,
+    .size = PARTITION_SIZE,
+    .erase_size = SECTOR_SIZE,
+    .label = "lorawan",
+};
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    (void)code;
+    return "error";
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype, const char *label)
+{
+    (void)subtype;
+    if (!partition_present || type != ESP_PARTITION_TYPE_DATA || strcmp(label, partition.label) != 0) {
+        return NULL;
+    }
+    return &partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t src_offset, void *dst, size_t size)
+{
+    if (p != &partition || src_offset + size > PARTITION_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dst, flash + src_offset, size);
+    return ESP_OK;
+}
+
+static void flash_account_program(size_t offset, size_t size)
+{
+    size_t pages = (offset + size - 1) / FLASH_PAGE_SIZE - offset / FLASH_PAGE_SIZE + 1;
+    stats.bytes += size;
+    stats.programs += pages;
+    stats.time_us += pages * FLASH_PAGE_PROGRAM_US;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *p, size_t dst_offset, const void *src, size_t size)
+{
+    const uint8_t *s = src;
+
+    if (p != &partition || dst_offset + size > PARTITION_SIZE || size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (power_lost) {
+        return ESP_FAIL;
+    }
+    if (cut_after >= 0 && (size_t)cut_after < size) {
+        /* The first bytes make it, the rest of the page stays as it was */
+        size = (size_t)cut_after;
+        power_lost = true;
+    } else if (cut_after >= 0) {
+        cut_after -= (long)size;
+    }
+    for (size_t i = 0; i < size; i++) {
+        if ((flash[dst_offset + i] & s[i]) != s[i]) {
+            nor_violations++;
+        }
+        flash[dst_offset + i] &= s[i];
+    }
+    if (size > 0) {
+        flash_account_program(dst_offset, size);
+    }
+    return power_lost ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t offset, size_t size)
+{
+    if (p != &partition || offset % SECTOR_SIZE || size % SECTOR_SIZE || offset + size > PARTITION_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (power_lost) {
+        return ESP_FAIL;
+    }
+    memset(flash + offset, 0xFF, size);
+    stats.erases += size / SECTOR_SIZE;
+    stats.time_us += (size / SECTOR_SIZE) * FLASH_SECTOR_ERASE_US;
+    return ESP_OK;
+}
+
+/* --------------------------------------------------------------- nvs ---- */
+
+#define NVS_MAX_KEYS                8
+
+typedef struct {
+    char key[16];
+    uint8_t data[sizeof(LoRaMacNvmData_t)];
+    size_t length;
+    bool used;
+} nvs_blob_t;
+
+static nvs_blob_t nvs_blobs[NVS_MAX_KEYS];
+static uint64_t nvs_entries_written = 0;
+
+static nvs_blob_t *nvs_find(const char *key)
+{
+    for (int i = 0; i < NVS_MAX_KEYS; i++) {
+        if (nvs_blobs[i].used && strcmp(nvs_blobs[i].key, key) == 0) {
+            return &nvs_blobs[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    memset(nvs_blobs, 0, sizeof(nvs_blobs));
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    (void)name;
+    (void)open_mode;
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    (void)handle;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+/*
+ * A blob costs a blob data header entry, its data entries and a blob index
+ * entry, each programmed separately, plus the state bitmap updates that mark
+ * them written and the previous version erased. A page is erased for every
+ * NVS_PAGE_ENTRIES entries written once the partition has been used up; the
+ * copying of live entries that goes with it is not counted, so this is a
+ * lower bound.
+ */
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    nvs_blob_t *blob = nvs_find(key);
+    size_t entries = 2 + (length + NVS_ENTRY_SIZE - 1) / NVS_ENTRY_SIZE;
+    uint64_t before = nvs_entries_written / NVS_PAGE_ENTRIES;
+
+    (void)handle;
+    if (blob == NULL) {
+        for (int i = 0; i < NVS_MAX_KEYS && blob == NULL; i++) {
+            if (!nvs_blobs[i].used) {
+                blob = &nvs_blobs[i];
+            }
+        }
+        if (blob == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        snprintf(blob->key, sizeof(blob->key), "%s", key);
+        blob->used = true;
+    }
+    memcpy(blob->data, value, length);
+    blob->length = length;
+
+    nvs_entries_written += entries;
+    stats.bytes += entries * NVS_ENTRY_SIZE;
+    stats.programs += 2 + (length + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE + 2;
+    stats.time_us += (2 + (length + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE + 2) * FLASH_PAGE_PROGRAM_US;
+    if (nvs_entries_written / NVS_PAGE_ENTRIES != before) {
+        stats.erases++;
+        stats.time_us += FLASH_SECTOR_ERASE_US;
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    nvs_blob_t *blob = nvs_find(key);
+
+    (void)handle;
+    if (blob == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (*length < blob->length) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(out_value, blob->data, blob->length);
+    *length = blob->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    nvs_blob_t *blob = nvs_find(key);
+
+    (void)handle;
+    if (blob == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    blob->used = false;
+    return ESP_OK;
+}
+
+static int nvs_count(void)
+{
+    int n = 0;
+    for (int i = 0; i < NVS_MAX_KEYS; i++) {
+        n += nvs_blobs[i].used;
+    }
+    return n;
+}
+
+/* --------------------------------------------------------------- mac ---- */
+
+static LoRaMacNvmData_t nvm;
+static bool mac_stopped = false;
+static int mac_stops = 0;
+static uint64_t mac_stop_cpu_ns;
+static uint64_t mac_stop_flash_us;
+static uint64_t mac_stopped_us;         /* of the last store */
+
+LoRaMacStatus_t LoRaMacMibGetRequestConfirm(MibRequestConfirm_t *mibGet)
+{
+    if (mibGet->Type != MIB_NVM_CTXS) {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    mibGet->Param.Contexts = &nvm;
+    return LORAMAC_STATUS_OK;
+}
+
+bool LoRaMacIsBusy(void)
+{
+    return false;
+}
+
+LoRaMacStatus_t LoRaMacStop(void)
+{
+    mac_stopped = true;
+    mac_stops++;
+    mac_stop_cpu_ns = now_ns();
+    mac_stop_flash_us = stats.time_us;
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacStart(void)
+{
+    mac_stopped = false;
+    mac_stopped_us = (now_ns() - mac_stop_cpu_ns) / 1000 + (stats.time_us - mac_stop_flash_us);
+    return LORAMAC_STATUS_OK;
+}
+
+/* What LoRaMacHandleNvm does when the MAC is idle */
+#define HANDLE_GROUP(member, flag)                                                          \
+    do {                                                                                    \
+        uint32_t crc = Crc32((uint8_t *)&nvm.member, sizeof(nvm.member) - sizeof(uint32_t)); \
+        if (crc != nvm.member.Crc32) {                                                      \
+            nvm.member.Crc32 = crc;                                                         \
+            flags |= (flag);                                                                \
+        }                                                                                   \
+    } while (0)
+
+static void mac_handle_nvm(void)
+{
+    uint16_t flags = LORAMAC_NVM_NOTIFY_FLAG_NONE;
+
+    HANDLE_GROUP(Crypto, LORAMAC_NVM_NOTIFY_FLAG_CRYPTO);
+    HANDLE_GROUP(MacGroup1, LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP1);
+    HANDLE_GROUP(MacGroup2, LORAMAC_NVM_NOTIFY_FLAG_MAC_GROUP2);
+    HANDLE_GROUP(SecureElement, LORAMAC_NVM_NOTIFY_FLAG_SECURE_ELEMENT);
+    HANDLE_GROUP(RegionGroup1, LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP1);
+    HANDLE_GROUP(RegionGroup2, LORAMAC_NVM_NOTIFY_FLAG_REGION_GROUP2);
+    HANDLE_GROUP(ClassB, LORAMAC_NVM_NOTIFY_FLAG_CLASS_B);
+    if (flags != LORAMAC_NVM_NOTIFY_FLAG_NONE) {
+        NvmDataMgmtEvent(flags);
+    }
+}
+
+static void fill_random(void *p, size_t size)
+{
+    uint8_t *b = p;
+    for (size_t i = 0; i < size; i++) {
+        b[i] = (uint8_t)rnd32();
+    }
+}
+
+static void mac_join(void)
+{
+    fill_random(&nvm.SecureElement.KeyList, sizeof(nvm.SecureElement.KeyList));
+    nvm.MacGroup2.DevAddr = rnd32();
+    nvm.Crypto.FCntList.FCntUp = 0;
+    nvm.Crypto.FCntList.NFCntDown = 0;
+    nvm.Crypto.FCntList.AFCntDown = 0;
+    nvm.Crypto.DevNonce++;
+    nvm.Crypto.JoinNonce = rnd32() & 0xFFFFFF;
+    nvm.MacGroup1.AdrAckCounter = 0;
+}
+
+static void mac_reset(void)
+{
+    memset(&nvm, 0, sizeof(nvm));
+    fill_random(&nvm.SecureElement, sizeof(nvm.SecureElement));
+    fill_random(&nvm.RegionGroup2.Channels, sizeof(nvm.RegionGroup2.Channels));
+    nvm.MacGroup2.Region = LORAMAC_REGION_EU868;
+    nvm.MacGroup2.MacParams.ChannelsNbTrans = 1;
+    nvm.RegionGroup2.ChannelsMask[0] = 0x0007;
+    mac_join();
+    mac_handle_nvm();
+}
+
+/*
+ * One uplink: frame counter and ADR ack counter, time of the transmission,
+ * a downlink every 8th uplink, a LinkADRReq every 250th and a rejoin every
+ * 500th.
+ */
+static void mac_uplink(uint32_t n)
+{
+    nvm.Crypto.FCntList.FCntUp++;
+    nvm.MacGroup1.AdrAckCounter++;
+    nvm.MacGroup1.LastTxDoneTime = n * 60000;
+    nvm.MacGroup1.AggregatedTimeOff = (rnd32() % 4) * 1000;
+    if (n % 8 == 0) {
+        nvm.Crypto.FCntList.NFCntDown++;
+        nvm.Crypto.LastDownFCnt = nvm.Crypto.FCntList.NFCntDown;
+        nvm.MacGroup1.LastRxMic = rnd32();
+        nvm.MacGroup1.AdrAckCounter = 0;
+    }
+    if (n % 250 == 0) {
+        nvm.RegionGroup2.ChannelsMask[0] = (uint16_t)(0x0007 | (rnd32() & 0x00F8));
+        nvm.MacGroup2.MacParams.ChannelsNbTrans = (uint8_t)(1 + rnd32() % 3);
+        nvm.MacGroup1.ChannelsDatarate = (int8_t)(rnd32() % 6);
+    }
+    if (n % 500 == 0) {
+        mac_join();
+    }
+    mac_handle_nvm();
+}
+
+static LoRaMacRegion_t restore_region = LORAMAC_REGION_EU868;
+
+/* Power cycle: the MAC starts from its defaults, then restores */
+static uint16_t reboot(void)
+{
+    memset(&nvm, 0, sizeof(nvm));
+    nvm.MacGroup2.Region = restore_region;
+    power_lost = false;
+    cut_after = -1;
+    return NvmDataMgmtRestore();
+}
+
+/* ------------------------------------------------------------- tests ---- */
+
+static void reset_storage(bool with_partition)
+{
+    memset(flash, 0xFF, sizeof(flash));
+    nvs_flash_erase();
+    partition_present = with_partition;
+    memset(&stats, 0, sizeof(stats));
+    nvs_entries_written = 0;
+    nor_violations = 0;
+    mac_stops = 0;
+    reboot();
+    mac_reset();
+    NvmDataMgmtStore();
+}
+
+static void test_round_trip(bool with_partition)
+{
+    LoRaMacNvmData_t expected;
+    char what[96];
+
+    reset_storage(with_partition);
+    for (uint32_t n = 1; n <= 3000; n++) {
+        mac_uplink(n);
+        NvmDataMgmtStore();
+        if (n % 37 == 0 || n % 500 == 0 || n == 3000) {
+            expected = nvm;
+            check(reboot() == sizeof(LoRaMacNvmData_t), "restore reports the contexts");
+            snprintf(what, sizeof(what), "%s: contexts restored after uplink %u",
+                     with_partition ? "log" : "nvs", (unsigned)n);
+            check(memcmp(&nvm, &expected, sizeof(nvm)) == 0, what);
+        }
+    }
+    if (with_partition) {
+        check(nor_violations == 0, "log: no bit programmed from 0 to 1");
+        check(mac_stops == 0, "log: MAC never stopped");
+        check(nvs_count() == 0, "log: nothing written to NVS");
+    } else {
+        check(mac_stops > 0, "nvs: MAC stopped while storing");
+    }
+}
+
+static bool group_is(const void *restored, const void *a, const void *b, size_t size)
+{
+    return memcmp(restored, a, size) == 0 || memcmp(restored, b, size) == 0;
+}
+
+#define GROUP_IS(member) group_is(&nvm.member, &before->member, &after->member, sizeof(nvm.member))
+
+/* Each context is restored as it was either before or after the cut store */
+static bool groups_before_or_after(const LoRaMacNvmData_t *before, const LoRaMacNvmData_t *after)
+{
+    return GROUP_IS(Crypto) && GROUP_IS(MacGroup1) && GROUP_IS(MacGroup2) && GROUP_IS(SecureElement) &&
+           GROUP_IS(RegionGroup1) && GROUP_IS(RegionGroup2) && GROUP_IS(ClassB);
+}
+
+static void test_power_cuts(void)
+{
+    LoRaMacNvmData_t before;
+    LoRaMacNvmData_t after;
+    uint32_t n = 1;
+
+    reset_storage(true);
+    for (int trial = 0; trial < TEST_POWER_CUTS; trial++) {
+        /* Vary the position in the bank so that compactions get cut too */
+        uint32_t steps = 1 + rnd32() % 40;
+        for (uint32_t i = 0; i < steps; i++, n++) {
+            mac_uplink(n);
+            NvmDataMgmtStore();
+        }
+        before = nvm;
+        mac_uplink(n++);
+        after = nvm;
+        cut_after = (long)(rnd32() % 96);
+        NvmDataMgmtStore();
+
+        reboot();
+        check(groups_before_or_after(&before, &after), "power cut: contexts before or after");
+
+        /* The MAC carries on from the restored state, and stores again */
+        mac_uplink(n++);
+        NvmDataMgmtStore();
+        after = nvm;
+        reboot();
+        check(memcmp(&nvm, &after, sizeof(nvm)) == 0, "power cut: log recovers");
+    }
+    check(nor_violations == 0, "power cut: no bit programmed from 0 to 1");
+}
+
+/*
+ * Cuts the power at many points of one compaction: the store that finds the
+ * bank full is replayed from a copy of the flash each time.
+ */
+static void test_compaction_cuts(void)
+{
+    static uint8_t saved[PARTITION_SIZE];
+    LoRaMacNvmData_t before;
+    LoRaMacNvmData_t after;
+    uint64_t written = 0;
+    uint32_t n = 1;
+
+    reset_storage(true);
+    while (written < 1024 && n < 100000) {
+        before = nvm;
+        memcpy(saved, flash, sizeof(flash));
+        mac_uplink(n++);
+        uint64_t bytes = stats.bytes;
+        NvmDataMgmtStore();
+        written = stats.bytes - bytes;
+    }
+    check(written >= 1024, "compaction cut: bank filled up");
+    after = nvm;
+
+    for (long cut = 0; cut < (long)written; cut += 1 + (long)(rnd32() % 48)) {
+        memcpy(flash, saved, sizeof(flash));
+        reboot();
+        check(memcmp(&nvm, &before, sizeof(nvm)) == 0, "compaction cut: state before the store");
+        nvm = after;
+        NvmDataMgmtEvent(0x7F);
+        cut_after = cut;
+        NvmDataMgmtStore();
+
+        reboot();
+        check(groups_before_or_after(&before, &after), "compaction cut: contexts before or after");
+        mac_uplink(n);
+        NvmDataMgmtStore();
+        LoRaMacNvmData_t expected = nvm;
+        reboot();
+        check(memcmp(&nvm, &expected, sizeof(nvm)) == 0, "compaction cut: log recovers");
+    }
+    check(nor_violations == 0, "compaction cut: no bit programmed from 0 to 1");
+}
+
+static void test_migration(void)
+{
+    LoRaMacNvmData_t expected;
+
+    reset_storage(false);
+    for (uint32_t n = 1; n <= 50; n++) {
+        mac_uplink(n);
+        NvmDataMgmtStore();
+    }
+    expected = nvm;
+    check(nvs_count() == 7, "migration: contexts in NVS");
+
+    partition_present = true;
+    check(reboot() == sizeof(LoRaMacNvmData_t), "migration: restored from NVS");
+    check(memcmp(&nvm, &expected, sizeof(nvm)) == 0, "migration: NVS contexts restored");
+    mac_uplink(51);
+    NvmDataMgmtStore();
+    expected = nvm;
+    check(nvs_count() == 0, "migration: NVS copy dropped");
+    reboot();
+    check(memcmp(&nvm, &expected, sizeof(nvm)) == 0, "migration: contexts restored from the log");
+}
+
+static void test_region_change_and_reset(void)
+{
+    LoRaMacNvmData_t expected;
+
+    reset_storage(true);
+    for (uint32_t n = 1; n <= 20; n++) {
+        mac_uplink(n);
+        NvmDataMgmtStore();
+    }
+    expected = nvm;
+
+    restore_region = LORAMAC_REGION_US915;
+    check(reboot() == 0, "region change: nothing restored");
+    check(memcmp(&nvm.Crypto, &expected.Crypto, sizeof(nvm.Crypto)) == 0,
+          "region change: frame counters kept");
+    check(nvm.MacGroup2.Region == LORAMAC_REGION_US915, "region change: new region kept");
+    restore_region = LORAMAC_REGION_EU868;
+
+    check(NvmDataMgmtFactoryReset(), "factory reset succeeds");
+    bool blank = true;
+    for (size_t i = 0; i < sizeof(flash); i++) {
+        blank &= flash[i] == 0xFF;
+    }
+    check(blank, "factory reset erases the log");
+    check(nvs_count() == 0, "factory reset erases NVS");
+    reboot();
+    check(nvm.Crypto.FCntList.FCntUp == 0, "factory reset: nothing restored");
+
+    mac_reset();
+    NvmDataMgmtStore();
+    expected = nvm;
+    reboot();
+    check(memcmp(&nvm, &expected, sizeof(nvm)) == 0, "factory reset: log usable again");
+}
+
+/* ------------------------------------------------------------- bench ---- */
+
+typedef struct {
+    flash_stats_t flash;
+    uint64_t stores;
+    uint64_t store_us_sum;
+    uint64_t store_us_max;
+    uint64_t stopped_us_sum;
+    uint64_t stopped_us_max;
+    uint64_t cpu_ns_sum;
+} bench_result_t;
+
+static void bench(bool with_partition, uint32_t uplinks, bench_result_t *r)
+{
+    memset(r, 0, sizeof(*r));
+    reset_storage(with_partition);
+    /* Start from a used log, as a device in the field would */
+    for (uint32_t n = 1; n <= 2 * uplinks; n++) {
+        mac_uplink(n);
+        NvmDataMgmtStore();
+    }
+    memset(&stats, 0, sizeof(stats));
+
+    for (uint32_t n = 2 * uplinks + 1; n <= 3 * uplinks; n++) {
+        mac_uplink(n);
+        uint64_t flash_us = stats.time_us;
+        mac_stopped_us = 0;
+        uint64_t t0 = now_ns();
+        NvmDataMgmtStore();
+        uint64_t cpu = now_ns() - t0;
+        uint64_t store_us = cpu / 1000 + (stats.time_us - flash_us);
+
+        r->stores++;
+        r->cpu_ns_sum += cpu;
+        r->store_us_sum += store_us;
+        if (store_us > r->store_us_max) {
+            r->store_us_max = store_us;
+        }
+        r->stopped_us_sum += mac_stopped_us;
+        if (mac_stopped_us > r->stopped_us_max) {
+            r->stopped_us_max = mac_stopped_us;
+        }
+    }
+    r->flash = stats;
+}
+
+static void report(const char *name, const bench_result_t *r, uint32_t uplinks, bool csv)
+{
+    double per_k = 1000.0 / uplinks;
+
+    if (csv) {
+        printf("%s,%.0f,%.0f,%.1f,%.2f,%.2f,%.2f,%.2f,%.2f\n", name,
+               r->flash.bytes * per_k, r->flash.programs * per_k, r->flash.erases * per_k,
+               r->store_us_sum / 1000.0 / r->stores, r->store_us_max / 1000.0,
+               r->stopped_us_sum / 1000.0 / r->stores, r->stopped_us_max / 1000.0,
+               r->cpu_ns_sum / 1000.0 / r->stores);
+        return;
+    }
+    printf("%-5s %9.0f B %7.0f %7.1f   %7.2f / %7.2f   %7.2f / %7.2f   %6.2f\n", name,
+           r->flash.bytes * per_k, r->flash.programs * per_k, r->flash.erases * per_k,
+           r->store_us_sum / 1000.0 / r->stores, r->store_us_max / 1000.0,
+           r->stopped_us_sum / 1000.0 / r->stores, r->stopped_us_max / 1000.0,
+           r->cpu_ns_sum / 1000.0 / r->stores);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t uplinks = BENCH_UPLINKS_DEFAULT;
+    bool csv = false;
+    bench_result_t nvs_result;
+    bench_result_t log_result;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            uplinks = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else {
+            fprintf(stderr, "usage: %s [-n uplinks] [--csv]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (uplinks == 0) {
+        uplinks = BENCH_UPLINKS_DEFAULT;
+    }
+
+    test_round_trip(false);
+    test_round_trip(true);
+    test_power_cuts();
+    test_compaction_cuts();
+    test_migration();
+    test_region_change_and_reset();
+
+    bench(false, uplinks, &nvs_result);
+    bench(true, uplinks, &log_result);
+
+    if (csv) {
+        printf("storage,bytes_per_1k,programs_per_1k,erases_per_1k,store_ms_mean,store_ms_max,"
+               "mac_stopped_ms_mean,mac_stopped_ms_max,cpu_us_per_store\n");
+    } else {
+        printf("contexts %u bytes, %u uplinks, flash %d us/page program, %d us/sector erase\n\n",
+               (unsigned)sizeof(LoRaMacNvmData_t), (unsigned)uplinks,
+               FLASH_PAGE_PROGRAM_US, FLASH_SECTOR_ERASE_US);
+        printf("             per 1000 uplinks         store ms          MAC stopped ms    cpu us\n");
+        printf("      %11s %7s %7s   %7s / %7s   %7s / %7s   %6s\n",
+               "written", "progs", "erases", "mean", "max", "mean", "max", "/store");
+    }
+    report("nvs", &nvs_result, uplinks, csv);
+    report("log", &log_result, uplinks, csv);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    if (!csv) {
+        printf("\nall checks passed\n");
+    }
+    return 0;
+}
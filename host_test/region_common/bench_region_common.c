@@ -0,0 +1,387 @@
+/*
+ * Region channel selection test and benchmark.
+ *
+ * Builds the unmodified RegionCommon.c on the host and compares its channel
+ * selection with the previous bit-by-bit implementation, kept below as the
+ * reference:
+ *
+ *   - RegionCommonCountNbOfEnabledChannels must return the same enabled
+ *     channel list, in the same order, and the same restricted count, for
+ *     random channel masks, join masks, data rates, channel data rate
+ *     ranges, unset frequencies and band readiness. Since the regions pick
+ *     enabledChannels[randr( 0, n - 1 )], the same list means the same
+ *     channel statistics. A pick histogram is compared as well.
+ *   - RegionCommonChanVerifyDr and RegionCommonCountChannels must agree.
+ *
+ * Then reports the per-TX scheduling cost (what RegionCommonIdentifyChannels
+ * runs: band time-off update plus channel count) for the EU868, US915 and
+ * CN470 channel layouts, with the reference and the current channel count.
+ * Exits non-zero on a mismatch, so it doubles as a regression test.
+ *
+ * Usage: bench_region_common [-n iterations] [--csv]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "radio.h"
+#include "RegionCommon.h"
+
+#define BENCH_ITERATIONS_DEFAULT    200000
+#define BENCH_ROUNDS                5       /* Best round is reported */
+#define TEST_SCENARIOS              20000
+#define TEST_PICKS                  100000
+#define MAX_CHANNELS                96
+#define MAX_BANDS                   6
+
+static int failures = 0;
+
+/* ---------------------------------------------------------------- host ---- */
+
+const struct Radio_s Radio;
+
+static TimerTime_t fake_now = 1000;
+
+TimerTime_t TimerGetCurrentTime(void)
+{
+    return fake_now;
+}
+
+TimerTime_t TimerGetElapsedTime(TimerTime_t past)
+{
+    if (past == 0) {
+        return 0;
+    }
+    return fake_now - past;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rng_state = 0x2545f491;
+
+static uint32_t rnd32(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        if (failures < 10) {
+            fprintf(stderr, "FAIL: %s\n", what);
+        }
+        failures++;
+    }
+}
+
+/* ---------------------------------------------------------- reference ---- */
+
+/* Previous implementation, one mask bit at a time */
+static void ref_count_enabled(RegionCommonCountNbOfEnabledChannelsParams_t *p, uint8_t *enabledChannels,
+                              uint8_t *nbEnabledChannels, uint8_t *nbRestrictedChannels)
+{
+    uint8_t nbChannelCount = 0;
+    uint8_t nbRestrictedChannelsCount = 0;
+
+    for (uint8_t i = 0, k = 0; i < p->MaxNbChannels; i += 16, k++) {
+        for (uint8_t j = 0; j < 16; j++) {
+            if ((p->ChannelsMask[k] & (1 << j)) != 0) {
+                if (p->Channels[i + j].Frequency == 0) {
+                    continue;
+                }
+                if ((p->Joined == false) && (p->JoinChannels != NULL)) {
+                    if ((p->JoinChannels[k] & (1 << j)) == 0) {
+                        continue;
+                    }
+                }
+                if (RegionCommonValueInRange(p->Datarate, p->Channels[i + j].DrRange.Fields.Min,
+                                             p->Channels[i + j].DrRange.Fields.Max) == false) {
+                    continue;
+                }
+                if (p->Bands[p->Channels[i + j].Band].ReadyForTransmission == false) {
+                    nbRestrictedChannelsCount++;
+                    continue;
+                }
+                enabledChannels[nbChannelCount++] = i + j;
+            }
+        }
+    }
+    *nbEnabledChannels = nbChannelCount;
+    *nbRestrictedChannels = nbRestrictedChannelsCount;
+}
+
+static bool ref_verify_dr(uint8_t nbChannels, uint16_t *channelsMask, int8_t dr, int8_t minDr, int8_t maxDr,
+                          ChannelParams_t *channels)
+{
+    if (RegionCommonValueInRange(dr, minDr, maxDr) == 0) {
+        return false;
+    }
+    for (uint8_t i = 0, k = 0; i < nbChannels; i += 16, k++) {
+        for (uint8_t j = 0; j < 16; j++) {
+            if (((channelsMask[k] & (1 << j)) != 0)) {
+                if (RegionCommonValueInRange(dr, (channels[i + j].DrRange.Fields.Min & 0x0F),
+                                             (channels[i + j].DrRange.Fields.Max & 0x0F)) == 1) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+static uint8_t ref_count_channels(uint16_t *channelsMask, uint8_t startIdx, uint8_t stopIdx)
+{
+    uint8_t nbChannels = 0;
+
+    for (uint8_t i = startIdx; i < stopIdx; i++) {
+        for (uint8_t j = 0; j < 16; j++) {
+            if ((channelsMask[i] & (1 << j)) == (1 << j)) {
+                nbChannels++;
+            }
+        }
+    }
+    return nbChannels;
+}
+
+/* ------------------------------------------------------------ layouts ---- */
+
+typedef struct {
+    const char *name;
+    uint16_t nb_channels;
+    uint8_t nb_bands;
+    uint16_t mask[MAX_CHANNELS / 16];
+} layout_t;
+
+static const layout_t layouts[] = {
+    /* 3 default channels plus 5 from the CFList, 6 duty cycle bands */
+    { "EU868", 16, 6, { 0x00ff } },
+    /* Sub-band 2 plus its 500 kHz channel */
+    { "US915", 72, 1, { 0xff00, 0, 0, 0, 0x0002 } },
+    { "US915-all", 72, 1, { 0xffff, 0xffff, 0xffff, 0xffff, 0x00ff } },
+    { "CN470", 96, 1, { 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff } },
+};
+
+static ChannelParams_t channels[MAX_CHANNELS];
+static Band_t bands[MAX_BANDS];
+
+static void setup_layout(const layout_t *l, uint16_t *mask)
+{
+    memset(channels, 0, sizeof(channels));
+    memset(bands, 0, sizeof(bands));
+    for (uint16_t i = 0; i < l->nb_channels; i++) {
+        channels[i].Frequency = 868100000 + i * 200000;
+        channels[i].DrRange.Fields.Min = 0;
+        channels[i].DrRange.Fields.Max = 5;
+        channels[i].Band = (uint8_t)(i % l->nb_bands);
+    }
+    for (uint8_t b = 0; b < l->nb_bands; b++) {
+        bands[b].DCycle = 100;
+        bands[b].ReadyForTransmission = true;
+    }
+    memcpy(mask, l->mask, sizeof(l->mask));
+}
+
+/* -------------------------------------------------------- correctness ---- */
+
+static uint16_t random_mask_word(void)
+{
+    switch (rnd32() % 4) {
+    case 0:
+        return 0;
+    case 1:
+        return 0xffff;
+    default:
+        return (uint16_t)rnd32();
+    }
+}
+
+static void check_selection(void)
+{
+    uint16_t mask[MAX_CHANNELS / 16], join[MAX_CHANNELS / 16];
+
+    for (int n = 0; n < TEST_SCENARIOS; n++) {
+        const layout_t *l = &layouts[n % (sizeof(layouts) / sizeof(layouts[0]))];
+        uint8_t ref_list[MAX_CHANNELS], list[MAX_CHANNELS];
+        uint8_t ref_nb, ref_restricted, nb, restricted;
+
+        setup_layout(l, mask);
+        for (uint16_t k = 0; k < (l->nb_channels + 15) / 16; k++) {
+            mask[k] = random_mask_word();
+            join[k] = random_mask_word();
+        }
+        if ((l->nb_channels % 16) != 0) {
+            /* Regions keep the bits past the last channel cleared */
+            mask[l->nb_channels / 16] &= (uint16_t)((1U << (l->nb_channels % 16)) - 1);
+        }
+        for (uint16_t i = 0; i < l->nb_channels; i++) {
+            if (rnd32() % 8 == 0) {
+                channels[i].Frequency = 0;
+            }
+            channels[i].DrRange.Fields.Min = rnd32() % 4;
+            channels[i].DrRange.Fields.Max = 3 + rnd32() % 5;
+        }
+        for (uint8_t b = 0; b < l->nb_bands; b++) {
+            bands[b].ReadyForTransmission = (rnd32() % 3) != 0;
+        }
+
+        RegionCommonCountNbOfEnabledChannelsParams_t p = {
+            .Joined = (rnd32() & 1) != 0,
+            .Datarate = (uint8_t)(rnd32() % 8),
+            .ChannelsMask = mask,
+            .Channels = channels,
+            .Bands = bands,
+            .MaxNbChannels = l->nb_channels,
+            .JoinChannels = (rnd32() & 1) ? join : NULL,
+        };
+
+        ref_count_enabled(&p, ref_list, &ref_nb, &ref_restricted);
+        RegionCommonCountNbOfEnabledChannels(&p, list, &nb, &restricted);
+        check(nb == ref_nb && restricted == ref_restricted && memcmp(list, ref_list, nb) == 0,
+              "RegionCommonCountNbOfEnabledChannels matches the reference");
+
+        int8_t dr = (int8_t)(rnd32() % 8);
+        check(RegionCommonChanVerifyDr(l->nb_channels, mask, dr, 0, 7, channels) ==
+              ref_verify_dr(l->nb_channels, mask, dr, 0, 7, channels),
+              "RegionCommonChanVerifyDr matches the reference");
+        check(RegionCommonCountChannels(mask, 0, (l->nb_channels + 15) / 16) ==
+              ref_count_channels(mask, 0, (l->nb_channels + 15) / 16),
+              "RegionCommonCountChannels matches the reference");
+    }
+}
+
+/* Channel pick histogram, as RegionXXNextChannel picks from the list */
+static void check_pick_statistics(void)
+{
+    uint16_t mask[MAX_CHANNELS / 16];
+    uint32_t ref_hist[MAX_CHANNELS] = { 0 }, hist[MAX_CHANNELS] = { 0 };
+    uint8_t ref_list[MAX_CHANNELS], list[MAX_CHANNELS];
+    uint8_t ref_nb, nb, restricted;
+
+    setup_layout(&layouts[2], mask);
+    mask[1] = 0x5a5a;
+    bands[0].ReadyForTransmission = true;
+    RegionCommonCountNbOfEnabledChannelsParams_t p = {
+        .Joined = true, .Datarate = 2, .ChannelsMask = mask, .Channels = channels,
+        .Bands = bands, .MaxNbChannels = 72, .JoinChannels = NULL,
+    };
+    ref_count_enabled(&p, ref_list, &ref_nb, &restricted);
+    RegionCommonCountNbOfEnabledChannels(&p, list, &nb, &restricted);
+    check(nb == ref_nb && nb > 0, "pick statistics channel count");
+    if (nb != ref_nb || nb == 0) {
+        return;
+    }
+
+    uint32_t seed = rng_state;
+    for (int i = 0; i < TEST_PICKS; i++) {
+        ref_hist[ref_list[rnd32() % ref_nb]]++;
+    }
+    rng_state = seed;
+    for (int i = 0; i < TEST_PICKS; i++) {
+        hist[list[rnd32() % nb]]++;
+    }
+    check(memcmp(ref_hist, hist, sizeof(hist)) == 0, "channel pick histogram matches the reference");
+}
+
+/* ---------------------------------------------------------- benchmark ---- */
+
+typedef void (*count_fn_t)(RegionCommonCountNbOfEnabledChannelsParams_t *, uint8_t *, uint8_t *, uint8_t *);
+
+/* What RegionCommonIdentifyChannels does per TX, with a selectable channel count */
+static uint8_t identify(RegionCommonIdentifyChannelsParam_t *p, count_fn_t count, uint8_t *list)
+{
+    uint8_t nb = 0, restricted = 0;
+
+    RegionCommonUpdateBandTimeOff(p->CountNbOfEnabledChannelsParam->Joined,
+                                  p->CountNbOfEnabledChannelsParam->Bands, p->MaxBands,
+                                  p->DutyCycleEnabled, p->LastTxIsJoinRequest,
+                                  p->ElapsedTimeSinceStartUp, p->ExpectedTimeOnAir);
+    count(p->CountNbOfEnabledChannelsParam, list, &nb, &restricted);
+    return nb;
+}
+
+static double bench_layout(const layout_t *l, count_fn_t count, int iterations)
+{
+    uint16_t mask[MAX_CHANNELS / 16];
+    uint8_t list[MAX_CHANNELS];
+    volatile uint32_t sink = 0;
+    double best = 0;
+
+    setup_layout(l, mask);
+    RegionCommonCountNbOfEnabledChannelsParams_t countParams = {
+        .Joined = true, .Datarate = 3, .ChannelsMask = mask, .Channels = channels,
+        .Bands = bands, .MaxNbChannels = l->nb_channels, .JoinChannels = NULL,
+    };
+    RegionCommonIdentifyChannelsParam_t p = {
+        .AggrTimeOff = 0, .LastAggrTx = 0, .DutyCycleEnabled = true, .MaxBands = l->nb_bands,
+        .ElapsedTimeSinceStartUp = { .Seconds = 7200 }, .LastTxIsJoinRequest = false,
+        .ExpectedTimeOnAir = 60, .CountNbOfEnabledChannelsParam = &countParams,
+    };
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        uint64_t start = now_ns();
+        for (int n = 0; n < iterations; n++) {
+            fake_now += 1000;
+            sink += identify(&p, count, list);
+        }
+        double ns = (double)(now_ns() - start) / iterations;
+        if (round == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    (void)sink;
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = BENCH_ITERATIONS_DEFAULT;
+    bool csv = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        }
+    }
+    if (iterations < 1) {
+        fprintf(stderr, "iterations must be >= 1\n");
+        return 2;
+    }
+
+    check_selection();
+    check_pick_statistics();
+
+    if (csv) {
+        printf("layout,channels,bands,reference_ns_per_tx,current_ns_per_tx\n");
+    } else {
+        printf("%d iterations, best of %d rounds, ns per TX (band time-off update + channel count)\n", iterations, BENCH_ROUNDS);
+        printf("%-10s %8s %6s %12s %12s %8s\n", "layout", "channels", "bands", "reference", "current", "speedup");
+    }
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+        const layout_t *l = &layouts[i];
+        double ref = bench_layout(l, ref_count_enabled, iterations);
+        double cur = bench_layout(l, RegionCommonCountNbOfEnabledChannels, iterations);
+
+        if (csv) {
+            printf("%s,%u,%u,%.1f,%.1f\n", l->name, l->nb_channels, l->nb_bands, ref, cur);
+        } else {
+            printf("%-10s %8u %6u %12.1f %12.1f %7.2fx\n", l->name, l->nb_channels, l->nb_bands, ref, cur, ref / cur);
+        }
+    }
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
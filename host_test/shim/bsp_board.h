@@ -0,0 +1,7 @@
+/*
+ * Host shim: bsp_board.h (nothing from the board is used by the model layer)
+ */
+#ifndef HOST_SHIM_BSP_BOARD_H
+#define HOST_SHIM_BSP_BOARD_H
+
+#endif
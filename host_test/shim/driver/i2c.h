@@ -0,0 +1,14 @@
+/*
+ * Host shim: driver/i2c.h
+ *
+ * Expander access goes through io_expander_ops_t. Like ESP-IDF's header, this
+ * pulls in the FreeRTOS semaphores and assert() that includers rely on.
+ */
+#ifndef HOST_SHIM_DRIVER_I2C_H
+#define HOST_SHIM_DRIVER_I2C_H
+
+#include <assert.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#endif
@@ -0,0 +1,14 @@
+/*
+ * Host shim: esp_attr.h
+ *
+ * Placement attributes have no meaning on the host.
+ */
+#ifndef HOST_SHIM_ESP_ATTR_H
+#define HOST_SHIM_ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define WORD_ALIGNED_ATTR       __attribute__((aligned(4)))
+#define DMA_ATTR                WORD_ALIGNED_ATTR
+
+#endif
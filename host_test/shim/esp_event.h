@@ -0,0 +1,18 @@
+/*
+ * Host shim: esp_event.h
+ *
+ * Posted events are not dispatched, the last one is kept for inspection.
+ */
+#ifndef HOST_SHIM_ESP_EVENT_H
+#define HOST_SHIM_ESP_EVENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event_base.h"
+#include "freertos/FreeRTOS.h"
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
+                            const void *event_data, size_t event_data_size, TickType_t ticks_to_wait);
+
+#endif
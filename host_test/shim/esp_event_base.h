@@ -0,0 +1,13 @@
+/*
+ * Host shim: esp_event_base.h
+ */
+#ifndef HOST_SHIM_ESP_EVENT_BASE_H
+#define HOST_SHIM_ESP_EVENT_BASE_H
+
+typedef const char *esp_event_base_t;
+typedef void *esp_event_loop_handle_t;
+
+#define ESP_EVENT_DECLARE_BASE(id) extern esp_event_base_t const id
+#define ESP_EVENT_DEFINE_BASE(id) esp_event_base_t const id = #id
+
+#endif
@@ -0,0 +1,13 @@
+/*
+ * Host shim: esp_rom_sys.h
+ *
+ * Each test that needs it provides esp_rom_delay_us().
+ */
+#ifndef HOST_SHIM_ESP_ROM_SYS_H
+#define HOST_SHIM_ESP_ROM_SYS_H
+
+#include <stdint.h>
+
+void esp_rom_delay_us(uint32_t us);
+
+#endif
@@ -0,0 +1,16 @@
+/*
+ * Host shim: esp_system.h
+ */
+#ifndef HOST_SHIM_ESP_SYSTEM_H
+#define HOST_SHIM_ESP_SYSTEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define MALLOC_CAP_SPIRAM       (1 << 10)
+
+uint32_t esp_get_free_heap_size(void);
+size_t heap_caps_get_free_size(uint32_t caps);
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ * Host shim: freertos/timers.h
+ *
+ * Timers are created but never fire.
+ */
+#ifndef HOST_SHIM_FREERTOS_TIMERS_H
+#define HOST_SHIM_FREERTOS_TIMERS_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload,
+                           void *timer_id, TimerCallbackFunction_t callback);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks_to_wait);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks_to_wait);
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks_to_wait);
+
+#endif
@@ -0,0 +1,9 @@
+/*
+ * Host shim: sdkconfig.h
+ *
+ * Empty, host tests set the CONFIG_ options they need on the command line.
+ */
+#ifndef HOST_SHIM_SDKCONFIG_H
+#define HOST_SHIM_SDKCONFIG_H
+
+#endif
@@ -0,0 +1,306 @@
+/*
+ * Soft secure element benchmark.
+ *
+ * Runs the unmodified soft-se.c on the host and reports, for a 51 and a 242
+ * byte frame (largest application payloads of DR0 and DR5 in EU868), the
+ * throughput of payload encryption and MIC computation:
+ *
+ *   per-block  the previous path: the key schedule is expanded again for
+ *              every 16-byte block (encrypt) or every MIC
+ *   cached     SecureElementAesCtrEncrypt / SecureElementComputeAesCmac on
+ *              the key schedules kept by the secure element
+ *
+ * Checks the AES and CMAC reference vectors (FIPS-197 C.1, RFC 4493), that
+ * the CTR path matches the per-block one and that a changed key is picked
+ * up, and exits non-zero on a mismatch, so it doubles as a regression test.
+ *
+ * Usage: bench_soft_se_<backend> [-n iterations] [--csv]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "aes.h"
+#include "cmac.h"
+#include "secure-element.h"
+#include "soft-se-hal.h"
+
+#define BENCH_ITERATIONS_DEFAULT    20000
+#define BENCH_MAX_ITERATIONS        10000000
+#define BENCH_ROUNDS                5       /* Best round is reported */
+
+static const uint16_t frame_sizes[] = { 51, 242 };
+
+static int failures = 0;
+
+/* ---------------------------------------------------------------- host ---- */
+
+void SoftSeHalGetUniqueId( uint8_t *id )
+{
+    for (int i = 0; i < 8; i++) {
+        id[i] = (uint8_t)(0xa0 + i);
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+/* ------------------------------------------------------ per-block path ---- */
+
+/* What PayloadEncrypt + SecureElementAesEncrypt did before the schedule cache */
+static void per_block_encrypt(const uint8_t *key, uint8_t *a_block, uint8_t *buffer, uint16_t size)
+{
+    aes_context ctx;
+    uint8_t s_block[16];
+    uint16_t index = 0;
+    uint8_t ctr = a_block[15];
+
+    while (size > 0) {
+        uint8_t len = size > 16 ? 16 : size;
+
+        memset(ctx.ksch, 0, sizeof(ctx.ksch));
+        aes_set_key(key, 16, &ctx);
+        a_block[15] = ctr++;
+        lorawan_aes_encrypt(a_block, s_block, &ctx);
+        for (uint8_t i = 0; i < len; i++) {
+            buffer[index + i] ^= s_block[i];
+        }
+        index += len;
+        size -= len;
+    }
+}
+
+static uint32_t per_block_mic(const uint8_t *key, uint8_t *b0, const uint8_t *buffer, uint16_t size)
+{
+    AES_CMAC_CTX ctx;
+    uint8_t mac[16];
+
+    AES_CMAC_Init(&ctx);
+    AES_CMAC_SetKey(&ctx, key);
+    AES_CMAC_Update(&ctx, b0, 16);
+    AES_CMAC_Update(&ctx, buffer, size);
+    AES_CMAC_Final(mac, &ctx);
+    return (uint32_t)mac[3] << 24 | (uint32_t)mac[2] << 16 | (uint32_t)mac[1] << 8 | mac[0];
+}
+
+/* -------------------------------------------------------- correctness ---- */
+
+static void check_vectors(void)
+{
+    /* FIPS-197 appendix C.1 */
+    uint8_t aes_key[16], aes_pt[16], aes_ct[16];
+    static const uint8_t aes_expected[16] = {
+        0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+    };
+    for (int i = 0; i < 16; i++) {
+        aes_key[i] = (uint8_t)i;
+        aes_pt[i] = (uint8_t)(i * 0x11);
+    }
+    SecureElementSetKey(APP_S_KEY, aes_key);
+    check(SecureElementAesEncrypt(aes_pt, 16, APP_S_KEY, aes_ct) == SECURE_ELEMENT_SUCCESS &&
+          memcmp(aes_ct, aes_expected, 16) == 0, "AES-128 FIPS-197 C.1");
+
+    /* RFC 4493 section 4, examples 2 and 4, first four bytes little endian */
+    uint8_t cmac_key[16] = {
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+    };
+    uint8_t msg[64] = {
+        0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+        0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+        0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+        0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+    };
+    uint32_t mic = 0;
+    SecureElementSetKey(F_NWK_S_INT_KEY, cmac_key);
+    check(SecureElementComputeAesCmac(NULL, msg, 16, F_NWK_S_INT_KEY, &mic) == SECURE_ELEMENT_SUCCESS &&
+          mic == 0xb4160a07, "AES-CMAC RFC 4493 example 2");
+    check(SecureElementComputeAesCmac(NULL, msg, 64, F_NWK_S_INT_KEY, &mic) == SECURE_ELEMENT_SUCCESS &&
+          mic == 0xbfbef051, "AES-CMAC RFC 4493 example 4");
+    check(SecureElementVerifyAesCmac(msg, 64, 0xbfbef051, F_NWK_S_INT_KEY) == SECURE_ELEMENT_SUCCESS,
+          "AES-CMAC verify");
+
+    /* A new key must not be served from the old schedule */
+    SecureElementSetKey(F_NWK_S_INT_KEY, aes_key);
+    check(SecureElementComputeAesCmac(NULL, msg, 64, F_NWK_S_INT_KEY, &mic) == SECURE_ELEMENT_SUCCESS &&
+          mic != 0xbfbef051, "schedule invalidated by SecureElementSetKey");
+    SecureElementSetKey(F_NWK_S_INT_KEY, cmac_key);
+    check(SecureElementComputeAesCmac(NULL, msg, 64, F_NWK_S_INT_KEY, &mic) == SECURE_ELEMENT_SUCCESS &&
+          mic == 0xbfbef051, "schedule rebuilt after SecureElementSetKey");
+}
+
+static void check_ctr(void)
+{
+    uint8_t key[16];
+    for (int i = 0; i < 16; i++) {
+        key[i] = (uint8_t)(0x30 + i);
+    }
+    SecureElementSetKey(APP_S_KEY, key);
+
+    for (uint16_t size = 0; size <= 242; size++) {
+        uint8_t ref[242], out[242], a_ref[16] = { 0x01, 0, 0, 0, 0, 0, 0x11, 0x22, 0x33, 0x44, 0x2a, 0, 0, 0, 0, 0x01 };
+        uint8_t a_ctr[16];
+        for (uint16_t i = 0; i < size; i++) {
+            ref[i] = out[i] = (uint8_t)(i * 7 + size);
+        }
+        memcpy(a_ctr, a_ref, 16);
+
+        per_block_encrypt(key, a_ref, ref, size);
+        if (SecureElementAesCtrEncrypt(a_ctr, out, size, APP_S_KEY) != SECURE_ELEMENT_SUCCESS ||
+            memcmp(ref, out, size) != 0) {
+            fprintf(stderr, "size %u: ", size);
+            check(false, "CTR matches the per-block path");
+            return;
+        }
+        check(a_ctr[15] == 0x01, "counter block left unchanged");
+
+        SecureElementAesCtrEncrypt(a_ctr, out, size, APP_S_KEY);
+        for (uint16_t i = 0; i < size; i++) {
+            if (out[i] != (uint8_t)(i * 7 + size)) {
+                check(false, "CTR round trip");
+                return;
+            }
+        }
+    }
+}
+
+/* ---------------------------------------------------------- benchmark ---- */
+
+typedef struct {
+    double encrypt_old;     /* MB/s */
+    double encrypt_new;
+    double mic_old;
+    double mic_new;
+} bench_result_t;
+
+static double mb_per_s(uint64_t bytes, uint64_t ns)
+{
+    return ns ? (double)bytes * 1000.0 / (double)ns : 0.0;
+}
+
+static void keep_best(double *best, double value)
+{
+    if (value > *best) {
+        *best = value;
+    }
+}
+
+static void bench_frame(uint16_t size, int iterations, bench_result_t *res)
+{
+    uint8_t key[16], frame[242], a_block[16] = { 0x01 }, b0[16] = { 0x49 };
+    volatile uint32_t sink = 0;
+    uint64_t bytes = (uint64_t)size * iterations;
+
+    for (int i = 0; i < 16; i++) {
+        key[i] = (uint8_t)(0x51 * i);
+    }
+    for (uint16_t i = 0; i < size; i++) {
+        frame[i] = (uint8_t)i;
+    }
+    b0[15] = (uint8_t)size;
+    SecureElementSetKey(APP_S_KEY, key);
+    SecureElementSetKey(F_NWK_S_INT_KEY, key);
+    memset(res, 0, sizeof(*res));
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        uint64_t start = now_ns();
+        for (int n = 0; n < iterations; n++) {
+            a_block[15] = 0x01;
+            per_block_encrypt(key, a_block, frame, size);
+        }
+        keep_best(&res->encrypt_old, mb_per_s(bytes, now_ns() - start));
+
+        start = now_ns();
+        for (int n = 0; n < iterations; n++) {
+            a_block[15] = 0x01;
+            SecureElementAesCtrEncrypt(a_block, frame, size, APP_S_KEY);
+        }
+        keep_best(&res->encrypt_new, mb_per_s(bytes, now_ns() - start));
+
+        start = now_ns();
+        for (int n = 0; n < iterations; n++) {
+            sink += per_block_mic(key, b0, frame, size);
+        }
+        keep_best(&res->mic_old, mb_per_s(bytes, now_ns() - start));
+
+        start = now_ns();
+        for (int n = 0; n < iterations; n++) {
+            uint32_t mic;
+            SecureElementComputeAesCmac(b0, frame, size, F_NWK_S_INT_KEY, &mic);
+            sink += mic;
+        }
+        keep_best(&res->mic_new, mb_per_s(bytes, now_ns() - start));
+    }
+    (void)sink;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = BENCH_ITERATIONS_DEFAULT;
+    bool csv = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        }
+    }
+    if (iterations < 1 || iterations > BENCH_MAX_ITERATIONS) {
+        fprintf(stderr, "iterations must be 1..%d\n", BENCH_MAX_ITERATIONS);
+        return 2;
+    }
+
+    static SecureElementNvmData_t nvm;
+    if (SecureElementInit(&nvm) != SECURE_ELEMENT_SUCCESS) {
+        fprintf(stderr, "SecureElementInit failed\n");
+        return 1;
+    }
+
+    check_vectors();
+    check_ctr();
+
+    if (csv) {
+        printf("frame_bytes,encrypt_per_block_mbps,encrypt_cached_mbps,mic_per_block_mbps,mic_cached_mbps\n");
+    } else {
+        printf("%d iterations, best of %d rounds, MB/s\n", iterations, BENCH_ROUNDS);
+        printf("%-6s %12s %12s %8s %12s %12s %8s\n", "frame", "enc/block", "enc/cached", "speedup",
+               "mic/block", "mic/cached", "speedup");
+    }
+    for (size_t i = 0; i < sizeof(frame_sizes) / sizeof(frame_sizes[0]); i++) {
+        bench_result_t res;
+        bench_frame(frame_sizes[i], iterations, &res);
+        if (csv) {
+            printf("%u,%.2f,%.2f,%.2f,%.2f\n", frame_sizes[i], res.encrypt_old, res.encrypt_new,
+                   res.mic_old, res.mic_new);
+        } else {
+            printf("%-6u %12.2f %12.2f %7.2fx %12.2f %12.2f %7.2fx\n", frame_sizes[i],
+                   res.encrypt_old, res.encrypt_new, res.encrypt_new / res.encrypt_old,
+                   res.mic_old, res.mic_new, res.mic_new / res.mic_old);
+        }
+    }
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
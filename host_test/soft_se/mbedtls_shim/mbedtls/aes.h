@@ -0,0 +1,38 @@
+/*
+ * Host shim: mbedtls/aes.h
+ *
+ * The part of the mbedTLS AES API used by se-crypto-mbedtls.c, with the same
+ * semantics (CBC updates the IV, CTR carries across the whole 128-bit
+ * counter), on top of soft-se/aes.c. Used when the host has no mbedTLS
+ * development package.
+ */
+#ifndef HOST_SHIM_MBEDTLS_AES_H
+#define HOST_SHIM_MBEDTLS_AES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "soft-se/aes.h"  /* not this file */
+
+#define MBEDTLS_AES_ENCRYPT                     1
+#define MBEDTLS_AES_DECRYPT                     0
+#define MBEDTLS_ERR_AES_INVALID_KEY_LENGTH      -0x0020
+#define MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH    -0x0022
+#define MBEDTLS_ERR_AES_BAD_INPUT_DATA          -0x0021
+
+typedef struct {
+    aes_context ctx;
+    int has_key;
+} mbedtls_aes_context;
+
+void mbedtls_aes_init(mbedtls_aes_context *ctx);
+void mbedtls_aes_free(mbedtls_aes_context *ctx);
+int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits);
+int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx, int mode, const unsigned char input[16],
+                          unsigned char output[16]);
+int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx, int mode, size_t length, unsigned char iv[16],
+                          const unsigned char *input, unsigned char *output);
+int mbedtls_aes_crypt_ctr(mbedtls_aes_context *ctx, size_t length, size_t *nc_off,
+                          unsigned char nonce_counter[16], unsigned char stream_block[16],
+                          const unsigned char *input, unsigned char *output);
+
+#endif
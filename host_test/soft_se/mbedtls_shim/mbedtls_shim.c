@@ -0,0 +1,84 @@
+/*
+ * Host shim: mbedTLS AES on soft-se/aes.c, see mbedtls_shim/mbedtls/aes.h
+ */
+#include <string.h>
+#include "mbedtls/aes.h"
+
+void mbedtls_aes_init(mbedtls_aes_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_aes_free(mbedtls_aes_context *ctx)
+{
+    if (ctx) {
+        memset(ctx, 0, sizeof(*ctx));
+    }
+}
+
+int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits)
+{
+    if (keybits != 128 && keybits != 192 && keybits != 256) {
+        return MBEDTLS_ERR_AES_INVALID_KEY_LENGTH;
+    }
+    if (aes_set_key(key, (uint8_t)(keybits / 8), &ctx->ctx) != 0) {
+        return MBEDTLS_ERR_AES_INVALID_KEY_LENGTH;
+    }
+    ctx->has_key = 1;
+    return 0;
+}
+
+int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx, int mode, const unsigned char input[16],
+                          unsigned char output[16])
+{
+    if (mode != MBEDTLS_AES_ENCRYPT || !ctx->has_key) {
+        return MBEDTLS_ERR_AES_BAD_INPUT_DATA;
+    }
+    lorawan_aes_encrypt(input, output, &ctx->ctx);
+    return 0;
+}
+
+int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx, int mode, size_t length, unsigned char iv[16],
+                          const unsigned char *input, unsigned char *output)
+{
+    if (length % 16) {
+        return MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH;
+    }
+    if (mode != MBEDTLS_AES_ENCRYPT || !ctx->has_key) {
+        return MBEDTLS_ERR_AES_BAD_INPUT_DATA;
+    }
+    for (size_t off = 0; off < length; off += 16) {
+        unsigned char block[16];
+        for (int i = 0; i < 16; i++) {
+            block[i] = input[off + i] ^ iv[i];
+        }
+        lorawan_aes_encrypt(block, &output[off], &ctx->ctx);
+        memcpy(iv, &output[off], 16);
+    }
+    return 0;
+}
+
+int mbedtls_aes_crypt_ctr(mbedtls_aes_context *ctx, size_t length, size_t *nc_off,
+                          unsigned char nonce_counter[16], unsigned char stream_block[16],
+                          const unsigned char *input, unsigned char *output)
+{
+    size_t n = *nc_off;
+
+    if (n > 15 || !ctx->has_key) {
+        return MBEDTLS_ERR_AES_BAD_INPUT_DATA;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (n == 0) {
+            lorawan_aes_encrypt(nonce_counter, stream_block, &ctx->ctx);
+            for (int j = 15; j >= 0; j--) {
+                if (++nonce_counter[j] != 0) {
+                    break;
+                }
+            }
+        }
+        output[i] = input[i] ^ stream_block[n];
+        n = (n + 1) & 0x0f;
+    }
+    *nc_off = n;
+    return 0;
+}
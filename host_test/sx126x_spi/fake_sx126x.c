@@ -0,0 +1,476 @@
+/*
+ * SX126x, TCA9535 and SPI master fakes, see fake_sx126x.h.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_rom_sys.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "bsp_io_expander.h"
+#include "fake_sx126x.h"
+
+#define PIN_NSS                 0
+#define PIN_BUSY                2
+#define PIN_VER                 11
+
+#define I2C_SCL_HZ              400000.0
+/* TCA9535 16-bit register write: START, address, register, 2 bytes, STOP */
+#define I2C_WRITE_CLOCKS        (1 + 4 * 9 + 1)
+/* 16-bit register read: START, address, register, repeated START, address, 2 bytes, STOP */
+#define I2C_READ_CLOCKS         (1 + 2 * 9 + 1 + 3 * 9 + 1)
+
+#define OP_WRITE_REGISTER       0x0D
+#define OP_WRITE_BUFFER         0x0E
+#define OP_READ_REGISTER        0x1D
+#define OP_READ_BUFFER          0x1E
+#define OP_SET_STANDBY          0x80
+#define OP_SET_RX               0x82
+#define OP_SET_TX               0x83
+#define OP_SET_SLEEP            0x84
+#define OP_CALIBRATE            0x89
+#define OP_CALIBRATE_IMAGE      0x98
+#define OP_GET_STATUS           0xC0
+#define OP_SET_FS               0xC1
+#define OP_SET_CAD              0xC5
+
+/* Assumed BUSY time after waking from sleep, [us] */
+#define WAKEUP_BUSY_US          400
+
+#define ISR_MAX                 4
+#define SEMAPHORES_MAX          8
+
+double fake_now_us;
+fake_bus_stats_t fake_bus;
+fake_latency_t fake_busy_latency;
+double fake_spi_overhead_us;
+double fake_spi_polling_overhead_us;
+double fake_i2c_overhead_us;
+double fake_wake_overhead_us;
+
+uint8_t fake_sx126x_buffer[256];
+uint8_t fake_sx126x_registers[0x10000];
+
+static bool nss_low;
+static double spi_clock_hz = 2000000.0;
+static fake_frame_t frame;
+static fake_frame_t last_frame;
+static double set_tx_us = -1;
+
+static bool sleeping;
+static bool busy;
+static double busy_until_us;
+static bool command_unseen;         /* no read has shown BUSY low since the last command */
+static double command_end_us;
+
+static uint16_t last_read_pins;
+static bool int_low;
+static bsp_io_expander_isr_t isr_tab[ISR_MAX];
+static void *isr_arg[ISR_MAX];
+static int isr_num;
+
+void fake_bus_reset_stats(void)
+{
+    memset(&fake_bus, 0, sizeof(fake_bus));
+    memset(&fake_busy_latency, 0, sizeof(fake_busy_latency));
+    set_tx_us = -1;
+}
+
+const fake_frame_t *fake_sx126x_last_frame(void)
+{
+    return &last_frame;
+}
+
+double fake_sx126x_set_tx_us(void)
+{
+    return set_tx_us;
+}
+
+bool fake_sx126x_busy(void)
+{
+    return busy;
+}
+
+uint8_t fake_sx126x_reply(uint8_t opcode, int n)
+{
+    return (uint8_t)(opcode * 7 + n * 31 + 1);
+}
+
+/* --------------------------------------------------- pins, INT and time ---- */
+
+static uint16_t input_pins(void)
+{
+    /* DIO1 low, TCXO fitted */
+    return (uint16_t)((busy ? 1u << PIN_BUSY : 0) | 1u << PIN_VER);
+}
+
+/* An input changed: INT goes low unless it already is */
+static void update_int(void)
+{
+    if (!int_low && input_pins() != last_read_pins) {
+        int_low = true;
+        fake_bus.int_edges++;
+        for (int i = 0; i < isr_num; i++) {
+            isr_tab[i](isr_arg[i]);
+        }
+    }
+}
+
+static void set_busy(bool level)
+{
+    busy = level;
+    update_int();
+}
+
+/* Moves the clock to until_us, dropping BUSY on the way if it is due */
+static void advance_to(double until_us)
+{
+    if (busy && !sleeping && busy_until_us <= until_us) {
+        if (busy_until_us > fake_now_us) {
+            fake_now_us = busy_until_us;
+        }
+        set_busy(false);
+    }
+    if (until_us > fake_now_us) {
+        fake_now_us = until_us;
+    }
+}
+
+static void advance(double us)
+{
+    advance_to(fake_now_us + us);
+}
+
+/* ------------------------------------------------------------- device ---- */
+
+/*
+ * Assumed BUSY time after each command, [us]. Simple commands release BUSY
+ * within microseconds, mode changes take longer and calibrations longest.
+ */
+static double busy_time_us(uint8_t opcode)
+{
+    switch (opcode) {
+    case OP_CALIBRATE:
+        return 3500;
+    case OP_CALIBRATE_IMAGE:
+        return 1000;
+    case OP_SET_TX:
+    case OP_SET_RX:
+    case OP_SET_FS:
+    case OP_SET_CAD:
+        return 60;
+    case OP_SET_STANDBY:
+        return 20;
+    default:
+        return 4;
+    }
+}
+
+static bool is_get_command(uint8_t opcode)
+{
+    return opcode == OP_GET_STATUS || (opcode >= 0x10 && opcode <= 0x17);
+}
+
+/* What the device drives on MISO while byte n of the current frame goes out */
+static uint8_t device_miso(int n)
+{
+    uint8_t opcode = frame.mosi[0];
+
+    if (n == 0) {
+        return FAKE_SX126X_STATUS;
+    }
+    if (opcode == OP_READ_BUFFER && n >= 3) {
+        return fake_sx126x_buffer[(frame.mosi[1] + n - 3) & 0xff];
+    }
+    if (opcode == OP_READ_REGISTER && n >= 4) {
+        uint16_t address = (uint16_t)((frame.mosi[1] << 8) | frame.mosi[2]);
+        return fake_sx126x_registers[(uint16_t)(address + n - 4)];
+    }
+    if (is_get_command(opcode) && n >= 2) {
+        return fake_sx126x_reply(opcode, n - 2);
+    }
+    return FAKE_SX126X_STATUS;
+}
+
+/* NSS went high: run the command */
+static void device_execute(void)
+{
+    uint8_t opcode = frame.mosi[0];
+
+    if (frame.length == 0) {
+        return;
+    }
+    if (opcode == OP_WRITE_BUFFER && frame.length >= 2) {
+        for (int i = 2; i < frame.length; i++) {
+            fake_sx126x_buffer[(frame.mosi[1] + i - 2) & 0xff] = frame.mosi[i];
+        }
+    } else if (opcode == OP_WRITE_REGISTER && frame.length >= 3) {
+        uint16_t address = (uint16_t)((frame.mosi[1] << 8) | frame.mosi[2]);
+        for (int i = 3; i < frame.length; i++) {
+            fake_sx126x_registers[(uint16_t)(address + i - 3)] = frame.mosi[i];
+        }
+    } else if (opcode == OP_SET_TX) {
+        set_tx_us = fake_now_us;
+    }
+    fake_bus.frames++;
+    if (frame.transactions > 1) {
+        fake_bus.split_frames++;
+    }
+    frame.end_us = fake_now_us;
+    last_frame = frame;
+
+    if (opcode == OP_SET_SLEEP) {
+        sleeping = true;
+        command_unseen = false;
+        set_busy(true);
+        return;
+    }
+    command_unseen = true;
+    command_end_us = fake_now_us;
+    /* A command sent to wake the device does not shorten the wakeup */
+    if (!busy || busy_until_us < fake_now_us + busy_time_us(opcode)) {
+        busy_until_us = fake_now_us + busy_time_us(opcode);
+    }
+    if (!busy) {
+        set_busy(true);
+    }
+}
+
+/* A port read showed BUSY low: the last command is ready */
+static void busy_seen_low(void)
+{
+    double us = fake_now_us - command_end_us;
+    int bucket = 0;
+
+    command_unseen = false;
+    while (bucket < FAKE_LATENCY_BUCKETS - 1 && us >= (64 << bucket)) {
+        bucket++;
+    }
+    fake_busy_latency.count++;
+    fake_busy_latency.sum_us += us;
+    if (us > fake_busy_latency.max_us) {
+        fake_busy_latency.max_us = us;
+    }
+    fake_busy_latency.histogram[bucket]++;
+}
+
+/* ----------------------------------------------------------- expander ---- */
+
+static esp_err_t expander_init(uint8_t i2c_addr)
+{
+    (void)i2c_addr;
+    return ESP_OK;
+}
+
+static esp_err_t expander_write(void)
+{
+    fake_bus.i2c_writes++;
+    advance(I2C_WRITE_CLOCKS * 1e6 / I2C_SCL_HZ + fake_i2c_overhead_us);
+    return ESP_OK;
+}
+
+static esp_err_t expander_set_direction(uint8_t pin, bool is_output)
+{
+    (void)pin;
+    (void)is_output;
+    return expander_write();
+}
+
+static esp_err_t expander_set_level(uint8_t pin, bool level)
+{
+    esp_err_t ret = expander_write();
+
+    /* The new level shows on the pin at the end of the I2C write */
+    if (pin == PIN_NSS) {
+        if (!level && !nss_low) {
+            if (busy && !sleeping) {
+                fake_bus.busy_frames++;
+            }
+            memset(&frame, 0, sizeof(frame));
+            if (sleeping) {
+                sleeping = false;
+                busy_until_us = fake_now_us + WAKEUP_BUSY_US;
+            }
+        } else if (level && nss_low) {
+            device_execute();
+        }
+        nss_low = !level;
+    }
+    return ret;
+}
+
+/* The port is sampled at the end of the read, which also releases INT */
+static esp_err_t expander_read_input_pins(uint16_t *pin_val)
+{
+    fake_bus.i2c_reads++;
+    advance(I2C_READ_CLOCKS * 1e6 / I2C_SCL_HZ + fake_i2c_overhead_us);
+    *pin_val = input_pins();
+    last_read_pins = *pin_val;
+    int_low = false;
+    if (command_unseen && !busy) {
+        busy_seen_low();
+    }
+    return ESP_OK;
+}
+
+io_expander_ops_t fake_expander_ops = {
+    .init = expander_init,
+    .set_direction = expander_set_direction,
+    .set_level = expander_set_level,
+    .read_input_pins = expander_read_input_pins,
+};
+
+esp_err_t bsp_io_expander_isr_add(bsp_io_expander_isr_t isr, void *arg)
+{
+    if (isr_num >= ISR_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+    isr_tab[isr_num] = isr;
+    isr_arg[isr_num] = arg;
+    isr_num++;
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------- SPI master ---- */
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, int dma_chan)
+{
+    (void)host_id;
+    (void)bus_config;
+    (void)dma_chan;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config,
+                             spi_device_handle_t *handle)
+{
+    (void)host_id;
+    spi_clock_hz = dev_config->clock_speed_hz;
+    *handle = (spi_device_handle_t)&spi_clock_hz;
+    return ESP_OK;
+}
+
+static esp_err_t spi_transfer(spi_transaction_t *trans, double overhead_us)
+{
+    size_t bytes = trans->length / 8;
+    const uint8_t *tx = trans->tx_buffer;
+    uint8_t *rx = trans->rx_buffer;
+
+    if (!nss_low) {
+        fake_bus.spi_without_nss++;
+    }
+    frame.transactions++;
+    for (size_t i = 0; i < bytes; i++) {
+        uint8_t mosi = (tx != NULL) ? tx[i] : 0x00;
+        uint8_t miso;
+
+        if (frame.length >= FAKE_FRAME_MAX) {
+            fprintf(stderr, "frame too long\n");
+            return ESP_FAIL;
+        }
+        frame.mosi[frame.length] = mosi;
+        miso = device_miso(frame.length);
+        frame.miso[frame.length] = miso;
+        frame.length++;
+        if (rx != NULL) {
+            rx[i] = miso;
+        }
+    }
+    fake_bus.spi_transactions++;
+    fake_bus.spi_bytes += bytes;
+    advance(trans->length * 1e6 / spi_clock_hz + overhead_us);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    (void)handle;
+    return spi_transfer(trans_desc, fake_spi_overhead_us);
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    (void)handle;
+    fake_bus.spi_polled++;
+    return spi_transfer(trans_desc, fake_spi_polling_overhead_us);
+}
+
+/* ------------------------------------------------- delays, semaphores ---- */
+
+void esp_rom_delay_us(uint32_t us)
+{
+    advance(us);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    advance(ticks * 1000.0 * portTICK_PERIOD_MS);
+}
+
+typedef struct {
+    bool binary;
+    bool given;
+} fake_semaphore_t;
+
+static fake_semaphore_t semaphores[SEMAPHORES_MAX];
+static int semaphore_num;
+
+static SemaphoreHandle_t semaphore_create(bool binary)
+{
+    fake_semaphore_t *sem = &semaphores[semaphore_num++];
+
+    sem->binary = binary;
+    sem->given = !binary;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return semaphore_create(false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return semaphore_create(true);
+}
+
+/* Mutexes are never contended; a binary semaphore waits for the next give */
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t ticks_to_wait)
+{
+    fake_semaphore_t *sem = handle;
+
+    if (!sem->binary) {
+        return pdTRUE;
+    }
+    if (!sem->given && ticks_to_wait > 0) {
+        double deadline = fake_now_us + ticks_to_wait * 1000.0 * portTICK_PERIOD_MS;
+
+        /* Only the device's BUSY edge can give it while the task sleeps */
+        advance_to(deadline < busy_until_us || sleeping ? deadline : busy_until_us);
+        if (sem->given) {
+            advance(fake_wake_overhead_us);
+        } else {
+            advance_to(deadline);
+        }
+    }
+    if (sem->given) {
+        sem->given = false;
+        return pdTRUE;
+    }
+    return pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle)
+{
+    fake_semaphore_t *sem = handle;
+
+    sem->given = true;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t handle, BaseType_t *higher_priority_task_woken)
+{
+    if (higher_priority_task_woken != NULL) {
+        *higher_priority_task_woken = pdTRUE;
+    }
+    return xSemaphoreGive(handle);
+}
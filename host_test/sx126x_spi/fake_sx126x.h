@@ -0,0 +1,93 @@
+/*
+ * SX126x on the SenseCAP Indicator SPI bus, for host tests.
+ *
+ * The radio's NSS, BUSY and DIO1 lines sit on the TCA9535 IO expander, which
+ * is reached over I2C; SCK, MOSI and MISO go to the ESP32-S3 SPI3 host. The
+ * fake provides both (io_expander_ops_t and the spi_master functions) and a
+ * device that decodes every NSS frame into a command: buffer and register
+ * accesses hit a RAM model, Get* commands return fixed replies.
+ *
+ * After each command BUSY stays high for an assumed time per opcode, and
+ * during sleep until NSS wakes the device. Like the TCA9535, any change of an
+ * input against the last port read pulls INT low and calls the handlers added
+ * with bsp_io_expander_isr_add(). Binary semaphores given from there wake a
+ * xSemaphoreTake() that waits in virtual time.
+ *
+ * Time is virtual. Each bus access advances it by its wire time: SPI bits at
+ * the device's clock, and TCA9535 register accesses at 400 kHz SCL (9 clocks
+ * per byte plus START/STOP). Driver overheads are zero unless set, so the
+ * figures are a lower bound for the device.
+ */
+#ifndef FAKE_SX126X_H
+#define FAKE_SX126X_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "bsp_board.h"
+
+#define FAKE_FRAME_MAX          512
+#define FAKE_LATENCY_BUCKETS    10      /* bucket i: below 64 us << i */
+
+typedef struct {
+    uint32_t spi_transactions;
+    uint32_t spi_polled;
+    uint32_t spi_bytes;
+    uint32_t i2c_writes;
+    uint32_t i2c_reads;
+    uint32_t frames;
+    uint32_t split_frames;          /* frames moved in more than one transaction */
+    uint32_t spi_without_nss;       /* transactions while NSS was high */
+    uint32_t int_edges;             /* expander INT assertions */
+    uint32_t busy_frames;           /* frames started while the awake device was BUSY */
+} fake_bus_stats_t;
+
+/* From the end of a command to the first port read that shows BUSY low */
+typedef struct {
+    uint32_t count;
+    double max_us;
+    double sum_us;
+    uint32_t histogram[FAKE_LATENCY_BUCKETS];
+} fake_latency_t;
+
+typedef struct {
+    uint8_t mosi[FAKE_FRAME_MAX];
+    uint8_t miso[FAKE_FRAME_MAX];
+    uint16_t length;
+    uint16_t transactions;
+    double end_us;                  /* when NSS went high */
+} fake_frame_t;
+
+extern double fake_now_us;
+extern fake_bus_stats_t fake_bus;
+extern fake_latency_t fake_busy_latency;
+extern io_expander_ops_t fake_expander_ops;
+
+/* Driver overheads added per call, [us] (0 by default) */
+extern double fake_spi_overhead_us;
+extern double fake_spi_polling_overhead_us;
+extern double fake_i2c_overhead_us;
+/* From a semaphore give to the waiting task running again, [us] (0 by default) */
+extern double fake_wake_overhead_us;
+
+extern uint8_t fake_sx126x_buffer[256];
+extern uint8_t fake_sx126x_registers[0x10000];
+
+/* Clears fake_bus and fake_busy_latency */
+void fake_bus_reset_stats(void);
+
+/* Last complete NSS frame */
+const fake_frame_t *fake_sx126x_last_frame(void);
+
+/* End of the last SetTx frame, -1 if none since the last reset */
+double fake_sx126x_set_tx_us(void);
+
+/* Level of the BUSY line now */
+bool fake_sx126x_busy(void);
+
+/* Reply byte n of a Get* command with the given opcode */
+uint8_t fake_sx126x_reply(uint8_t opcode, int n);
+
+/* Status byte returned while the NOP after an opcode goes out */
+#define FAKE_SX126X_STATUS      0x22
+
+#endif
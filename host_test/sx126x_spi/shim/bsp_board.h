@@ -0,0 +1,38 @@
+/*
+ * Host shim: bsp_board.h, the parts the radio board files use
+ */
+#ifndef HOST_SHIM_SX126X_BSP_BOARD_H
+#define HOST_SHIM_SX126X_BSP_BOARD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+
+/* The TCA9535 behind these fills 16 bits of pin levels */
+typedef struct {
+    esp_err_t (*init)(uint8_t i2c_addr);
+    esp_err_t (*set_direction)(uint8_t pin, bool is_output);
+    esp_err_t (*set_level)(uint8_t pin, bool level);
+    esp_err_t (*read_output_pins)(uint16_t *pin_val);
+    esp_err_t (*read_input_pins)(uint16_t *pin_val);
+    esp_err_t (*multi_write_start)(void);
+    esp_err_t (*multi_write_new_level)(int pin, bool new_level);
+    esp_err_t (*multi_write_end)(void);
+} io_expander_ops_t;
+
+typedef struct {
+    int GPIO_SPI_CS;
+    int GPIO_SPI_MISO;
+    int GPIO_SPI_MOSI;
+    int GPIO_SPI_SCLK;
+    io_expander_ops_t *io_expander_ops;
+} board_res_desc_t;
+
+board_res_desc_t *bsp_board_get_description(void);
+
+#endif
@@ -0,0 +1,9 @@
+/*
+ * Host shim: bsp_i2c.h (the expander is reached through io_expander_ops_t)
+ */
+#ifndef HOST_SHIM_SX126X_BSP_I2C_H
+#define HOST_SHIM_SX126X_BSP_I2C_H
+
+#include "bsp_board.h"
+
+#endif
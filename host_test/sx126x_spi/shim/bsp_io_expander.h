@@ -0,0 +1,13 @@
+/*
+ * Host shim: bsp_io_expander.h
+ */
+#ifndef HOST_SHIM_SX126X_BSP_IO_EXPANDER_H
+#define HOST_SHIM_SX126X_BSP_IO_EXPANDER_H
+
+#include "esp_err.h"
+
+typedef void (*bsp_io_expander_isr_t)(void *arg);
+
+esp_err_t bsp_io_expander_isr_add(bsp_io_expander_isr_t isr, void *arg);
+
+#endif
@@ -0,0 +1,451 @@
+/*
+ * SX126x SPI test for the LoRaWAN radio driver.
+ *
+ * Builds components/lora (sx126x_sensecap_board.c, sx126x.c, radio.c and
+ * timer.c) unchanged against the fake bus in fake_sx126x.c and checks:
+ *
+ *   - every command is one SPI transaction inside one NSS frame;
+ *   - the bytes on the wire for buffer, register and command accesses;
+ *   - data read back from the buffer and registers, Get* replies and the
+ *     status byte;
+ *   - SX126xWaitOnBusy returns only once BUSY is low, after mode changes,
+ *     calibration and wakeup from sleep too, and counts each wait in
+ *     SX126xGetBusyLatency().
+ *
+ * It then reports the bus cost of a 255 byte WriteBuffer and ReadBuffer, and
+ * of Radio.Send of a 255 byte frame up to the end of SetTx: SPI transactions,
+ * expander I2C accesses and the wire time. Driver overheads per call can be
+ * added to the wire time to match what is measured on the device. The
+ * distribution of the delay from the end of a command to SX126xWaitOnBusy
+ * seeing BUSY low follows, with the expander reads per wait.
+ *
+ * Usage: test_sx126x_board [-n operations] [--spi-overhead us]
+ *        [--polling-overhead us] [--i2c-overhead us] [--wake-overhead us]
+ *        [--csv]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "bsp_io_expander.h"
+#include "radio.h"
+#include "sx126x.h"
+#include "sx126x-board.h"
+#include "fake_sx126x.h"
+
+#define TEST_OPERATIONS_DEFAULT 20000
+
+esp_log_level_t host_log_level = ESP_LOG_WARN;
+
+static int failures = 0;
+
+/* -------------------------------------------------------- board and OS ---- */
+
+static board_res_desc_t board = {
+    .GPIO_SPI_MISO = GPIO_NUM_47,
+    .GPIO_SPI_MOSI = GPIO_NUM_48,
+    .GPIO_SPI_SCLK = GPIO_NUM_41,
+    .io_expander_ops = &fake_expander_ops,
+};
+
+board_res_desc_t *bsp_board_get_description(void)
+{
+    return &board;
+}
+
+/* The IRQ task is not run: DIO1 stays low in this test */
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_depth,
+                       void *params, UBaseType_t priority, TaskHandle_t *created_task)
+{
+    (void)task;
+    (void)name;
+    (void)stack_depth;
+    (void)params;
+    (void)priority;
+    (void)created_task;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    (void)task;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t queue_length, UBaseType_t item_size)
+{
+    (void)queue_length;
+    (void)item_size;
+    return (QueueHandle_t)1;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higher_priority_task_woken)
+{
+    (void)queue;
+    (void)item;
+    (void)higher_priority_task_woken;
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticks_to_wait)
+{
+    (void)queue;
+    (void)buffer;
+    (void)ticks_to_wait;
+    return pdFALSE;
+}
+
+/* Radio timers are started but never expire here */
+struct esp_timer {
+    int unused;
+};
+
+static struct esp_timer hw;
+
+int64_t esp_timer_get_time(void)
+{
+    return (int64_t)fake_now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    (void)create_args;
+    *out_handle = &hw;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    (void)timer;
+    (void)timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    (void)timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    (void)timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    (void)timer;
+    return false;
+}
+
+/* --------------------------------------------------------------- checks ---- */
+
+static uint32_t rng_state = 0x1b873593;
+
+static uint32_t rnd32(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        if (failures < 10) {
+            fprintf(stderr, "FAIL: %s\n", what);
+        }
+        failures++;
+    }
+}
+
+/* The last frame is header followed by data, moved in one transaction */
+static void check_frame(uint32_t frames_before, const uint8_t *header, int header_len,
+                        const uint8_t *data, int data_len, const char *what)
+{
+    const fake_frame_t *f = fake_sx126x_last_frame();
+
+    check(fake_bus.frames == frames_before + 1, what);
+    check(f->transactions == 1, what);
+    check(f->length == header_len + data_len, what);
+    check(memcmp(f->mosi, header, header_len) == 0, what);
+    if (data != NULL) {
+        check(memcmp(f->mosi + header_len, data, data_len) == 0, what);
+    }
+}
+
+static void random_bytes(uint8_t *data, int len)
+{
+    for (int i = 0; i < len; i++) {
+        data[i] = (uint8_t)rnd32();
+    }
+}
+
+static uint8_t model_buffer[256];
+
+static void random_op(void)
+{
+    uint8_t data[256];
+    uint8_t read[256];
+    uint8_t header[4];
+    uint32_t frames = fake_bus.frames;
+
+    switch (rnd32() % 7) {
+    case 0: {
+        uint8_t offset = (uint8_t)rnd32();
+        uint8_t size = (uint8_t)(1 + rnd32() % 255);
+
+        random_bytes(data, size);
+        SX126xWriteBuffer(offset, data, size);
+        for (int i = 0; i < size; i++) {
+            model_buffer[(offset + i) & 0xff] = data[i];
+        }
+        header[0] = RADIO_WRITE_BUFFER;
+        header[1] = offset;
+        check_frame(frames, header, 2, data, size, "WriteBuffer frame");
+        break;
+    }
+    case 1: {
+        uint8_t offset = (uint8_t)rnd32();
+        uint8_t size = (uint8_t)(1 + rnd32() % 255);
+
+        SX126xReadBuffer(offset, read, size);
+        for (int i = 0; i < size; i++) {
+            check(read[i] == model_buffer[(offset + i) & 0xff], "ReadBuffer data");
+        }
+        header[0] = RADIO_READ_BUFFER;
+        header[1] = offset;
+        header[2] = 0;
+        check_frame(frames, header, 3, NULL, size, "ReadBuffer frame");
+        break;
+    }
+    case 2: {
+        /* A scratch area well away from the registers radio.c sets up */
+        uint16_t address = (uint16_t)(0x4000 + rnd32() % 0x1000);
+        uint16_t size = (uint16_t)(1 + rnd32() % 16);
+
+        random_bytes(data, size);
+        SX126xWriteRegisters(address, data, size);
+        header[0] = RADIO_WRITE_REGISTER;
+        header[1] = address >> 8;
+        header[2] = address & 0xff;
+        check_frame(frames, header, 3, data, size, "WriteRegisters frame");
+
+        frames = fake_bus.frames;
+        SX126xReadRegisters(address, read, size);
+        check(memcmp(read, data, size) == 0, "ReadRegisters data");
+        header[0] = RADIO_READ_REGISTER;
+        header[3] = 0;
+        check_frame(frames, header, 4, NULL, size, "ReadRegisters frame");
+        break;
+    }
+    case 3: {
+        static const RadioCommands_t gets[] = {
+            RADIO_GET_IRQSTATUS, RADIO_GET_RXBUFFERSTATUS, RADIO_GET_PACKETSTATUS, RADIO_GET_ERROR,
+        };
+        RadioCommands_t command = gets[rnd32() % 4];
+        uint16_t size = (uint16_t)(1 + rnd32() % 3);
+        uint8_t status = SX126xReadCommand(command, read, size);
+
+        check(status == FAKE_SX126X_STATUS, "ReadCommand status");
+        for (int i = 0; i < size; i++) {
+            check(read[i] == fake_sx126x_reply(command, i), "ReadCommand reply");
+        }
+        header[0] = command;
+        header[1] = 0;
+        check_frame(frames, header, 2, NULL, size, "ReadCommand frame");
+        break;
+    }
+    case 4: {
+        /* Mode changes and calibration keep BUSY high for longer */
+        switch (rnd32() % 4) {
+        case 0:
+            SX126xSetStandby(STDBY_RC);
+            header[0] = RADIO_SET_STANDBY;
+            break;
+        case 1:
+            SX126xSetTx(0);
+            header[0] = RADIO_SET_TX;
+            break;
+        case 2:
+            SX126xSetRx(0);
+            header[0] = RADIO_SET_RX;
+            break;
+        default:
+            SX126xCalibrateImage(868000000);
+            header[0] = RADIO_CALIBRATEIMAGE;
+            break;
+        }
+        check(fake_sx126x_last_frame()->mosi[0] == header[0], "mode command sent");
+        check(!fake_sx126x_busy(), "BUSY low after mode command");
+        SX126xSetStandby(STDBY_RC);
+        break;
+    }
+    case 5: {
+        /* Cold sleep, then the next command wakes the device */
+        SleepParams_t params = { 0 };
+
+        SX126xSetSleep(params);
+        check(fake_sx126x_last_frame()->mosi[0] == RADIO_SET_SLEEP, "SetSleep sent");
+        SX126xSetStandby(STDBY_RC);
+        check(fake_sx126x_last_frame()->mosi[0] == RADIO_SET_STANDBY, "SetStandby after wakeup");
+        check(!fake_sx126x_busy(), "BUSY low after wakeup");
+        break;
+    }
+    default: {
+        /* SetRfFrequency with a random value */
+        random_bytes(data, 4);
+        SX126xWriteCommand(RADIO_SET_RFFREQUENCY, data, 4);
+        header[0] = RADIO_SET_RFFREQUENCY;
+        check_frame(frames, header, 1, data, 4, "WriteCommand frame");
+        break;
+    }
+    }
+}
+
+/* ---------------------------------------------------------------- bench ---- */
+
+static bool csv;
+
+static void report(const char *name, double start_us, double end_us)
+{
+    if (csv) {
+        printf("%s,%u,%u,%u,%u,%.1f\n", name, fake_bus.spi_transactions, fake_bus.spi_bytes,
+               fake_bus.i2c_writes, fake_bus.i2c_reads, end_us - start_us);
+    } else {
+        printf("%-22s %6u %8u %6u %6u %10.1f\n", name, fake_bus.spi_transactions, fake_bus.spi_bytes,
+               fake_bus.i2c_writes, fake_bus.i2c_reads, end_us - start_us);
+    }
+}
+
+static void bench(void)
+{
+    uint8_t data[255];
+    double start;
+
+    random_bytes(data, sizeof(data));
+    if (csv) {
+        printf("operation,spi_transactions,spi_bytes,i2c_writes,i2c_reads,us\n");
+    } else {
+        printf("%-22s %6s %8s %6s %6s %10s\n", "operation", "spi", "bytes", "i2c wr", "i2c rd", "time [us]");
+    }
+
+    fake_bus_reset_stats();
+    start = fake_now_us;
+    SX126xWriteBuffer(0, data, sizeof(data));
+    report("WriteBuffer 255", start, fake_now_us);
+
+    fake_bus_reset_stats();
+    start = fake_now_us;
+    SX126xReadBuffer(0, data, sizeof(data));
+    report("ReadBuffer 255", start, fake_now_us);
+
+    /* EU868 SF7/125 kHz, as LoRaMac configures it before each uplink */
+    Radio.SetChannel(868100000);
+    Radio.SetTxConfig(MODEM_LORA, 14, 0, 0, 7, 1, 8, false, true, 0, 0, false, 4000);
+    fake_bus_reset_stats();
+    start = fake_now_us;
+    Radio.Send(data, sizeof(data));
+    check(fake_sx126x_set_tx_us() >= 0, "Radio.Send issued SetTx");
+    report("Radio.Send 255 to SetTx", start, fake_sx126x_set_tx_us());
+}
+
+/*
+ * Runs the random operations again and prints how long each command kept
+ * SX126xWaitOnBusy waiting. The driver's own statistics must agree.
+ */
+static void bench_busy(uint32_t operations)
+{
+    SX126xLatency_t before;
+    SX126xLatency_t after;
+    uint32_t waits;
+
+    /* bench() wrote the buffer behind the model's back */
+    memcpy(model_buffer, fake_sx126x_buffer, sizeof(model_buffer));
+    SX126xGetBusyLatency(&before);
+    fake_bus_reset_stats();
+    for (uint32_t n = 0; n < operations; n++) {
+        random_op();
+    }
+    SX126xGetBusyLatency(&after);
+    waits = after.Count - before.Count;
+    check(waits == fake_busy_latency.count, "busy waits counted by the driver");
+    check(after.MaxUs >= (uint32_t)fake_busy_latency.max_us, "longest busy wait");
+    for (int i = 0; i < SX126X_LATENCY_BUCKETS; i++) {
+        check(after.Histogram[i] - before.Histogram[i] == fake_busy_latency.histogram[i], "busy wait histogram");
+    }
+    if (waits == 0) {
+        return;
+    }
+
+    if (csv) {
+        printf("\nbusy_below_us,waits\n");
+    } else {
+        printf("\n%u commands, %u expander reads, %u INT edges\n", fake_bus.frames, fake_bus.i2c_reads,
+               fake_bus.int_edges);
+        printf("command end to BUSY seen low: mean %.1f us, max %.1f us\n", fake_busy_latency.sum_us / waits,
+               fake_busy_latency.max_us);
+        printf("%-10s %8s\n", "below [us]", "waits");
+    }
+    for (int i = 0; i < SX126X_LATENCY_BUCKETS; i++) {
+        uint32_t count = fake_busy_latency.histogram[i];
+
+        char below[16];
+
+        if (i == SX126X_LATENCY_BUCKETS - 1) {
+            snprintf(below, sizeof(below), "inf");
+        } else {
+            snprintf(below, sizeof(below), "%u", 64u << i);
+        }
+        printf(csv ? "%s,%u\n" : "%-10s %8u\n", below, count);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static RadioEvents_t events;
+    uint32_t operations = TEST_OPERATIONS_DEFAULT;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            operations = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--spi-overhead") == 0 && i + 1 < argc) {
+            fake_spi_overhead_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--polling-overhead") == 0 && i + 1 < argc) {
+            fake_spi_polling_overhead_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--i2c-overhead") == 0 && i + 1 < argc) {
+            fake_i2c_overhead_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--wake-overhead") == 0 && i + 1 < argc) {
+            fake_wake_overhead_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        }
+    }
+
+    bsp_sx126x_init();
+    Radio.Init(&events);
+    memcpy(model_buffer, fake_sx126x_buffer, sizeof(model_buffer));
+
+    fake_bus_reset_stats();
+    for (uint32_t n = 0; n < operations; n++) {
+        random_op();
+    }
+    check(fake_bus.split_frames == 0, "command split over several transactions");
+    check(fake_bus.spi_without_nss == 0, "SPI transaction with NSS high");
+    check(fake_bus.busy_frames == 0, "command sent while BUSY was high");
+    if (!csv) {
+        printf("%u operations, %u frames\n\n", operations, fake_bus.frames);
+    }
+
+    bench();
+    bench_busy(operations / 10);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
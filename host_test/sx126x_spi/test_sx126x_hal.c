@@ -0,0 +1,286 @@
+/*
+ * SX126x SPI test for the LoRa hub radio HAL.
+ *
+ * Builds components/radio_drivers/sx126x_hal.c and the sx126x_driver
+ * unchanged against the fake bus in fake_sx126x.c and checks that every
+ * driver call is one SPI transaction inside one NSS frame, with the expected
+ * bytes on the wire and data read back from the buffer, the registers and
+ * GetIrqStatus. Each command must wait for BUSY first, also after mode
+ * changes and image calibration.
+ *
+ * It then reports the bus cost of a 255 byte sx126x_write_buffer and
+ * sx126x_read_buffer, and of the end of the hub's TX setup (packet and IRQ
+ * parameters, payload) up to the end of SetTx.
+ *
+ * Usage: test_sx126x_hal [-n operations] [--spi-overhead us]
+ *        [--polling-overhead us] [--i2c-overhead us] [--csv]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "sx126x.h"
+#include "radio_context.h"
+#include "bsp_sx126x.h"
+#include "fake_sx126x.h"
+
+#define TEST_OPERATIONS_DEFAULT 20000
+
+#define OP_WRITE_REGISTER       0x0D
+#define OP_WRITE_BUFFER         0x0E
+#define OP_GET_IRQ_STATUS       0x12
+#define OP_READ_REGISTER        0x1D
+#define OP_READ_BUFFER          0x1E
+
+esp_log_level_t host_log_level = ESP_LOG_WARN;
+
+/* Normally set up by components/lora/sx126x_sensecap_board.c */
+io_expander_ops_t *indicator_io_expander = &fake_expander_ops;
+
+static uint32_t busy_waits;
+
+/* The board's version sleeps on the expander INT, see test_sx126x_board */
+void SX126xWaitOnBusy(void)
+{
+    uint16_t pin_val;
+
+    busy_waits++;
+    do {
+        indicator_io_expander->read_input_pins(&pin_val);
+    } while (pin_val & (0x01 << EXPANDER_IO_RADIO_BUSY));
+}
+
+static int failures = 0;
+static radio_context_t radio;
+
+/* --------------------------------------------------------------- checks ---- */
+
+static uint32_t rng_state = 0x85ebca6b;
+
+static uint32_t rnd32(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        if (failures < 10) {
+            fprintf(stderr, "FAIL: %s\n", what);
+        }
+        failures++;
+    }
+}
+
+/* The last frame is header followed by data, moved in one transaction */
+static void check_frame(uint32_t frames_before, const uint8_t *header, int header_len,
+                        const uint8_t *data, int data_len, const char *what)
+{
+    const fake_frame_t *f = fake_sx126x_last_frame();
+
+    check(fake_bus.frames == frames_before + 1, what);
+    check(f->transactions == 1, what);
+    check(f->length == header_len + data_len, what);
+    check(memcmp(f->mosi, header, header_len) == 0, what);
+    if (data != NULL) {
+        check(memcmp(f->mosi + header_len, data, data_len) == 0, what);
+    }
+}
+
+static void random_bytes(uint8_t *data, int len)
+{
+    for (int i = 0; i < len; i++) {
+        data[i] = (uint8_t)rnd32();
+    }
+}
+
+static uint8_t model_buffer[256];
+
+static void random_op(void)
+{
+    uint8_t data[256];
+    uint8_t read[256];
+    uint8_t header[4];
+    uint32_t frames = fake_bus.frames;
+
+    switch (rnd32() % 5) {
+    case 0: {
+        uint8_t offset = (uint8_t)rnd32();
+        uint8_t size = (uint8_t)(1 + rnd32() % 255);
+
+        random_bytes(data, size);
+        check(sx126x_write_buffer(&radio, offset, data, size) == SX126X_STATUS_OK, "write_buffer status");
+        for (int i = 0; i < size; i++) {
+            model_buffer[(offset + i) & 0xff] = data[i];
+        }
+        header[0] = OP_WRITE_BUFFER;
+        header[1] = offset;
+        check_frame(frames, header, 2, data, size, "write_buffer frame");
+        break;
+    }
+    case 1: {
+        uint8_t offset = (uint8_t)rnd32();
+        uint8_t size = (uint8_t)(1 + rnd32() % 255);
+
+        check(sx126x_read_buffer(&radio, offset, read, size) == SX126X_STATUS_OK, "read_buffer status");
+        for (int i = 0; i < size; i++) {
+            check(read[i] == model_buffer[(offset + i) & 0xff], "read_buffer data");
+        }
+        header[0] = OP_READ_BUFFER;
+        header[1] = offset;
+        header[2] = 0;
+        check_frame(frames, header, 3, NULL, size, "read_buffer frame");
+        break;
+    }
+    case 2: {
+        uint16_t address = (uint16_t)(0x4000 + rnd32() % 0x1000);
+        uint8_t size = (uint8_t)(1 + rnd32() % 16);
+
+        random_bytes(data, size);
+        sx126x_write_register(&radio, address, data, size);
+        header[0] = OP_WRITE_REGISTER;
+        header[1] = address >> 8;
+        header[2] = address & 0xff;
+        check_frame(frames, header, 3, data, size, "write_register frame");
+
+        frames = fake_bus.frames;
+        sx126x_read_register(&radio, address, read, size);
+        check(memcmp(read, data, size) == 0, "read_register data");
+        header[0] = OP_READ_REGISTER;
+        header[3] = 0;
+        check_frame(frames, header, 4, NULL, size, "read_register frame");
+        break;
+    }
+    case 3: {
+        /* Mode changes and calibration keep BUSY high for longer */
+        switch (rnd32() % 4) {
+        case 0:
+            sx126x_set_standby(&radio, SX126X_STANDBY_CFG_RC);
+            break;
+        case 1:
+            sx126x_set_tx(&radio, 0);
+            break;
+        case 2:
+            sx126x_set_rx(&radio, 0);
+            break;
+        default:
+            sx126x_cal_img(&radio, 0xD7, 0xDB);
+            break;
+        }
+        check(fake_bus.frames == frames + 1, "mode command frame");
+        break;
+    }
+    default: {
+        sx126x_irq_mask_t irq = 0;
+
+        sx126x_get_irq_status(&radio, &irq);
+        check(irq == ((fake_sx126x_reply(OP_GET_IRQ_STATUS, 0) << 8) | fake_sx126x_reply(OP_GET_IRQ_STATUS, 1)),
+              "get_irq_status reply");
+        header[0] = OP_GET_IRQ_STATUS;
+        header[1] = 0;
+        check_frame(frames, header, 2, NULL, 2, "get_irq_status frame");
+        break;
+    }
+    }
+}
+
+/* ---------------------------------------------------------------- bench ---- */
+
+static bool csv;
+
+static void report(const char *name, double start_us, double end_us)
+{
+    if (csv) {
+        printf("%s,%u,%u,%u,%u,%.1f\n", name, fake_bus.spi_transactions, fake_bus.spi_bytes,
+               fake_bus.i2c_writes, fake_bus.i2c_reads, end_us - start_us);
+    } else {
+        printf("%-22s %6u %8u %6u %6u %10.1f\n", name, fake_bus.spi_transactions, fake_bus.spi_bytes,
+               fake_bus.i2c_writes, fake_bus.i2c_reads, end_us - start_us);
+    }
+}
+
+static void bench(void)
+{
+    uint8_t data[255];
+    double start;
+    const sx126x_pkt_params_lora_t pkt_params = {
+        .preamble_len_in_symb = 8,
+        .header_type = SX126X_LORA_PKT_EXPLICIT,
+        .pld_len_in_bytes = sizeof(data),
+        .crc_is_on = true,
+        .invert_iq_is_on = false,
+    };
+
+    random_bytes(data, sizeof(data));
+    if (csv) {
+        printf("operation,spi_transactions,spi_bytes,i2c_writes,i2c_reads,us\n");
+    } else {
+        printf("%-22s %6s %8s %6s %6s %10s\n", "operation", "spi", "bytes", "i2c wr", "i2c rd", "time [us]");
+    }
+
+    fake_bus_reset_stats();
+    start = fake_now_us;
+    sx126x_write_buffer(&radio, 0, data, sizeof(data));
+    report("write_buffer 255", start, fake_now_us);
+
+    fake_bus_reset_stats();
+    start = fake_now_us;
+    sx126x_read_buffer(&radio, 0, data, sizeof(data));
+    report("read_buffer 255", start, fake_now_us);
+
+    /* As lgw_radio_configure_tx and lgw_send finish a 255 byte packet */
+    fake_bus_reset_stats();
+    start = fake_now_us;
+    sx126x_set_lora_pkt_params(&radio, &pkt_params);
+    sx126x_set_dio_irq_params(&radio, SX126X_IRQ_TX_DONE | SX126X_IRQ_TIMEOUT, SX126X_IRQ_TX_DONE | SX126X_IRQ_TIMEOUT,
+                              SX126X_IRQ_NONE, SX126X_IRQ_NONE);
+    sx126x_clear_irq_status(&radio, SX126X_IRQ_ALL);
+    sx126x_write_buffer(&radio, 0, data, sizeof(data));
+    sx126x_set_tx(&radio, 0);
+    check(fake_sx126x_set_tx_us() >= 0, "SetTx issued");
+    report("TX setup 255 to SetTx", start, fake_sx126x_set_tx_us());
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t operations = TEST_OPERATIONS_DEFAULT;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            operations = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--spi-overhead") == 0 && i + 1 < argc) {
+            fake_spi_overhead_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--polling-overhead") == 0 && i + 1 < argc) {
+            fake_spi_polling_overhead_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--i2c-overhead") == 0 && i + 1 < argc) {
+            fake_i2c_overhead_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        }
+    }
+
+    /* Same device as the LoRaWAN driver: bsp_sx126x_spi_handle_get() */
+    radio.spi_handle = (spi_device_handle_t)&radio;
+
+    for (uint32_t n = 0; n < operations; n++) {
+        random_op();
+    }
+    check(fake_bus.split_frames == 0, "command split over several transactions");
+    check(fake_bus.spi_without_nss == 0, "SPI transaction with NSS high");
+    check(fake_bus.busy_frames == 0, "command sent while BUSY was high");
+    check(busy_waits == fake_bus.frames, "one BUSY wait per command");
+    if (!csv) {
+        printf("%u operations, %u frames\n\n", operations, fake_bus.frames);
+    }
+
+    bench();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * Transport model benchmark.
+ *
+ * Replays recorded transport.opendata.ch responses through the unmodified
+ * transport_data.c (fetch task -> parser -> view event) and reports per
+ * response the parse time, peak heap and number of allocations, and for
+ * boards the size of the posted snapshot and the cost of copying it out
+ * with transport_data_get_*() (what the view's live timer does). Exits
+ * non-zero if a response no longer parses to the expected item count, so it
+ * doubles as a regression test.
+ *
+ * Usage: bench_transport [-n iterations] [--csv] [-v] [manifest]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host_port.h"
+#include "esp_log.h"
+#include "cJSON.h"
+#include "transport_data.h"
+#include "view_data.h"
+
+#define BENCH_ITERATIONS_DEFAULT    20
+#define BENCH_MAX_ITERATIONS        1000
+#define BENCH_COPY_ROUNDS           2000
+
+typedef struct {
+    const char *kind;
+    char file[128];
+    int expected;
+    char journey[64];
+} bench_entry_t;
+
+typedef struct {
+    size_t bytes;
+    uint64_t parse_ns_min;
+    uint64_t parse_ns_med;
+    size_t peak;
+    uint32_t allocs;
+    int items;
+    size_t event_bytes;     /* Boards only */
+    double copy_ns;
+    bool ok;
+} bench_result_t;
+
+static char *load_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(size + 1);
+    if (buf && fread(buf, 1, size, f) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    if (buf) {
+        buf[size] = '\0';
+        *len = size;
+    }
+    return buf;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Run one fetch of the given kind and return the parsed item count.
+ */
+static int run_once(const bench_entry_t *e)
+{
+    if (strcmp(e->kind, "bus") == 0) {
+        transport_data_refresh_bus();
+        if (host_event_last_id() != VIEW_EVENT_BUS_COUNTDOWN_UPDATE) return -1;
+        const struct view_data_bus_countdown *d = host_event_last_data();
+        return d->api_error ? -1 : d->count;
+    } else if (strcmp(e->kind, "train") == 0) {
+        transport_data_refresh_train();
+        if (host_event_last_id() != VIEW_EVENT_TRAIN_STATION_UPDATE) return -1;
+        const struct view_data_train_station *d = host_event_last_data();
+        return d->api_error ? -1 : d->count;
+    } else if (strcmp(e->kind, "train_details") == 0) {
+        if (transport_data_fetch_train_details(e->journey) != ESP_OK) return -1;
+        if (host_event_last_id() != VIEW_EVENT_TRAIN_DETAILS_UPDATE) return -1;
+        const struct view_data_train_details *d = host_event_last_data();
+        return d->error ? -1 : d->stop_count;
+    } else if (strcmp(e->kind, "bus_details") == 0) {
+        if (transport_data_fetch_bus_details(e->journey) != ESP_OK) return -1;
+        if (host_event_last_id() != VIEW_EVENT_BUS_DETAILS_UPDATE) return -1;
+        const struct view_data_bus_details *d = host_event_last_data();
+        return d->error ? -1 : d->stop_count;
+    }
+    return -1;
+}
+
+static bool run_entry(const bench_entry_t *e, const char *dir, int iterations, bench_result_t *res)
+{
+    static uint64_t samples[BENCH_MAX_ITERATIONS];
+    char path[512];
+    size_t len = 0;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, e->file);
+    char *body = load_file(path, &len);
+    if (!body) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return false;
+    }
+    host_http_set_response(body, len);
+
+    memset(res, 0, sizeof(*res));
+    res->bytes = len;
+    res->ok = true;
+    for (int i = 0; i < iterations; i++) {
+        host_heap_stats_t heap;
+
+        host_heap_reset();
+        host_http_take_ns();
+        uint64_t start = host_now_ns();
+        int items = run_once(e);
+        uint64_t elapsed = host_now_ns() - start;
+        host_heap_get(&heap);
+
+        /* Copying the recorded body stands in for the network, not parsing */
+        samples[i] = elapsed - host_http_take_ns();
+        res->peak = heap.peak > res->peak ? heap.peak : res->peak;
+        res->allocs = heap.allocs;
+        res->items = items;
+        if (items != e->expected) {
+            res->ok = false;
+        }
+    }
+    qsort(samples, iterations, sizeof(samples[0]), cmp_u64);
+    res->parse_ns_min = samples[0];
+    res->parse_ns_med = samples[iterations / 2];
+
+    if (strcmp(e->kind, "bus") == 0 || strcmp(e->kind, "train") == 0) {
+        static struct view_data_bus_countdown bus;
+        static struct view_data_train_station train;
+        bool is_bus = strcmp(e->kind, "bus") == 0;
+
+        res->event_bytes = host_event_last_size();
+        uint64_t start = host_now_ns();
+        for (int i = 0; i < BENCH_COPY_ROUNDS; i++) {
+            if (is_bus) {
+                transport_data_get_bus_countdown(&bus);
+            } else {
+                transport_data_get_train_station(&train);
+            }
+            __asm__ volatile("" ::: "memory");
+        }
+        res->copy_ns = (double)(host_now_ns() - start) / BENCH_COPY_ROUNDS;
+    }
+
+    host_http_set_response(NULL, 0);
+    free(body);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = BENCH_ITERATIONS_DEFAULT;
+    bool csv = false;
+    const char *manifest = BENCH_CORPUS_DIR "/manifest.txt";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            host_log_level = ESP_LOG_INFO;
+        } else {
+            manifest = argv[i];
+        }
+    }
+    if (iterations < 1 || iterations > BENCH_MAX_ITERATIONS) {
+        fprintf(stderr, "iterations must be 1..%d\n", BENCH_MAX_ITERATIONS);
+        return 2;
+    }
+
+    /* Corpus directory is the manifest's */
+    char dir[256];
+    snprintf(dir, sizeof(dir), "%s", manifest);
+    char *slash = strrchr(dir, '/');
+    if (slash) {
+        *slash = '\0';
+    } else {
+        strcpy(dir, ".");
+    }
+
+    FILE *f = fopen(manifest, "r");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", manifest);
+        return 2;
+    }
+
+    /* Same zone as indicator_time.c sets on the device */
+    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+    tzset();
+
+    cJSON_Hooks hooks = {
+        .malloc_fn = host_malloc,
+        .free_fn = host_free,
+    };
+    cJSON_InitHooks(&hooks);
+
+    /* Select stop and station, the initial fetch fails quietly without a response */
+    esp_log_level_t level = host_log_level;
+    host_log_level = ESP_LOG_NONE;
+    transport_data_set_bus_stop(NULL, NULL);
+    transport_data_set_train_station(NULL, NULL);
+    host_log_level = level;
+
+    if (csv) {
+        printf("response,bytes,items,parse_us_min,parse_us_median,peak_heap_bytes,allocs,event_bytes,copy_ns\n");
+    } else {
+        printf("Snapshot structs: bus %zu B, train %zu B (string table %d B each)\n",
+               sizeof(struct view_data_bus_countdown), sizeof(struct view_data_train_station),
+               VIEW_STRTAB_SIZE);
+        printf("%-44s %8s %5s %10s %10s %9s %7s %8s %8s\n",
+               "response", "bytes", "items", "min us", "median us", "peak kB", "allocs", "event B", "copy ns");
+    }
+
+    int failures = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char kind[32];
+        bench_entry_t e = {0};
+        int consumed = 0;
+
+        if (line[0] == '#' || sscanf(line, "%31s", kind) != 1) {
+            continue;
+        }
+        if (strcmp(kind, "now") == 0) {
+            long long now = 0;
+            sscanf(line, "%*s %lld", &now);
+            host_time_set((time_t)now);
+            continue;
+        }
+        if (sscanf(line, "%31s %127s %d %n", kind, e.file, &e.expected, &consumed) < 3) {
+            fprintf(stderr, "bad manifest line: %s", line);
+            failures++;
+            continue;
+        }
+        e.kind = kind;
+        snprintf(e.journey, sizeof(e.journey), "%s", line + consumed);
+        e.journey[strcspn(e.journey, "\r\n")] = '\0';
+
+        bench_result_t res;
+        if (!run_entry(&e, dir, iterations, &res)) {
+            failures++;
+            continue;
+        }
+
+        if (csv) {
+            printf("%s,%zu,%d,%.1f,%.1f,%zu,%u,%zu,%.0f\n", e.file, res.bytes, res.items,
+                   res.parse_ns_min / 1000.0, res.parse_ns_med / 1000.0, res.peak, res.allocs,
+                   res.event_bytes, res.copy_ns);
+        } else {
+            printf("%-44s %8zu %5d %10.1f %10.1f %9.1f %7u %8zu %8.0f%s\n", e.file, res.bytes, res.items,
+                   res.parse_ns_min / 1000.0, res.parse_ns_med / 1000.0, res.peak / 1024.0, res.allocs,
+                   res.event_bytes, res.copy_ns, res.ok ? "" : "  FAIL");
+        }
+        if (!res.ok) {
+            fprintf(stderr, "%s: expected %d items, got %d\n", e.file, e.expected, res.items);
+            failures++;
+        }
+    }
+    fclose(f);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,340 @@
+/*
+ * Host implementations of the ESP-IDF, FreeRTOS and application services the
+ * transport model layer depends on.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "host_port.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "network_manager.h"
+#include "indicator_display.h"
+#include "indicator_wifi.h"
+#include "indicator_storage.h"
+#include "boot_timeline.h"
+
+esp_log_level_t host_log_level = ESP_LOG_ERROR;
+
+ESP_EVENT_DEFINE_BASE(VIEW_EVENT_BASE);
+esp_event_loop_handle_t view_event_handle = (esp_event_loop_handle_t)&view_event_handle;
+
+/* ---------------------------------------------------------------- heap ---- */
+
+/* Keeps the size in front of each block, padded to max_align_t */
+typedef union {
+    size_t size;
+    max_align_t align;
+} host_block_t;
+
+static host_heap_stats_t heap_stats;
+
+void *host_malloc(size_t size)
+{
+    host_block_t *blk = malloc(sizeof(*blk) + size);
+    if (!blk) {
+        return NULL;
+    }
+    blk->size = size;
+    heap_stats.allocs++;
+    heap_stats.in_use += size;
+    if (heap_stats.in_use > heap_stats.peak) {
+        heap_stats.peak = heap_stats.in_use;
+    }
+    return blk + 1;
+}
+
+void *host_calloc(size_t n, size_t size)
+{
+    if (size && n > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *p = host_malloc(n * size);
+    if (p) {
+        memset(p, 0, n * size);
+    }
+    return p;
+}
+
+void host_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    host_block_t *blk = (host_block_t *)ptr - 1;
+    heap_stats.frees++;
+    heap_stats.in_use -= blk->size;
+    free(blk);
+}
+
+void *host_realloc(void *ptr, size_t size)
+{
+    if (!ptr) {
+        return host_malloc(size);
+    }
+    host_block_t *old = (host_block_t *)ptr - 1;
+    size_t old_size = old->size;
+    host_block_t *blk = realloc(old, sizeof(*blk) + size);
+    if (!blk) {
+        return NULL;
+    }
+    blk->size = size;
+    heap_stats.allocs++;
+    heap_stats.in_use = heap_stats.in_use - old_size + size;
+    if (heap_stats.in_use > heap_stats.peak) {
+        heap_stats.peak = heap_stats.in_use;
+    }
+    return blk + 1;
+}
+
+char *host_strdup(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *p = host_malloc(len);
+    if (p) {
+        memcpy(p, s, len);
+    }
+    return p;
+}
+
+void host_heap_reset(void)
+{
+    heap_stats.peak = heap_stats.in_use;
+    heap_stats.allocs = 0;
+    heap_stats.frees = 0;
+}
+
+void host_heap_get(host_heap_stats_t *stats)
+{
+    *stats = heap_stats;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 0;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    return 0;
+}
+
+/* ---------------------------------------------------------------- time ---- */
+
+static time_t host_clock;
+
+time_t host_time(time_t *t)
+{
+    time_t now = host_clock ? host_clock : time(NULL);
+    if (t) {
+        *t = now;
+    }
+    return now;
+}
+
+void host_time_set(time_t now)
+{
+    host_clock = now;
+}
+
+uint64_t host_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* ------------------------------------------------------------ FreeRTOS ---- */
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_depth,
+                       void *params, UBaseType_t priority, TaskHandle_t *created_task)
+{
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+    if (created_task) {
+        *created_task = NULL;
+    }
+    task(params);
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    (void)task;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    (void)ticks;
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload,
+                           void *timer_id, TimerCallbackFunction_t callback)
+{
+    static int dummy;
+    (void)name;
+    (void)period;
+    (void)auto_reload;
+    (void)timer_id;
+    (void)callback;
+    return &dummy;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks_to_wait)
+{
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks_to_wait)
+{
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks_to_wait)
+{
+    return pdPASS;
+}
+
+/* ------------------------------------------------------------ esp_event --- */
+
+static int32_t last_event_id = -1;
+static size_t last_event_size = 0;
+static unsigned char last_event_data[256 * 1024];
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
+                            const void *event_data, size_t event_data_size, TickType_t ticks_to_wait)
+{
+    /* The real loop copies the payload too */
+    if (event_data_size > sizeof(last_event_data)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (event_data && event_data_size) {
+        memcpy(last_event_data, event_data, event_data_size);
+    }
+    last_event_id = event_id;
+    last_event_size = event_data_size;
+    return ESP_OK;
+}
+
+int32_t host_event_last_id(void)
+{
+    return last_event_id;
+}
+
+const void *host_event_last_data(void)
+{
+    return last_event_data;
+}
+
+size_t host_event_last_size(void)
+{
+    return last_event_size;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+/* ------------------------------------------------- storage, boot markers --- */
+
+/* Nothing persisted: every boot starts without a saved selection */
+esp_err_t indicator_storage_write(char *p_key, void *p_data, size_t len)
+{
+    return ESP_OK;
+}
+
+esp_err_t indicator_storage_read(char *p_key, void *p_data, size_t *p_len)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+void boot_timeline_mark(enum boot_stage stage)
+{
+    (void)stage;
+}
+
+/* ------------------------------------------------------ network_manager --- */
+
+static const char *http_body;
+static size_t http_len;
+static uint64_t http_ns;
+
+void host_http_set_response(const char *body, size_t len)
+{
+    http_body = body;
+    http_len = len;
+}
+
+uint64_t host_http_take_ns(void)
+{
+    uint64_t ns = http_ns;
+    http_ns = 0;
+    return ns;
+}
+
+bool network_manager_is_connected(void)
+{
+    return true;
+}
+
+esp_err_t network_manager_ping(const char *host)
+{
+    return ESP_OK;
+}
+
+esp_err_t network_manager_http_get(const char *url, char *response_buffer,
+                                   size_t buffer_size, size_t *response_length)
+{
+    uint64_t start = host_now_ns();
+
+    if (!http_body) {
+        return ESP_FAIL;
+    }
+    size_t len = http_len < buffer_size ? http_len : buffer_size;
+    memcpy(response_buffer, http_body, len);
+    *response_length = len;
+
+    http_ns += host_now_ns() - start;
+    return ESP_OK;
+}
+
+/* ------------------------------------------------------ indicator_wifi ---- */
+
+void indicator_wifi_ps_hold(uint32_t ms)
+{
+    (void)ms;
+}
+
+/* --------------------------------------------------- indicator_display ---- */
+
+bool indicator_display_st_get(void)
+{
+    return true;
+}
+
+int indicator_display_on(void)
+{
+    return 0;
+}
+
+int indicator_display_sleep_restart(void)
+{
+    return 0;
+}
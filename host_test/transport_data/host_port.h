@@ -0,0 +1,70 @@
+/*
+ * Host port of the transport model layer.
+ *
+ * Force-included (-include) into the model sources so that every heap
+ * allocation goes through the counting allocator and time() reads the
+ * benchmark clock. System headers are pulled in first so their prototypes
+ * are not renamed.
+ */
+#ifndef HOST_PORT_H
+#define HOST_PORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Allocation statistics since the last host_heap_reset() */
+typedef struct {
+    size_t   in_use;        /* Bytes currently allocated */
+    size_t   peak;          /* Highest in_use seen */
+    uint32_t allocs;        /* malloc/calloc/realloc/strdup calls */
+    uint32_t frees;
+} host_heap_stats_t;
+
+void *host_malloc(size_t size);
+void *host_calloc(size_t n, size_t size);
+void *host_realloc(void *ptr, size_t size);
+void host_free(void *ptr);
+char *host_strdup(const char *s);
+
+void host_heap_reset(void);
+void host_heap_get(host_heap_stats_t *stats);
+
+/* Wall clock seen by the model, 0 means the real clock */
+time_t host_time(time_t *t);
+void host_time_set(time_t now);
+
+/* Recorded response served by network_manager_http_get() */
+void host_http_set_response(const char *body, size_t len);
+/* Nanoseconds spent inside network_manager_http_get() since the last call */
+uint64_t host_http_take_ns(void);
+
+/* Last event posted with esp_event_post_to() */
+int32_t host_event_last_id(void);
+const void *host_event_last_data(void);
+size_t host_event_last_size(void);
+
+uint64_t host_now_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef HOST_PORT_REDIRECT
+#undef strdup
+#define malloc(size)        host_malloc(size)
+#define calloc(n, size)     host_calloc(n, size)
+#define realloc(ptr, size)  host_realloc(ptr, size)
+#define free(ptr)           host_free(ptr)
+#define strdup(s)           host_strdup(s)
+#define time(t)             host_time(t)
+#endif
+
+#endif
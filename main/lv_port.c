@@ -1,3 +1,4 @@
+#include <string.h>
 #include "esp_heap_caps.h"
 #include "esp_err.h"
 #include "esp_log.h"
@@ -11,6 +12,7 @@
 #include "bsp_board.h"
 #include "bsp_lcd.h"
 #include "indev/indev.h"
+#include "indev/indev_tp.h"
 #include "sdkconfig.h"
 
 #include "indicator_display.h"
@@ -30,6 +32,25 @@ static lv_indev_t *indev_button = NULL;
 static SemaphoreHandle_t lvgl_mutex = NULL;
 static TaskHandle_t lvgl_task_handle;
 
+/* Touch INT driven input: read timer runs only between INT and release */
+static bool touchpad_int_mode = false;
+static volatile bool touchpad_int_pending = false;
+
+#if LV_PORT_PROFILER_EN
+/* Frame profiler: per-frame state is LVGL task only, prof_stats is read by other tasks */
+static lv_port_prof_stats_t prof_stats[LV_PORT_SCREEN_MAX];
+static lv_port_screen_t prof_screen = LV_PORT_SCREEN_CLOCK;
+static int64_t prof_frame_start_us;
+static uint32_t prof_frame_flush_us;
+static uint32_t prof_frame_sync_us;
+static uint32_t prof_frame_areas;
+static portMUX_TYPE prof_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const prof_screen_names[LV_PORT_SCREEN_MAX] = {
+    "clock", "bus", "train", "settings", "details",
+};
+#endif
+
 #ifndef CONFIG_LCD_TASK_PRIORITY
 #define CONFIG_LCD_TASK_PRIORITY    5
 #endif
@@ -43,6 +64,11 @@ static void disp_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_
 static esp_err_t lv_port_tick_init(void);
 static void lvgl_task(void *args);
 static void lv_port_direct_mode_copy(void);
+static void touchpad_int_process(void);
+#if LV_PORT_PROFILER_EN
+static void prof_render_start(lv_disp_drv_t *drv);
+static void prof_monitor(lv_disp_drv_t *drv, uint32_t time, uint32_t px);
+#endif
 
 void lv_port_init(void)
 {
@@ -103,8 +129,20 @@ static void disp_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_
 {
     (void)disp_drv;
 
+#if LV_PORT_PROFILER_EN
+    uint32_t sync_us = prof_frame_sync_us;
+    int64_t start = esp_timer_get_time();
+#endif
+
     /*The most simple case (but also the slowest) to put all pixels to the screen one-by-one*/
     bsp_lcd_flush(area->x1, area->y1, area->x2 + 1, area->y2 + 1, (uint8_t *) color_p);
+
+#if LV_PORT_PROFILER_EN
+    /* Direct mode sync runs inside bsp_lcd_flush, it is counted in sync_us only */
+    sync_us = prof_frame_sync_us - sync_us;
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start);
+    prof_frame_flush_us += elapsed_us > sync_us ? elapsed_us - sync_us : 0;
+#endif
 }
 
 static void button_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data)
@@ -172,10 +210,59 @@ static IRAM_ATTR void touchpad_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *
         data->state = LV_INDEV_STATE_REL;
         data->point.x = x;
         data->point.y = y;
+
+        /* Released and no scroll throw/snap left to animate: wait for next INT */
+        if (touchpad_int_mode && NULL == lv_indev_get_scroll_obj(indev_touchpad)) {
+            lv_timer_pause(indev_drv->read_timer);
+        }
     }
     //ESP_LOGI(TAG, "Touch (%u) : [%3u, %3u] - 0x%02X", indev_data.pressed, data->point.x, data->point.y, indev_data.btn_val);
 }
 
+/**
+ * @brief Expander INT handler, wakes the LVGL task.
+ * @note  The line is shared with the radio, touchpad_int_process() sorts it out.
+ *
+ * @param arg Not used.
+ */
+static void IRAM_ATTR touchpad_isr(void *arg)
+{
+    BaseType_t task_woken = pdFALSE;
+
+    touchpad_int_pending = true;
+    if (lvgl_task_handle) {
+        vTaskNotifyGiveFromISR(lvgl_task_handle, &task_woken);
+    }
+    if (task_woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+/**
+ * @brief Resume touch reading after an INT edge.
+ * @note  Must be called with the LVGL mutex held.
+ *
+ */
+static void touchpad_int_process(void)
+{
+    if (!touchpad_int_mode || !touchpad_int_pending) {
+        return;
+    }
+    touchpad_int_pending = false;
+
+    /* Releases the shared expander INT line so the next edge is seen */
+    bool tp_int = false;
+    indev_tp_int_ack(&tp_int);
+    if (!tp_int) {
+        /* Radio DIO1 or BUSY edge, the panel has nothing new */
+        return;
+    }
+
+    lv_timer_t *read_timer = indev_touchpad->driver->read_timer;
+    lv_timer_resume(read_timer);
+    lv_timer_ready(read_timer);
+}
+
 /**
  * @brief Initialize display driver for LVGL.
  *
@@ -216,6 +303,10 @@ static void lv_port_disp_init(void)
     disp_drv.ver_res = brd->LCD_HEIGHT;
     disp_drv.flush_cb = disp_flush;
     disp_drv.draw_buf = &disp_buf;
+#if LV_PORT_PROFILER_EN
+    disp_drv.render_start_cb = prof_render_start;
+    disp_drv.monitor_cb = prof_monitor;
+#endif
 #if CONFIG_LCD_LVGL_FULL_REFRESH
     disp_drv.full_refresh = 1;
 #elif CONFIG_LCD_LVGL_DIRECT_MODE
@@ -263,6 +354,13 @@ static void lv_port_indev_init(void)
         indev_drv_tp.read_cb = touchpad_read;
         indev_touchpad = lv_indev_drv_register(&indev_drv_tp);
 
+        /* Event driven input when the TP INT line is available, polling otherwise */
+        if (ESP_OK == indev_tp_int_register(touchpad_isr, NULL)) {
+            touchpad_int_mode = true;
+            lv_timer_pause(indev_touchpad->driver->read_timer);
+            ESP_LOGI(TAG, "TP input is interrupt driven");
+        }
+
     } else {
         ESP_LOGI(TAG, "Add KEYPAD input device to LVGL");
         lv_indev_drv_init(&indev_drv_btn);
@@ -324,6 +422,9 @@ static esp_err_t lv_port_tick_init(void)
  */
 static void lv_port_direct_mode_copy(void)
 {
+#if LV_PORT_PROFILER_EN
+    int64_t start = esp_timer_get_time();
+#endif
     lv_disp_t *disp_refr = _lv_refr_get_disp_refreshing();
 
     uint8_t *buf_act = disp_refr->driver->draw_buf->buf_act;
@@ -365,6 +466,139 @@ static void lv_port_direct_mode_copy(void)
             Cache_WriteBack_Addr((uint32_t)(flush_ptr), bytes_to_flush);
         }
     }
+#if LV_PORT_PROFILER_EN
+    prof_frame_sync_us += (uint32_t)(esp_timer_get_time() - start);
+#endif
+}
+#endif
+
+#if LV_PORT_PROFILER_EN
+/**
+ * @brief Histogram bucket of a duration: <1, <2, <4 ... >=64 ms.
+ *
+ */
+static int prof_bucket(uint32_t us)
+{
+    uint32_t ms = us / 1000;
+    int i = 0;
+
+    while (ms && i < LV_PORT_PROF_HIST_BUCKETS - 1) {
+        ms >>= 1;
+        i++;
+    }
+    return i;
+}
+
+/**
+ * @brief Called by LVGL before rendering the invalidated areas of a frame.
+ *
+ */
+static void prof_render_start(lv_disp_drv_t *drv)
+{
+    lv_disp_t *disp_refr = _lv_refr_get_disp_refreshing();
+    uint32_t areas = 0;
+
+    for (int i = 0; i < disp_refr->inv_p; i++) {
+        if (disp_refr->inv_area_joined[i] == 0) {
+            areas++;
+        }
+    }
+    prof_frame_areas = areas;
+    prof_frame_flush_us = 0;
+    prof_frame_sync_us = 0;
+    prof_frame_start_us = esp_timer_get_time();
+}
+
+/**
+ * @brief Called by LVGL after a frame has been rendered and flushed.
+ *
+ * @param time Refresh time in ms, too coarse, own timestamps are used instead.
+ * @param px Number of rendered pixels.
+ */
+static void prof_monitor(lv_disp_drv_t *drv, uint32_t time, uint32_t px)
+{
+    (void)time;
+
+    uint32_t total_us = (uint32_t)(esp_timer_get_time() - prof_frame_start_us);
+    uint32_t flush_us = prof_frame_flush_us;
+    uint32_t sync_us = prof_frame_sync_us;
+    uint32_t spent_us = flush_us + sync_us;
+    uint32_t render_us = total_us > spent_us ? total_us - spent_us : 0;
+
+    portENTER_CRITICAL(&prof_lock);
+    lv_port_prof_stats_t *st = &prof_stats[prof_screen];
+    st->frames++;
+    st->render_us += render_us;
+    st->flush_us += flush_us;
+    st->sync_us += sync_us;
+    st->render_max_us = LV_MAX(st->render_max_us, render_us);
+    st->flush_max_us = LV_MAX(st->flush_max_us, flush_us);
+    st->sync_max_us = LV_MAX(st->sync_max_us, sync_us);
+    st->inv_areas += prof_frame_areas;
+    st->inv_px += px;
+    st->render_hist[prof_bucket(render_us)]++;
+    st->flush_hist[prof_bucket(flush_us)]++;
+    st->sync_hist[prof_bucket(sync_us)]++;
+    portEXIT_CRITICAL(&prof_lock);
+}
+
+void lv_port_prof_set_screen(lv_port_screen_t screen)
+{
+    if (screen < LV_PORT_SCREEN_MAX) {
+        prof_screen = screen;
+    }
+}
+
+void lv_port_prof_get_stats(lv_port_screen_t screen, lv_port_prof_stats_t *stats)
+{
+    if (screen >= LV_PORT_SCREEN_MAX || NULL == stats) {
+        return;
+    }
+    portENTER_CRITICAL(&prof_lock);
+    *stats = prof_stats[screen];
+    portEXIT_CRITICAL(&prof_lock);
+}
+
+void lv_port_prof_reset(void)
+{
+    portENTER_CRITICAL(&prof_lock);
+    memset(prof_stats, 0, sizeof(prof_stats));
+    portEXIT_CRITICAL(&prof_lock);
+}
+
+const char *lv_port_prof_screen_name(lv_port_screen_t screen)
+{
+    return screen < LV_PORT_SCREEN_MAX ? prof_screen_names[screen] : "?";
+}
+
+static void prof_dump_hist(const char *name, const uint32_t *hist)
+{
+    ESP_LOGI(TAG, "  %-6s <1:%-5lu <2:%-5lu <4:%-5lu <8:%-5lu <16:%-5lu <32:%-5lu <64:%-5lu >=64:%-5lu",
+             name,
+             (unsigned long)hist[0], (unsigned long)hist[1], (unsigned long)hist[2], (unsigned long)hist[3],
+             (unsigned long)hist[4], (unsigned long)hist[5], (unsigned long)hist[6], (unsigned long)hist[7]);
+}
+
+void lv_port_prof_dump(void)
+{
+    lv_port_prof_stats_t st;
+
+    ESP_LOGI(TAG, "----- Frame profile (us, histograms in ms) -----");
+    for (int i = 0; i < LV_PORT_SCREEN_MAX; i++) {
+        lv_port_prof_get_stats(i, &st);
+        if (0 == st.frames) {
+            continue;
+        }
+        ESP_LOGI(TAG, "%s: %lu frames, render avg %llu max %lu, flush avg %llu max %lu, sync avg %llu max %lu, %llu areas %llu px per frame",
+                 prof_screen_names[i], (unsigned long)st.frames,
+                 st.render_us / st.frames, (unsigned long)st.render_max_us,
+                 st.flush_us / st.frames, (unsigned long)st.flush_max_us,
+                 st.sync_us / st.frames, (unsigned long)st.sync_max_us,
+                 st.inv_areas / st.frames, st.inv_px / st.frames);
+        prof_dump_hist("render", st.render_hist);
+        prof_dump_hist("flush", st.flush_hist);
+        prof_dump_hist("sync", st.sync_hist);
+    }
 }
 #endif
 
@@ -377,8 +611,10 @@ static void lvgl_task(void *args)
 {
     for (;;) {
         xSemaphoreTake(lvgl_mutex, portMAX_DELAY);
+        touchpad_int_process();
         lv_task_handler();
         xSemaphoreGive(lvgl_mutex);
-        vTaskDelay(pdMS_TO_TICKS(LV_PORT_TASK_DELAY_MS));
+        /* Touch INT wakes the task early */
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LV_PORT_TASK_DELAY_MS));
     }
 }
@@ -7,6 +7,39 @@
 extern "C" {
 #endif
 
+/* Frame profiler: per-frame render / flush / framebuffer sync cost, off by default */
+#ifndef LV_PORT_PROFILER_EN
+#define LV_PORT_PROFILER_EN             0
+#endif
+
+#define LV_PORT_PROF_HIST_BUCKETS       8   /* <1, <2, <4, <8, <16, <32, <64, >=64 ms */
+
+/** Top-level screen a frame is attributed to */
+typedef enum {
+    LV_PORT_SCREEN_CLOCK = 0,
+    LV_PORT_SCREEN_BUS,
+    LV_PORT_SCREEN_TRAIN,
+    LV_PORT_SCREEN_SETTINGS,
+    LV_PORT_SCREEN_DETAILS,
+    LV_PORT_SCREEN_MAX,
+} lv_port_screen_t;
+
+/** Aggregated frame statistics of one screen */
+typedef struct {
+    uint32_t frames;
+    uint64_t render_us;                 /* Rendering, flush wait excluded */
+    uint64_t flush_us;                  /* disp_flush -> flush ready, sync excluded */
+    uint64_t sync_us;                   /* Direct mode framebuffer copy */
+    uint32_t render_max_us;
+    uint32_t flush_max_us;
+    uint32_t sync_max_us;
+    uint64_t inv_areas;                 /* Invalidated areas (after joining) */
+    uint64_t inv_px;                    /* Invalidated pixels */
+    uint32_t render_hist[LV_PORT_PROF_HIST_BUCKETS];
+    uint32_t flush_hist[LV_PORT_PROF_HIST_BUCKETS];
+    uint32_t sync_hist[LV_PORT_PROF_HIST_BUCKETS];
+} lv_port_prof_stats_t;
+
 /**
  * @brief Initialize related work for lvgl.
  *
@@ -27,6 +60,36 @@ void lv_port_sem_take(void);
  */
 void lv_port_sem_give(void);
 
+/**
+ * @brief Set the screen following frames are attributed to.
+ *
+ */
+void lv_port_prof_set_screen(lv_port_screen_t screen);
+
+/**
+ * @brief Get a copy of the frame statistics of one screen.
+ *
+ */
+void lv_port_prof_get_stats(lv_port_screen_t screen, lv_port_prof_stats_t *stats);
+
+/**
+ * @brief Clear all frame statistics.
+ *
+ */
+void lv_port_prof_reset(void);
+
+/**
+ * @brief Print frame statistics and histograms of all screens to the log.
+ *
+ */
+void lv_port_prof_dump(void);
+
+/**
+ * @brief Get the name of a screen.
+ *
+ */
+const char *lv_port_prof_screen_name(lv_port_screen_t screen);
+
 #ifdef __cplusplus
 }
 #endif
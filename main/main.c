@@ -1,5 +1,6 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "bsp_board.h"
 #include "lv_port.h"
@@ -17,6 +18,7 @@
 #include "network_manager.h"
 #include "indicator_display.h"
 #include "view_data.h"
+#include "boot_timeline.h"
 
 static const char *TAG = "app_main";
 
@@ -135,106 +137,112 @@ static void settings_update_task(void *arg)
     }
 }
 
+#define BOOT_NETWORK_WAIT_MS   60000   // then show offline/"No WiFi" boards, keep waiting
+#define BOOT_TIMELINE_WAIT_MS  120000  // print the timeline once data and SNTP are in, or after this
+
+static SemaphoreHandle_t __g_network_sem = NULL;
+
+static void __boot_event_handler(void* handler_args, esp_event_base_t base, int32_t id, void* event_data)
+{
+    const struct view_data_wifi_st *st = (const struct view_data_wifi_st *)event_data;
+    if (id == VIEW_EVENT_WIFI_ST && st->is_network) {
+        boot_timeline_mark(BOOT_STAGE_NETWORK);
+        xSemaphoreGive(__g_network_sem);
+    }
+}
+
 /**
  * @brief Task for initial data fetch after WiFi connects
+ *
+ * The fetch does not wait for SNTP: until it syncs, the clock is taken from
+ * the API's HTTP Date header (see network_manager_http_get).
  */
 static void initial_fetch_task(void *arg)
 {
-    ESP_LOGI(TAG, "Waiting for WiFi connection...");
-    
-    // Wait for WiFi connection (up to 60 seconds to handle slow or unstable connections)
-    int retries = 0;
-    while (!network_manager_is_connected() && retries < 60) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        retries++;
-        if (retries % 10 == 0) {
-            ESP_LOGI(TAG, "Still waiting for WiFi... (%d/60)", retries);
-        }
+    ESP_LOGI(TAG, "Waiting for network...");
+
+    if (xSemaphoreTake(__g_network_sem, pdMS_TO_TICKS(BOOT_NETWORK_WAIT_MS)) != pdTRUE) {
+        ESP_LOGW(TAG, "No network after %d seconds, showing offline boards", BOOT_NETWORK_WAIT_MS / 1000);
+        transport_data_force_refresh();
+        xSemaphoreTake(__g_network_sem, portMAX_DELAY);
     }
-    
-    if (!network_manager_is_connected()) {
-        ESP_LOGW(TAG, "WiFi connection timeout after 60 seconds");
-        ESP_LOGW(TAG, "Application will continue with limited functionality");
-        ESP_LOGW(TAG, "Data refresh will start automatically when WiFi connects");
-        vTaskDelete(NULL);
-        return;
+    ESP_LOGI(TAG, "Network up after %lld ms, fetching", esp_timer_get_time() / 1000);
+
+    // Restored stop/station, if any; skipped by the fetch task otherwise
+    transport_data_force_refresh();
+
+    // Start refresh timer (it will check if station is selected before fetching)
+    TimerHandle_t refresh_timer = transport_data_get_refresh_timer();
+    if (refresh_timer) {
+        int interval = transport_data_get_refresh_interval();
+        xTimerChangePeriod(refresh_timer, pdMS_TO_TICKS(interval * 60 * 1000), 0);
+        xTimerStart(refresh_timer, 0);
+        ESP_LOGI(TAG, "Started refresh timer with %d minute interval", interval);
     }
-    
-    ESP_LOGI(TAG, "WiFi connected after %d seconds", retries);
 
-    ESP_LOGI(TAG, "WiFi connected, waiting for time sync...");
-    
-    // Wait for time sync (up to 120 seconds to handle unstable WiFi)
-    retries = 0;
-    time_t now;
-    struct tm timeinfo;
-    time(&now);
-    localtime_r(&now, &timeinfo);
-    
-    while (timeinfo.tm_year < (2020 - 1900) && retries < 120) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        time(&now);
-        localtime_r(&now, &timeinfo);
-        retries++;
-        
-        // Check if we're still connected to WiFi
-        if (!network_manager_is_connected() && retries % 10 == 0) {
-            ESP_LOGW(TAG, "WiFi disconnected during time sync, waiting for reconnection...");
-        }
-        
-        if (retries % 10 == 0) {
-            ESP_LOGI(TAG, "Waiting for time sync... (%d/120)", retries);
-        }
+    int64_t deadline = esp_timer_get_time() + BOOT_TIMELINE_WAIT_MS * 1000LL;
+    while ((!boot_timeline_get_us(BOOT_STAGE_DATA) || !boot_timeline_get_us(BOOT_STAGE_TIME)) &&
+           esp_timer_get_time() < deadline) {
+        vTaskDelay(pdMS_TO_TICKS(500));
     }
-    
-    if (timeinfo.tm_year < (2020 - 1900)) {
-        ESP_LOGW(TAG, "Time sync timeout after %d seconds - continuing with unsynced time", retries);
-        ESP_LOGW(TAG, "Application will retry NTP sync when WiFi connection stabilizes");
-    } else {
-        ESP_LOGI(TAG, "Time synced successfully after %d seconds: %s", retries, asctime(&timeinfo));
+    if (!boot_timeline_get_us(BOOT_STAGE_TIME)) {
+        ESP_LOGW(TAG, "SNTP not synced yet, it keeps retrying in the background");
     }
+    boot_timeline_print();
 
-    ESP_LOGI(TAG, "Checking internet connectivity (ping 1.1.1.1)...");
-    if (network_manager_ping("1.1.1.1") == ESP_OK) {
-        ESP_LOGI(TAG, "Internet access confirmed");
-        
-        // Start refresh timer (it will check if station is selected before fetching)
-        TimerHandle_t refresh_timer = transport_data_get_refresh_timer();
-        if (refresh_timer) {
-            int interval = transport_data_get_refresh_interval();
-            xTimerChangePeriod(refresh_timer, pdMS_TO_TICKS(interval * 60 * 1000), 0);
-            xTimerStart(refresh_timer, 0);
-            ESP_LOGI(TAG, "Started refresh timer with %d minute interval", interval);
-        }
-    } else {
-        ESP_LOGE(TAG, "Ping failed, no internet access?");
-    }
-    
     vTaskDelete(NULL);
 }
 
+static void view_event_task(void *arg)
+{
+    while (1) {
+        esp_event_loop_run(view_event_handle, portMAX_DELAY);
+    }
+}
+
 void app_main(void)
 {
+    boot_timeline_mark(BOOT_STAGE_APP_START);
     ESP_LOGI("", SENSECAP, VERSION, __DATE__, __TIME__);
 
-    ESP_ERROR_CHECK(bsp_board_init());
-    lv_port_init();
-
+    /*
+     * No dispatch task yet: model events posted while the board and UI come
+     * up wait in the queue until the view has registered its handlers.
+     */
     esp_event_loop_args_t view_event_task_args = {
-        .queue_size = 20,
-        .task_name = "view_event_task",
-        .task_priority = uxTaskPriorityGet(NULL),
-        .task_stack_size = 10240,
-        .task_core_id = tskNO_AFFINITY
+        .queue_size = 32,
+        .task_name = NULL,
     };
 
     ESP_ERROR_CHECK(esp_event_loop_create(&view_event_task_args, &view_event_handle));
 
+    // Storage, then WiFi/SNTP on their own task while the display comes up
+    indicator_model_early_init();
+
+    ESP_ERROR_CHECK(bsp_board_init());
+    boot_timeline_mark(BOOT_STAGE_BSP);
+    lv_port_init();
+    boot_timeline_mark(BOOT_STAGE_LVGL);
+
     lv_port_sem_take();
     indicator_view_init();
     lv_port_sem_give();
+    boot_timeline_mark(BOOT_STAGE_UI);
+
+    __g_network_sem = xSemaphoreCreateBinary();
+    ESP_ERROR_CHECK(esp_event_handler_instance_register_with(view_event_handle,
+                                                            VIEW_EVENT_BASE, VIEW_EVENT_WIFI_ST,
+                                                            __boot_event_handler, NULL, NULL));
+    xTaskCreate(view_event_task, "view_event_task", 10240, NULL, uxTaskPriorityGet(NULL), NULL);
 
     indicator_model_init();
+
+    // Draw the first frame now rather than on the next LVGL tick; the backlight is on
+    lv_port_sem_take();
+    lv_refr_now(NULL);
+    lv_port_sem_give();
+    boot_timeline_mark(BOOT_STAGE_SCREEN);
+
     /* Trigger initial settings/button state now that model is inited */
     {
         struct view_data_settings settings = {0};
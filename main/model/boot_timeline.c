@@ -0,0 +1,119 @@
+#include "boot_timeline.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+static const char *TAG = "boot";
+
+static const char *const stage_names[BOOT_STAGE_MAX] = {
+    [BOOT_STAGE_APP_START]  = "app start",
+    [BOOT_STAGE_STORAGE]    = "storage",
+    [BOOT_STAGE_WIFI_START] = "wifi start",
+    [BOOT_STAGE_BSP]        = "board",
+    [BOOT_STAGE_LVGL]       = "lvgl",
+    [BOOT_STAGE_UI]         = "ui built",
+    [BOOT_STAGE_SCREEN]     = "screen",
+    [BOOT_STAGE_WIFI_IP]    = "wifi ip",
+    [BOOT_STAGE_NETWORK]    = "network",
+    [BOOT_STAGE_FETCH]      = "fetch",
+    [BOOT_STAGE_DATA]       = "live data",
+    [BOOT_STAGE_TIME]       = "sntp",
+};
+
+static int64_t marks_us[BOOT_STAGE_MAX];
+static portMUX_TYPE marks_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void boot_timeline_mark(enum boot_stage stage)
+{
+    if (stage >= BOOT_STAGE_MAX) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    bool first = false;
+    portENTER_CRITICAL(&marks_lock);
+    if (marks_us[stage] == 0) {
+        marks_us[stage] = now > 0 ? now : 1;
+        first = true;
+    }
+    portEXIT_CRITICAL(&marks_lock);
+
+    if (first) {
+        ESP_LOGI(TAG, "%s at %lld ms", stage_names[stage], now / 1000);
+    }
+}
+
+int64_t boot_timeline_get_us(enum boot_stage stage)
+{
+    if (stage >= BOOT_STAGE_MAX) {
+        return 0;
+    }
+    portENTER_CRITICAL(&marks_lock);
+    int64_t us = marks_us[stage];
+    portEXIT_CRITICAL(&marks_lock);
+    return us;
+}
+
+// Stages reached, in the order they happened. Returns how many
+static int __sorted(int64_t *us, int *order)
+{
+    int n = 0;
+    portENTER_CRITICAL(&marks_lock);
+    for (int i = 0; i < BOOT_STAGE_MAX; i++) {
+        us[i] = marks_us[i];
+    }
+    portEXIT_CRITICAL(&marks_lock);
+
+    for (int i = 0; i < BOOT_STAGE_MAX; i++) {
+        if (us[i] == 0) {
+            continue;
+        }
+        int j = n++;
+        while (j > 0 && us[order[j - 1]] > us[i]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    return n;
+}
+
+void boot_timeline_print(void)
+{
+    int64_t us[BOOT_STAGE_MAX];
+    int order[BOOT_STAGE_MAX];
+    int n = __sorted(us, order);
+
+    ESP_LOGI(TAG, "Boot timeline (ms since app start, +ms since previous):");
+    int64_t prev = 0;
+    for (int i = 0; i < n; i++) {
+        int64_t t = us[order[i]];
+        ESP_LOGI(TAG, "  %-10s %6lld  +%lld", stage_names[order[i]], t / 1000, (t - prev) / 1000);
+        prev = t;
+    }
+}
+
+size_t boot_timeline_format(char *buf, size_t len)
+{
+    if (!buf || len == 0) {
+        return 0;
+    }
+
+    int64_t us[BOOT_STAGE_MAX];
+    int order[BOOT_STAGE_MAX];
+    int n = __sorted(us, order);
+
+    size_t used = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < n && used < len; i++) {
+        int ret = snprintf(buf + used, len - used, "%s%s: %lld ms", used ? "\n" : "",
+                           stage_names[order[i]], us[order[i]] / 1000);
+        if (ret < 0) {
+            break;
+        }
+        used += ret;
+    }
+    return used < len ? used : len - 1;
+}
@@ -0,0 +1,58 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Startup timeline: each boot stage records when it was first reached, in
+ * microseconds since the application started (ROM and bootloader time,
+ * typically a few hundred ms, comes on top).
+ */
+
+enum boot_stage {
+    BOOT_STAGE_APP_START = 0,   // app_main entered
+    BOOT_STAGE_STORAGE,         // NVS open, settings readable
+    BOOT_STAGE_WIFI_START,      // radio started, connecting in the background
+    BOOT_STAGE_BSP,             // panel, touch and IO expander up
+    BOOT_STAGE_LVGL,
+    BOOT_STAGE_UI,              // widgets built
+    BOOT_STAGE_SCREEN,          // first frame drawn, backlight on
+    BOOT_STAGE_WIFI_IP,
+    BOOT_STAGE_NETWORK,         // connectivity check passed, fetches allowed
+    BOOT_STAGE_FETCH,           // first board request sent
+    BOOT_STAGE_DATA,            // first live board handed to the UI
+    BOOT_STAGE_TIME,            // SNTP synced
+    BOOT_STAGE_MAX,
+};
+
+/**
+ * @brief Record that a stage was reached, later calls for it are ignored
+ */
+void boot_timeline_mark(enum boot_stage stage);
+
+/**
+ * @return Time the stage was reached in us, 0 if not (yet)
+ */
+int64_t boot_timeline_get_us(enum boot_stage stage);
+
+/**
+ * @brief Log the stages reached so far in the order they happened
+ */
+void boot_timeline_print(void);
+
+/**
+ * @brief One "name  ms" line per stage reached, for the sysinfo screen
+ * @return Length written, excluding the terminator
+ */
+size_t boot_timeline_format(char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOOT_TIMELINE_H
@@ -0,0 +1,340 @@
+#include "dns_cache.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "dns_cache";
+
+#define DNS_CACHE_REFRESH_STACK  3072
+#define DNS_TYPE_A               1
+#define DNS_TYPE_CNAME           5
+#define DNS_CLASS_IN             1
+
+struct dns_cache_entry {
+    char     host[DNS_CACHE_HOST_MAX];
+    uint32_t addr;
+    int64_t  expires;       // monotonic seconds
+    int64_t  refresh_at;
+    int64_t  retry_at;      // no resolver calls before this while stale
+    int64_t  last_used;
+    bool     refreshing;
+};
+
+static struct dns_cache_entry __g_entries[DNS_CACHE_ENTRIES];
+static struct dns_cache_stats __g_stats;
+static dns_cache_resolver_t __g_resolver = NULL;
+static SemaphoreHandle_t __g_dns_mutex = NULL;
+
+static int64_t __now_s(void)
+{
+    return esp_timer_get_time() / 1000000;
+}
+
+static bool __is_ip_literal(const char *host)
+{
+    for (const char *p = host; *p; p++) {
+        if (*p == ':') {
+            return true;
+        }
+        if (*p != '.' && (*p < '0' || *p > '9')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static struct dns_cache_entry *__entry_find(const char *host)
+{
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        if (__g_entries[i].host[0] && strcasecmp(__g_entries[i].host, host) == 0) {
+            return &__g_entries[i];
+        }
+    }
+    return NULL;
+}
+
+static struct dns_cache_entry *__entry_victim(void)
+{
+    struct dns_cache_entry *victim = &__g_entries[0];
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        if (!__g_entries[i].host[0]) {
+            return &__g_entries[i];
+        }
+        if (__g_entries[i].last_used < victim->last_used) {
+            victim = &__g_entries[i];
+        }
+    }
+    return victim;
+}
+
+// Called with the mutex held
+static void __entry_store(const char *host, uint32_t addr, uint32_t ttl_s, int64_t now)
+{
+    if (ttl_s < DNS_CACHE_TTL_MIN_S) ttl_s = DNS_CACHE_TTL_MIN_S;
+    if (ttl_s > DNS_CACHE_TTL_MAX_S) ttl_s = DNS_CACHE_TTL_MAX_S;
+
+    struct dns_cache_entry *e = __entry_find(host);
+    if (!e) {
+        e = __entry_victim();
+        memset(e, 0, sizeof(*e));
+        strncpy(e->host, host, sizeof(e->host) - 1);
+        e->last_used = now;
+    }
+    e->addr = addr;
+    e->expires = now + ttl_s;
+    e->refresh_at = e->expires - ttl_s / 4;
+    e->retry_at = 0;
+    e->refreshing = false;
+    ESP_LOGD(TAG, "%s -> %u.%u.%u.%u, ttl %us", host,
+             (unsigned)(addr & 0xff), (unsigned)((addr >> 8) & 0xff),
+             (unsigned)((addr >> 16) & 0xff), (unsigned)(addr >> 24), (unsigned)ttl_s);
+}
+
+static void __dns_refresh_task(void *p_arg)
+{
+    char *host = (char *)p_arg;
+    uint32_t addr = 0, ttl_s = 0;
+    esp_err_t err = __g_resolver(host, &addr, &ttl_s);
+
+    xSemaphoreTake(__g_dns_mutex, portMAX_DELAY);
+    if (err == ESP_OK) {
+        __entry_store(host, addr, ttl_s, __now_s());
+    } else {
+        struct dns_cache_entry *e = __entry_find(host);
+        if (e) {
+            e->refreshing = false;
+            e->retry_at = __now_s() + DNS_CACHE_RETRY_S;
+        }
+        ESP_LOGW(TAG, "Refresh of %s failed, keeping cached address", host);
+    }
+    xSemaphoreGive(__g_dns_mutex);
+
+    free(host);
+    vTaskDelete(NULL);
+}
+
+esp_err_t dns_cache_init(dns_cache_resolver_t resolver)
+{
+    if (!resolver) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (__g_dns_mutex == NULL) {
+        __g_dns_mutex = xSemaphoreCreateMutex();
+        if (__g_dns_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    __g_resolver = resolver;
+    dns_cache_flush();
+    return ESP_OK;
+}
+
+esp_err_t dns_cache_lookup(const char *host, uint32_t *addr)
+{
+    if (!host || !addr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!__g_resolver) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (host[0] == '\0' || strlen(host) >= DNS_CACHE_HOST_MAX || __is_ip_literal(host)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    int64_t now = __now_s();
+    bool refresh = false;
+    bool in_backoff = false;
+
+    xSemaphoreTake(__g_dns_mutex, portMAX_DELAY);
+    struct dns_cache_entry *e = __entry_find(host);
+    if (e && now < e->expires) {
+        *addr = e->addr;
+        e->last_used = now;
+        __g_stats.hits++;
+        if (!e->refreshing && now >= e->refresh_at && now >= e->retry_at) {
+            e->refreshing = true;
+            __g_stats.refreshes++;
+            refresh = true;
+        }
+        xSemaphoreGive(__g_dns_mutex);
+
+        if (refresh) {
+            char *arg = strdup(host);
+            if (!arg || xTaskCreate(__dns_refresh_task, "dns_refresh", DNS_CACHE_REFRESH_STACK,
+                                    arg, 2, NULL) != pdPASS) {
+                free(arg);
+                xSemaphoreTake(__g_dns_mutex, portMAX_DELAY);
+                e = __entry_find(host);
+                if (e) e->refreshing = false;
+                xSemaphoreGive(__g_dns_mutex);
+            }
+        }
+        return ESP_OK;
+    }
+    if (e && now < e->retry_at) {
+        in_backoff = true;
+    }
+    xSemaphoreGive(__g_dns_mutex);
+
+    uint32_t new_addr = 0, ttl_s = 0;
+    esp_err_t err = in_backoff ? ESP_FAIL : __g_resolver(host, &new_addr, &ttl_s);
+
+    xSemaphoreTake(__g_dns_mutex, portMAX_DELAY);
+    now = __now_s();
+    if (err == ESP_OK) {
+        __g_stats.misses++;
+        __entry_store(host, new_addr, ttl_s, now);
+        __entry_find(host)->last_used = now;
+        *addr = new_addr;
+    } else {
+        e = __entry_find(host);
+        if (e && now - e->expires < DNS_CACHE_STALE_MAX_S) {
+            if (!in_backoff) {
+                e->retry_at = now + DNS_CACHE_RETRY_S;
+                ESP_LOGW(TAG, "Resolver failed for %s, using last known address", host);
+            }
+            e->last_used = now;
+            *addr = e->addr;
+            __g_stats.stale++;
+            err = ESP_OK;
+        } else {
+            __g_stats.failures++;
+            err = ESP_FAIL;
+        }
+    }
+    xSemaphoreGive(__g_dns_mutex);
+    return err;
+}
+
+void dns_cache_flush(void)
+{
+    if (__g_dns_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(__g_dns_mutex, portMAX_DELAY);
+    memset(__g_entries, 0, sizeof(__g_entries));
+    memset(&__g_stats, 0, sizeof(__g_stats));
+    xSemaphoreGive(__g_dns_mutex);
+}
+
+void dns_cache_get_stats(struct dns_cache_stats *stats)
+{
+    if (!stats || __g_dns_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(__g_dns_mutex, portMAX_DELAY);
+    *stats = __g_stats;
+    xSemaphoreGive(__g_dns_mutex);
+}
+
+size_t dns_cache_build_query(uint8_t *buf, size_t buf_len, uint16_t id, const char *host)
+{
+    size_t name_len = strlen(host);
+    if (name_len == 0 || name_len > 253 || buf_len < 12 + name_len + 2 + 4) {
+        return 0;
+    }
+
+    memset(buf, 0, 12);
+    buf[0] = id >> 8;
+    buf[1] = id & 0xff;
+    buf[2] = 0x01;              // RD
+    buf[5] = 1;                 // QDCOUNT
+
+    size_t pos = 12;
+    const char *label = host;
+    while (*label) {
+        const char *dot = strchr(label, '.');
+        size_t len = dot ? (size_t)(dot - label) : strlen(label);
+        if (len == 0 || len > 63) {
+            return 0;
+        }
+        buf[pos++] = (uint8_t)len;
+        memcpy(&buf[pos], label, len);
+        pos += len;
+        label += len + (dot ? 1 : 0);
+    }
+    buf[pos++] = 0;
+    buf[pos++] = 0;
+    buf[pos++] = DNS_TYPE_A;
+    buf[pos++] = 0;
+    buf[pos++] = DNS_CLASS_IN;
+    return pos;
+}
+
+// Returns the offset after the name, 0 if it runs past the end
+static size_t __skip_name(const uint8_t *buf, size_t len, size_t pos)
+{
+    while (pos < len) {
+        uint8_t c = buf[pos];
+        if ((c & 0xc0) == 0xc0) {
+            return pos + 2 <= len ? pos + 2 : 0;
+        }
+        if (c & 0xc0) {
+            return 0;
+        }
+        if (c == 0) {
+            return pos + 1;
+        }
+        pos += 1 + c;
+    }
+    return 0;
+}
+
+esp_err_t dns_cache_parse_reply(const uint8_t *buf, size_t len, uint16_t id,
+                                uint32_t *addr, uint32_t *ttl_s)
+{
+    if (len < 12 || ((buf[0] << 8) | buf[1]) != id || !(buf[2] & 0x80)) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    uint8_t rcode = buf[3] & 0x0f;
+    if (rcode == 3) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (rcode != 0) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    uint16_t qdcount = (buf[4] << 8) | buf[5];
+    uint16_t ancount = (buf[6] << 8) | buf[7];
+    size_t pos = 12;
+
+    for (uint16_t i = 0; i < qdcount; i++) {
+        pos = __skip_name(buf, len, pos);
+        if (pos == 0 || pos + 4 > len) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        pos += 4;
+    }
+
+    uint32_t min_ttl = UINT32_MAX;
+    for (uint16_t i = 0; i < ancount; i++) {
+        pos = __skip_name(buf, len, pos);
+        if (pos == 0 || pos + 10 > len) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        uint16_t type = (buf[pos] << 8) | buf[pos + 1];
+        uint16_t cls = (buf[pos + 2] << 8) | buf[pos + 3];
+        uint32_t ttl = ((uint32_t)buf[pos + 4] << 24) | ((uint32_t)buf[pos + 5] << 16) |
+                       ((uint32_t)buf[pos + 6] << 8) | buf[pos + 7];
+        uint16_t rdlen = (buf[pos + 8] << 8) | buf[pos + 9];
+        pos += 10;
+        if (pos + rdlen > len) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        if (cls == DNS_CLASS_IN && (type == DNS_TYPE_A || type == DNS_TYPE_CNAME) && ttl < min_ttl) {
+            min_ttl = ttl;
+        }
+        if (cls == DNS_CLASS_IN && type == DNS_TYPE_A && rdlen == 4) {
+            memcpy(addr, &buf[pos], 4);     // already network byte order
+            *ttl_s = min_ttl;
+            return ESP_OK;
+        }
+        pos += rdlen;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
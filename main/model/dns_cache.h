@@ -0,0 +1,86 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DNS_CACHE_ENTRIES        4      // hosts kept, least recently used is replaced
+#define DNS_CACHE_HOST_MAX       64     // longer names bypass the cache
+#define DNS_CACHE_TTL_MIN_S      30     // clamp for very short / zero TTLs
+#define DNS_CACHE_TTL_MAX_S      3600
+#define DNS_CACHE_STALE_MAX_S    86400  // serve the last address this long past expiry
+#define DNS_CACHE_RETRY_S        15     // resolver back-off while serving stale
+
+/**
+ * @brief Resolve one A record
+ * @param host Hostname
+ * @param addr Output: IPv4 address, network byte order
+ * @param ttl_s Output: TTL of the answer in seconds
+ * @return ESP_OK on success
+ */
+typedef esp_err_t (*dns_cache_resolver_t)(const char *host, uint32_t *addr, uint32_t *ttl_s);
+
+struct dns_cache_stats {
+    uint32_t hits;
+    uint32_t misses;        // resolved synchronously (unknown or expired)
+    uint32_t refreshes;     // asynchronous refreshes started
+    uint32_t stale;         // resolver failed, last known address returned
+    uint32_t failures;      // resolver failed, nothing to fall back to
+};
+
+/**
+ * @brief Initialize the cache
+ * @param resolver Called on a miss and for refreshes, never with the cache locked
+ * @return ESP_OK on success
+ */
+esp_err_t dns_cache_init(dns_cache_resolver_t resolver);
+
+/**
+ * @brief Look up a hostname
+ *
+ * Fresh entries are returned without calling the resolver; once less than a
+ * quarter of the TTL is left a refresh is started in the background. Expired
+ * or unknown names are resolved synchronously. If that fails, the last known
+ * address is returned for up to DNS_CACHE_STALE_MAX_S.
+ *
+ * @param host Hostname
+ * @param addr Output: IPv4 address, network byte order
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED for IP literals and
+ *         over-long names, ESP_ERR_INVALID_STATE before init, ESP_FAIL if
+ *         the name could not be resolved
+ */
+esp_err_t dns_cache_lookup(const char *host, uint32_t *addr);
+
+/**
+ * @brief Drop all entries
+ */
+void dns_cache_flush(void);
+
+void dns_cache_get_stats(struct dns_cache_stats *stats);
+
+/**
+ * @brief Build a recursive A query for host
+ * @return Query length, 0 if buf is too small or the name is invalid
+ */
+size_t dns_cache_build_query(uint8_t *buf, size_t buf_len, uint16_t id, const char *host);
+
+/**
+ * @brief Take the first A record from a reply to a query built above
+ * @param ttl_s Output: smallest TTL along the answer chain (CNAMEs included)
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND for NXDOMAIN / no A record,
+ *         ESP_ERR_INVALID_RESPONSE for a malformed or mismatched reply
+ */
+esp_err_t dns_cache_parse_reply(const uint8_t *buf, size_t len, uint16_t id,
+                                uint32_t *addr, uint32_t *ttl_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DNS_CACHE_H
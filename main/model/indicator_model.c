@@ -6,22 +6,53 @@
 #include "indicator_btn.h"
 #include "network_manager.h"
 #include "transport_data.h"
+#include "boot_timeline.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "esp_log.h"
 
 static const char *TAG = "model";
 
+static SemaphoreHandle_t __g_net_init_done = NULL;
+
+/**
+ * @brief Network bring-up, runs while the display and UI are initialised
+ */
+static void __model_net_task(void *arg)
+{
+    indicator_wifi_init();
+    indicator_time_init();
+
+    // Initialize network manager (must be after WiFi)
+    network_manager_init();
+
+    xSemaphoreGive(__g_net_init_done);
+    vTaskDelete(NULL);
+}
+
+int indicator_model_early_init(void)
+{
+    ESP_LOGI(TAG, "Starting storage and network...");
+
+    // Everything else reads its settings from here
+    indicator_storage_init();
+    boot_timeline_mark(BOOT_STAGE_STORAGE);
+
+    __g_net_init_done = xSemaphoreCreateBinary();
+    xTaskCreate(__model_net_task, "model_net_init", 1024 * 4, NULL, 5, NULL);
+    return 0;
+}
+
 int indicator_model_init(void)
 {
     ESP_LOGI(TAG, "Initializing model components...");
     
-    indicator_storage_init();
-    indicator_wifi_init();
-    indicator_time_init();
     indicator_display_init();
     indicator_btn_init();
-    
-    // Initialize network manager (must be after WiFi)
-    network_manager_init();
+
+    // Callers query WiFi state right after this returns
+    xSemaphoreTake(__g_net_init_done, portMAX_DELAY);
     
     // Initialize transport data module with smart refresh
     transport_data_init();
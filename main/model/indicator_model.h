@@ -7,6 +7,18 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Open storage and start WiFi/SNTP on a separate task
+ *
+ * Needs view_event_handle, not the display. Call before the board and UI
+ * are initialised so the radio connects in the meantime.
+ */
+int indicator_model_early_init(void);
+
+/**
+ * @brief Display, buttons and transport data; waits for the network
+ * bring-up started by indicator_model_early_init()
+ */
 int indicator_model_init(void);
 
 #ifdef __cplusplus
@@ -1,7 +1,146 @@
 #include "indicator_storage.h"
 #include "nvs_flash.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
 
 #define STORAGE_NAMESPACE "indicator"
+#define STORAGE_NVS_ENTRY_SIZE  32      // Blob data is stored in 32 byte entries after a header entry
+
+static const char *TAG = "storage";
+
+struct storage_cache_entry {
+    char     key[NVS_KEY_NAME_MAX_SIZE];
+    uint8_t *data;
+    size_t   len;
+    bool     present;       // false: key known to be absent from NVS
+    bool     dirty;         // newer than flash, written back by the flush
+    uint32_t last_used;
+};
+
+static nvs_handle_t __g_handle;
+static bool __g_open = false;
+static SemaphoreHandle_t __g_storage_mutex = NULL;
+static SemaphoreHandle_t __g_flush_sem = NULL;
+static struct storage_cache_entry __g_cache[INDICATOR_STORAGE_CACHE_ENTRIES];
+static struct indicator_storage_stats __g_stats;
+static bool __g_flush_pending = false;
+static bool __g_commit_pending = false;
+static uint32_t __g_use_clock = 0;
+
+static struct storage_cache_entry *__cache_find(const char *key)
+{
+    for (int i = 0; i < INDICATOR_STORAGE_CACHE_ENTRIES; i++) {
+        if (__g_cache[i].key[0] && strcmp(__g_cache[i].key, key) == 0) {
+            __g_cache[i].last_used = ++__g_use_clock;
+            return &__g_cache[i];
+        }
+    }
+    return NULL;
+}
+
+// Called with the mutex held. NULL if the value is too big or every slot is waiting for the flush
+static struct storage_cache_entry *__cache_load(const char *key)
+{
+    size_t len = 0;
+    esp_err_t err = nvs_get_blob(__g_handle, key, NULL, &len);
+    if ((err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) || len > INDICATOR_STORAGE_CACHE_BLOB_MAX ||
+        strlen(key) >= NVS_KEY_NAME_MAX_SIZE) {
+        return NULL;
+    }
+
+    struct storage_cache_entry *e = NULL;
+    for (int i = 0; i < INDICATOR_STORAGE_CACHE_ENTRIES; i++) {
+        struct storage_cache_entry *c = &__g_cache[i];
+        if (!c->key[0]) {
+            e = c;
+            break;
+        }
+        if (!c->dirty && (!e || c->last_used < e->last_used)) {
+            e = c;
+        }
+    }
+    if (!e) {
+        return NULL;
+    }
+
+    uint8_t *data = NULL;
+    if (err == ESP_OK && len > 0) {
+        data = malloc(len);
+        if (!data || nvs_get_blob(__g_handle, key, data, &len) != ESP_OK) {
+            free(data);
+            return NULL;
+        }
+    }
+
+    free(e->data);
+    memset(e, 0, sizeof(*e));
+    strlcpy(e->key, key, sizeof(e->key));
+    e->data = data;
+    e->len = len;
+    e->present = (err == ESP_OK);
+    e->last_used = ++__g_use_clock;
+    return e;
+}
+
+// Called with the mutex held
+static esp_err_t __storage_set(const char *key, const void *data, size_t len)
+{
+    size_t old_len = 0;
+    if (nvs_get_blob(__g_handle, key, NULL, &old_len) == ESP_OK) {
+        __g_stats.entries_erased += 1 + (old_len + STORAGE_NVS_ENTRY_SIZE - 1) / STORAGE_NVS_ENTRY_SIZE;
+    }
+
+    esp_err_t err = nvs_set_blob(__g_handle, key, data, len);
+    if (err == ESP_OK) {
+        __g_stats.blob_writes++;
+        __g_commit_pending = true;
+    }
+    return err;
+}
+
+// Called with the mutex held
+static void __flush_schedule(void)
+{
+    if (!__g_flush_pending) {
+        __g_flush_pending = true;
+        xSemaphoreGive(__g_flush_sem);
+    }
+}
+
+static void __storage_task(void *p_arg)
+{
+    while (1) {
+        xSemaphoreTake(__g_flush_sem, portMAX_DELAY);
+        // Let the rest of a settings change arrive, then commit it in one go
+        vTaskDelay(pdMS_TO_TICKS(INDICATOR_STORAGE_COMMIT_DELAY_MS));
+        indicator_storage_flush();
+    }
+}
+
+static void __view_event_handler(void* handler_args, esp_event_base_t base, int32_t id, void* event_data)
+{
+    switch (id)
+    {
+        case VIEW_EVENT_SHUTDOWN: {
+            // Power may be cut right after, don't wait for the deferred commit
+            indicator_storage_flush();
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void __storage_shutdown_handler(void)
+{
+    indicator_storage_flush();
+}
 
 int indicator_storage_init(void)
 {
@@ -11,43 +150,174 @@ int indicator_storage_init(void)
       ESP_ERROR_CHECK(nvs_flash_erase());
       ret = nvs_flash_init();
     }
+
+    __g_storage_mutex = xSemaphoreCreateMutex();
+    __g_flush_sem = xSemaphoreCreateBinary();
+
+    ret = nvs_open(STORAGE_NAMESPACE, NVS_READWRITE, &__g_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "nvs_open failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    __g_open = true;
+
+    xTaskCreate(&__storage_task, "__storage_task", 1024 * 3, NULL, 5, NULL);
+    esp_register_shutdown_handler(__storage_shutdown_handler);
+    ESP_ERROR_CHECK(esp_event_handler_instance_register_with(view_event_handle,
+                                                            VIEW_EVENT_BASE, VIEW_EVENT_SHUTDOWN,
+                                                            __view_event_handler, NULL, NULL));
+    return 0;
 }
 
 esp_err_t indicator_storage_write(char *p_key, void *p_data, size_t len)
 {
-    nvs_handle_t my_handle;
-    esp_err_t err;
-    err = nvs_open(STORAGE_NAMESPACE, NVS_READWRITE, &my_handle);
-    if (err != ESP_OK) return err;
+    if (!__g_open) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    err = nvs_set_blob(my_handle,  p_key, p_data, len);
-    if (err != ESP_OK) {
-        nvs_close(my_handle);
-        return err;
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(__g_storage_mutex, portMAX_DELAY);
+    __g_stats.writes++;
+
+    struct storage_cache_entry *e = __cache_find(p_key);
+    if (!e && len <= INDICATOR_STORAGE_CACHE_BLOB_MAX) {
+        e = __cache_load(p_key);
     }
-    err = nvs_commit(my_handle);
-    if (err != ESP_OK) {
-        nvs_close(my_handle);
-        return err;
+
+    if (e && e->present && e->len == len && (len == 0 || memcmp(e->data, p_data, len) == 0)) {
+        __g_stats.writes_unchanged++;
+    } else if (e && len <= INDICATOR_STORAGE_CACHE_BLOB_MAX) {
+        if (e->len != len || !e->data) {
+            uint8_t *data = len ? malloc(len) : NULL;
+            if (len && !data) {
+                xSemaphoreGive(__g_storage_mutex);
+                return ESP_ERR_NO_MEM;
+            }
+            free(e->data);
+            e->data = data;
+        }
+        if (len) {
+            memcpy(e->data, p_data, len);
+        }
+        if (e->dirty) {
+            __g_stats.writes_coalesced++;
+        }
+        e->len = len;
+        e->present = true;
+        e->dirty = true;
+        __flush_schedule();
+    } else {
+        // Not cacheable: the blob goes out now, only the commit is deferred
+        if (e) {
+            free(e->data);
+            memset(e, 0, sizeof(*e));
+        }
+        err = __storage_set(p_key, p_data, len);
+        if (err == ESP_OK) {
+            __flush_schedule();
+        }
     }
-    nvs_close(my_handle);
-    return ESP_OK;
+
+    xSemaphoreGive(__g_storage_mutex);
+    return err;
 }
 
 esp_err_t indicator_storage_read(char *p_key, void *p_data, size_t *p_len)
 {
-    nvs_handle_t my_handle;
-    esp_err_t err;
+    if (!__g_open) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    err = nvs_open(STORAGE_NAMESPACE, NVS_READWRITE, &my_handle);
-    if (err != ESP_OK) return err;
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(__g_storage_mutex, portMAX_DELAY);
+    __g_stats.reads++;
 
-    err = nvs_get_blob(my_handle, p_key, p_data, p_len);
-    if (err != ESP_OK) {
-        nvs_close(my_handle);
-        return err;
+    struct storage_cache_entry *e = __cache_find(p_key);
+    if (e) {
+        __g_stats.read_hits++;
+    } else {
+        e = __cache_load(p_key);
     }
-    nvs_close(my_handle);
-    return ESP_OK;
+
+    if (!e) {
+        err = nvs_get_blob(__g_handle, p_key, p_data, p_len);
+    } else if (!e->present) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    } else if (*p_len < e->len) {
+        *p_len = e->len;
+        err = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        if (e->len) {
+            memcpy(p_data, e->data, e->len);
+        }
+        *p_len = e->len;
+    }
+
+    xSemaphoreGive(__g_storage_mutex);
+    return err;
 }
 
+esp_err_t indicator_storage_flush(void)
+{
+    if (!__g_open) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = ESP_OK;
+    int written = 0;
+    xSemaphoreTake(__g_storage_mutex, portMAX_DELAY);
+    __g_flush_pending = false;
+
+    for (int i = 0; i < INDICATOR_STORAGE_CACHE_ENTRIES; i++) {
+        struct storage_cache_entry *e = &__g_cache[i];
+        if (!e->dirty) {
+            continue;
+        }
+        esp_err_t ret = __storage_set(e->key, e->data, e->len);
+        if (ret == ESP_OK) {
+            e->dirty = false;
+            written++;
+        } else {
+            ESP_LOGE(TAG, "write %s failed: %s", e->key, esp_err_to_name(ret));
+            err = ret;
+        }
+    }
+
+    if (__g_commit_pending) {
+        esp_err_t ret = nvs_commit(__g_handle);
+        if (ret == ESP_OK) {
+            __g_commit_pending = false;
+            __g_stats.commits++;
+        } else {
+            ESP_LOGE(TAG, "commit failed: %s", esp_err_to_name(ret));
+            err = ret;
+        }
+    }
+    xSemaphoreGive(__g_storage_mutex);
+
+    if (written) {
+        ESP_LOGD(TAG, "flushed %d values", written);
+    }
+    return err;
+}
+
+esp_err_t indicator_storage_get_stats(struct indicator_storage_stats *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!__g_open) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(__g_storage_mutex, portMAX_DELAY);
+    *stats = __g_stats;
+    xSemaphoreGive(__g_storage_mutex);
+
+    nvs_stats_t nvs_stats;
+    if (nvs_get_stats(NULL, &nvs_stats) == ESP_OK) {
+        stats->used_entries = nvs_stats.used_entries;
+        stats->free_entries = nvs_stats.free_entries;
+    }
+    return ESP_OK;
+}
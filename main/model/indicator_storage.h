@@ -8,15 +8,43 @@
 extern "C" {
 #endif
 
+#define INDICATOR_STORAGE_COMMIT_DELAY_MS   2000    // Writes within this window share one commit
+#define INDICATOR_STORAGE_CACHE_ENTRIES     12
+#define INDICATOR_STORAGE_CACHE_BLOB_MAX    4096    // Larger blobs bypass the RAM cache
+
+struct indicator_storage_stats {
+    uint32_t reads;
+    uint32_t read_hits;         // Served from RAM
+    uint32_t writes;
+    uint32_t writes_unchanged;  // Same value as stored, dropped
+    uint32_t writes_coalesced;  // Replaced a value still waiting for the commit
+    uint32_t blob_writes;       // nvs_set_blob calls that reached flash
+    uint32_t commits;
+    uint32_t entries_erased;    // NVS entries released by overwrites, the wear that pages pay for
+    size_t   used_entries;
+    size_t   free_entries;
+};
 
 int indicator_storage_init(void);
 
+/**
+ * Values are cached in RAM and written back after
+ * INDICATOR_STORAGE_COMMIT_DELAY_MS, so several settings changed together
+ * cost one commit. Writing the stored value again does not touch flash.
+ */
 esp_err_t indicator_storage_write(char *p_key, void *p_data, size_t len);
 
 
 //p_len : inout
 esp_err_t indicator_storage_read(char *p_key, void *p_data, size_t *p_len);
 
+/**
+ * @brief Write pending values and commit now
+ */
+esp_err_t indicator_storage_flush(void);
+
+esp_err_t indicator_storage_get_stats(struct indicator_storage_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,4 +1,5 @@
 #include "indicator_time.h"
+#include "boot_timeline.h"
 #include "esp_sntp.h"
 #include "freertos/semphr.h"
 #include<stdlib.h>
@@ -64,6 +65,7 @@ static void __time_sync_notification_cb(struct timeval *tv)
     strftime(strftime_buf, sizeof(strftime_buf), "%Y-%m-%d %H:%M:%S %Z", &timeinfo);
     
     ESP_LOGI("ntp", "Time synchronized successfully: %s", strftime_buf);
+    boot_timeline_mark(BOOT_STAGE_TIME);
     
     // Ensure timezone is set correctly after sync
     setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
@@ -1,17 +1,22 @@
 #include "indicator_wifi.h"
 #include "indicator_storage.h"
+#include "boot_timeline.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/timers.h"
 #include "freertos/event_groups.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
 
 #include "lwip/err.h"
 #include "lwip/sys.h"
 #include "lwip/inet.h"
 #include "lwip/netdb.h"
 #include "lwip/sockets.h"
+#include "lwip/dhcp.h"
 #include "esp_event.h"
 #include "ping/ping_sock.h"
 #include "nvs_flash.h"
@@ -24,6 +29,46 @@
 #define WIFI_SAVED_NETWORKS_STORAGE "wifi-saved"  // Max 15 chars for NVS key
 #define WIFI_BACKUP_FALLBACK_MS (2 * 60 * 1000)
 
+/* Fast reconnect: last AP (BSSID, channel) and DHCP lease, reused on the next connect */
+#define WIFI_FAST_RECONNECT_EN      1
+#define WIFI_FAST_CACHE_STORAGE     "wifi-fast"
+#define WIFI_FAST_CACHE_VERSION     1
+#define WIFI_LEASE_MIN_LEFT_S       120                 // Don't reuse a lease this close to expiry
+#define WIFI_LEASE_UNVERIFIED_MS    (10 * 60 * 1000)    // Drop a lease if wall time never syncs
+#define WIFI_TIME_VALID_MIN         1735689600          // 2025-01-01, same check as transport_data
+
+/* Modem power policy: max modem sleep between fetches, awake around network bursts */
+#define WIFI_PS_POLICY_EN           1
+#define WIFI_PS_LISTEN_INTERVAL     10                  // Beacons between wakes in max modem sleep (~1 s)
+#define WIFI_PS_TAIL_MS             3000                // Stay awake after the last request ends
+#define WIFI_PS_PING_EVERY          60                  // Task ticks (5 s) between connectivity checks
+#define WIFI_PS_PING_MAX_DEFER      240                 // Check without a wake window after 20 min
+#define WIFI_TASK_TICK_MS           5000                // Period of the net check counters, scan events wake the task in between
+#define WIFI_RECONNECT_TICKS        5                   // Task ticks before restarting WiFi while configured but disconnected
+#define WIFI_PS_STATS_PERIOD_US     (3600LL * 1000 * 1000)
+
+/* Scanning: list requests stream results channel by channel, background scans keep the cache warm */
+#define WIFI_SCAN_CHANNEL_MAX       13                  // CH/EU channel plan
+#define WIFI_SCAN_CACHE_SIZE        24
+#define WIFI_SCAN_ACTIVE_MAX_MS     120                 // Per-channel dwell, list request
+#define WIFI_SCAN_PASSIVE_MS        110                 // One beacon interval (102.4 ms), IDF default is 360
+#define WIFI_SCAN_BG_PERIOD_S       900                 // Background scan once the cache is this old
+#define WIFI_SCAN_TIMEOUT_MS        3000                // Give up on a channel whose SCAN_DONE never came
+
+struct wifi_fast_cache
+{
+    uint8_t  version;
+    uint8_t  channel;
+    uint8_t  bssid[6];
+    char     ssid[33];
+    bool     lease_valid;
+    esp_netif_ip_info_t ip_info;
+    esp_ip4_addr_t dns_main;
+    esp_ip4_addr_t dns_backup;
+    uint32_t lease_s;           // DHCP lease time (T0)
+    int64_t  lease_start;       // Wall time the lease was obtained
+};
+
 struct indicator_wifi
 {
     struct view_data_wifi_st  st;
@@ -47,9 +92,52 @@ static bool __g_auto_save_pending = false;
 
 static EventGroupHandle_t __wifi_event_group;
 
-static const char *TAG = "wifi-model";
+static esp_netif_t *__g_sta_netif = NULL;
+static bool __g_fast_connect_active = false;    // Targeted BSSID/channel connect in progress
+static bool __g_static_lease = false;           // Cached lease in use, DHCP client stopped
+static bool __g_fast_cache_pending = false;     // Cache update deferred to __indicator_wifi_task
+static int64_t __g_static_lease_since_us = 0;
+static int64_t __g_got_ip_us = 0;
+static struct wifi_fast_cache __g_fast_cache;
+
+static SemaphoreHandle_t   __g_ps_mutex;
+static esp_timer_handle_t  __g_ps_timer = NULL;
+static int __g_ps_refs = 0;                     // Requests in flight
+static int64_t __g_ps_hold_until_us = 0;        // Wake window end
+static bool __g_ps_awake = false;               // WIFI_PS_NONE applied
+static int64_t __g_ps_changed_us = 0;
+static int64_t __g_ps_awake_us = 0;             // Time awake in the current stats period
+static int64_t __g_ps_stats_since_us = 0;
+
+enum wifi_scan_mode {
+    WIFI_SCAN_IDLE = 0,
+    WIFI_SCAN_LIST,                             // Active, one channel at a time, results posted
+    WIFI_SCAN_BACKGROUND,                       // Passive, all channels, cache only
+};
+
+struct wifi_scan_entry {
+    char    ssid[33];
+    int8_t  rssi;
+    uint8_t channel;
+    bool    auth_mode;
+    int64_t seen_us;
+};
 
-static int min(int a, int b) { return (a < b) ? a : b; }
+/* Scan state, only touched by __indicator_wifi_task */
+static struct wifi_scan_entry __g_scan_cache[WIFI_SCAN_CACHE_SIZE];
+static int64_t __g_scan_cache_us = 0;           // Last complete pass, 0 = never
+static enum wifi_scan_mode __g_scan_mode = WIFI_SCAN_IDLE;
+static bool __g_scan_post_result = false;       // A list request is waiting on the pass in progress
+static uint8_t __g_scan_channel = 0;            // Channel in progress, 0 = all
+static int64_t __g_scan_pass_us = 0;
+static int64_t __g_scan_channel_us = 0;
+static wifi_ap_record_t __g_scan_records[WIFI_SCAN_CACHE_SIZE];
+static struct view_data_wifi_list __g_scan_list;
+static volatile bool __g_scan_list_req = false; // Set by the view handler
+static volatile bool __g_scan_done = false;     // Set on WIFI_EVENT_SCAN_DONE
+static volatile bool __g_scan_done_ok = false;
+
+static const char *TAG = "wifi-model";
 
 // Forward declarations for new multi-network functions
 static esp_err_t __wifi_saved_networks_load(struct view_data_wifi_saved_list *list);
@@ -58,6 +146,8 @@ static esp_err_t __wifi_saved_network_add(const char *ssid, const char *password
 static esp_err_t __wifi_saved_network_delete(const char *ssid);
 static bool __wifi_saved_network_find(const char *ssid, struct view_data_wifi_saved *out_network);
 static void __wifi_try_next_saved_network(void);
+static void __wifi_fast_connect_fallback(void);
+static bool __wifi_ps_is_awake(void);
 
 static void __wifi_st_set( struct view_data_wifi_st *p_st )
 {
@@ -133,9 +223,25 @@ static void __wifi_event_handler(void* arg, esp_event_base_t event_base,
             esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_WIFI_CONNECT_RET, &msg, sizeof(msg), portMAX_DELAY);
             break;
         }
+        case WIFI_EVENT_SCAN_DONE: {
+            wifi_event_sta_scan_done_t *event = (wifi_event_sta_scan_done_t*) event_data;
+            ESP_LOGD(TAG, "wifi event: WIFI_EVENT_SCAN_DONE, status %u, %u APs",
+                     (unsigned)event->status, (unsigned)event->number);
+            __g_scan_done_ok = (event->status == 0);
+            __g_scan_done = true;
+            xSemaphoreGive(__g_net_check_sem);
+            break;
+        }
         case WIFI_EVENT_STA_DISCONNECTED: {
             ESP_LOGI(TAG, "wifi event: WIFI_EVENT_STA_DISCONNECTED");
 
+            /* Cached AP not reachable: retry once with a full scan before counting retries */
+            if (__g_fast_connect_active) {
+                __wifi_fast_connect_fallback();
+                esp_wifi_connect();
+                break;
+            }
+
             if ( (wifi_retry_max == -1) || s_retry_num < wifi_retry_max) {
                 esp_wifi_connect();
                 s_retry_num++;
@@ -174,6 +280,14 @@ static void __ip_event_handler(void* arg, esp_event_base_t event_base,
         ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
         s_retry_num = 0;
 
+        __g_got_ip_us = esp_timer_get_time();
+        boot_timeline_mark(BOOT_STAGE_WIFI_IP);
+        ESP_LOGI(TAG, "Got IP %lld ms after boot (%s connect, %s)", __g_got_ip_us / 1000,
+                 __g_fast_connect_active ? "targeted" : "scan",
+                 __g_static_lease ? "cached lease" : "DHCP");
+        __g_fast_connect_active = false;
+        __g_fast_cache_pending = true;
+
         // Set flag for auto-save (deferred to __indicator_wifi_task)
         __g_auto_save_pending = true;
 
@@ -188,28 +302,449 @@ static void __ip_event_handler(void* arg, esp_event_base_t event_base,
 //     return true; //todo
 // }
 
-static int __wifi_scan(wifi_ap_record_t *p_ap_info, uint16_t number)
+/**
+ * Scanning. A list request posts the cached networks straight away, then scans
+ * one channel at a time and posts the list again after every channel that
+ * found something, so the screen fills while the scan is still running. When
+ * the cache is older than WIFI_SCAN_BG_PERIOD_S a short-dwell passive scan of
+ * all channels refreshes it without posting anything.
+ */
+static esp_err_t __wifi_scan_start_channel(void)
 {
-    uint16_t ap_count;
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA) );
-    ESP_ERROR_CHECK(esp_wifi_start());
-    esp_wifi_scan_start(NULL, true);
-    ESP_ERROR_CHECK(esp_wifi_scan_get_ap_num(&ap_count));
-    ESP_ERROR_CHECK(esp_wifi_scan_get_ap_records(&number, p_ap_info));
-    ESP_LOGI(TAG, " scan ap cont: %d", ap_count);
-    
-    for (int i = 0; (i < number) && (i < ap_count); i++) {
-        ESP_LOGI(TAG, "SSID: %s, RSSI:%d, Channel: %d", p_ap_info[i].ssid, p_ap_info[i].rssi, p_ap_info[i].primary);
+    wifi_scan_config_t cfg = {
+        .channel = __g_scan_channel,
+        .show_hidden = false,
+    };
+    if (__g_scan_mode == WIFI_SCAN_BACKGROUND) {
+        cfg.scan_type = WIFI_SCAN_TYPE_PASSIVE;
+        cfg.scan_time.passive = WIFI_SCAN_PASSIVE_MS;
+    } else {
+        cfg.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+        cfg.scan_time.active.min = 0;
+        cfg.scan_time.active.max = WIFI_SCAN_ACTIVE_MAX_MS;
+    }
+    __g_scan_channel_us = esp_timer_get_time();
+    return esp_wifi_scan_start(&cfg, false);
+}
+
+static void __wifi_scan_merge(const wifi_ap_record_t *records, int number, bool complete)
+{
+    int64_t now = esp_timer_get_time();
+
+    for (int i = 0; i < number; i++) {
+        const char *ssid = (const char *)records[i].ssid;
+        if (ssid[0] == '\0') {
+            continue;
+        }
+
+        struct wifi_scan_entry *e = NULL;
+        struct wifi_scan_entry *weakest = NULL;
+        for (int j = 0; j < WIFI_SCAN_CACHE_SIZE; j++) {
+            struct wifi_scan_entry *c = &__g_scan_cache[j];
+            if (c->ssid[0] && strcmp(c->ssid, ssid) == 0) {
+                e = c;
+                break;
+            }
+            if (!weakest || !c->ssid[0] || (weakest->ssid[0] && c->rssi < weakest->rssi)) {
+                weakest = c;
+            }
+        }
+        if (!e) {
+            if (weakest->ssid[0] && weakest->rssi >= records[i].rssi) {
+                continue;
+            }
+            e = weakest;
+            memset(e, 0, sizeof(*e));
+            strlcpy(e->ssid, ssid, sizeof(e->ssid));
+        } else if (e->seen_us >= __g_scan_pass_us && e->rssi >= records[i].rssi) {
+            // Same SSID on another channel in this pass, keep the strongest
+            continue;
+        }
+        e->rssi = records[i].rssi;
+        e->channel = records[i].primary;
+        e->auth_mode = records[i].authmode != WIFI_AUTH_OPEN;
+        e->seen_us = now;
+    }
+
+    // Networks on the scanned channel(s) that did not answer this pass are gone
+    if (complete) {
+        for (int j = 0; j < WIFI_SCAN_CACHE_SIZE; j++) {
+            struct wifi_scan_entry *c = &__g_scan_cache[j];
+            if (c->ssid[0] && c->seen_us < __g_scan_pass_us &&
+                (__g_scan_channel == 0 || c->channel == __g_scan_channel)) {
+                memset(c, 0, sizeof(*c));
+            }
+        }
     }
-    return ap_count;
 }
 
+static void __wifi_scan_post(bool scanning, bool cached)
+{
+    struct view_data_wifi_list *list = &__g_scan_list;
+    struct view_data_wifi_st st;
+    bool taken[WIFI_SCAN_CACHE_SIZE] = { 0 };
+
+    memset(list, 0, sizeof(struct view_data_wifi_list));
+
+    __wifi_st_get(&st);
+    list->is_connect = st.is_connected;
+    if( st.is_connected ) {
+        strlcpy((char *)list->connect.ssid, (char *)st.ssid, sizeof(list->connect.ssid));
+        list->connect.auth_mode = false;
+        list->connect.rssi = st.rssi;
+    }
+
+    // Strongest first
+    while (list->cnt < WIFI_SCAN_LIST_SIZE) {
+        int best = -1;
+        for (int j = 0; j < WIFI_SCAN_CACHE_SIZE; j++) {
+            if (__g_scan_cache[j].ssid[0] && !taken[j] &&
+                (best < 0 || __g_scan_cache[j].rssi > __g_scan_cache[best].rssi)) {
+                best = j;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        taken[best] = true;
+        strlcpy(list->aps[list->cnt].ssid, __g_scan_cache[best].ssid, sizeof(list->aps[0].ssid));
+        list->aps[list->cnt].rssi = __g_scan_cache[best].rssi;
+        list->aps[list->cnt].auth_mode = __g_scan_cache[best].auth_mode;
+        list->cnt++;
+    }
+
+    list->scanning = scanning;
+    if (cached && __g_scan_cache_us) {
+        int64_t age_s = (esp_timer_get_time() - __g_scan_cache_us) / 1000000;
+        list->age_s = age_s > 0 ? (uint32_t)age_s : 1;
+    }
+    esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_WIFI_LIST, list, sizeof(struct view_data_wifi_list ), portMAX_DELAY);
+}
+
+static void __wifi_scan_finish(bool complete)
+{
+    int64_t now = esp_timer_get_time();
+    int cnt = 0;
+    for (int j = 0; j < WIFI_SCAN_CACHE_SIZE; j++) {
+        cnt += __g_scan_cache[j].ssid[0] ? 1 : 0;
+    }
+    if (complete) {
+        __g_scan_cache_us = now;
+    }
+    ESP_LOGI(TAG, "%s scan %s after %lld ms, %d networks cached",
+             __g_scan_mode == WIFI_SCAN_BACKGROUND ? "Background" : "List",
+             complete ? "done" : "aborted", (now - __g_scan_pass_us) / 1000, cnt);
+
+    __g_scan_mode = WIFI_SCAN_IDLE;
+    if (__g_scan_post_result) {
+        __g_scan_post_result = false;
+        __wifi_scan_post(false, !complete);
+    }
+}
+
+static void __wifi_scan_begin(enum wifi_scan_mode mode)
+{
+    __g_scan_mode = mode;
+    __g_scan_post_result = (mode == WIFI_SCAN_LIST);
+    __g_scan_channel = (mode == WIFI_SCAN_LIST) ? 1 : 0;
+    __g_scan_pass_us = esp_timer_get_time();
+
+    esp_err_t err = __wifi_scan_start_channel();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Scan start failed: %s", esp_err_to_name(err));
+        __wifi_scan_finish(false);
+    }
+}
+
+static void __wifi_scan_channel_done(bool ok)
+{
+    uint16_t number = WIFI_SCAN_CACHE_SIZE;
+    if (esp_wifi_scan_get_ap_records(&number, __g_scan_records) != ESP_OK) {
+        number = 0;
+    }
+    if (__g_scan_mode == WIFI_SCAN_IDLE) {
+        return;
+    }
+    __wifi_scan_merge(__g_scan_records, number, ok);
+    if (!ok) {
+        __wifi_scan_finish(false);
+        return;
+    }
+
+    if (__g_scan_mode == WIFI_SCAN_LIST && __g_scan_channel < WIFI_SCAN_CHANNEL_MAX) {
+        if (number > 0) {
+            __wifi_scan_post(true, false);
+        }
+        __g_scan_channel++;
+        if (__wifi_scan_start_channel() == ESP_OK) {
+            return;
+        }
+        __wifi_scan_finish(false);
+        return;
+    }
+    __wifi_scan_finish(true);
+}
+
+/**
+ * @brief Drive the scan state machine, called from __indicator_wifi_task
+ */
+static void __wifi_scan_process(const struct view_data_wifi_st *st)
+{
+    int64_t now = esp_timer_get_time();
+
+    if (__g_scan_done) {
+        __g_scan_done = false;
+        __wifi_scan_channel_done(__g_scan_done_ok);
+    } else if (__g_scan_mode != WIFI_SCAN_IDLE &&
+               now - __g_scan_channel_us > WIFI_SCAN_TIMEOUT_MS * 1000LL) {
+        // SCAN_DONE never came, e.g. the scan was cut short by esp_wifi_stop()
+        __wifi_scan_finish(false);
+    }
+
+    bool list_req = __g_scan_list_req;
+    if (list_req) {
+        __g_scan_list_req = false;
+        __wifi_scan_post(true, true);
+        // A running background pass is handed over instead of restarted
+        __g_scan_post_result = true;
+    }
+
+    if (__g_scan_mode != WIFI_SCAN_IDLE || st->is_connecting) {
+        return;     // A pending list request is retried on the next wake
+    }
+    if (__g_scan_post_result) {
+        __wifi_scan_begin(WIFI_SCAN_LIST);
+    } else if ((__g_scan_pass_us == 0 || now - __g_scan_pass_us > WIFI_SCAN_BG_PERIOD_S * 1000000LL) &&
+               !__wifi_ps_is_awake()) {
+        // Stay off-channel only while no fetch is in flight
+        __wifi_scan_begin(WIFI_SCAN_BACKGROUND);
+    }
+}
+
+
+/**
+ * @brief Hand the interface back to the DHCP client after using a cached lease
+ */
+static void __wifi_dhcp_restart(const char *reason)
+{
+    if (!__g_static_lease) {
+        return;
+    }
+    __g_static_lease = false;
+    ESP_LOGI(TAG, "Cached lease released (%s), starting DHCP", reason);
+    esp_err_t err = esp_netif_dhcpc_start(__g_sta_netif);
+    if (err != ESP_OK && err != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STARTED) {
+        ESP_LOGE(TAG, "DHCP client start failed: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Apply the cached lease as static IP, DHCP client stopped until renewal is due
+ */
+static bool __wifi_static_lease_apply(const struct wifi_fast_cache *cache)
+{
+    if (!cache->lease_valid || cache->lease_s == 0) {
+        return false;
+    }
+
+    time_t now;
+    time(&now);
+    if (now >= WIFI_TIME_VALID_MIN) {
+        int64_t left = cache->lease_start + cache->lease_s - now;
+        if (left < WIFI_LEASE_MIN_LEFT_S) {
+            ESP_LOGI(TAG, "Cached lease expired (%lld s left)", left);
+            return false;
+        }
+    }
+    /* Without wall time (cold boot) the lease is used optimistically and checked once SNTP syncs */
+
+    esp_err_t err = esp_netif_dhcpc_stop(__g_sta_netif);
+    if (err != ESP_OK && err != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED) {
+        return false;
+    }
+    if (esp_netif_set_ip_info(__g_sta_netif, &cache->ip_info) != ESP_OK) {
+        esp_netif_dhcpc_start(__g_sta_netif);
+        return false;
+    }
+
+    esp_netif_dns_info_t dns = {0};
+    dns.ip.type = ESP_IPADDR_TYPE_V4;
+    if (cache->dns_main.addr) {
+        dns.ip.u_addr.ip4 = cache->dns_main;
+        esp_netif_set_dns_info(__g_sta_netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+    if (cache->dns_backup.addr) {
+        dns.ip.u_addr.ip4 = cache->dns_backup;
+        esp_netif_set_dns_info(__g_sta_netif, ESP_NETIF_DNS_BACKUP, &dns);
+    }
+
+    __g_static_lease = true;
+    __g_static_lease_since_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Using cached lease " IPSTR " gw " IPSTR,
+             IP2STR(&cache->ip_info.ip), IP2STR(&cache->ip_info.gw));
+    return true;
+}
+
+/**
+ * @brief Target the cached AP for the next connect instead of scanning all channels
+ *
+ * The targeted config is applied with RAM storage so the flash copy stays the
+ * plain SSID/password config. SSID and password are unchanged, so the PMK the
+ * driver keeps with that config is reused rather than derived again.
+ */
+static bool __wifi_fast_connect_prepare(void)
+{
+#if WIFI_FAST_RECONNECT_EN
+    wifi_config_t wifi_cfg;
+    size_t len = sizeof(__g_fast_cache);
+
+    if (indicator_storage_read(WIFI_FAST_CACHE_STORAGE, &__g_fast_cache, &len) != ESP_OK ||
+        len != sizeof(__g_fast_cache) || __g_fast_cache.version != WIFI_FAST_CACHE_VERSION) {
+        memset(&__g_fast_cache, 0, sizeof(__g_fast_cache));
+        return false;
+    }
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_cfg) != ESP_OK ||
+        strncmp((char *)wifi_cfg.sta.ssid, __g_fast_cache.ssid, sizeof(wifi_cfg.sta.ssid)) != 0 ||
+        __g_fast_cache.channel == 0) {
+        return false;
+    }
+
+    wifi_cfg.sta.bssid_set = 1;
+    memcpy(wifi_cfg.sta.bssid, __g_fast_cache.bssid, sizeof(wifi_cfg.sta.bssid));
+    wifi_cfg.sta.channel = __g_fast_cache.channel;
+    wifi_cfg.sta.scan_method = WIFI_FAST_SCAN;
+
+    esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    esp_err_t err = esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg);
+    esp_wifi_set_storage(WIFI_STORAGE_FLASH);
+    if (err != ESP_OK) {
+        return false;
+    }
+
+    if (!__g_static_lease) {
+        __wifi_static_lease_apply(&__g_fast_cache);
+    }
+    __g_fast_connect_active = true;
+    ESP_LOGI(TAG, "Fast reconnect: " MACSTR " on channel %d",
+             MAC2STR(__g_fast_cache.bssid), __g_fast_cache.channel);
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Targeted connect failed: clear BSSID/channel so the next connect scans all channels
+ */
+static void __wifi_fast_connect_fallback(void)
+{
+    wifi_config_t wifi_cfg;
+
+    __g_fast_connect_active = false;
+    ESP_LOGW(TAG, "Fast reconnect failed, falling back to full scan");
+
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_cfg) == ESP_OK) {
+        wifi_cfg.sta.bssid_set = 0;
+        memset(wifi_cfg.sta.bssid, 0, sizeof(wifi_cfg.sta.bssid));
+        wifi_cfg.sta.channel = 0;
+        esp_wifi_set_storage(WIFI_STORAGE_RAM);
+        esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg);
+        esp_wifi_set_storage(WIFI_STORAGE_FLASH);
+    }
+    __wifi_dhcp_restart("AP changed");
+}
+
+/**
+ * @brief Store AP and lease of the current connection, called from __indicator_wifi_task
+ *
+ * @return true when done, false to retry later (lease start needs wall time)
+ */
+static bool __wifi_fast_cache_update(void)
+{
+    struct wifi_fast_cache cache = __g_fast_cache;
+    wifi_ap_record_t ap_info;
+
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+        return true;
+    }
+    if (strncmp(cache.ssid, (char *)ap_info.ssid, sizeof(cache.ssid)) != 0) {
+        memset(&cache, 0, sizeof(cache));
+    }
+    cache.version = WIFI_FAST_CACHE_VERSION;
+    strlcpy(cache.ssid, (char *)ap_info.ssid, sizeof(cache.ssid));
+    memcpy(cache.bssid, ap_info.bssid, sizeof(cache.bssid));
+    cache.channel = ap_info.primary;
+
+    bool done = true;
+    if (!__g_static_lease) {
+        /* Lease from the DHCP client, lease_start is back-dated to when it was bound */
+        struct netif *lwip_netif = esp_netif_get_netif_impl(__g_sta_netif);
+        struct dhcp *dhcp = lwip_netif ? netif_dhcp_data(lwip_netif) : NULL;
+        esp_netif_dns_info_t dns;
+        time_t now;
+
+        esp_netif_get_ip_info(__g_sta_netif, &cache.ip_info);
+        cache.dns_main.addr = 0;
+        cache.dns_backup.addr = 0;
+        if (esp_netif_get_dns_info(__g_sta_netif, ESP_NETIF_DNS_MAIN, &dns) == ESP_OK) {
+            cache.dns_main = dns.ip.u_addr.ip4;
+        }
+        if (esp_netif_get_dns_info(__g_sta_netif, ESP_NETIF_DNS_BACKUP, &dns) == ESP_OK) {
+            cache.dns_backup = dns.ip.u_addr.ip4;
+        }
+        cache.lease_s = dhcp ? dhcp->offered_t0_lease : 0;
+
+        time(&now);
+        if (now >= WIFI_TIME_VALID_MIN && cache.lease_s) {
+            cache.lease_start = now - (esp_timer_get_time() - __g_got_ip_us) / 1000000;
+            cache.lease_valid = true;
+        } else {
+            cache.lease_valid = false;
+            done = (cache.lease_s == 0);
+        }
+    }
+
+    if (memcmp(&cache, &__g_fast_cache, sizeof(cache)) != 0) {
+        __g_fast_cache = cache;
+        esp_err_t err = indicator_storage_write(WIFI_FAST_CACHE_STORAGE, &__g_fast_cache, sizeof(__g_fast_cache));
+        ESP_LOGI(TAG, "Fast reconnect cache saved: " MACSTR " ch %d, lease %s (err=%d)",
+                 MAC2STR(cache.bssid), cache.channel, cache.lease_valid ? "yes" : "no", err);
+    }
+    return done;
+}
+
+/**
+ * @brief Hand over to DHCP once the cached lease is due for renewal (T1) or can't be verified
+ */
+static void __wifi_static_lease_check(void)
+{
+    if (!__g_static_lease) {
+        return;
+    }
+
+    time_t now;
+    time(&now);
+    if (now < WIFI_TIME_VALID_MIN) {
+        if (esp_timer_get_time() - __g_static_lease_since_us > WIFI_LEASE_UNVERIFIED_MS * 1000LL) {
+            __wifi_dhcp_restart("no wall time to verify it");
+        }
+        return;
+    }
+    if (!__g_fast_cache.lease_valid ||
+        now >= __g_fast_cache.lease_start + __g_fast_cache.lease_s / 2) {
+        __wifi_dhcp_restart("renewal due");
+    }
+}
 
 static int __wifi_connect(const char *p_ssid, const char *p_password, int retry_num)
 {
     wifi_retry_max = retry_num; //todo
     s_retry_num =0;
 
+    /* Explicit connect may target another network, never reuse the cached AP or lease */
+    __g_fast_connect_active = false;
+    __wifi_dhcp_restart("new connection");
+
     wifi_config_t wifi_config = {0};
     strlcpy((char *)wifi_config.sta.ssid, p_ssid, sizeof(wifi_config.sta.ssid));
     ESP_LOGI(TAG, "ssid: %s", p_ssid);
@@ -228,6 +763,7 @@ static int __wifi_connect(const char *p_ssid, const char *p_password, int retry_
         _g_wifi_model.last_had_password = false;
     }
     wifi_config.sta.sae_pwe_h2e = WPA3_SAE_PWE_BOTH;
+    wifi_config.sta.listen_interval = WIFI_PS_LISTEN_INTERVAL;
 
     esp_wifi_stop();
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA) );
@@ -515,6 +1051,110 @@ static void __wifi_shutdown(void)
     esp_wifi_stop();
 }
 
+/**
+ * Modem power policy. Between scheduled fetches the modem sits in max modem
+ * sleep and only wakes every WIFI_PS_LISTEN_INTERVAL beacons. Requests in
+ * flight (acquire/release) and wake windows opened ahead of a fetch burst or
+ * while a details screen is in use (hold) switch it to WIFI_PS_NONE, so
+ * replies are not held back at the AP until the next listen interval.
+ */
+static void __wifi_ps_update(void)
+{
+#if WIFI_PS_POLICY_EN
+    xSemaphoreTake(__g_ps_mutex, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    bool awake = __g_ps_refs > 0 || now < __g_ps_hold_until_us;
+
+    if (awake != __g_ps_awake) {
+        if (__g_ps_awake) {
+            __g_ps_awake_us += now - __g_ps_changed_us;
+        }
+        __g_ps_awake = awake;
+        __g_ps_changed_us = now;
+        esp_wifi_set_ps(awake ? WIFI_PS_NONE : WIFI_PS_MAX_MODEM);
+        ESP_LOGD(TAG, "modem %s", awake ? "awake" : "max power-save");
+    }
+    if (awake && __g_ps_refs == 0 && __g_ps_timer) {
+        esp_timer_stop(__g_ps_timer);
+        esp_timer_start_once(__g_ps_timer, __g_ps_hold_until_us - now);
+    }
+    xSemaphoreGive(__g_ps_mutex);
+#endif
+}
+
+static void __wifi_ps_timer_cb(void *arg)
+{
+    __wifi_ps_update();
+}
+
+static bool __wifi_ps_is_awake(void)
+{
+    xSemaphoreTake(__g_ps_mutex, portMAX_DELAY);
+    bool awake = __g_ps_awake;
+    xSemaphoreGive(__g_ps_mutex);
+    return awake;
+}
+
+static void __wifi_ps_log_stats(void)
+{
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(__g_ps_mutex, portMAX_DELAY);
+    if (now - __g_ps_stats_since_us < WIFI_PS_STATS_PERIOD_US) {
+        xSemaphoreGive(__g_ps_mutex);
+        return;
+    }
+    int64_t awake_us = __g_ps_awake_us;
+    if (__g_ps_awake) {
+        awake_us += now - __g_ps_changed_us;
+        __g_ps_changed_us = now;
+    }
+    int64_t period_us = now - __g_ps_stats_since_us;
+    __g_ps_awake_us = 0;
+    __g_ps_stats_since_us = now;
+    xSemaphoreGive(__g_ps_mutex);
+
+    ESP_LOGI(TAG, "Modem awake %lld s of %lld s (%d%%), max power-save otherwise",
+             awake_us / 1000000, period_us / 1000000, (int)(awake_us * 100 / period_us));
+}
+
+void indicator_wifi_ps_acquire(void)
+{
+    xSemaphoreTake(__g_ps_mutex, portMAX_DELAY);
+    __g_ps_refs++;
+    xSemaphoreGive(__g_ps_mutex);
+    __wifi_ps_update();
+}
+
+void indicator_wifi_ps_release(void)
+{
+    int64_t tail = esp_timer_get_time() + WIFI_PS_TAIL_MS * 1000LL;
+
+    xSemaphoreTake(__g_ps_mutex, portMAX_DELAY);
+    if (__g_ps_refs > 0) {
+        __g_ps_refs--;
+    }
+    if (tail > __g_ps_hold_until_us) {
+        __g_ps_hold_until_us = tail;
+    }
+    xSemaphoreGive(__g_ps_mutex);
+    __wifi_ps_update();
+}
+
+void indicator_wifi_ps_hold(uint32_t ms)
+{
+    int64_t until = esp_timer_get_time() + ms * 1000LL;
+
+    xSemaphoreTake(__g_ps_mutex, portMAX_DELAY);
+    if (until > __g_ps_hold_until_us) {
+        __g_ps_hold_until_us = until;
+    }
+    xSemaphoreGive(__g_ps_mutex);
+    __wifi_ps_update();
+
+    // Let a deferred connectivity check run inside this window
+    xSemaphoreGive(__g_net_check_sem);
+}
+
 static void __ping_end(esp_ping_handle_t hdl, void *args)
 {
     ip_addr_t target_addr;
@@ -555,6 +1195,7 @@ static void __ping_end(esp_ping_handle_t hdl, void *args)
     }
     esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_WIFI_ST, &st, sizeof(struct view_data_wifi_st ), portMAX_DELAY);
     __g_ping_done = true;
+    indicator_wifi_ps_release();
 }
 
 static void __ping_start(void)
@@ -573,7 +1214,10 @@ static void __ping_start(void)
         .on_ping_end = __ping_end
     };
     esp_ping_handle_t ping;
-    esp_ping_new_session(&config, &cbs, &ping);
+    if (esp_ping_new_session(&config, &cbs, &ping) != ESP_OK) {
+        return;
+    }
+    indicator_wifi_ps_acquire();
     __g_ping_done = false;
     esp_ping_start(ping);
 }
@@ -583,10 +1227,20 @@ static void __indicator_wifi_task(void *p_arg)
 {
     int cnt = 0;
     struct view_data_wifi_st st;
+    int64_t tick_us = esp_timer_get_time();
 
     while(1) {
 
-        xSemaphoreTake(__g_net_check_sem, pdMS_TO_TICKS(5000));
+        // Wakes from events (scan channel done, IP, list request) come in between
+        // ticks; the periodic counters only advance once per elapsed tick
+        int64_t wait_us = tick_us + WIFI_TASK_TICK_MS * 1000LL - esp_timer_get_time();
+        if (wait_us > 0) {
+            xSemaphoreTake(__g_net_check_sem, pdMS_TO_TICKS(wait_us / 1000) + 1);
+        }
+        bool tick = esp_timer_get_time() - tick_us >= WIFI_TASK_TICK_MS * 1000LL;
+        if (tick) {
+            tick_us = esp_timer_get_time();
+        }
         __wifi_st_get(&st);
 
         // Auto-save: Handle deferred save (from IP_EVENT_STA_GOT_IP)
@@ -614,14 +1268,23 @@ static void __indicator_wifi_task(void *p_arg)
             }
         }
 
+        // Fast reconnect: remember AP and lease, hand cached lease back to DHCP when due
+        if (__g_fast_cache_pending && st.is_connected) {
+            __g_fast_cache_pending = !__wifi_fast_cache_update();
+        }
+        __wifi_static_lease_check();
+        __wifi_ps_log_stats();
+        __wifi_scan_process(&st);
+
         // Periodically check the network connection status
         if( st.is_connected) {
 
             if(__g_ping_done ) {
                 if( st.is_network ) {
-                    cnt++;
-                    //5min check network
-                    if( cnt > 60) {
+                    cnt += tick ? 1 : 0;
+                    //5min check network, batched into the next wake window unless overdue
+                    if( cnt > WIFI_PS_PING_MAX_DEFER ||
+                        (cnt > WIFI_PS_PING_EVERY && (!WIFI_PS_POLICY_EN || __wifi_ps_is_awake())) ) {
                         cnt = 0;
                         ESP_LOGI(TAG, "Network normal last time, retry check network...");
                         __ping_start();
@@ -635,8 +1298,8 @@ static void __indicator_wifi_task(void *p_arg)
         } else if(  _g_wifi_model.is_cfg && !st.is_connecting) {
             // Periodically check the wifi connection status
 
-            // 5min retry connect 
-            if( _g_wifi_model.wifi_reconnect_cnt > 5 ) {
+            // Retry connect, not while a scan is on air: esp_wifi_stop() would cut it short
+            if( _g_wifi_model.wifi_reconnect_cnt > WIFI_RECONNECT_TICKS && __g_scan_mode == WIFI_SCAN_IDLE ) {
                 ESP_LOGI(TAG, " Wifi reconnect...");
                 _g_wifi_model.wifi_reconnect_cnt =0;
                 wifi_retry_max = 3;
@@ -644,9 +1307,10 @@ static void __indicator_wifi_task(void *p_arg)
 
                 esp_wifi_stop();
                 ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA) );
+                __wifi_fast_connect_prepare();
                 ESP_ERROR_CHECK(esp_wifi_start());
             }
-            _g_wifi_model.wifi_reconnect_cnt++;
+            _g_wifi_model.wifi_reconnect_cnt += tick ? 1 : 0;
         }
 
     }
@@ -660,54 +1324,9 @@ static void __view_event_handler(void* handler_args, esp_event_base_t base, int3
     {
         case VIEW_EVENT_WIFI_LIST_REQ: {
             ESP_LOGI(TAG, "event: VIEW_EVENT_WIFI_LIST_REQ");
-
-            uint16_t number = WIFI_SCAN_LIST_SIZE;
-            uint16_t ap_count = 0;
-            wifi_ap_record_t ap_info[WIFI_SCAN_LIST_SIZE];
-            ap_count = __wifi_scan(ap_info, number);
-
-            struct view_data_wifi_list list;
-            struct view_data_wifi_st st;
-
-            memset(&list, 0 , sizeof(struct view_data_wifi_list ));
-            
-            __wifi_st_get(&st);
-
-            list.is_connect = st.is_connected;
-            if( st.is_connected ) {
-                strlcpy((char *)list.connect.ssid, (char *)st.ssid, sizeof(list.connect.ssid));
-                list.connect.auth_mode =false;
-                list.connect.rssi = st.rssi;
-            }
-            
-            ap_count= min(number, ap_count);
-            
-            bool is_exist =  false;
-            int list_cnt = 0;
-            for(int i = 0; i <  ap_count; i++ ) {
-
-                is_exist = false;
-                for( int j = 0; j < list_cnt; j++ ) {
-                    if(strcmp(list.aps[j].ssid, ap_info[i].ssid) == 0) {
-                        ESP_LOGI(TAG, "list exit ap:%s", ap_info[i].ssid);
-                        is_exist = true;
-                        break;
-                    }
-                }
-                if(!is_exist) {
-                    strcpy(list.aps[list_cnt].ssid, ap_info[i].ssid);
-                    list.aps[list_cnt].rssi = ap_info[i].rssi;
-                    if( ap_info[i].authmode == WIFI_AUTH_OPEN) {
-                        list.aps[list_cnt].auth_mode = false;
-                    } else {
-                        list.aps[list_cnt].auth_mode = true;
-                    } 
-                    list_cnt++;
-                }
-            }
-            list.cnt = list_cnt;
-            esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_WIFI_LIST, &list, sizeof(struct view_data_wifi_list ), portMAX_DELAY);
-
+            // Served by __indicator_wifi_task, this handler must not block on the scan
+            __g_scan_list_req = true;
+            xSemaphoreGive(__g_net_check_sem);
             break;
         }
         case VIEW_EVENT_WIFI_CONNECT: {
@@ -826,6 +1445,7 @@ int indicator_wifi_init(void)
     __g_wifi_mutex  = xSemaphoreCreateMutex( );
     __g_data_mutex  =  xSemaphoreCreateMutex();
     __g_net_check_sem = xSemaphoreCreateBinary();
+    __g_ps_mutex = xSemaphoreCreateMutex();
     //__wifi_event_group = xEventGroupCreate();
 
     __wifi_model_init();
@@ -836,11 +1456,21 @@ int indicator_wifi_init(void)
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
-    esp_netif_create_default_wifi_sta();
+    __g_sta_netif = esp_netif_create_default_wifi_sta();
 
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
+#if WIFI_PS_POLICY_EN
+    const esp_timer_create_args_t ps_timer_args = {
+        .callback = __wifi_ps_timer_cb,
+        .name = "wifi_ps",
+    };
+    esp_timer_create(&ps_timer_args, &__g_ps_timer);
+    __g_ps_stats_since_us = esp_timer_get_time();
+    esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+#endif
+
     esp_event_handler_instance_t instance_any_id;
     esp_event_handler_instance_t instance_got_ip;
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
@@ -899,6 +1529,12 @@ int indicator_wifi_init(void)
         _g_wifi_model.is_cfg = true;
         ESP_LOGI(TAG, "last config ssid: %s",  wifi_cfg.sta.ssid);
         ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+        if (wifi_cfg.sta.listen_interval != WIFI_PS_LISTEN_INTERVAL) {
+            // Config saved before the power policy existed
+            wifi_cfg.sta.listen_interval = WIFI_PS_LISTEN_INTERVAL;
+            esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg);
+        }
+        __wifi_fast_connect_prepare();
         ESP_ERROR_CHECK(esp_wifi_start());
     } else {
         ESP_LOGI(TAG, "Not config wifi, Entry wifi config screen");
@@ -907,6 +1543,7 @@ int indicator_wifi_init(void)
         ESP_ERROR_CHECK(esp_wifi_start());
         esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_SCREEN_START, &screen, sizeof(screen), portMAX_DELAY);
     }
+    boot_timeline_mark(BOOT_STAGE_WIFI_START);
 
     return 0;
 }
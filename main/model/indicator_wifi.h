@@ -26,6 +26,24 @@ int indicator_wifi_init(void);
  */
 esp_err_t indicator_wifi_get_status(struct view_data_wifi_st *status);
 
+/**
+ * @brief Keep the modem out of power-save while a request is in flight
+ *
+ * Every acquire must be paired with indicator_wifi_ps_release(). The modem
+ * stays awake for a short tail after the last release.
+ */
+void indicator_wifi_ps_acquire(void);
+
+void indicator_wifi_ps_release(void);
+
+/**
+ * @brief Open (or extend) a wake window of ms milliseconds
+ *
+ * Used ahead of a fetch burst and while the user is on a details screen.
+ * Deferred periodic network checks run inside the window.
+ */
+void indicator_wifi_ps_hold(uint32_t ms);
+
 /**
  * @brief Request list of saved WiFi networks
  * Response will be sent via VIEW_EVENT_WIFI_SAVED_LIST event
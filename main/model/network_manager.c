@@ -1,16 +1,24 @@
 #include "network_manager.h"
 #include "indicator_wifi.h"
+#include "dns_cache.h"
 #include "esp_log.h"
 #include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "esp_timer.h"
 #include "esp_netif.h"
+#include "esp_random.h"
 #include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "ping/ping_sock.h"
+#include "lwip/api.h"
 #include "lwip/inet.h"
 #include "lwip/netdb.h"
 #include "lwip/sockets.h"
 #include <string.h>
+#include <strings.h>
+#include <sys/time.h>
+#include <unistd.h>
 
 static const char *TAG = "network_mgr";
 static SemaphoreHandle_t network_mutex = NULL;
@@ -18,6 +26,158 @@ static SemaphoreHandle_t network_mutex = NULL;
 // Global var to track length during a single request
 static int http_recv_len = 0;
 
+// One client kept across requests: the connection is reused while the server
+// keeps it open, and the TLS session ticket survives reconnects
+static esp_http_client_handle_t http_client = NULL;
+static bool http_tls_session = false;   // a ticket from an earlier handshake will be offered
+static bool http_conn_open = false;
+static int64_t http_connected_us = 0;
+static struct network_manager_http_stats http_stats;
+
+#define DNS_QUERY_TIMEOUT_MS 1000
+#define DNS_MSG_MAX          512
+
+#define CLOCK_VALID_AFTER    1735689600  // 2025-01-01, anything earlier was never set
+
+/**
+ * @brief Send one A query to a DNS server and wait for the matching reply
+ */
+static esp_err_t dns_query_server(const esp_ip4_addr_t *server, const char *host,
+                                  uint32_t *addr, uint32_t *ttl_s)
+{
+    uint8_t msg[DNS_MSG_MAX];
+    uint16_t id = esp_random() & 0xffff;
+    size_t len = dns_cache_build_query(msg, sizeof(msg), id, host);
+    if (len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        return ESP_FAIL;
+    }
+    struct timeval tv = {
+        .tv_sec = DNS_QUERY_TIMEOUT_MS / 1000,
+        .tv_usec = (DNS_QUERY_TIMEOUT_MS % 1000) * 1000,
+    };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_in dest = {
+        .sin_family = AF_INET,
+        .sin_port = htons(53),
+        .sin_addr.s_addr = server->addr,
+    };
+    esp_err_t err = ESP_ERR_TIMEOUT;
+    if (sendto(sock, msg, len, 0, (struct sockaddr *)&dest, sizeof(dest)) == (int)len) {
+        // Skip late replies to earlier queries, bounded by the receive timeout
+        for (int i = 0; i < 3; i++) {
+            int n = recv(sock, msg, sizeof(msg), 0);
+            if (n <= 0) {
+                break;
+            }
+            err = dns_cache_parse_reply(msg, n, id, addr, ttl_s);
+            if (err != ESP_ERR_INVALID_RESPONSE) {
+                break;
+            }
+        }
+    }
+    close(sock);
+    return err;
+}
+
+/**
+ * @brief dns_cache resolver: queries the DHCP-provided servers directly so
+ * the answer TTL is known (lwIP's resolver does not expose it)
+ */
+static esp_err_t dns_resolve_a(const char *host, uint32_t *addr, uint32_t *ttl_s)
+{
+    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    if (!netif) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = ESP_FAIL;
+    const esp_netif_dns_type_t types[] = { ESP_NETIF_DNS_MAIN, ESP_NETIF_DNS_BACKUP };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        esp_netif_dns_info_t dns_info;
+        if (esp_netif_get_dns_info(netif, types[i], &dns_info) != ESP_OK ||
+            dns_info.ip.u_addr.ip4.addr == 0) {
+            continue;
+        }
+        err = dns_query_server(&dns_info.ip.u_addr.ip4, host, addr, ttl_s);
+        if (err == ESP_OK || err == ESP_ERR_NOT_FOUND) {
+            break;
+        }
+    }
+    return err;
+}
+
+#ifdef CONFIG_LWIP_HOOK_NETCONN_EXT_RESOLVE_CUSTOM
+/**
+ * @brief lwIP hook in front of netconn_gethostbyname()/getaddrinfo(), so
+ * esp_http_client and every other lookup goes through the cache. Returning 0
+ * hands the name to lwIP's own resolver (IP literals, IPv6-only lookups,
+ * cache failures).
+ */
+int lwip_hook_netconn_external_resolve(const char *name, ip_addr_t *addr, u8_t addrtype, err_t *err)
+{
+    uint32_t ip4;
+
+    if (addrtype == NETCONN_DNS_IPV6 || dns_cache_lookup(name, &ip4) != ESP_OK) {
+        return 0;
+    }
+    ip_addr_set_ip4_u32(addr, ip4);
+    *err = ERR_OK;
+    return 1;
+}
+#endif
+
+/**
+ * @brief Parse an RFC 7231 date ("Sun, 18 Oct 2026 10:00:00 GMT")
+ * @return Seconds since the epoch, 0 if it does not parse
+ */
+static time_t http_date_parse(const char *s)
+{
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char mon[4];
+    int day, year, hour, min, sec;
+    if (sscanf(s, "%*3s, %d %3s %d %d:%d:%d", &day, mon, &year, &hour, &min, &sec) != 6) {
+        return 0;
+    }
+    const char *m = strstr(months, mon);
+    if (!m || strlen(mon) != 3 || (m - months) % 3 || year < 1970) {
+        return 0;
+    }
+    int month = (m - months) / 3 + 1;
+
+    // Days since 1970-01-01 in the proleptic Gregorian calendar, no timegm() in newlib
+    int y = year - (month <= 2);
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + doe - 719468;
+    return (time_t)(days * 86400 + hour * 3600 + min * 60 + sec);
+}
+
+/**
+ * @brief Until SNTP syncs, the server's Date header is good enough to the
+ * second for departure countdowns, so the first fetch need not wait for it
+ */
+static void http_date_set_clock(const char *value)
+{
+    if (time(NULL) >= CLOCK_VALID_AFTER) {
+        return;
+    }
+    time_t t = http_date_parse(value);
+    if (t < CLOCK_VALID_AFTER) {
+        return;
+    }
+    struct timeval tv = { .tv_sec = t, .tv_usec = 0 };
+    settimeofday(&tv, NULL);
+    ESP_LOGI(TAG, "Clock set from HTTP Date (%s) until SNTP syncs", value);
+}
+
 /**
  * @brief HTTP event handler
  */
@@ -30,12 +190,17 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
         case HTTP_EVENT_ON_CONNECTED:
             ESP_LOGD(TAG, "HTTP_EVENT_ON_CONNECTED");
             http_recv_len = 0;
+            http_connected_us = esp_timer_get_time();
+            http_conn_open = true;
             break;
         case HTTP_EVENT_HEADER_SENT:
             ESP_LOGD(TAG, "HTTP_EVENT_HEADER_SENT");
             break;
         case HTTP_EVENT_ON_HEADER:
             ESP_LOGD(TAG, "HTTP_EVENT_ON_HEADER, key=%s, val=%s", evt->header_key, evt->header_value);
+            if (strcasecmp(evt->header_key, "Date") == 0) {
+                http_date_set_clock(evt->header_value);
+            }
             break;
         case HTTP_EVENT_ON_DATA:
             if (!evt->user_data) {
@@ -65,6 +230,7 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
             break;
         case HTTP_EVENT_DISCONNECTED:
             ESP_LOGD(TAG, "HTTP_EVENT_DISCONNECTED");
+            http_conn_open = false;
             break;
         default:
             break;
@@ -82,7 +248,7 @@ esp_err_t network_manager_init(void)
         network_mutex = xSemaphoreCreateMutex();
     }
     
-    return ESP_OK;
+    return dns_cache_init(dns_resolve_a);
 }
 
 bool network_manager_is_connected(void)
@@ -134,27 +300,75 @@ esp_err_t network_manager_http_get(const char *url, char *response_buffer,
     http_recv_len = 0;
     *response_length = 0;
     
-    esp_http_client_config_t config = {
-        .url = url,
-        .event_handler = http_event_handler,
-        .user_data = response_buffer,  // Pass buffer directly
-        .timeout_ms = 30000,           // Increased timeout to 30s
-        .buffer_size = 4096,           // Increased internal RX buffer for headers/chunks
-        .buffer_size_tx = 1024,        // TX buffer
-    };
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) {
-        ESP_LOGE(TAG, "Failed to init HTTP client");
+    // Modem out of power-save for the request, restored after a short tail
+    indicator_wifi_ps_acquire();
+
+    if (!http_client) {
+        esp_http_client_config_t config = {
+            .url = url,
+            .event_handler = http_event_handler,
+            .user_data = response_buffer,  // Pass buffer directly
+            .timeout_ms = 30000,           // Increased timeout to 30s
+            .buffer_size = 4096,           // Increased internal RX buffer for headers/chunks
+            .buffer_size_tx = 1024,        // TX buffer
+            .crt_bundle_attach = esp_crt_bundle_attach,
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+            .save_client_session = true,
+#endif
+        };
+        http_client = esp_http_client_init(&config);
+        if (!http_client) {
+            ESP_LOGE(TAG, "Failed to init HTTP client");
+            indicator_wifi_ps_release();
+            xSemaphoreGive(network_mutex);
+            return ESP_FAIL;
+        }
+        http_tls_session = false;
+
+        // Explicitly request identity to avoid compression issues, though standard client handles it
+        esp_http_client_set_header(http_client, "Accept-Encoding", "identity");
+    } else if (esp_http_client_set_url(http_client, url) != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid URL: %s", url);
+        indicator_wifi_ps_release();
         xSemaphoreGive(network_mutex);
-        return ESP_FAIL;
+        return ESP_ERR_INVALID_ARG;
     }
-    
-    // Explicitly request identity to avoid compression issues, though standard client handles it
-    esp_http_client_set_header(client, "Accept-Encoding", "identity");
-    
+    esp_http_client_set_user_data(http_client, response_buffer);
+    esp_http_client_handle_t client = http_client;
+    bool https = strncmp(url, "https://", 8) == 0;
+
+    bool was_open = http_conn_open;
+    http_connected_us = 0;
+    int64_t start_us = esp_timer_get_time();
     esp_err_t err = esp_http_client_perform(client);
+
+    if (err != ESP_OK && was_open && !http_connected_us) {
+        // The server dropped the connection while it sat idle, retry once on a new one
+        ESP_LOGW(TAG, "Request on kept connection failed (%s), reconnecting", esp_err_to_name(err));
+        esp_http_client_close(client);
+        http_conn_open = false;
+        http_recv_len = 0;
+        start_us = esp_timer_get_time();
+        err = esp_http_client_perform(client);
+    }
     
+    if (http_connected_us) {
+        // New connection: DNS + TCP + TLS handshake
+        uint32_t connect_ms = (http_connected_us - start_us) / 1000;
+        bool ticket = https && http_tls_session;
+        struct network_manager_conn_stats *cs = ticket ? &http_stats.ticket : &http_stats.full;
+        cs->count++;
+        cs->total_ms += connect_ms;
+        if (connect_ms > cs->max_ms) cs->max_ms = connect_ms;
+        ESP_LOGI(TAG, "%s connect %lu ms (%s)", https ? "TLS" : "TCP", (unsigned long)connect_ms,
+                 !https ? "plain" : ticket ? "session ticket offered" : "no session ticket");
+        if (https) {
+            http_tls_session = true;
+        }
+    } else if (err == ESP_OK) {
+        http_stats.reused++;
+    }
+
     if (err == ESP_OK) {
         int status = esp_http_client_get_status_code(client);
         int64_t content_len = esp_http_client_get_content_length(client);
@@ -174,13 +388,28 @@ esp_err_t network_manager_http_get(const char *url, char *response_buffer,
         }
     } else {
         ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
+        // Drop the connection but keep the client (and its TLS session)
+        esp_http_client_close(client);
+        http_conn_open = false;
     }
     
-    esp_http_client_cleanup(client);
+    indicator_wifi_ps_release();
     xSemaphoreGive(network_mutex);
     return err;
 }
 
+esp_err_t network_manager_get_http_stats(struct network_manager_http_stats *stats)
+{
+    if (!stats) return ESP_ERR_INVALID_ARG;
+    if (network_mutex == NULL ||
+        xSemaphoreTake(network_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    *stats = http_stats;
+    xSemaphoreGive(network_mutex);
+    return ESP_OK;
+}
+
 esp_err_t network_manager_wifi_connect(const char *ssid, const char *password)
 {
     // WiFi connection is handled by indicator_wifi module
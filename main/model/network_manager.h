@@ -8,6 +8,25 @@
 extern "C" {
 #endif
 
+struct network_manager_conn_stats {
+    uint32_t count;
+    uint32_t total_ms;
+    uint32_t max_ms;
+};
+
+/**
+ * @brief Connection setup cost of network_manager_http_get()
+ *
+ * Connect time runs from the start of the request to the HTTP client's
+ * connected event: DNS, TCP and, for https URLs, the TLS handshake.
+ */
+struct network_manager_http_stats {
+    struct network_manager_conn_stats full;     // TLS without a session ticket, or plain TCP
+    struct network_manager_conn_stats ticket;   // TLS with a session ticket offered, the
+                                                // server may still do a full handshake
+    uint32_t reused;                            // requests on an already open connection
+};
+
 /**
  * @brief Initialize network manager (WiFi + HTTP client)
  * @return ESP_OK on success
@@ -38,6 +57,13 @@ esp_err_t network_manager_get_ip(char *ip_buffer);
 esp_err_t network_manager_http_get(const char *url, char *response_buffer, 
                                     size_t buffer_size, size_t *response_length);
 
+/**
+ * @brief Get connection statistics of network_manager_http_get()
+ * @param stats Output structure
+ * @return ESP_OK on success
+ */
+esp_err_t network_manager_get_http_stats(struct network_manager_http_stats *stats);
+
 /**
  * @brief Connect to WiFi
  * @param ssid WiFi SSID
@@ -1,7 +1,13 @@
 #include "transport_data.h"
 #include "network_manager.h"
 #include "indicator_display.h"  // For display state check
+#include "indicator_wifi.h"     // Modem wake windows
+#include "transport_offline.h"
+#include "view_strtab.h"
+#include "indicator_storage.h"
+#include "boot_timeline.h"
 #include "esp_log.h"
+#include "esp_event.h"
 #include "cJSON.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -12,8 +18,20 @@
 
 static const char *TAG = "transport_data";
 
-// API endpoint base URL
+// Modem wake windows (see indicator_wifi_ps_hold): a scheduled fetch burst,
+// and a details screen where further clicks are likely
+#define FETCH_PS_WINDOW_MS      15000
+#define DETAILS_PS_WINDOW_MS    60000
+
+// API endpoint base URL, TRANSPORT_API_HTTPS=0 falls back to plain HTTP
+#ifndef TRANSPORT_API_HTTPS
+#define TRANSPORT_API_HTTPS 1
+#endif
+#if TRANSPORT_API_HTTPS
+#define TRANSPORT_API_BASE "https://transport.opendata.ch/v1"
+#else
 #define TRANSPORT_API_BASE "http://transport.opendata.ch/v1"
+#endif
 
 // Global data storage
 static struct view_data_bus_countdown g_bus_data = {0};
@@ -56,8 +74,62 @@ void transport_data_notify_screen_change(int screen_index)
     // But basic requirement is just to fetch for active screen during timed refresh
 }
 
+#define TRANSPORT_SELECTION_STORAGE "transport-sel"
+
+/**
+ * @brief Remember the selection so the next boot can fetch it without the user
+ */
+static void transport_selection_save(void)
+{
+    struct view_data_transport_selection sel = {0};
+    sel.bus_selected = g_bus_stop_selected;
+    strncpy(sel.bus_stop_name, g_bus_stop_name, sizeof(sel.bus_stop_name) - 1);
+    strncpy(sel.bus_stop_id, g_bus_stop_id, sizeof(sel.bus_stop_id) - 1);
+    sel.train_selected = g_train_station_selected;
+    strncpy(sel.train_station_name, g_train_station_name, sizeof(sel.train_station_name) - 1);
+    strncpy(sel.train_station_id, g_train_station_id, sizeof(sel.train_station_id) - 1);
+
+    esp_err_t err = indicator_storage_write(TRANSPORT_SELECTION_STORAGE, &sel, sizeof(sel));
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save selection: %s", esp_err_to_name(err));
+    }
+}
+
+static void transport_selection_restore(void)
+{
+    struct view_data_transport_selection sel;
+    size_t len = sizeof(sel);
+    if (indicator_storage_read(TRANSPORT_SELECTION_STORAGE, &sel, &len) != ESP_OK || len != sizeof(sel)) {
+        return;
+    }
+    if (!sel.bus_selected && !sel.train_selected) {
+        return;
+    }
+
+    if (sel.bus_selected) {
+        strncpy(g_bus_stop_name, sel.bus_stop_name, sizeof(g_bus_stop_name) - 1);
+        strncpy(g_bus_stop_id, sel.bus_stop_id, sizeof(g_bus_stop_id) - 1);
+        g_bus_stop_selected = true;
+        ESP_LOGI(TAG, "Restored bus stop: %s (%s)", g_bus_stop_name, g_bus_stop_id);
+    }
+    if (sel.train_selected) {
+        strncpy(g_train_station_name, sel.train_station_name, sizeof(g_train_station_name) - 1);
+        strncpy(g_train_station_id, sel.train_station_id, sizeof(g_train_station_id) - 1);
+        g_train_station_selected = true;
+        ESP_LOGI(TAG, "Restored train station: %s (%s)", g_train_station_name, g_train_station_id);
+    }
+
+    // Boards open on the restored stop, the first fetch fills them
+    extern esp_event_loop_handle_t view_event_handle;
+    esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_TRANSPORT_SELECTION,
+                      &sel, sizeof(sel), portMAX_DELAY);
+}
+
 void transport_data_set_bus_stop(const char *name, const char *id)
 {
+    if (id && strcmp(id, g_bus_stop_id) != 0) {
+        transport_offline_reset(TRANSPORT_OFFLINE_BUS);
+    }
     if (name) strncpy(g_bus_stop_name, name, sizeof(g_bus_stop_name) - 1);
     if (id) strncpy(g_bus_stop_id, id, sizeof(g_bus_stop_id) - 1);
     
@@ -67,6 +139,7 @@ void transport_data_set_bus_stop(const char *name, const char *id)
     g_bus_data.count = 0;
     strncpy(g_bus_data.stop_name, g_bus_stop_name, sizeof(g_bus_data.stop_name) - 1);
     g_bus_data.direction_count = 0;
+    transport_selection_save();
     
     // Trigger refresh immediately
     transport_data_refresh_bus();
@@ -74,6 +147,9 @@ void transport_data_set_bus_stop(const char *name, const char *id)
 
 void transport_data_set_train_station(const char *name, const char *id)
 {
+    if (id && strcmp(id, g_train_station_id) != 0) {
+        transport_offline_reset(TRANSPORT_OFFLINE_TRAIN);
+    }
     if (name) strncpy(g_train_station_name, name, sizeof(g_train_station_name) - 1);
     if (id) strncpy(g_train_station_id, id, sizeof(g_train_station_id) - 1);
     
@@ -82,6 +158,7 @@ void transport_data_set_train_station(const char *name, const char *id)
     // Invalidate current data
     g_train_data.count = 0;
     strncpy(g_train_data.station_name, g_train_station_name, sizeof(g_train_data.station_name) - 1);
+    transport_selection_save();
     
     // Trigger refresh immediately
     transport_data_refresh_train();
@@ -221,7 +298,7 @@ static int get_or_add_direction(const char *name, const char *id, char ids_store
     // Fallback: match by name if ID missing (legacy/fallback case)
     else if (name && name[0]) {
         for (int i = 0; i < g_bus_data.direction_count; i++) {
-            if (strcmp(g_bus_data.directions[i], name) == 0) {
+            if (strcmp(view_str(&g_bus_data.strings, g_bus_data.directions[i]), name) == 0) {
                 return i;
             }
         }
@@ -229,7 +306,7 @@ static int get_or_add_direction(const char *name, const char *id, char ids_store
     
     // Add new if space available
     if (g_bus_data.direction_count < MAX_DIRECTIONS) {
-        strncpy(g_bus_data.directions[g_bus_data.direction_count], name ? name : "Unknown", sizeof(g_bus_data.directions[0]) - 1);
+        g_bus_data.directions[g_bus_data.direction_count] = view_strtab_intern(&g_bus_data.strings, name ? name : "Unknown");
         
         if (id && id[0]) {
             strncpy(ids_store[g_bus_data.direction_count], id, 31);
@@ -289,6 +366,7 @@ static esp_err_t parse_bus_json(const char *json_str)
     
     // Reset data
     memset(&g_bus_data, 0, sizeof(g_bus_data));
+    view_strtab_reset(&g_bus_data.strings);
     strncpy(g_bus_data.stop_name, BUS_STOP_NAME, sizeof(g_bus_data.stop_name) - 1);
     g_bus_data.direction_count = 0;
     int idx = 0;
@@ -385,16 +463,13 @@ static esp_err_t parse_bus_json(const char *json_str)
         if (minutes < 0) continue;
         
         // Store departure
-        strncpy(g_bus_data.departures[idx].line, line, sizeof(g_bus_data.departures[idx].line) - 1);
-        strncpy(g_bus_data.departures[idx].destination, destination, 
-                sizeof(g_bus_data.departures[idx].destination) - 1);
-        strncpy(g_bus_data.departures[idx].journey_name, journey_name,
-                sizeof(g_bus_data.departures[idx].journey_name) - 1);
+        g_bus_data.departures[idx].line = view_strtab_intern(&g_bus_data.strings, line);
+        g_bus_data.departures[idx].destination = view_strtab_intern(&g_bus_data.strings, destination);
+        g_bus_data.departures[idx].journey_name = view_strtab_intern(&g_bus_data.strings, journey_name);
         
         struct tm timeinfo;
         localtime_r(&dep_time, &timeinfo);
-        snprintf(g_bus_data.departures[idx].time_str, sizeof(g_bus_data.departures[idx].time_str),
-                 "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
+        g_bus_data.departures[idx].time_min = timeinfo.tm_hour * 60 + timeinfo.tm_min;
         
         g_bus_data.departures[idx].departure_timestamp = dep_time;
         g_bus_data.departures[idx].minutes_until = minutes;
@@ -419,7 +494,7 @@ static esp_err_t parse_bus_json(const char *json_str)
     
     ESP_LOGI(TAG, "Parsed %d bus departures. Directions found: %d", idx, g_bus_data.direction_count);
     for (int i = 0; i < g_bus_data.direction_count; i++) {
-        ESP_LOGI(TAG, "  Dir %d (%s): %d departures", i, g_bus_data.directions[i], dir_counts[i]);
+        ESP_LOGI(TAG, "  Dir %d (%s): %d departures", i, view_str(&g_bus_data.strings, g_bus_data.directions[i]), dir_counts[i]);
     }
     
     g_bus_data.count = idx;
@@ -427,8 +502,10 @@ static esp_err_t parse_bus_json(const char *json_str)
     g_bus_data.api_error = false;
     
     cJSON_Delete(root);
-    ESP_LOGI(TAG, "Parsed %d bus departures", idx);
-    return idx > 0 ? ESP_OK : ESP_FAIL;
+    ESP_LOGI(TAG, "Parsed %d bus departures, snapshot %u bytes (%u string bytes)", idx,
+             (unsigned)view_data_bus_countdown_size(&g_bus_data), (unsigned)g_bus_data.strings.used);
+    // An empty board is a valid answer (night, end of service), not a parse error
+    return ESP_OK;
 }
 
 /**
@@ -457,6 +534,7 @@ static esp_err_t parse_train_json(const char *json_str)
     
     // Reset data
     memset(&g_train_data, 0, sizeof(g_train_data));
+    view_strtab_reset(&g_train_data.strings);
     strncpy(g_train_data.station_name, TRAIN_STATION_NAME, sizeof(g_train_data.station_name) - 1);
     int idx = 0;
     
@@ -542,20 +620,15 @@ static esp_err_t parse_train_json(const char *json_str)
         int delay_minutes = delay_seconds / 60;  // Convert to minutes
         
         // Store departure
-        strncpy(g_train_data.departures[idx].line, line, sizeof(g_train_data.departures[idx].line) - 1);
-        strncpy(g_train_data.departures[idx].destination, destination,
-                sizeof(g_train_data.departures[idx].destination) - 1);
-        strncpy(g_train_data.departures[idx].via, via_str,
-                sizeof(g_train_data.departures[idx].via) - 1);
-        strncpy(g_train_data.departures[idx].journey_name, journey_name,
-                sizeof(g_train_data.departures[idx].journey_name) - 1);
-        strncpy(g_train_data.departures[idx].platform, platform,
-                sizeof(g_train_data.departures[idx].platform) - 1);
+        g_train_data.departures[idx].line = view_strtab_intern(&g_train_data.strings, line);
+        g_train_data.departures[idx].destination = view_strtab_intern(&g_train_data.strings, destination);
+        g_train_data.departures[idx].via = view_strtab_intern(&g_train_data.strings, via_str);
+        g_train_data.departures[idx].journey_name = view_strtab_intern(&g_train_data.strings, journey_name);
+        g_train_data.departures[idx].platform = view_strtab_intern(&g_train_data.strings, platform);
         
         struct tm timeinfo;
         localtime_r(&dep_time, &timeinfo);
-        snprintf(g_train_data.departures[idx].time_str, sizeof(g_train_data.departures[idx].time_str),
-                 "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
+        g_train_data.departures[idx].time_min = timeinfo.tm_hour * 60 + timeinfo.tm_min;
         
         g_train_data.departures[idx].departure_timestamp = dep_time;
         g_train_data.departures[idx].delay_minutes = delay_minutes;
@@ -588,8 +661,10 @@ static esp_err_t parse_train_json(const char *json_str)
     }
     
     cJSON_Delete(root);
-    ESP_LOGI(TAG, "Parsed %d train departures", idx);
-    return idx > 0 ? ESP_OK : ESP_FAIL;
+    ESP_LOGI(TAG, "Parsed %d train departures, snapshot %u bytes (%u string bytes)", idx,
+             (unsigned)view_data_train_station_size(&g_train_data), (unsigned)g_train_data.strings.used);
+    // An empty board is a valid answer (night, end of service), not a parse error
+    return ESP_OK;
 }
 
 /**
@@ -795,8 +870,8 @@ static void fetch_details_task(void *arg)
     time_t departure_time = 0;
     
     for (int i = 0; i < g_train_data.count; i++) {
-        if (strcmp(g_train_data.departures[i].journey_name, journey_name) == 0) {
-            strncpy(destination, g_train_data.departures[i].destination, sizeof(destination)-1);
+        if (strcmp(view_str(&g_train_data.strings, g_train_data.departures[i].journey_name), journey_name) == 0) {
+            strncpy(destination, view_str(&g_train_data.strings, g_train_data.departures[i].destination), sizeof(destination)-1);
             departure_time = g_train_data.departures[i].departure_timestamp;
             break;
         }
@@ -1049,8 +1124,8 @@ static void fetch_bus_details_task(void *arg)
     time_t departure_time = 0;
     
     for (int i = 0; i < g_bus_data.count; i++) {
-        if (strcmp(g_bus_data.departures[i].journey_name, journey_name) == 0) {
-            strncpy(destination, g_bus_data.departures[i].destination, sizeof(destination)-1);
+        if (strcmp(view_str(&g_bus_data.strings, g_bus_data.departures[i].journey_name), journey_name) == 0) {
+            strncpy(destination, view_str(&g_bus_data.strings, g_bus_data.departures[i].destination), sizeof(destination)-1);
             departure_time = g_bus_data.departures[i].departure_timestamp;
             break;
         }
@@ -1125,6 +1200,41 @@ static void fetch_bus_details_task(void *arg)
     vTaskDelete(NULL);
 }
 
+/**
+ * @brief Keep the bus board useful after a failed fetch: prune departed
+ * entries and fill up with estimates from the offline timetable
+ */
+static void bus_offline_fallback(const char *reason)
+{
+    int estimated = transport_offline_fill_bus(&g_bus_data, time(NULL));
+
+    g_bus_data.api_error = true;
+    strncpy(g_bus_data.error_msg, estimated ? "Offline - estimated times" : reason,
+            sizeof(g_bus_data.error_msg) - 1);
+    ESP_LOGI(TAG, "Bus board offline (%s), %d estimated departures", reason, estimated);
+
+    extern esp_event_loop_handle_t view_event_handle;
+    esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_BUS_COUNTDOWN_UPDATE,
+                     &g_bus_data, view_data_bus_countdown_size(&g_bus_data), portMAX_DELAY);
+}
+
+/**
+ * @brief Train board counterpart of bus_offline_fallback()
+ */
+static void train_offline_fallback(const char *reason)
+{
+    int estimated = transport_offline_fill_train(&g_train_data, time(NULL));
+
+    g_train_data.api_error = true;
+    strncpy(g_train_data.error_msg, estimated ? "Offline - estimated times" : reason,
+            sizeof(g_train_data.error_msg) - 1);
+    ESP_LOGI(TAG, "Train board offline (%s), %d estimated departures", reason, estimated);
+
+    extern esp_event_loop_handle_t view_event_handle;
+    esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_TRAIN_STATION_UPDATE,
+                     &g_train_data, view_data_train_station_size(&g_train_data), portMAX_DELAY);
+}
+
 /**
  * @brief Task to fetch bus data
  */
@@ -1142,6 +1252,9 @@ static void fetch_bus_task(void *arg)
     // Check if WiFi is connected
     if (!network_manager_is_connected()) {
         ESP_LOGW(TAG, "WiFi not connected, skipping bus data fetch");
+        if (g_bus_stop_selected) {
+            bus_offline_fallback("No WiFi");
+        }
         vTaskDelete(NULL);
         return;
     }
@@ -1153,20 +1266,7 @@ static void fetch_bus_task(void *arg)
         return;
     }
     
-    // Wait for time sync if needed (up to 10 seconds)
-    time_t now;
-    time(&now);
-    int retries = 0;
-    while (now < 1735689600 && retries < 10) { // 2025-01-01
-        ESP_LOGI(TAG, "Waiting for time sync... (%d/10)", retries + 1);
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        time(&now);
-        retries++;
-    }
-    
-    if (now < 1735689600) {
-         ESP_LOGW(TAG, "Time not synced yet, fetching anyway but times might be wrong");
-    }
+    // No wait for SNTP: an unset clock is taken from the response's Date header
     
     // Ping check to ensure connectivity
     if (network_manager_ping("8.8.8.8") != ESP_OK) {
@@ -1196,6 +1296,7 @@ static void fetch_bus_task(void *arg)
     }
     
     size_t response_length = 0;
+    boot_timeline_mark(BOOT_STAGE_FETCH);
     esp_err_t err = network_manager_http_get(url, response_buffer, 400 * 1024, &response_length);
     
     if (err == ESP_OK && response_length > 0) {
@@ -1233,27 +1334,19 @@ static void fetch_bus_task(void *arg)
         err = parse_bus_json(response_buffer);
         if (err == ESP_OK) {
             time(&g_last_bus_refresh);
+            transport_offline_record_bus(&g_bus_data, g_last_bus_refresh);
             
             // Post event to update UI
             extern esp_event_loop_handle_t view_event_handle;
             esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_BUS_COUNTDOWN_UPDATE,
-                             &g_bus_data, sizeof(g_bus_data), portMAX_DELAY);
+                             &g_bus_data, view_data_bus_countdown_size(&g_bus_data), portMAX_DELAY);
+            boot_timeline_mark(BOOT_STAGE_DATA);
         } else {
-            g_bus_data.api_error = true;
-            strncpy(g_bus_data.error_msg, "Parse error", sizeof(g_bus_data.error_msg) - 1);
-            // Post event to update UI with error
-            extern esp_event_loop_handle_t view_event_handle;
-            esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_BUS_COUNTDOWN_UPDATE,
-                             &g_bus_data, sizeof(g_bus_data), portMAX_DELAY);
+            bus_offline_fallback("Parse error");
         }
     } else {
-        g_bus_data.api_error = true;
-        strncpy(g_bus_data.error_msg, "API error", sizeof(g_bus_data.error_msg) - 1);
         ESP_LOGE(TAG, "Failed to fetch bus data: %s, len=%d", esp_err_to_name(err), response_length);
-        // Post event to update UI with error
-        extern esp_event_loop_handle_t view_event_handle;
-        esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_BUS_COUNTDOWN_UPDATE,
-                         &g_bus_data, sizeof(g_bus_data), portMAX_DELAY);
+        bus_offline_fallback("API error");
     }
     
     free(response_buffer);
@@ -1278,6 +1371,9 @@ static void fetch_train_task(void *arg)
     // Check if WiFi is connected
     if (!network_manager_is_connected()) {
         ESP_LOGW(TAG, "WiFi not connected, skipping train data fetch");
+        if (g_train_station_selected) {
+            train_offline_fallback("No WiFi");
+        }
         vTaskDelete(NULL);
         return;
     }
@@ -1312,6 +1408,7 @@ static void fetch_train_task(void *arg)
     }
     
     size_t response_length = 0;
+    boot_timeline_mark(BOOT_STAGE_FETCH);
     esp_err_t err = network_manager_http_get(url, response_buffer, 400 * 1024, &response_length);
     
     if (err == ESP_OK && response_length > 0) {
@@ -1349,27 +1446,19 @@ static void fetch_train_task(void *arg)
         err = parse_train_json(response_buffer);
         if (err == ESP_OK) {
             time(&g_last_train_refresh);
+            transport_offline_record_train(&g_train_data, g_last_train_refresh);
             
             // Post event to update UI
             extern esp_event_loop_handle_t view_event_handle;
             esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_TRAIN_STATION_UPDATE,
-                             &g_train_data, sizeof(g_train_data), portMAX_DELAY);
+                             &g_train_data, view_data_train_station_size(&g_train_data), portMAX_DELAY);
+            boot_timeline_mark(BOOT_STAGE_DATA);
         } else {
-            g_train_data.api_error = true;
-            strncpy(g_train_data.error_msg, "Parse error", sizeof(g_train_data.error_msg) - 1);
-            // Post event to update UI with error
-            extern esp_event_loop_handle_t view_event_handle;
-            esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_TRAIN_STATION_UPDATE,
-                             &g_train_data, sizeof(g_train_data), portMAX_DELAY);
+            train_offline_fallback("Parse error");
         }
     } else {
-        g_train_data.api_error = true;
-        strncpy(g_train_data.error_msg, "API error", sizeof(g_train_data.error_msg) - 1);
         ESP_LOGE(TAG, "Failed to fetch train data: %s", esp_err_to_name(err));
-        // Post event to update UI with error
-        extern esp_event_loop_handle_t view_event_handle;
-        esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_TRAIN_STATION_UPDATE,
-                         &g_train_data, sizeof(g_train_data), portMAX_DELAY);
+        train_offline_fallback("API error");
     }
     
     free(response_buffer);
@@ -1386,6 +1475,9 @@ static void refresh_timer_callback(TimerHandle_t xTimer)
     int interval_min = transport_data_get_refresh_interval();
     xTimerChangePeriod(xTimer, pdMS_TO_TICKS(interval_min * 60 * 1000), 0);
 
+    /* Wake the modem for the burst; deferred periodic checks join it */
+    indicator_wifi_ps_hold(FETCH_PS_WINDOW_MS);
+
     if (g_active_screen == 0) {
         xTaskCreate(fetch_bus_task, "fetch_bus", 8192, NULL, 5, NULL);
     } else if (g_active_screen == 1) {
@@ -1401,10 +1493,15 @@ esp_err_t transport_data_init(void)
     ESP_LOGI(TAG, "Train station: %s (%s)", TRAIN_STATION_NAME, TRAIN_STATION_ID);
     ESP_LOGI(TAG, "Selected bus lines: %s", SELECTED_BUS_LINES);
     
+    transport_selection_restore();
+    
     // Initialize data structures
     strncpy(g_bus_data.stop_name, g_bus_stop_name, sizeof(g_bus_data.stop_name) - 1);
     strncpy(g_train_data.station_name, g_train_station_name, sizeof(g_train_data.station_name) - 1);
     
+    // Timetable history for offline estimates (not fatal if it can't be allocated)
+    transport_offline_init();
+    
     // Create refresh timer (will be started after initial fetch)
     g_refresh_timer = xTimerCreate("transport_refresh",
                                    pdMS_TO_TICKS(transport_data_get_refresh_interval() * 60 * 1000),
@@ -1447,14 +1544,14 @@ esp_err_t transport_data_fetch_train(void)
 esp_err_t transport_data_get_bus_countdown(struct view_data_bus_countdown *data)
 {
     if (!data) return ESP_ERR_INVALID_ARG;
-    memcpy(data, &g_bus_data, sizeof(*data));
+    memcpy(data, &g_bus_data, view_data_bus_countdown_size(&g_bus_data));
     return ESP_OK;
 }
 
 esp_err_t transport_data_get_train_station(struct view_data_train_station *data)
 {
     if (!data) return ESP_ERR_INVALID_ARG;
-    memcpy(data, &g_train_data, sizeof(*data));
+    memcpy(data, &g_train_data, view_data_train_station_size(&g_train_data));
     return ESP_OK;
 }
 
@@ -1472,6 +1569,8 @@ esp_err_t transport_data_fetch_train_details(const char *journey_name)
         return ESP_ERR_NO_MEM;
     }
     
+    indicator_wifi_ps_hold(DETAILS_PS_WINDOW_MS);
+
     // Set loading state
     g_train_details.loading = true;
     g_train_details.error = false;
@@ -1493,6 +1592,8 @@ esp_err_t transport_data_fetch_bus_details(const char *journey_name)
         return ESP_ERR_NO_MEM;
     }
     
+    indicator_wifi_ps_hold(DETAILS_PS_WINDOW_MS);
+
     g_bus_details.loading = true;
     g_bus_details.error = false;
     
@@ -0,0 +1,373 @@
+#include "transport_offline.h"
+#include "view_strtab.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "transport_offline";
+
+#define OFFLINE_RECORD_MAX_MIN  180     // cap on the observed window of one board
+#define OFFLINE_MATCH_S         90      // a real departure this close hides an estimate
+
+struct offline_pattern {
+    char line[16];
+    char destination[64];
+    char extra[128];            // bus: direction name, train: via
+    char platform[16];
+    time_t last_seen;
+    uint64_t minutes[2][24];    // [weekend][hour], bit n = departs at minute n
+};
+
+struct offline_board {
+    struct offline_pattern patterns[TRANSPORT_OFFLINE_PATTERNS];
+    uint64_t covered[2][24];    // minutes for which a fetched board was complete
+};
+
+struct offline_obs {
+    const char *line;
+    const char *destination;
+    const char *extra;
+    const char *platform;
+    time_t ts;
+};
+
+struct offline_cand {
+    const struct offline_pattern *p;
+    time_t ts;
+};
+
+static struct offline_board *g_boards = NULL;
+static SemaphoreHandle_t g_offline_mutex = NULL;
+
+static void slot_of(time_t t, int *day, int *hour, int *minute)
+{
+    struct tm tm_info;
+    localtime_r(&t, &tm_info);
+    *day = (tm_info.tm_wday == 0 || tm_info.tm_wday == 6) ? 1 : 0;
+    *hour = tm_info.tm_hour;
+    *minute = tm_info.tm_min;
+}
+
+static struct offline_pattern *find_pattern(struct offline_board *b, const struct offline_obs *o, bool add)
+{
+    struct offline_pattern *oldest = &b->patterns[0];
+
+    for (int i = 0; i < TRANSPORT_OFFLINE_PATTERNS; i++) {
+        struct offline_pattern *p = &b->patterns[i];
+        if (p->line[0] && strcmp(p->line, o->line) == 0 &&
+            strcmp(p->destination, o->destination) == 0) {
+            return p;
+        }
+        if (p->last_seen < oldest->last_seen) {
+            oldest = p;
+        }
+    }
+    if (!add) {
+        return NULL;
+    }
+
+    // Free slots have last_seen 0, so this is a free slot or the least recently seen pattern
+    memset(oldest, 0, sizeof(*oldest));
+    strncpy(oldest->line, o->line, sizeof(oldest->line) - 1);
+    strncpy(oldest->destination, o->destination, sizeof(oldest->destination) - 1);
+    return oldest;
+}
+
+static void record(enum transport_offline_board board, const struct offline_obs *obs, int n, time_t now)
+{
+    if (!g_boards) return;
+
+    // An empty board says nothing runs within the horizon the fallback would fill
+    time_t end = n ? 0 : now + TRANSPORT_OFFLINE_HORIZON_MIN * 60;
+    for (int i = 0; i < n; i++) {
+        if (obs[i].ts > end) end = obs[i].ts;
+    }
+    if (end > now + OFFLINE_RECORD_MAX_MIN * 60) {
+        end = now + OFFLINE_RECORD_MAX_MIN * 60;
+    }
+
+    xSemaphoreTake(g_offline_mutex, portMAX_DELAY);
+    struct offline_board *b = &g_boards[board];
+
+    for (int i = 0; i < TRANSPORT_OFFLINE_PATTERNS; i++) {
+        if (b->patterns[i].line[0] && now - b->patterns[i].last_seen > TRANSPORT_OFFLINE_MAX_AGE_S) {
+            memset(&b->patterns[i], 0, sizeof(b->patterns[i]));
+        }
+    }
+
+    // The fetched board lists every departure in [now, end]: the latest observation wins
+    int minutes_covered = 0;
+    for (time_t t = (now + 59) / 60 * 60; t <= end; t += 60) {
+        int d, h, m;
+        slot_of(t, &d, &h, &m);
+        uint64_t bit = 1ULL << m;
+        b->covered[d][h] |= bit;
+        for (int i = 0; i < TRANSPORT_OFFLINE_PATTERNS; i++) {
+            b->patterns[i].minutes[d][h] &= ~bit;
+        }
+        minutes_covered++;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (obs[i].ts < now - 60 || obs[i].ts > end) continue;
+        struct offline_pattern *p = find_pattern(b, &obs[i], true);
+        int d, h, m;
+        slot_of(obs[i].ts, &d, &h, &m);
+        p->minutes[d][h] |= 1ULL << m;
+        p->last_seen = now;
+        if (obs[i].extra) strncpy(p->extra, obs[i].extra, sizeof(p->extra) - 1);
+        if (obs[i].platform) strncpy(p->platform, obs[i].platform, sizeof(p->platform) - 1);
+    }
+    xSemaphoreGive(g_offline_mutex);
+
+    ESP_LOGD(TAG, "Board %d: %d departures over %d observed minutes", board, n, minutes_covered);
+}
+
+/**
+ * Is p expected at day/hour/minute? Observed minutes answer directly; for a
+ * minute never observed in this hour the nearest observed hour is used,
+ * since most lines run on a clock-face (same minutes every hour) timetable.
+ */
+static bool pattern_at(const struct offline_board *b, const struct offline_pattern *p,
+                       int d, int h, int m)
+{
+    uint64_t bit = 1ULL << m;
+
+    for (int k = 0; k <= TRANSPORT_OFFLINE_HOUR_REACH; k++) {
+        int hours[2] = { h - k, h + k };
+        for (int j = 0; j < (k ? 2 : 1); j++) {
+            int hh = hours[j];
+            if (hh < 0 || hh > 23) continue;
+            if (b->covered[d][hh] & bit) {
+                return (p->minutes[d][hh] & bit) != 0;
+            }
+        }
+    }
+    return false;
+}
+
+// Called with the mutex held; candidates come out in time order
+static int candidates(const struct offline_board *b, time_t now, struct offline_cand *out, int max)
+{
+    int n = 0;
+
+    for (time_t t = (now + 59) / 60 * 60; t <= now + TRANSPORT_OFFLINE_HORIZON_MIN * 60 && n < max; t += 60) {
+        int d, h, m;
+        slot_of(t, &d, &h, &m);
+        for (int i = 0; i < TRANSPORT_OFFLINE_PATTERNS && n < max; i++) {
+            const struct offline_pattern *p = &b->patterns[i];
+            if (p->line[0] && pattern_at(b, p, d, h, m)) {
+                out[n].p = p;
+                out[n].ts = t;
+                n++;
+            }
+        }
+    }
+    return n;
+}
+
+static int compare_bus(const void *a, const void *b)
+{
+    const struct bus_departure_view *x = a, *y = b;
+    return (x->departure_timestamp > y->departure_timestamp) - (x->departure_timestamp < y->departure_timestamp);
+}
+
+static int compare_train(const void *a, const void *b)
+{
+    const struct train_departure_view *x = a, *y = b;
+    return (x->departure_timestamp > y->departure_timestamp) - (x->departure_timestamp < y->departure_timestamp);
+}
+
+esp_err_t transport_offline_init(void)
+{
+    if (g_boards) return ESP_OK;
+
+    g_offline_mutex = xSemaphoreCreateMutex();
+    // ~18 KB, large enough to be placed in PSRAM by malloc
+    g_boards = calloc(TRANSPORT_OFFLINE_BOARD_MAX, sizeof(struct offline_board));
+    if (!g_offline_mutex || !g_boards) {
+        ESP_LOGE(TAG, "Failed to allocate offline timetable");
+        free(g_boards);
+        g_boards = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void transport_offline_reset(enum transport_offline_board board)
+{
+    if (!g_boards || board >= TRANSPORT_OFFLINE_BOARD_MAX) return;
+    xSemaphoreTake(g_offline_mutex, portMAX_DELAY);
+    memset(&g_boards[board], 0, sizeof(g_boards[board]));
+    xSemaphoreGive(g_offline_mutex);
+}
+
+void transport_offline_record_bus(const struct view_data_bus_countdown *data, time_t now)
+{
+    struct offline_obs obs[MAX_DEPARTURES];
+    int n = 0;
+
+    for (int i = 0; i < data->count && i < MAX_DEPARTURES; i++) {
+        const struct bus_departure_view *dep = &data->departures[i];
+        if (!dep->valid || dep->estimated || dep->departure_timestamp <= 0) continue;
+        int dir = dep->direction_index;
+        obs[n].line = view_str(&data->strings, dep->line);
+        obs[n].destination = view_str(&data->strings, dep->destination);
+        obs[n].extra = (dir >= 0 && dir < data->direction_count) ? view_str(&data->strings, data->directions[dir]) : NULL;
+        obs[n].platform = NULL;
+        obs[n].ts = dep->departure_timestamp;
+        n++;
+    }
+    record(TRANSPORT_OFFLINE_BUS, obs, n, now);
+}
+
+void transport_offline_record_train(const struct view_data_train_station *data, time_t now)
+{
+    struct offline_obs obs[MAX_DEPARTURES];
+    int n = 0;
+
+    for (int i = 0; i < data->count && i < MAX_DEPARTURES; i++) {
+        const struct train_departure_view *dep = &data->departures[i];
+        if (!dep->valid || dep->estimated || dep->departure_timestamp <= 0) continue;
+        obs[n].line = view_str(&data->strings, dep->line);
+        obs[n].destination = view_str(&data->strings, dep->destination);
+        obs[n].extra = view_str(&data->strings, dep->via);
+        obs[n].platform = view_str(&data->strings, dep->platform);
+        obs[n].ts = dep->departure_timestamp;
+        n++;
+    }
+    record(TRANSPORT_OFFLINE_TRAIN, obs, n, now);
+}
+
+int transport_offline_fill_bus(struct view_data_bus_countdown *data, time_t now)
+{
+    // Drop departed and previously estimated entries
+    int n = 0;
+    for (int i = 0; i < data->count && i < MAX_DEPARTURES; i++) {
+        const struct bus_departure_view *dep = &data->departures[i];
+        if (!dep->valid || dep->estimated) continue;
+        if (dep->departure_timestamp > 0 && dep->departure_timestamp < now - TRANSPORT_OFFLINE_PRUNE_S) continue;
+        if (n != i) data->departures[n] = *dep;
+        n++;
+    }
+    int real = n;
+    if (!g_boards) {
+        data->count = n;
+        return 0;
+    }
+
+    struct offline_cand *cand = malloc(sizeof(*cand) * MAX_DEPARTURES * 4);
+    if (!cand) {
+        data->count = n;
+        return 0;
+    }
+
+    xSemaphoreTake(g_offline_mutex, portMAX_DELAY);
+    int nc = candidates(&g_boards[TRANSPORT_OFFLINE_BUS], now, cand, MAX_DEPARTURES * 4);
+    for (int c = 0; c < nc && n < MAX_DEPARTURES; c++) {
+        const struct offline_pattern *p = cand[c].p;
+        bool seen = false;
+        for (int i = 0; i < real && !seen; i++) {
+            const struct bus_departure_view *dep = &data->departures[i];
+            seen = strcmp(view_str(&data->strings, dep->line), p->line) == 0 &&
+                   strcmp(view_str(&data->strings, dep->destination), p->destination) == 0 &&
+                   llabs((long long)(dep->departure_timestamp - cand[c].ts)) < OFFLINE_MATCH_S;
+        }
+        if (seen) continue;
+
+        // Direction by name, added if the current board does not have it
+        int dir = 0;
+        if (p->extra[0]) {
+            for (dir = 0; dir < data->direction_count; dir++) {
+                if (strcmp(view_str(&data->strings, data->directions[dir]), p->extra) == 0) break;
+            }
+            if (dir == data->direction_count) {
+                if (dir < MAX_DIRECTIONS) {
+                    data->directions[dir] = view_strtab_intern(&data->strings, p->extra);
+                    data->direction_count++;
+                } else {
+                    dir = 0;
+                }
+            }
+        }
+
+        struct bus_departure_view *dep = &data->departures[n++];
+        memset(dep, 0, sizeof(*dep));
+        dep->line = view_strtab_intern(&data->strings, p->line);
+        dep->destination = view_strtab_intern(&data->strings, p->destination);
+        struct tm tm_info;
+        localtime_r(&cand[c].ts, &tm_info);
+        dep->time_min = tm_info.tm_hour * 60 + tm_info.tm_min;
+        dep->departure_timestamp = cand[c].ts;
+        dep->minutes_until = (int)((cand[c].ts - now) / 60);
+        dep->direction_index = dir;
+        dep->valid = true;
+        dep->estimated = true;
+    }
+    xSemaphoreGive(g_offline_mutex);
+    free(cand);
+
+    qsort(data->departures, n, sizeof(data->departures[0]), compare_bus);
+    data->count = n;
+    return n - real;
+}
+
+int transport_offline_fill_train(struct view_data_train_station *data, time_t now)
+{
+    int n = 0;
+    for (int i = 0; i < data->count && i < MAX_DEPARTURES; i++) {
+        const struct train_departure_view *dep = &data->departures[i];
+        if (!dep->valid || dep->estimated) continue;
+        if (dep->departure_timestamp > 0 &&
+            dep->departure_timestamp + dep->delay_minutes * 60 < now - TRANSPORT_OFFLINE_PRUNE_S) continue;
+        if (n != i) data->departures[n] = *dep;
+        n++;
+    }
+    int real = n;
+    if (!g_boards) {
+        data->count = n;
+        return 0;
+    }
+
+    struct offline_cand *cand = malloc(sizeof(*cand) * MAX_DEPARTURES * 4);
+    if (!cand) {
+        data->count = n;
+        return 0;
+    }
+
+    xSemaphoreTake(g_offline_mutex, portMAX_DELAY);
+    int nc = candidates(&g_boards[TRANSPORT_OFFLINE_TRAIN], now, cand, MAX_DEPARTURES * 4);
+    for (int c = 0; c < nc && n < MAX_DEPARTURES; c++) {
+        const struct offline_pattern *p = cand[c].p;
+        bool seen = false;
+        for (int i = 0; i < real && !seen; i++) {
+            const struct train_departure_view *dep = &data->departures[i];
+            seen = strcmp(view_str(&data->strings, dep->line), p->line) == 0 &&
+                   strcmp(view_str(&data->strings, dep->destination), p->destination) == 0 &&
+                   llabs((long long)(dep->departure_timestamp - cand[c].ts)) < OFFLINE_MATCH_S;
+        }
+        if (seen) continue;
+
+        struct train_departure_view *dep = &data->departures[n++];
+        memset(dep, 0, sizeof(*dep));
+        dep->line = view_strtab_intern(&data->strings, p->line);
+        dep->destination = view_strtab_intern(&data->strings, p->destination);
+        dep->via = view_strtab_intern(&data->strings, p->extra);
+        dep->platform = view_strtab_intern(&data->strings, p->platform);
+        struct tm tm_info;
+        localtime_r(&cand[c].ts, &tm_info);
+        dep->time_min = tm_info.tm_hour * 60 + tm_info.tm_min;
+        dep->departure_timestamp = cand[c].ts;
+        dep->minutes_until = (int)((cand[c].ts - now) / 60);
+        dep->valid = true;
+        dep->estimated = true;
+    }
+    xSemaphoreGive(g_offline_mutex);
+    free(cand);
+
+    qsort(data->departures, n, sizeof(data->departures[0]), compare_train);
+    data->count = n;
+    return n - real;
+}
@@ -0,0 +1,63 @@
+#ifndef TRANSPORT_OFFLINE_H
+#define TRANSPORT_OFFLINE_H
+
+#include "esp_err.h"
+#include "view_data.h"
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Offline timetable: remembers the scheduled minutes at which each line /
+ * destination has been seen leaving, per hour and weekday/weekend, and
+ * synthesises upcoming departures from that pattern while the API is not
+ * reachable. Synthesised departures have `estimated` set.
+ */
+
+#define TRANSPORT_OFFLINE_PATTERNS      24      // line/destination pairs kept per board
+#define TRANSPORT_OFFLINE_HORIZON_MIN   60      // how far ahead departures are synthesised
+#define TRANSPORT_OFFLINE_HOUR_REACH    2       // borrow a minute from up to +-2 h (clock-face timetable)
+#define TRANSPORT_OFFLINE_MAX_AGE_S     (14 * 24 * 3600)   // forget patterns not seen for this long
+#define TRANSPORT_OFFLINE_PRUNE_S       60      // drop departures this long past
+
+enum transport_offline_board {
+    TRANSPORT_OFFLINE_BUS = 0,
+    TRANSPORT_OFFLINE_TRAIN,
+    TRANSPORT_OFFLINE_BOARD_MAX,
+};
+
+/**
+ * @brief Allocate the history tables
+ * @return ESP_OK on success, ESP_ERR_NO_MEM
+ */
+esp_err_t transport_offline_init(void);
+
+/**
+ * @brief Forget the history of one board (stop/station changed)
+ */
+void transport_offline_reset(enum transport_offline_board board);
+
+/**
+ * @brief Learn from a freshly fetched board
+ *
+ * The minutes between now and the last listed departure are treated as fully
+ * observed: patterns not listed there are cleared for those minutes. An empty
+ * board covers the next TRANSPORT_OFFLINE_HORIZON_MIN minutes.
+ */
+void transport_offline_record_bus(const struct view_data_bus_countdown *data, time_t now);
+void transport_offline_record_train(const struct view_data_train_station *data, time_t now);
+
+/**
+ * @brief Prune departed entries and add estimated ones up to the horizon
+ * @return Number of estimated departures now in data
+ */
+int transport_offline_fill_bus(struct view_data_bus_countdown *data, time_t now);
+int transport_offline_fill_train(struct view_data_train_station *data, time_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRANSPORT_OFFLINE_H
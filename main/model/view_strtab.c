@@ -0,0 +1,41 @@
+#include "view_strtab.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "view_strtab";
+
+void view_strtab_reset(struct view_strtab *t)
+{
+    t->used = 1;
+    t->buf[0] = '\0';
+}
+
+view_str_t view_strtab_intern(struct view_strtab *t, const char *s)
+{
+    size_t len = s ? strlen(s) : 0;
+    if (len == 0) {
+        return 0;
+    }
+    if (t->used == 0) {
+        view_strtab_reset(t);
+    }
+
+    // A board has a few dozen distinct strings, a linear walk is cheaper than an index
+    for (size_t off = 1; off < t->used; ) {
+        size_t n = strlen(&t->buf[off]);
+        if (n == len && memcmp(&t->buf[off], s, len) == 0) {
+            return (view_str_t)off;
+        }
+        off += n + 1;
+    }
+
+    if (t->used + len + 1 > VIEW_STRTAB_SIZE) {
+        ESP_LOGW(TAG, "String table full (%u bytes), dropping \"%.*s\"", (unsigned)t->used, (int)len, s);
+        return 0;
+    }
+    view_str_t off = t->used;
+    memcpy(&t->buf[off], s, len);
+    t->buf[off + len] = '\0';
+    t->used += len + 1;
+    return off;
+}
@@ -0,0 +1,26 @@
+#ifndef VIEW_STRTAB_H
+#define VIEW_STRTAB_H
+
+#include "view_data.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Empty the table, only the empty string at offset 0 remains
+ */
+void view_strtab_reset(struct view_strtab *t);
+
+/**
+ * @brief Store s once per table
+ * @return Offset of s, an earlier copy if there is one; 0 ("") for NULL,
+ *         "" or when the table is full
+ */
+view_str_t view_strtab_intern(struct view_strtab *t, const char *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VIEW_STRTAB_H
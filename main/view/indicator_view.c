@@ -1,9 +1,13 @@
 #include "indicator_view.h"
 #include "view_data.h"
 #include "lvgl.h"
+#include "lv_port.h"
 #include "esp_log.h"
 #include "esp_event.h"
+#include "esp_timer.h"
 #include "network_manager.h"
+#include "indicator_storage.h"
+#include "boot_timeline.h"
 #include "transport_data.h"
 #include "indicator_time.h"  // For time updates
 #include "indicator_display.h"  // For display config
@@ -141,6 +145,8 @@ static lv_obj_t *display_apply_btn = NULL;
 static lv_obj_t *wifi_view_cont = NULL;
 static lv_obj_t *wifi_netinfo_cont = NULL;  /* panel with IP, DNS, RSSI, etc. */
 static lv_obj_t *wifi_list = NULL;
+static int64_t wifi_list_req_us = 0;        // For time-to-first-entry, 0 once measured
+static bool wifi_list_cached_logged = false;
 static lv_obj_t *wifi_password_view_cont = NULL;  /* Unified Connection Screen */
 static lv_obj_t *wifi_ssid_ta = NULL;  /* SSID Text Area (editable for manual add) */
 static lv_obj_t *wifi_password_ta = NULL;
@@ -168,6 +174,12 @@ static lv_obj_t *sysinfo_uptime_label = NULL;
 static lv_obj_t *sysinfo_versions_label = NULL;
 static lv_obj_t *sysinfo_author_label = NULL;
 static lv_obj_t *sysinfo_build_label = NULL;
+static lv_obj_t *sysinfo_conn_label = NULL;
+static lv_obj_t *sysinfo_storage_label = NULL;
+static lv_obj_t *sysinfo_boot_label = NULL;
+#if LV_PORT_PROFILER_EN
+static lv_obj_t *sysinfo_render_label = NULL;
+#endif
 
 // Forward declarations
 static void update_bus_screen(const struct view_data_bus_countdown *data);
@@ -212,6 +224,9 @@ static void display_btn_cb(lv_event_t *e);
 static void display_back_btn_cb(lv_event_t *e);
 static void sysinfo_btn_cb(lv_event_t *e);
 static void sysinfo_back_btn_cb(lv_event_t *e);
+#if LV_PORT_PROFILER_EN
+static void sysinfo_prof_dump_btn_cb(lv_event_t *e);
+#endif
 static void wifi_back_btn_cb(lv_event_t *e);
 static void wifi_scan_btn_cb(lv_event_t *e);
 static void wifi_manual_add_btn_cb(lv_event_t *e);
@@ -249,6 +264,10 @@ static void live_update_timer_cb(lv_timer_t *timer)
             if (bus_data.departures[i].valid && bus_data.departures[i].departure_timestamp > 0) {
                 double diff = difftime(bus_data.departures[i].departure_timestamp, now);
                 bus_data.departures[i].minutes_until = (int)(diff / 60);
+                // Drop buses that left over a minute ago (matters while no fresh data arrives)
+                if (diff < -60) {
+                    bus_data.departures[i].valid = false;
+                }
             }
         }
         update_bus_screen(&bus_data);
@@ -286,19 +305,195 @@ static void tabview_event_cb(lv_event_t *e)
     // Notify transport model about active screen
     // 0 = Clock, 1 = Bus, 2 = Train, 3 = Settings
     transport_data_notify_screen_change(id);
+#if LV_PORT_PROFILER_EN
+    lv_port_prof_set_screen((lv_port_screen_t)id);
+#endif
 }
 
 /**
- * @brief Get line color based on line number (matching opendata.ch colors)
- */
-static lv_color_t get_line_color(const char *line)
+ * @brief Shared styles for departure rows.
+ *
+ * Rows are rebuilt on every data update and every live tick, so they use these
+ * statically initialised styles via lv_obj_add_style() instead of
+ * lv_obj_set_style_*(), which would allocate a local style array per object.
+ * Initialised once in indicator_view_init().
+ */
+// Bus rows
+static lv_style_t style_bus_dir_header;
+static lv_style_t style_bus_row;
+static lv_style_t style_bus_badge;
+static lv_style_t style_bus_badge_red;      // Line 1
+static lv_style_t style_bus_badge_pink;     // Line 4
+static lv_style_t style_bus_badge_gray;     // Other lines
+static lv_style_t style_bus_line_text;
+static lv_style_t style_bus_dest;
+static lv_style_t style_bus_minutes;
+static lv_style_t style_minutes_on_time;
+static lv_style_t style_minutes_late;
+static lv_style_t style_minutes_early;
+
+// Train rows
+static lv_style_t style_train_row;
+static lv_style_t style_train_badge;
+static lv_style_t style_train_badge_s;      // S-Bahn: white bg
+static lv_style_t style_train_badge_re;     // RE/PE: white bg
+static lv_style_t style_train_badge_ic;     // IC/EC/etc: red bg
+static lv_style_t style_train_line_text;
+static lv_style_t style_train_line_text_s;  // Black text
+static lv_style_t style_train_line_text_re; // Red text
+static lv_style_t style_train_line_text_ic; // White text
+static lv_style_t style_train_time;
+static lv_style_t style_train_dest_cont;
+static lv_style_t style_train_dest;
+static lv_style_t style_train_via;
+static lv_style_t style_train_platform;
+static lv_style_t style_train_delay;
+
+static void init_row_style_pos(lv_style_t *style, lv_align_t align, lv_coord_t x, lv_coord_t y)
+{
+    lv_style_set_align(style, align);
+    lv_style_set_x(style, x);
+    lv_style_set_y(style, y);
+}
+
+static void init_row_styles(void)
+{
+    // --- Bus ---
+    lv_style_init(&style_bus_dir_header);
+    lv_style_set_text_font(&style_bus_dir_header, &arimo_16);
+    lv_style_set_text_color(&style_bus_dir_header, lv_color_hex(0xAAAAAA));
+    lv_style_set_pad_top(&style_bus_dir_header, 5);
+    lv_style_set_pad_bottom(&style_bus_dir_header, 5);
+
+    lv_style_init(&style_bus_row);
+    lv_style_set_width(&style_bus_row, LV_PCT(100));
+    lv_style_set_height(&style_bus_row, 55);
+    lv_style_set_pad_all(&style_bus_row, 3);
+    lv_style_set_pad_gap(&style_bus_row, 8);
+    lv_style_set_bg_color(&style_bus_row, lv_color_hex(0x1A1A1A));
+    lv_style_set_border_width(&style_bus_row, 0);  // No border
+    lv_style_set_shadow_width(&style_bus_row, 0);  // No shadow for button
+
+    lv_style_init(&style_bus_badge);
+    lv_style_set_width(&style_bus_badge, 55);
+    lv_style_set_height(&style_bus_badge, 48);
+    lv_style_set_bg_opa(&style_bus_badge, LV_OPA_COVER);
+    lv_style_set_border_width(&style_bus_badge, 0);
+    lv_style_set_radius(&style_bus_badge, 5);
+    init_row_style_pos(&style_bus_badge, LV_ALIGN_LEFT_MID, 3, 0);
+
+    // Line colors matching opendata.ch
+    lv_style_init(&style_bus_badge_red);
+    lv_style_set_bg_color(&style_bus_badge_red, lv_color_hex(0xFF0000));
+    lv_style_init(&style_bus_badge_pink);
+    lv_style_set_bg_color(&style_bus_badge_pink, lv_color_hex(0xFF69B4));
+    lv_style_init(&style_bus_badge_gray);
+    lv_style_set_bg_color(&style_bus_badge_gray, lv_color_hex(0x808080));
+
+    lv_style_init(&style_bus_line_text);
+    lv_style_set_text_color(&style_bus_line_text, lv_color_white());
+    lv_style_set_text_font(&style_bus_line_text, &arimo_24);
+    init_row_style_pos(&style_bus_line_text, LV_ALIGN_CENTER, 0, 0);
+
+    lv_style_init(&style_bus_dest);
+    lv_style_set_text_color(&style_bus_dest, lv_color_hex(0xCCCCCC));
+    lv_style_set_text_font(&style_bus_dest, &arimo_14);
+    lv_style_set_width(&style_bus_dest, LV_PCT(50));
+    init_row_style_pos(&style_bus_dest, LV_ALIGN_LEFT_MID, 65, 0);
+
+    lv_style_init(&style_bus_minutes);
+    lv_style_set_text_font(&style_bus_minutes, &arimo_20);
+    init_row_style_pos(&style_bus_minutes, LV_ALIGN_RIGHT_MID, -5, 0);
+
+    lv_style_init(&style_minutes_on_time);
+    lv_style_set_text_color(&style_minutes_on_time, lv_color_white());
+    lv_style_init(&style_minutes_late);
+    lv_style_set_text_color(&style_minutes_late, lv_color_hex(0xFF0000));
+    lv_style_init(&style_minutes_early);
+    lv_style_set_text_color(&style_minutes_early, lv_color_hex(0x00FF00));
+
+    // --- Train ---
+    lv_style_init(&style_train_row);
+    lv_style_set_width(&style_train_row, LV_PCT(100));
+    lv_style_set_height(&style_train_row, 40);
+    lv_style_set_bg_opa(&style_train_row, LV_OPA_TRANSP);
+    lv_style_set_border_side(&style_train_row, LV_BORDER_SIDE_BOTTOM);
+    lv_style_set_border_color(&style_train_row, lv_color_hex(0x404040));
+    lv_style_set_border_width(&style_train_row, 1); // Separator line
+    lv_style_set_pad_all(&style_train_row, 0);
+    lv_style_set_shadow_width(&style_train_row, 0); // No shadow for button
+
+    lv_style_init(&style_train_badge);
+    lv_style_set_width(&style_train_badge, 50);
+    lv_style_set_height(&style_train_badge, 30);
+    lv_style_set_border_width(&style_train_badge, 0);
+    lv_style_set_radius(&style_train_badge, 4);
+    init_row_style_pos(&style_train_badge, LV_ALIGN_LEFT_MID, 5, 0);
+
+    // S-Bahn: white bg, black text; RE/PE: white bg, red text; IC/EC/etc: red bg, white text
+    lv_style_init(&style_train_badge_s);
+    lv_style_set_bg_color(&style_train_badge_s, lv_color_white());
+    lv_style_init(&style_train_badge_re);
+    lv_style_set_bg_color(&style_train_badge_re, lv_color_white());
+    lv_style_init(&style_train_badge_ic);
+    lv_style_set_bg_color(&style_train_badge_ic, lv_color_hex(0xEB0000));
+
+    lv_style_init(&style_train_line_text);
+    lv_style_set_text_font(&style_train_line_text, &arimo_16);
+    init_row_style_pos(&style_train_line_text, LV_ALIGN_CENTER, 0, 0);
+
+    lv_style_init(&style_train_line_text_s);
+    lv_style_set_text_color(&style_train_line_text_s, lv_color_black());
+    lv_style_init(&style_train_line_text_re);
+    lv_style_set_text_color(&style_train_line_text_re, lv_color_hex(0xEB0000));
+    lv_style_init(&style_train_line_text_ic);
+    lv_style_set_text_color(&style_train_line_text_ic, lv_color_white());
+
+    lv_style_init(&style_train_time);
+    lv_style_set_text_color(&style_train_time, lv_color_white());
+    lv_style_set_text_font(&style_train_time, &arimo_16);
+    init_row_style_pos(&style_train_time, LV_ALIGN_LEFT_MID, 65, 0);
+
+    lv_style_init(&style_train_dest_cont);
+    lv_style_set_width(&style_train_dest_cont, 220);
+    lv_style_set_height(&style_train_dest_cont, 40);
+    lv_style_set_bg_opa(&style_train_dest_cont, LV_OPA_TRANSP);
+    lv_style_set_border_width(&style_train_dest_cont, 0);
+    lv_style_set_pad_all(&style_train_dest_cont, 0);
+    init_row_style_pos(&style_train_dest_cont, LV_ALIGN_LEFT_MID, 120, 0);
+
+    lv_style_init(&style_train_dest);
+    lv_style_set_text_color(&style_train_dest, lv_color_white());
+    lv_style_set_text_font(&style_train_dest, &arimo_16);
+    lv_style_set_width(&style_train_dest, 220);
+    init_row_style_pos(&style_train_dest, LV_ALIGN_TOP_LEFT, 0, 2);
+
+    lv_style_init(&style_train_via);
+    lv_style_set_text_color(&style_train_via, lv_color_hex(0xAAAAAA)); // Grey
+    lv_style_set_text_font(&style_train_via, &arimo_14);
+    lv_style_set_width(&style_train_via, 220);
+    init_row_style_pos(&style_train_via, LV_ALIGN_BOTTOM_LEFT, 0, -2);
+
+    lv_style_init(&style_train_platform);
+    lv_style_set_text_color(&style_train_platform, lv_color_white());
+    init_row_style_pos(&style_train_platform, LV_ALIGN_RIGHT_MID, -80, 0);
+
+    lv_style_init(&style_train_delay);
+    lv_style_set_text_color(&style_train_delay, lv_color_hex(0xFFD700)); // Yellow
+    init_row_style_pos(&style_train_delay, LV_ALIGN_RIGHT_MID, -10, 0);
+}
+
+/**
+ * @brief Get line badge style based on line number (matching opendata.ch colors)
+ */
+static lv_style_t *get_line_badge_style(const char *line)
 {
     if (strcmp(line, "1") == 0) {
-        return lv_color_hex(0xFF0000);  // Red for line 1
+        return &style_bus_badge_red;
     } else if (strcmp(line, "4") == 0) {
-        return lv_color_hex(0xFF69B4);  // Pink/HotPink for line 4
+        return &style_bus_badge_pink;
     }
-    return lv_color_hex(0x808080);  // Gray default
+    return &style_bus_badge_gray;
 }
 
 /**
@@ -358,6 +553,9 @@ static void bus_list_item_cb(lv_event_t *e)
     // Show details screen (loading)
     lv_obj_clear_flag(bus_details_screen, LV_OBJ_FLAG_HIDDEN);
     lv_obj_clear_flag(bus_details_loading, LV_OBJ_FLAG_HIDDEN);
+#if LV_PORT_PROFILER_EN
+    lv_port_prof_set_screen(LV_PORT_SCREEN_DETAILS);
+#endif
     lv_obj_add_flag(bus_details_view, LV_OBJ_FLAG_HIDDEN);
     
     esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_BUS_DETAILS_REQ, 
@@ -382,6 +580,9 @@ static void bus_details_close_btn_cb(lv_event_t *e)
 {
     // Hide details screen
     lv_obj_add_flag(bus_details_screen, LV_OBJ_FLAG_HIDDEN);
+#if LV_PORT_PROFILER_EN
+    lv_port_prof_set_screen(LV_PORT_SCREEN_BUS);
+#endif
     
     // Clear data in model
     transport_data_clear_bus_details();
@@ -455,6 +656,31 @@ static void station_select_cb(lv_event_t *e)
     }
 }
 
+/**
+ * @brief Open the boards on the stop/station restored from the last session
+ */
+static void restore_transport_selection(const struct view_data_transport_selection *sel)
+{
+    lv_port_sem_take();
+    if (sel->bus_selected && bus_selection_cont) {
+        lv_obj_add_flag(bus_selection_cont, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clear_flag(bus_loading_cont, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(bus_view_cont, LV_OBJ_FLAG_HIDDEN);
+        if (bus_stop_label) {
+            lv_label_set_text(bus_stop_label, sel->bus_stop_name);
+        }
+    }
+    if (sel->train_selected && station_selection_cont) {
+        lv_obj_add_flag(station_selection_cont, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clear_flag(loading_cont, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(train_view_cont, LV_OBJ_FLAG_HIDDEN);
+        if (train_station_label) {
+            lv_label_set_text(train_station_label, sel->train_station_name);
+        }
+    }
+    lv_port_sem_give();
+}
+
 /**
  * @brief Back to selection callback
  */
@@ -574,6 +800,18 @@ static void display_apply_btn_cb(lv_event_t *e)
     }
 }
 
+/**
+ * @brief Log once how long after boot the first departures were put on screen
+ */
+static void log_first_departure_render(const char *board)
+{
+    static bool logged = false;
+    if (!logged) {
+        logged = true;
+        ESP_LOGI(TAG, "Boot to first departure render: %lld ms (%s)", esp_timer_get_time() / 1000, board);
+    }
+}
+
 /**
  * @brief Update bus countdown screen
  */
@@ -613,16 +851,15 @@ static void update_bus_screen(const struct view_data_bus_countdown *data)
         
         const char* dir_name = "No departures";
         if (data->direction_count > 0) {
-            dir_name = data->directions[bus_view_direction_index];
+            dir_name = view_str(&data->strings, data->directions[bus_view_direction_index]);
         }
         
         // Add header label for direction
         lv_obj_t *header = lv_label_create(bus_list);
         lv_label_set_text(header, dir_name);
-        lv_obj_set_style_text_font(header, &arimo_16, 0);
-        lv_obj_set_style_text_color(header, lv_color_hex(0xAAAAAA), 0);
-        lv_obj_set_style_pad_top(header, 5, 0);
-        lv_obj_set_style_pad_bottom(header, 5, 0);
+        lv_obj_add_style(header, &style_bus_dir_header, 0);
+        
+        int rows = 0;
         
         for (int i = 0; i < data->count && i < MAX_DEPARTURES; i++) {
             if (!data->departures[i].valid) continue;
@@ -634,48 +871,34 @@ static void update_bus_screen(const struct view_data_bus_countdown *data)
             
             // Create container for each departure item - simplified, no border
             lv_obj_t *item = lv_btn_create(bus_list); // Changed to btn
-            lv_obj_set_width(item, LV_PCT(100));
-            lv_obj_set_height(item, 55);
-            lv_obj_set_style_pad_all(item, 3, 0);
-            lv_obj_set_style_pad_gap(item, 8, 0);
-            lv_obj_set_style_bg_color(item, lv_color_hex(0x1A1A1A), LV_PART_MAIN | LV_STATE_DEFAULT);
-            lv_obj_set_style_border_width(item, 0, LV_PART_MAIN | LV_STATE_DEFAULT);  // No border
-            lv_obj_set_style_shadow_width(item, 0, 0); // No shadow for button
+            lv_obj_add_style(item, &style_bus_row, 0);
             lv_obj_clear_flag(item, LV_OBJ_FLAG_SCROLLABLE);
+            rows++;
             
-            // Add click event
-            char *j_name = lv_mem_alloc(strlen(data->departures[i].journey_name) + 1);
+            // Add click event (estimated rows have no journey to show)
+            const char *journey_name = view_str(&data->strings, data->departures[i].journey_name);
+            char *j_name = data->departures[i].estimated ? NULL : lv_mem_alloc(strlen(journey_name) + 1);
             if (j_name) {
-                strcpy(j_name, data->departures[i].journey_name);
+                strcpy(j_name, journey_name);
                 lv_obj_add_event_cb(item, bus_list_item_cb, LV_EVENT_CLICKED, j_name);
                 lv_obj_add_event_cb(item, bus_list_item_delete_cb, LV_EVENT_DELETE, j_name);
             }
             
             // Line number with colored background
             lv_obj_t *line_container = lv_obj_create(item);
-            lv_color_t line_color = get_line_color(data->departures[i].line);
-            lv_obj_set_width(line_container, 55);
-            lv_obj_set_height(line_container, 48);
-            lv_obj_set_style_bg_color(line_container, line_color, LV_PART_MAIN | LV_STATE_DEFAULT);
-            lv_obj_set_style_bg_opa(line_container, LV_OPA_COVER, LV_PART_MAIN | LV_STATE_DEFAULT);
-            lv_obj_set_style_border_width(line_container, 0, LV_PART_MAIN | LV_STATE_DEFAULT);
-            lv_obj_set_style_radius(line_container, 5, LV_PART_MAIN | LV_STATE_DEFAULT);
-            lv_obj_align(line_container, LV_ALIGN_LEFT_MID, 3, 0);
+            lv_obj_add_style(line_container, &style_bus_badge, 0);
+            const char *line = view_str(&data->strings, data->departures[i].line);
+            lv_obj_add_style(line_container, get_line_badge_style(line), 0);
             lv_obj_clear_flag(line_container, LV_OBJ_FLAG_SCROLLABLE);
             
             lv_obj_t *line_label = lv_label_create(line_container);
-            lv_label_set_text(line_label, data->departures[i].line);
-            lv_obj_set_style_text_color(line_label, lv_color_white(), LV_PART_MAIN | LV_STATE_DEFAULT);
-            lv_obj_set_style_text_font(line_label, &arimo_24, LV_PART_MAIN | LV_STATE_DEFAULT);
-            lv_obj_center(line_label);
+            lv_label_set_text(line_label, line);
+            lv_obj_add_style(line_label, &style_bus_line_text, 0);
             
             // Destination/kierunek label (font 10) - between line and time
             lv_obj_t *destination_label = lv_label_create(item);
-            lv_label_set_text(destination_label, data->departures[i].destination);
-            lv_obj_set_style_text_color(destination_label, lv_color_hex(0xCCCCCC), LV_PART_MAIN | LV_STATE_DEFAULT);
-            lv_obj_set_style_text_font(destination_label, &arimo_14, LV_PART_MAIN | LV_STATE_DEFAULT);
-            lv_obj_set_width(destination_label, LV_PCT(50));
-            lv_obj_align(destination_label, LV_ALIGN_LEFT_MID, 65, 0);
+            lv_label_set_text(destination_label, view_str(&data->strings, data->departures[i].destination));
+            lv_obj_add_style(destination_label, &style_bus_dest, 0);
             
             // Minutes label
             lv_obj_t *minutes_label = lv_label_create(item);
@@ -707,21 +930,28 @@ static void update_bus_screen(const struct view_data_bus_countdown *data)
             }
             
             lv_label_set_text(minutes_label, minutes_text);
-            lv_obj_set_style_text_font(minutes_label, &arimo_20, LV_PART_MAIN | LV_STATE_DEFAULT);
-            lv_obj_align(minutes_label, LV_ALIGN_RIGHT_MID, -5, 0);
+            lv_obj_add_style(minutes_label, &style_bus_minutes, 0);
             
             // Color logic for delay
-            if (data->departures[i].delay_minutes >= 1) {
+            if (data->departures[i].estimated) {
+                // Offline estimate: "~" prefix, grey
+                lv_label_set_text_fmt(minutes_label, "~%s", minutes_text);
+                lv_obj_set_style_text_color(minutes_label, lv_color_hex(0x9E9E9E), 0);
+            } else if (data->departures[i].delay_minutes >= 1) {
                 // Late: Red
-                lv_obj_set_style_text_color(minutes_label, lv_color_hex(0xFF0000), LV_PART_MAIN | LV_STATE_DEFAULT);
+                lv_obj_add_style(minutes_label, &style_minutes_late, 0);
             } else if (data->departures[i].delay_minutes <= -1) {
                 // Early: Green
-                lv_obj_set_style_text_color(minutes_label, lv_color_hex(0x00FF00), LV_PART_MAIN | LV_STATE_DEFAULT);
+                lv_obj_add_style(minutes_label, &style_minutes_early, 0);
             } else {
                 // On time: White
-                lv_obj_set_style_text_color(minutes_label, lv_color_white(), LV_PART_MAIN | LV_STATE_DEFAULT);
+                lv_obj_add_style(minutes_label, &style_minutes_on_time, 0);
             }
         }
+        
+        if (rows > 0) {
+            log_first_departure_render("bus");
+        }
     }
     
     // Update time in footer
@@ -877,6 +1107,9 @@ static void train_list_item_cb(lv_event_t *e)
     // Show details screen (loading)
     lv_obj_clear_flag(train_details_screen, LV_OBJ_FLAG_HIDDEN);
     lv_obj_clear_flag(train_details_loading, LV_OBJ_FLAG_HIDDEN);
+#if LV_PORT_PROFILER_EN
+    lv_port_prof_set_screen(LV_PORT_SCREEN_DETAILS);
+#endif
     lv_obj_add_flag(train_details_view, LV_OBJ_FLAG_HIDDEN);
     
     // Request details fetch
@@ -907,6 +1140,9 @@ static void details_close_btn_cb(lv_event_t *e)
 {
     // Hide details screen
     lv_obj_add_flag(train_details_screen, LV_OBJ_FLAG_HIDDEN);
+#if LV_PORT_PROFILER_EN
+    lv_port_prof_set_screen(LV_PORT_SCREEN_TRAIN);
+#endif
     
     // Clear data in model
     transport_data_clear_train_details();
@@ -942,35 +1178,29 @@ static void update_train_screen(const struct view_data_train_station *data)
     if (train_list) {
         lv_obj_clean(train_list);
         
+        int rows = 0;
+        
         for (int i = 0; i < data->count && i < MAX_DEPARTURES; i++) {
             if (!data->departures[i].valid) continue;
             
             // Row Item - Clickable!
             lv_obj_t *item = lv_btn_create(train_list); // Changed from obj to btn
-            lv_obj_set_size(item, LV_PCT(100), 40);
-            lv_obj_set_style_bg_opa(item, LV_OPA_TRANSP, 0);
-            lv_obj_set_style_border_width(item, 0, 0);
-            lv_obj_set_style_border_side(item, LV_BORDER_SIDE_BOTTOM, 0);
-            lv_obj_set_style_border_color(item, lv_color_hex(0x404040), 0);
-            lv_obj_set_style_border_width(item, 1, 0); // Separator line
-            lv_obj_set_style_pad_all(item, 0, 0);
-            lv_obj_set_style_shadow_width(item, 0, 0); // No shadow for button
+            lv_obj_add_style(item, &style_train_row, 0);
             lv_obj_clear_flag(item, LV_OBJ_FLAG_SCROLLABLE);
+            rows++;
             
-            // Allocate memory for journey name to pass as user data
-            char *j_name = lv_mem_alloc(strlen(data->departures[i].journey_name) + 1);
+            // Allocate memory for journey name to pass as user data (none for estimated rows)
+            const char *journey_name = view_str(&data->strings, data->departures[i].journey_name);
+            char *j_name = data->departures[i].estimated ? NULL : lv_mem_alloc(strlen(journey_name) + 1);
             if (j_name) {
-                strcpy(j_name, data->departures[i].journey_name);
+                strcpy(j_name, journey_name);
                 lv_obj_add_event_cb(item, train_list_item_cb, LV_EVENT_CLICKED, j_name);
                 lv_obj_add_event_cb(item, train_list_item_delete_cb, LV_EVENT_DELETE, j_name);
             }
             
             // 1. Train Badge (Line)
             lv_obj_t *badge = lv_obj_create(item);
-            lv_obj_set_size(badge, 50, 30);
-            lv_obj_align(badge, LV_ALIGN_LEFT_MID, 5, 0);
-            lv_obj_set_style_border_width(badge, 0, 0);
-            lv_obj_set_style_radius(badge, 4, 0);
+            lv_obj_add_style(badge, &style_train_badge, 0);
             lv_obj_clear_flag(badge, LV_OBJ_FLAG_SCROLLABLE);
             
             // Color logic:
@@ -978,84 +1208,74 @@ static void update_train_screen(const struct view_data_train_station *data)
             // RE, PE: White bg, Red text (Requested: White background red letters)
             // IC, ICN, VAE, EC: Red bg, White text (Requested: Red background White letters)
             
-            bool is_sbahn = (strncmp(data->departures[i].line, "S", 1) == 0);
-            bool is_re_pe = (strncmp(data->departures[i].line, "RE", 2) == 0 || 
-                             strncmp(data->departures[i].line, "PE", 2) == 0);
-            
-            // Default assumes others are long distance (IC/EC etc) -> Red bg
-            
-            if (is_sbahn) {
-                lv_obj_set_style_bg_color(badge, lv_color_white(), 0);
-            } else if (is_re_pe) {
-                lv_obj_set_style_bg_color(badge, lv_color_white(), 0);
-            } else {
-                // IC, ICN, VAE, EC etc -> Red
-                lv_obj_set_style_bg_color(badge, lv_color_hex(0xEB0000), 0); // Red
-            }
+            const char *line = view_str(&data->strings, data->departures[i].line);
+            bool is_sbahn = (strncmp(line, "S", 1) == 0);
+            bool is_re_pe = (strncmp(line, "RE", 2) == 0 || 
+                             strncmp(line, "PE", 2) == 0);
             
             lv_obj_t *lbl_line = lv_label_create(badge);
-            lv_label_set_text(lbl_line, data->departures[i].line);
-            lv_obj_center(lbl_line);
+            lv_label_set_text(lbl_line, line);
+            lv_obj_add_style(lbl_line, &style_train_line_text, 0);
             
+            // Default assumes others are long distance (IC/EC etc) -> Red bg
             if (is_sbahn) {
-                 lv_obj_set_style_text_color(lbl_line, lv_color_black(), 0); // Black text
+                lv_obj_add_style(badge, &style_train_badge_s, 0);
+                lv_obj_add_style(lbl_line, &style_train_line_text_s, 0);
             } else if (is_re_pe) {
-                 lv_obj_set_style_text_color(lbl_line, lv_color_hex(0xEB0000), 0); // Red text
+                lv_obj_add_style(badge, &style_train_badge_re, 0);
+                lv_obj_add_style(lbl_line, &style_train_line_text_re, 0);
             } else {
-                 lv_obj_set_style_text_color(lbl_line, lv_color_white(), 0); // White text
+                lv_obj_add_style(badge, &style_train_badge_ic, 0);
+                lv_obj_add_style(lbl_line, &style_train_line_text_ic, 0);
             }
-            lv_obj_set_style_text_font(lbl_line, &arimo_16, 0);
             
             // 1.5 Time
             lv_obj_t *lbl_time = lv_label_create(item);
-            lv_label_set_text(lbl_time, data->departures[i].time_str);
-            lv_obj_set_style_text_color(lbl_time, lv_color_white(), 0);
-            lv_obj_set_style_text_font(lbl_time, &arimo_16, 0);
-            lv_obj_align(lbl_time, LV_ALIGN_LEFT_MID, 65, 0);
+            unsigned time_min = data->departures[i].time_min;
+            lv_label_set_text_fmt(lbl_time, "%02u:%02u", time_min / 60, time_min % 60);
+            lv_obj_add_style(lbl_time, &style_train_time, 0);
 
             // 2. Destination & Via
             lv_obj_t *dest_cont = lv_obj_create(item);
-            lv_obj_set_size(dest_cont, 220, 40);
-            lv_obj_align(dest_cont, LV_ALIGN_LEFT_MID, 120, 0);
-            lv_obj_set_style_bg_opa(dest_cont, LV_OPA_TRANSP, 0);
-            lv_obj_set_style_border_width(dest_cont, 0, 0);
-            lv_obj_set_style_pad_all(dest_cont, 0, 0);
+            lv_obj_add_style(dest_cont, &style_train_dest_cont, 0);
             lv_obj_clear_flag(dest_cont, LV_OBJ_FLAG_SCROLLABLE);
 
             lv_obj_t *lbl_dest = lv_label_create(dest_cont);
-            lv_label_set_text(lbl_dest, data->departures[i].destination);
-            lv_obj_set_style_text_color(lbl_dest, lv_color_white(), 0);
-            lv_obj_set_style_text_font(lbl_dest, &arimo_16, 0);
-            lv_obj_align(lbl_dest, LV_ALIGN_TOP_LEFT, 0, 2);
-            lv_obj_set_width(lbl_dest, 220);
+            lv_label_set_text(lbl_dest, view_str(&data->strings, data->departures[i].destination));
+            lv_obj_add_style(lbl_dest, &style_train_dest, 0);
             lv_label_set_long_mode(lbl_dest, LV_LABEL_LONG_CLIP);
             
-            if (data->departures[i].via[0]) {
+            const char *via = view_str(&data->strings, data->departures[i].via);
+            if (via[0]) {
                 lv_obj_t *lbl_via = lv_label_create(dest_cont);
-                lv_label_set_text(lbl_via, data->departures[i].via);
-                lv_obj_set_style_text_color(lbl_via, lv_color_hex(0xAAAAAA), 0); // Grey
-                lv_obj_set_style_text_font(lbl_via, &arimo_14, 0);
-                lv_obj_align(lbl_via, LV_ALIGN_BOTTOM_LEFT, 0, -2);
-                lv_obj_set_width(lbl_via, 220);
+                lv_label_set_text(lbl_via, via);
+                lv_obj_add_style(lbl_via, &style_train_via, 0);
                 lv_label_set_long_mode(lbl_via, LV_LABEL_LONG_SCROLL_CIRCULAR);
             }
 
             // 3. Platform
             lv_obj_t *lbl_plat = lv_label_create(item);
-            lv_label_set_text(lbl_plat, data->departures[i].platform);
-            lv_obj_set_style_text_color(lbl_plat, lv_color_white(), 0);
-            lv_obj_align(lbl_plat, LV_ALIGN_RIGHT_MID, -80, 0);
+            lv_label_set_text(lbl_plat, view_str(&data->strings, data->departures[i].platform));
+            lv_obj_add_style(lbl_plat, &style_train_platform, 0);
             
-            // 4. Info - Delay
-            if (data->departures[i].delay_minutes > 0) {
+            // 4. Info - Delay, or estimate marker while offline
+            if (data->departures[i].estimated) {
+                 lv_label_set_text_fmt(lbl_time, "~%02u:%02u", time_min / 60, time_min % 60);
+                 lv_obj_t *lbl_info = lv_label_create(item);
+                 lv_label_set_text(lbl_info, "estimated");
+                 lv_obj_add_style(lbl_info, &style_train_via, 0);
+            } else if (data->departures[i].delay_minutes > 0) {
                  lv_obj_t *lbl_info = lv_label_create(item);
                  char buf[32];
                  snprintf(buf, sizeof(buf), "approx. +%d'", data->departures[i].delay_minutes);
                  lv_label_set_text(lbl_info, buf);
-                 lv_obj_set_style_text_color(lbl_info, lv_color_hex(0xFFD700), 0); // Yellow
-                 lv_obj_align(lbl_info, LV_ALIGN_RIGHT_MID, -10, 0);
+                 lv_obj_add_style(lbl_info, &style_train_delay, 0);
             }
         }
+        
+        if (rows > 0) {
+            log_first_departure_render("train");
+        }
     }
     
     lv_port_sem_give();
@@ -1547,7 +1767,9 @@ static void wifi_btn_cb(lv_event_t *e)
     lv_obj_add_flag(settings_main_cont, LV_OBJ_FLAG_HIDDEN);
     lv_obj_clear_flag(wifi_view_cont, LV_OBJ_FLAG_HIDDEN);
     update_wifi_network_info();
-    // Request scan immediately
+    // Request scan immediately, cached networks are posted back before it starts
+    wifi_list_req_us = esp_timer_get_time();
+    wifi_list_cached_logged = false;
     esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_WIFI_LIST_REQ, NULL, 0, portMAX_DELAY);
 }
 
@@ -1618,6 +1840,16 @@ static void sysinfo_back_btn_cb(lv_event_t *e)
     lv_obj_clear_flag(settings_main_cont, LV_OBJ_FLAG_HIDDEN);
 }
 
+#if LV_PORT_PROFILER_EN
+/**
+ * @brief System Info "Log frame stats" Button Callback
+ */
+static void sysinfo_prof_dump_btn_cb(lv_event_t *e)
+{
+    lv_port_prof_dump();
+}
+#endif
+
 /**
  * @brief WiFi Scan/Refresh Button Callback
  */
@@ -1628,6 +1860,8 @@ static void wifi_scan_btn_cb(lv_event_t *e)
     lv_label_set_text(loading, "Scanning...");
     lv_obj_set_style_text_color(loading, lv_color_white(), 0);
     
+    wifi_list_req_us = esp_timer_get_time();
+    wifi_list_cached_logged = false;
     esp_event_post_to(view_event_handle, VIEW_EVENT_BASE, VIEW_EVENT_WIFI_LIST_REQ, NULL, 0, portMAX_DELAY);
 }
 
@@ -1925,6 +2159,19 @@ static void update_wifi_list(const struct view_data_wifi_list *list)
     
     lv_port_sem_take();
     lv_obj_clean(wifi_list);
+
+    if (list->scanning || list->cnt == 0) {
+        lv_obj_t *status = lv_label_create(wifi_list);
+        if (!list->scanning) {
+            lv_label_set_text(status, "No networks found");
+        } else if (list->age_s >= 60) {
+            lv_label_set_text_fmt(status, "Scanning... (list from %lu min ago)", (unsigned long)(list->age_s / 60));
+        } else {
+            lv_label_set_text(status, "Scanning...");
+        }
+        lv_obj_set_style_text_color(status, lv_color_hex(0xAAAAAA), 0);
+        lv_obj_set_style_text_font(status, &arimo_14, 0);
+    }
     
     for (int i = 0; i < list->cnt; i++) {
         lv_obj_t *btn = lv_btn_create(wifi_list);
@@ -1950,6 +2197,21 @@ static void update_wifi_list(const struct view_data_wifi_list *list)
         lv_obj_set_style_text_font(lbl_rssi, &arimo_14, 0);
     }
     lv_port_sem_give();
+
+    // Time to first entry: cached list and first live scan result are logged separately
+    if (wifi_list_req_us && list->cnt > 0) {
+        int64_t ms = (esp_timer_get_time() - wifi_list_req_us) / 1000;
+        if (list->age_s == 0) {
+            ESP_LOGI(TAG, "WiFi list first scanned entry after %lld ms", ms);
+            wifi_list_req_us = 0;
+        } else if (!wifi_list_cached_logged) {
+            ESP_LOGI(TAG, "WiFi list first cached entry after %lld ms (%lu s old)", ms, (unsigned long)list->age_s);
+            wifi_list_cached_logged = true;
+        }
+    }
+    if (!list->scanning) {
+        wifi_list_req_us = 0;
+    }
 }
 
 /**
@@ -2541,6 +2803,60 @@ static void create_sysinfo_screen(lv_obj_t *parent)
     lv_obj_set_style_text_font(sysinfo_versions_label, &arimo_14, 0);
     lv_obj_set_style_text_color(sysinfo_versions_label, lv_color_white(), 0);
 
+    // Connections section: setup cost of API requests, with and without a TLS session ticket
+    lv_obj_t *conn_header = lv_label_create(scroll_cont);
+    lv_label_set_text(conn_header, "\nConnections (avg/max ms):");
+    lv_obj_set_style_text_font(conn_header, &arimo_20, 0);
+    lv_obj_set_style_text_color(conn_header, lv_color_hex(0x00FF00), 0);
+
+    sysinfo_conn_label = lv_label_create(scroll_cont);
+    lv_label_set_text(sysinfo_conn_label, "No requests yet");
+    lv_obj_set_style_text_font(sysinfo_conn_label, &arimo_14, 0);
+    lv_obj_set_style_text_color(sysinfo_conn_label, lv_color_white(), 0);
+
+    // Storage section: settings writes vs what reached flash
+    lv_obj_t *storage_header = lv_label_create(scroll_cont);
+    lv_label_set_text(storage_header, "\nStorage:");
+    lv_obj_set_style_text_font(storage_header, &arimo_20, 0);
+    lv_obj_set_style_text_color(storage_header, lv_color_hex(0x00FF00), 0);
+
+    sysinfo_storage_label = lv_label_create(scroll_cont);
+    lv_label_set_text(sysinfo_storage_label, "Loading...");
+    lv_obj_set_style_text_font(sysinfo_storage_label, &arimo_14, 0);
+    lv_obj_set_style_text_color(sysinfo_storage_label, lv_color_white(), 0);
+
+    // Boot section: when each startup stage was reached
+    lv_obj_t *boot_header = lv_label_create(scroll_cont);
+    lv_label_set_text(boot_header, "\nBoot (ms after app start):");
+    lv_obj_set_style_text_font(boot_header, &arimo_20, 0);
+    lv_obj_set_style_text_color(boot_header, lv_color_hex(0x00FF00), 0);
+
+    sysinfo_boot_label = lv_label_create(scroll_cont);
+    lv_label_set_text(sysinfo_boot_label, "Loading...");
+    lv_obj_set_style_text_font(sysinfo_boot_label, &arimo_14, 0);
+    lv_obj_set_style_text_color(sysinfo_boot_label, lv_color_white(), 0);
+
+#if LV_PORT_PROFILER_EN
+    // Rendering section: per screen frame cost from the LVGL port profiler
+    lv_obj_t *render_header = lv_label_create(scroll_cont);
+    lv_label_set_text(render_header, "\nRendering (avg/max ms):");
+    lv_obj_set_style_text_font(render_header, &arimo_20, 0);
+    lv_obj_set_style_text_color(render_header, lv_color_hex(0x00FF00), 0);
+
+    sysinfo_render_label = lv_label_create(scroll_cont);
+    lv_label_set_text(sysinfo_render_label, "No frames yet");
+    lv_obj_set_style_text_font(sysinfo_render_label, &arimo_14, 0);
+    lv_obj_set_style_text_color(sysinfo_render_label, lv_color_white(), 0);
+
+    lv_obj_t *dump_btn = lv_btn_create(scroll_cont);
+    lv_obj_set_size(dump_btn, LV_PCT(90), 40);
+    lv_obj_add_event_cb(dump_btn, sysinfo_prof_dump_btn_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *dump_lbl = lv_label_create(dump_btn);
+    lv_label_set_text(dump_lbl, "Log frame stats to serial");
+    lv_obj_set_style_text_font(dump_lbl, &arimo_16, 0);
+    lv_obj_center(dump_lbl);
+#endif
+
     // About section
     lv_obj_t *about_header = lv_label_create(scroll_cont);
     lv_label_set_text(about_header, "\nAbout:");
@@ -2605,6 +2921,60 @@ static void update_sysinfo_screen(const struct view_data_system_info *info)
             info->app_version, info->idf_version);
     lv_label_set_text(sysinfo_versions_label, buf);
 
+    // Connections
+    struct network_manager_http_stats hs;
+    if (network_manager_get_http_stats(&hs) == ESP_OK &&
+        (hs.full.count || hs.ticket.count || hs.reused)) {
+        snprintf(buf, sizeof(buf), "New: %lu, %lu/%lu\nTicket offered: %lu, %lu/%lu\nReused: %lu",
+                 (unsigned long)hs.full.count,
+                 (unsigned long)(hs.full.count ? hs.full.total_ms / hs.full.count : 0),
+                 (unsigned long)hs.full.max_ms,
+                 (unsigned long)hs.ticket.count,
+                 (unsigned long)(hs.ticket.count ? hs.ticket.total_ms / hs.ticket.count : 0),
+                 (unsigned long)hs.ticket.max_ms,
+                 (unsigned long)hs.reused);
+        lv_label_set_text(sysinfo_conn_label, buf);
+    }
+
+    // Storage
+    struct indicator_storage_stats ss;
+    if (indicator_storage_get_stats(&ss) == ESP_OK) {
+        snprintf(buf, sizeof(buf), "Writes: %lu (%lu unchanged, %lu merged)\nTo flash: %lu, commits: %lu\nEntries erased: %lu, used/free: %u/%u",
+                 (unsigned long)ss.writes, (unsigned long)ss.writes_unchanged,
+                 (unsigned long)ss.writes_coalesced, (unsigned long)ss.blob_writes,
+                 (unsigned long)ss.commits, (unsigned long)ss.entries_erased,
+                 (unsigned)ss.used_entries, (unsigned)ss.free_entries);
+        lv_label_set_text(sysinfo_storage_label, buf);
+    }
+
+    // Boot
+    char boot_buf[BOOT_STAGE_MAX * 24];
+    if (boot_timeline_format(boot_buf, sizeof(boot_buf)) > 0) {
+        lv_label_set_text(sysinfo_boot_label, boot_buf);
+    }
+
+#if LV_PORT_PROFILER_EN
+    // Rendering: one line per screen that has drawn frames
+    char render_buf[LV_PORT_SCREEN_MAX * 96];
+    size_t len = 0;
+    render_buf[0] = '\0';
+    for (int i = 0; i < LV_PORT_SCREEN_MAX; i++) {
+        lv_port_prof_stats_t st;
+        lv_port_prof_get_stats((lv_port_screen_t)i, &st);
+        if (st.frames == 0) continue;
+        len += snprintf(render_buf + len, sizeof(render_buf) - len,
+                        "%s%s: %lu fr, draw %.1f/%.1f, flush %.1f/%.1f, sync %.1f/%.1f, %llu areas",
+                        len ? "\n" : "", lv_port_prof_screen_name((lv_port_screen_t)i),
+                        (unsigned long)st.frames,
+                        st.render_us / (float)st.frames / 1000.0f, st.render_max_us / 1000.0f,
+                        st.flush_us / (float)st.frames / 1000.0f, st.flush_max_us / 1000.0f,
+                        st.sync_us / (float)st.frames / 1000.0f, st.sync_max_us / 1000.0f,
+                        st.inv_areas / st.frames);
+        if (len >= sizeof(render_buf)) break;
+    }
+    lv_label_set_text(sysinfo_render_label, len ? render_buf : "No frames yet");
+#endif
+
     // About
     snprintf(buf, sizeof(buf), "Author: %s", info->author);
     lv_label_set_text(sysinfo_author_label, buf);
@@ -2956,6 +3326,10 @@ static void view_event_handler(void* handler_args, esp_event_base_t base,
             transport_data_refresh_train();
             break;
         }
+        case VIEW_EVENT_TRANSPORT_SELECTION: {
+            restore_transport_selection((const struct view_data_transport_selection *)event_data);
+            break;
+        }
         case VIEW_EVENT_WIFI_LIST: {
             const struct view_data_wifi_list *list = (const struct view_data_wifi_list *)event_data;
             update_wifi_list(list);
@@ -2990,6 +3364,8 @@ int indicator_view_init(void)
 {
     ESP_LOGI(TAG, "Initializing view...");
     
+    init_row_styles();
+    
     // Create tabview for navigation - hidden top bar (full screen)
     tabview = lv_tabview_create(lv_scr_act(), LV_DIR_TOP, 0);
     lv_obj_add_event_cb(tabview, tabview_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
@@ -3089,6 +3465,9 @@ int indicator_view_init(void)
     esp_event_handler_instance_register_with(view_event_handle, VIEW_EVENT_BASE,
                                             VIEW_EVENT_TRAIN_REFRESH,
                                             view_event_handler, NULL, NULL);
+    esp_event_handler_instance_register_with(view_event_handle, VIEW_EVENT_BASE,
+                                            VIEW_EVENT_TRANSPORT_SELECTION,
+                                            view_event_handler, NULL, NULL);
     esp_event_handler_instance_register_with(view_event_handle, VIEW_EVENT_BASE,
                                             VIEW_EVENT_WIFI_ST,
                                             view_event_handler, NULL, NULL);
@@ -2,6 +2,7 @@
 #define VIEW_DATA_H
 
 #include "config.h"
+#include <stddef.h>
 #include <time.h>
 
 #ifdef __cplusplus
@@ -22,6 +23,7 @@ enum start_screen {
 #define MAX_BUS_LINES 10
 #define MAX_TRAIN_LINES 20
 #define MAX_DIRECTIONS 5  // Maximum number of distinct directions to track
+#define VIEW_STRTAB_SIZE 3072   // String table bytes per board snapshot
 
 // WiFi structures
 struct view_data_wifi_st {
@@ -64,6 +66,8 @@ struct view_data_wifi_list {
     struct view_data_wifi_item  connect;
     uint16_t cnt;
     struct view_data_wifi_item aps[WIFI_SCAN_LIST_SIZE];
+    bool  scanning;    // More results follow
+    uint32_t age_s;    // Seconds since the last full scan, 0 for live results
 };
 
 struct view_data_wifi_connet_ret_msg {
@@ -101,31 +105,51 @@ struct view_data_time_cfg {
     bool    daylight;
 } __attribute__((packed));
 
+/*
+ * Board snapshots keep their strings (lines, destinations, via lists,
+ * platforms, journey names) once each in a string table at the end of the
+ * snapshot; departures refer to them by offset. Only the used part of the
+ * table is copied and posted, see view_data_*_size().
+ */
+typedef uint16_t view_str_t;    // Offset into the snapshot's string table, 0 is ""
+
+struct view_strtab {
+    uint16_t used;              // Bytes in use, offset 0 holds the empty string
+    char buf[VIEW_STRTAB_SIZE];
+};
+
+static inline const char *view_str(const struct view_strtab *t, view_str_t s)
+{
+    return (s < t->used) ? &t->buf[s] : "";
+}
+
 // Bus departure structure
 struct bus_departure_view {
-    char line[16];              // Bus line number (e.g., "1", "4", "12")
-    char destination[64];       // Final destination
-    char time_str[6];           // Time as "HH:MM"
+    view_str_t line;            // Bus line number (e.g., "1", "4", "12")
+    view_str_t destination;     // Final destination
+    view_str_t journey_name;    // Unique journey reference
+    uint16_t time_min;          // Scheduled local time as minutes after midnight ("HH:MM")
     time_t departure_timestamp; // Exact departure timestamp for sorting and recalculation
-    int minutes_until;          // Minutes until departure
-    int delay_minutes;          // Delay in minutes (negative = early, positive = late)
-    int direction_index;        // Index in directions array
+    int16_t minutes_until;      // Minutes until departure
+    int16_t delay_minutes;      // Delay in minutes (negative = early, positive = late)
+    int8_t direction_index;     // Index in directions array
     bool valid;
-    char journey_name[64];      // Unique journey reference
+    bool estimated;             // Synthesised from the timetable history while offline
 };
 
 // Train departure structure
 struct train_departure_view {
-    char line[16];              // Train line (e.g., "S12", "IC3", "RE")
-    char destination[64];       // Final destination
-    char via[128];              // Intermediate stations
-    char platform[16];          // Platform number (e.g., "1", "4", "12")
-    char time_str[6];           // Scheduled time as "HH:MM"
+    view_str_t line;            // Train line (e.g., "S12", "IC3", "RE")
+    view_str_t destination;     // Final destination
+    view_str_t via;             // Intermediate stations
+    view_str_t platform;        // Platform number (e.g., "1", "4", "12")
+    view_str_t journey_name;    // Unique journey reference (e.g. "S11 19055")
+    uint16_t time_min;          // Scheduled local time as minutes after midnight ("HH:MM")
     time_t departure_timestamp; // Exact departure timestamp for sorting
-    int minutes_until;          // Minutes until departure
-    int delay_minutes;          // Delay in minutes (0 if on time)
+    int16_t minutes_until;      // Minutes until departure
+    int16_t delay_minutes;      // Delay in minutes (0 if on time)
     bool valid;
-    char journey_name[64];      // Unique journey reference (e.g. "S11 19055")
+    bool estimated;             // Synthesised from the timetable history while offline
 };
 
 // Train details structure (stops/capacity)
@@ -168,12 +192,13 @@ struct view_data_bus_countdown {
     int count;
     
     // Dynamic directions
-    char directions[MAX_DIRECTIONS][64]; // Names of directions (e.g. "Next stop: Bahnhof")
-    int direction_count;                 // Number of valid directions found
+    view_str_t directions[MAX_DIRECTIONS]; // Names of directions (e.g. "Direction: Bahnhof")
+    int direction_count;                   // Number of valid directions found
     
     time_t update_time;
     bool api_error;
     char error_msg[64];
+    struct view_strtab strings; // Must stay last, copies end after strings.used
 };
 
 // Screen B: Train Station Board
@@ -184,6 +209,28 @@ struct view_data_train_station {
     time_t update_time;
     bool api_error;
     char error_msg[64];
+    struct view_strtab strings; // Must stay last, copies end after strings.used
+};
+
+// Bytes of a board snapshot that are in use: everything up to the end of the string table's contents
+static inline size_t view_data_bus_countdown_size(const struct view_data_bus_countdown *d)
+{
+    return offsetof(struct view_data_bus_countdown, strings.buf) + d->strings.used;
+}
+
+static inline size_t view_data_train_station_size(const struct view_data_train_station *d)
+{
+    return offsetof(struct view_data_train_station, strings.buf) + d->strings.used;
+}
+
+// Stop/station picked on the selection screens, restored at boot
+struct view_data_transport_selection {
+    bool bus_selected;
+    char bus_stop_name[64];
+    char bus_stop_id[32];
+    bool train_selected;
+    char train_station_name[64];
+    char train_station_id[32];
 };
 
 // Settings screen data
@@ -253,6 +300,7 @@ enum {
     VIEW_EVENT_TRANSPORT_REFRESH,       // NULL - trigger manual refresh all
     VIEW_EVENT_BUS_REFRESH,             // NULL - trigger manual refresh bus
     VIEW_EVENT_TRAIN_REFRESH,           // NULL - trigger manual refresh train
+    VIEW_EVENT_TRANSPORT_SELECTION,     // struct view_data_transport_selection - restored at boot
     VIEW_EVENT_TRAIN_DETAILS_REQ,       // char* journey_name - request details
     VIEW_EVENT_BUS_DETAILS_UPDATE,      // struct view_data_bus_details
     VIEW_EVENT_BUS_DETAILS_REQ,         // char* journey_name - request details